@@ -33,11 +33,22 @@
 + (NSHTTPCookie *) validateCookie: (NSHTTPCookie *) cookie forURL: (NSURL *) theURL;
 + (NSArray *) cookiesWithResponseHeaderFields: (NSDictionary *) headerFields forURL: (NSURL *) theURL;
 
+- (instancetype) initWithMaxCookies: (NSUInteger) maxCookies maxCookiesPerDomain: (NSUInteger) maxCookiesPerDomain;
+- (instancetype) initSharded;
+- (instancetype) initShardedWithMaxCookies: (NSUInteger) maxCookies maxCookiesPerDomain: (NSUInteger) maxCookiesPerDomain;
+
 - (void) setCookie: (NSHTTPCookie *) aCookie;
 - (void) deleteCookie: (NSHTTPCookie *) aCookie;
 
 - (NSArray *) cookiesForURL: (NSURL *) theURL;
+- (NSDictionary *) requestHeaderFieldsForURL: (NSURL *) theURL;
 
 - (void) deleteAllCookies;
 
+/** The maximum number of cookies held by the jar, across all shards if the jar is sharded. */
+@property(nonatomic, readonly) NSUInteger maxCookies;
+
+/** The maximum number of cookies held by the jar for any one registrable domain. */
+@property(nonatomic, readonly) NSUInteger maxCookiesPerDomain;
+
 @end
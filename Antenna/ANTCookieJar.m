@@ -27,241 +27,1948 @@
  */
 
 #import "ANTCookieJar.h"
+#import "ANTCookieTrie.h"
+#import "ANTEpoch.h"
+#import "ANTPersistentMap.h"
+#import "ANTPublicSuffix.h"
+#import "ANTSetCookie.h"
 #import <PLFoundation/PLFoundation.h>
 
-#import "ANTEffectiveTLDNames.c"
+/** Size of the on-stack buffers used to validate cookie domains; large enough for any valid DNS name. */
+#define ANT_COOKIE_JAR_DOMAIN_BUFSIZE 256
 
-typedef enum {
-    /** A standard TLD rule */
-    TLDRuleTypeStandard = 0,
+/**
+ * @internal
+ *
+ * Write the lowercase ASCII form of the domain name @a string to @a buffer, which must be at least
+ * ANT_COOKIE_JAR_DOMAIN_BUFSIZE bytes in size. This is the form used by the public suffix table; internationalized
+ * labels (U-labels) are case folded, NFC normalized, and converted to punycode A-labels, while ASCII labels (including
+ * existing A-labels) are lowercased.
+ *
+ * Names that are already ASCII, such as hosts returned by NSURL, are copied and lowercased directly, without being
+ * decoded or normalized.
+ *
+ * @param string The string to convert.
+ * @param buffer The destination buffer. The result will not be NUL terminated.
+ * @param length On return, the length of the ASCII data.
+ * @param converted If non-NULL, on return, set to YES if @a string contained non-ASCII characters.
+ *
+ * @return Returns NO if @a string is nil, can not be converted, or its ASCII form does not fit within @a buffer.
+ */
+static BOOL ANTCookieJarCopyLowercaseASCII (NSString *string, char *buffer, size_t *length, BOOL *converted) {
+    if (string == nil)
+        return NO;
+
+    CFStringRef cfstr = (__bridge CFStringRef) string;
+    CFRange range = CFRangeMake(0, CFStringGetLength(cfstr));
+    CFIndex used = 0;
+
+    /* Fast path: ASCII names need only be lowercased */
+    if (CFStringGetBytes(cfstr, range, kCFStringEncodingASCII, 0, false, (UInt8 *) buffer, ANT_COOKIE_JAR_DOMAIN_BUFSIZE, &used) == range.length) {
+        ANTPublicSuffixLowercaseASCII(buffer, used);
+        *length = used;
+        if (converted != NULL)
+            *converted = NO;
+        return YES;
+    } else if (range.length >= ANT_COOKIE_JAR_DOMAIN_BUFSIZE) {
+        /* Every character requires at least one byte in the ASCII form */
+        return NO;
+    }
+
+    /* Apply the IDNA mapping to the U-labels: case fold, normalize, and map the ideographic full stops to '.' */
+    CFMutableStringRef mapped = CFStringCreateMutableCopy(NULL, 0, cfstr);
+    CFStringLowercase(mapped, NULL);
+    CFStringNormalize(mapped, kCFStringNormalizationFormC);
+    CFStringFindAndReplace(mapped, CFSTR("\u3002"), CFSTR("."), CFRangeMake(0, CFStringGetLength(mapped)), 0);
+    CFStringFindAndReplace(mapped, CFSTR("\uFF0E"), CFSTR("."), CFRangeMake(0, CFStringGetLength(mapped)), 0);
+    CFStringFindAndReplace(mapped, CFSTR("\uFF61"), CFSTR("."), CFRangeMake(0, CFStringGetLength(mapped)), 0);
+
+    /* Each UTF-16 code unit requires at most three UTF-8 bytes */
+    char utf8[ANT_COOKIE_JAR_DOMAIN_BUFSIZE * 3];
+    range = CFRangeMake(0, CFStringGetLength(mapped));
+    CFIndex count = CFStringGetBytes(mapped, range, kCFStringEncodingUTF8, 0, false, (UInt8 *) utf8, sizeof(utf8), &used);
+    CFRelease(mapped);
+
+    if (count != range.length)
+        return NO;
+
+    if (!ANTPublicSuffixCopyASCIIName(utf8, used, buffer, ANT_COOKIE_JAR_DOMAIN_BUFSIZE, length))
+        return NO;
+
+    if (converted != NULL)
+        *converted = YES;
+    return YES;
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a cookie with its domain replaced by @a host.
+ */
+static NSHTTPCookie *ANTCookieJarReplaceDomain (NSHTTPCookie *cookie, NSString *host) {
+    NSMutableDictionary *props = [[cookie properties] mutableCopy];
+    [props setObject: host forKey: NSHTTPCookieDomain];
+    return [NSHTTPCookie cookieWithProperties: props];
+}
+
+/**
+ * @internal
+ *
+ * Per-response state used to construct cookies from Set-Cookie headers. The host's public suffix is computed once,
+ * and shared by all cookies in the response. The referenced objects must be retained by the caller.
+ */
+typedef struct ANTCookieJarResponseContext {
+    /** The response URL's host */
+    __unsafe_unretained NSString *host;
+
+    /** The lowercase UTF-8 representation of host */
+    char hostBuffer[ANT_COOKIE_JAR_DOMAIN_BUFSIZE];
+    size_t hostLength;
+
+    /** YES if the host is an IP address literal */
+    BOOL hostIsAddress;
+
+    /** The length of the host's public suffix, and whether it was determined by a known rule */
+    size_t suffixLength;
+    bool suffixKnown;
+
+    /** The default cookie path for the response URL */
+    __unsafe_unretained NSString *defaultPath;
+
+    /** The time at which the response was processed */
+    CFAbsoluteTime now;
+} ANTCookieJarResponseContext;
+
+/**
+ * @internal
+ *
+ * Return a new string containing the bytes of @a span, or nil if the span is absent.
+ */
+static NSString *ANTCookieJarStringWithSpan (ANTSetCookieSpan span) {
+    if (span.bytes == NULL)
+        return nil;
+
+    /* Fall back on ISO Latin 1 for header values that are not valid UTF-8 */
+    CFStringRef str = CFStringCreateWithBytes(NULL, (const UInt8 *) span.bytes, span.length, kCFStringEncodingUTF8, false);
+    if (str == NULL)
+        str = CFStringCreateWithBytes(NULL, (const UInt8 *) span.bytes, span.length, kCFStringEncodingISOLatin1, false);
+
+    return CFBridgingRelease(str);
+}
+
+/**
+ * @internal
+ *
+ * Return the RFC 6265 default cookie path for @a theURL: the URL's path, up to but not including its final '/'.
+ */
+static NSString *ANTCookieJarDefaultPath (NSURL *theURL) {
+    NSString *path = CFBridgingRelease(CFURLCopyPath((__bridge CFURLRef) theURL));
+    if (path.length == 0 || [path characterAtIndex: 0] != '/')
+        return @"/";
+
+    NSRange slash = [path rangeOfString: @"/" options: NSBackwardsSearch];
+    if (slash.location == 0)
+        return @"/";
+
+    return [path substringToIndex: slash.location];
+}
+
+/**
+ * @internal
+ *
+ * Determine the domain for a cookie with the given Domain attribute, applying the same rules as
+ * ANTCookieJar::validateCookie:forURL:.
+ *
+ * As the cookie domain must be a suffix of the response host, the public suffix of the domain is
+ * equal to the host's whenever the domain has more labels than the host's public suffix; the suffix
+ * computed once for the response may be used for every cookie.
+ *
+ * @param ctx The response context.
+ * @param domain The cookie's Domain attribute, or an absent span.
+ *
+ * @return Returns the cookie domain, or nil if the cookie must be discarded.
+ */
+static NSString *ANTCookieJarResolveDomain (const ANTCookieJarResponseContext *ctx, ANTSetCookieSpan domain) {
+    /* Host-only cookie */
+    if (domain.bytes == NULL)
+        return ctx->host;
+
+    /* If the URL uses an IP address, the cookie domain must also. */
+    if (ctx->hostIsAddress)
+        return ctx->host;
+
+    /* A leading '.' is implied */
+    if (domain.length > 0 && domain.bytes[0] == '.') {
+        domain.bytes++;
+        domain.length--;
+    }
+
+    /* The domain may not exceed the maximum DNS name length (including the '.' prefix) */
+    char labels[ANT_COOKIE_JAR_DOMAIN_BUFSIZE];
+    size_t labelsLength = domain.length;
+    labels[0] = '.';
+
+    if (ANTPublicSuffixIsASCII(domain.bytes, domain.length)) {
+        if (labelsLength == 0 || labelsLength >= sizeof(labels))
+            return nil;
+
+        memcpy(labels + 1, domain.bytes, labelsLength);
+        ANTPublicSuffixLowercaseASCII(labels + 1, labelsLength);
+    } else {
+        /* Internationalized domains are matched in their ASCII form */
+        char ascii[ANT_COOKIE_JAR_DOMAIN_BUFSIZE];
+        if (!ANTCookieJarCopyLowercaseASCII(ANTCookieJarStringWithSpan(domain), ascii, &labelsLength, NULL))
+            return nil;
+
+        if (labelsLength == 0 || labelsLength >= sizeof(labels))
+            return nil;
+
+        memcpy(labels + 1, ascii, labelsLength);
+    }
+
+    /* If the domain is not a suffix of the URL's host, the cookie domain is invalid; the cookie will be ignored. */
+    const char *hostBuffer = ctx->hostBuffer;
+    size_t hostLength = ctx->hostLength;
+    if (labelsLength > hostLength || memcmp(hostBuffer + (hostLength - labelsLength), labels + 1, labelsLength) != 0)
+        return nil;
+
+    if (labelsLength < hostLength && hostBuffer[hostLength - labelsLength - 1] != '.')
+        return nil;
+
+    /* The domain must not be a public suffix, and must be within a known public suffix; otherwise, the cookie is
+     * reset to be hostname-only. */
+    if (!ctx->suffixKnown || labelsLength <= ctx->suffixLength)
+        return ctx->host;
+
+    return CFBridgingRelease(CFStringCreateWithBytes(NULL, (const UInt8 *) labels, labelsLength + 1, kCFStringEncodingUTF8, false));
+}
+
+/**
+ * @internal
+ *
+ * Construct a cookie from @a parsed, returning nil if the cookie is invalid for the response.
+ */
+static NSHTTPCookie *ANTCookieJarCreateCookie (const ANTCookieJarResponseContext *ctx, const ANTSetCookie *parsed) {
+    NSString *domain = ANTCookieJarResolveDomain(ctx, parsed->domain);
+    if (domain == nil)
+        return nil;
+
+    NSString *name = ANTCookieJarStringWithSpan(parsed->name);
+    NSString *value = ANTCookieJarStringWithSpan(parsed->value);
+    if (name == nil || value == nil)
+        return nil;
+
+    NSString *path = ANTCookieJarStringWithSpan(parsed->path);
+    if (path == nil)
+        path = ctx->defaultPath;
+
+    id keys[9];
+    id objects[9];
+    NSUInteger count = 0;
+
+    keys[count] = NSHTTPCookieName;         objects[count++] = name;
+    keys[count] = NSHTTPCookieValue;        objects[count++] = value;
+    keys[count] = NSHTTPCookieDomain;       objects[count++] = domain;
+    keys[count] = NSHTTPCookiePath;         objects[count++] = path;
+    keys[count] = NSHTTPCookieVersion;      objects[count++] = parsed->version == 1 ? @"1" : @"0";
+
+    /* Max-Age takes precedence over Expires */
+    if (parsed->hasMaxAge) {
+        keys[count] = NSHTTPCookieExpires;
+        objects[count++] = [NSDate dateWithTimeIntervalSinceReferenceDate: ctx->now + parsed->maxAge];
+    } else if (parsed->hasExpires) {
+        keys[count] = NSHTTPCookieExpires;
+        objects[count++] = [NSDate dateWithTimeIntervalSince1970: parsed->expires];
+    }
+
+    if (parsed->secure) {
+        keys[count] = NSHTTPCookieSecure;
+        objects[count++] = @"TRUE";
+    }
+
+    if (parsed->discard) {
+        keys[count] = NSHTTPCookieDiscard;
+        objects[count++] = @"TRUE";
+    }
+
+    if (parsed->httpOnly) {
+        /* NSHTTPCookie does not export a constant for the HttpOnly property */
+        keys[count] = @"HttpOnly";
+        objects[count++] = @"TRUE";
+    }
+
+    return [NSHTTPCookie cookieWithProperties: [NSDictionary dictionaryWithObjects: objects forKeys: keys count: count]];
+}
+
+/**
+ * @internal
+ *
+ * Return YES if @a cookie has expired as of @a now.
+ */
+static inline BOOL ANTCookieJarIsExpired (NSHTTPCookie *cookie, CFAbsoluteTime now) {
+    NSDate *expires = cookie.expiresDate;
+    return expires != nil && [expires timeIntervalSinceReferenceDate] <= now;
+}
+
+/**
+ * @internal
+ *
+ * ANTEpochReleaseFunction that releases a CoreFoundation (or Objective-C) object.
+ */
+static void ANTCookieJarReleaseObject (void *object) {
+    CFRelease(object);
+}
+
+/** The number of sets in a snapshot's request header cache. Must be a power of two. */
+#define ANT_COOKIE_JAR_HEADER_CACHE_SETS 64
+
+/** The number of entries in each set of a snapshot's request header cache. */
+#define ANT_COOKIE_JAR_HEADER_CACHE_WAYS 4
+
+/**
+ * @internal
+ *
+ * A request header cache key. The referenced strings are borrowed from the caller.
+ */
+typedef struct ANTCookieJarHeaderCacheKey {
+    /** The key's hash. */
+    uint64_t hash;
+
+    /** YES if the request is secure. */
+    BOOL secure;
+
+    /** The request host, matched case-insensitively. */
+    __unsafe_unretained NSString *host;
+
+    /** The request path, of which only the first @a pathLength characters are significant. */
+    __unsafe_unretained NSString *path;
+
+    /** The number of significant characters in @a path. */
+    CFIndex pathLength;
+} ANTCookieJarHeaderCacheKey;
+
+/**
+ * @internal
+ *
+ * A cached set of request header fields.
+ */
+@interface ANTCookieJarHeaderCacheEntry : NSObject
+
+- (instancetype) initWithKey: (const ANTCookieJarHeaderCacheKey *) key headers: (NSDictionary *) headers cookies: (NSArray *) cookies accessTime: (CFAbsoluteTime) accessTime;
+
+- (BOOL) matchesKey: (const ANTCookieJarHeaderCacheKey *) key;
+- (BOOL) markAccessed: (CFAbsoluteTime) now;
+- (BOOL) clearReferenced;
+
+/** The hash of the entry's key. */
+@property(nonatomic, readonly) uint64_t keyHash;
+
+/** The serialized request header fields. */
+@property(nonatomic, readonly) NSDictionary *headers;
+
+/** The cookies from which the headers were serialized. */
+@property(nonatomic, readonly) NSArray *cookies;
+
+@end
+
+/**
+ * @internal
+ *
+ * A snapshot's request header cache; a set-associative table of ANTCookieJarHeaderCacheEntry values, replaced using
+ * the CLOCK algorithm.
+ */
+typedef struct ANTCookieJarHeaderCache {
+    /** Retained entries, or NULL. Entries are loaded within an epoch critical section, and retired via ANTEpochRetire()
+     * when replaced. */
+    void * volatile entries[ANT_COOKIE_JAR_HEADER_CACHE_SETS * ANT_COOKIE_JAR_HEADER_CACHE_WAYS];
+
+    /** The way of each set that will next be considered for replacement. Advisory; updated without synchronization. */
+    volatile uint32_t hands[ANT_COOKIE_JAR_HEADER_CACHE_SETS];
+} ANTCookieJarHeaderCache;
+
+/**
+ * @internal
+ *
+ * A cookie's access stamp. Each stamp holds the access time, in whole seconds since the reference date, followed by
+ * ANT_COOKIE_JAR_ACCESS_SEQUENCE_BITS of access sequence number.
+ *
+ * A stamp is shared by every snapshot holding its cookie, and by copies of its jar. Only the jar that owns the stamp
+ * updates it in place, and does so from readers without synchronization; as stamps only inform eviction order, a lost
+ * update is harmless. Any other jar replaces the stamp with one of its own on first access (copy-on-write).
+ */
+@interface ANTCookieJarAccessStamp : NSObject
+
+- (instancetype) initWithCookie: (NSHTTPCookie *) cookie stamp: (uint64_t) stamp owner: (int64_t) owner;
+
+- (uint64_t) stamp;
+- (void) setStamp: (uint64_t) stamp;
+
+/** The stamped cookie. Retaining the cookie ensures its address, which keys the stamp, is not reused. */
+@property(nonatomic, readonly) NSHTTPCookie *cookie;
+
+/** The access stamp owner of the jar that may update the stamp in place. */
+@property(nonatomic, readonly) int64_t owner;
+
+@end
+
+/**
+ * @internal
+ *
+ * An immutable, published cookie jar state.
+ */
+@interface ANTCookieJarSnapshot : NSObject
+
+- (instancetype) initWithTrie: (ANTCookieTrie *) trie
+                 accessStamps: (ANTPersistentMap *) accessStamps
+                   nextExpiry: (CFAbsoluteTime) nextExpiry
+                   generation: (uint64_t) generation
+                 maxPathDepth: (NSUInteger) maxPathDepth;
+
+/** The snapshot's cookies. */
+@property(nonatomic, readonly) ANTCookieTrie *trie;
+
+/** ANTCookieJarAccessStamp values for (at least) every cookie in the snapshot, keyed by cookie address. */
+@property(nonatomic, readonly) ANTPersistentMap *accessStamps;
+
+/** The jar generation at which this snapshot was published. Every published snapshot is assigned a new generation. */
+@property(nonatomic, readonly) uint64_t generation;
+
+/** An upper bound on the number of '/' characters in any cookie path in the snapshot. Request paths that share
+ * a prefix up to and including the next '/' will match an identical set of cookies. */
+@property(nonatomic, readonly) NSUInteger maxPathDepth;
+
+/** The earliest time at which a cookie in the snapshot may expire, or INFINITY if no cookie will expire. Readers
+ * need only check individual cookies for expiry once this time has passed. */
+@property(nonatomic, readonly) CFAbsoluteTime nextExpiry;
+
+- (ANTCookieJarHeaderCacheEntry *) headerCacheEntryForKey: (const ANTCookieJarHeaderCacheKey *) key;
+- (void) addHeaderCacheEntry: (ANTCookieJarHeaderCacheEntry *) entry;
+
+@end
+
+/**
+ * @internal
+ *
+ * Snapshots are immutable, but each holds a request header cache of the header fields serialized from its cookies;
+ * as every modification publishes a new snapshot, cached entries can never be stale. The cache is lock-free:
+ * lookups never block or allocate, and insertions replace entries with a compare-and-swap.
+ */
+@implementation ANTCookieJarSnapshot {
+@private
+    /** The request header cache, allocated on first insertion, or NULL. */
+    ANTCookieJarHeaderCache * volatile _headerCache;
+}
+
+/**
+ * Initialize a new instance.
+ *
+ * @param trie The snapshot's cookies.
+ * @param accessStamps The access stamps of the cookies in @a trie.
+ * @param nextExpiry The earliest time at which a cookie in @a trie may expire, or INFINITY.
+ * @param generation The jar generation of this snapshot.
+ * @param maxPathDepth An upper bound on the number of '/' characters in any cookie path in @a trie.
+ */
+- (instancetype) initWithTrie: (ANTCookieTrie *) trie
+                 accessStamps: (ANTPersistentMap *) accessStamps
+                   nextExpiry: (CFAbsoluteTime) nextExpiry
+                   generation: (uint64_t) generation
+                 maxPathDepth: (NSUInteger) maxPathDepth
+{
+    PLSuperInit();
+
+    _trie = trie;
+    _accessStamps = accessStamps;
+    _nextExpiry = nextExpiry;
+    _generation = generation;
+    _maxPathDepth = maxPathDepth;
+
+    return self;
+}
+
+- (void) dealloc {
+    if (_headerCache == NULL)
+        return;
+
+    for (NSUInteger i = 0; i < ANT_COOKIE_JAR_HEADER_CACHE_SETS * ANT_COOKIE_JAR_HEADER_CACHE_WAYS; i++) {
+        if (_headerCache->entries[i] != NULL)
+            CFRelease(_headerCache->entries[i]);
+    }
+
+    free(_headerCache);
+}
+
+/**
+ * Return the cached request header entry matching @a key, or nil. This will never block.
+ *
+ * @param key The request's cache key.
+ */
+- (ANTCookieJarHeaderCacheEntry *) headerCacheEntryForKey: (const ANTCookieJarHeaderCacheKey *) key {
+    ANTCookieJarHeaderCache *cache = _headerCache;
+    if (cache == NULL)
+        return nil;
+
+    void * volatile *set = cache->entries + (key->hash & (ANT_COOKIE_JAR_HEADER_CACHE_SETS - 1)) * ANT_COOKIE_JAR_HEADER_CACHE_WAYS;
+    ANTCookieJarHeaderCacheEntry *result = nil;
+
+    /* A concurrent insertion will not release the entry it replaces until we've left the critical section */
+    ANTEpochEnter(); {
+        for (NSUInteger i = 0; i < ANT_COOKIE_JAR_HEADER_CACHE_WAYS; i++) {
+            __unsafe_unretained ANTCookieJarHeaderCacheEntry *entry = (__bridge ANTCookieJarHeaderCacheEntry *) set[i];
+            if (entry != nil && [entry matchesKey: key]) {
+                result = entry;
+                break;
+            }
+        }
+    } ANTEpochExit();
+
+    return result;
+}
+
+/**
+ * Add @a entry to the request header cache, replacing an entry of the same set that has not been referenced
+ * since the set's clock hand last passed it. This will never block; if a concurrent insertion replaces the
+ * same entry, @a entry is discarded.
+ *
+ * @param entry The entry to be added.
+ */
+- (void) addHeaderCacheEntry: (ANTCookieJarHeaderCacheEntry *) entry {
+    ANTCookieJarHeaderCache *cache = _headerCache;
+    if (cache == NULL) {
+        ANTCookieJarHeaderCache *allocated = calloc(1, sizeof(ANTCookieJarHeaderCache));
+        if (allocated == NULL)
+            return;
+
+        if (OSAtomicCompareAndSwapPtrBarrier(NULL, allocated, (void * volatile *) &_headerCache)) {
+            cache = allocated;
+        } else {
+            free(allocated);
+            cache = _headerCache;
+        }
+    }
+
+    NSUInteger setIndex = entry.keyHash & (ANT_COOKIE_JAR_HEADER_CACHE_SETS - 1);
+    void * volatile *set = cache->entries + setIndex * ANT_COOKIE_JAR_HEADER_CACHE_WAYS;
+
+    ANTEpochEnter(); {
+        /* Sweep the clock hand over the set, clearing the reference bit of each referenced entry; the first empty or
+         * unreferenced way is replaced. After a full revolution every bit has been cleared, so two suffice. */
+        uint32_t hand = cache->hands[setIndex];
+        NSUInteger way = hand;
+        void *victim = NULL;
+        for (NSUInteger i = 0; i < ANT_COOKIE_JAR_HEADER_CACHE_WAYS * 2; i++) {
+            way = (hand + i) % ANT_COOKIE_JAR_HEADER_CACHE_WAYS;
+            victim = set[way];
+            if (victim == NULL || ![(__bridge ANTCookieJarHeaderCacheEntry *) victim clearReferenced])
+                break;
+        }
+        cache->hands[setIndex] = (uint32_t) ((way + 1) % ANT_COOKIE_JAR_HEADER_CACHE_WAYS);
+
+        void *value = (__bridge_retained void *) entry;
+        if (OSAtomicCompareAndSwapPtrBarrier(victim, value, &set[way])) {
+            if (victim != NULL)
+                ANTEpochRetire(victim, ANTCookieJarReleaseObject);
+        } else {
+            CFRelease(value);
+        }
+    } ANTEpochExit();
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * A cookie expiry index entry.
+ */
+@interface ANTCookieJarExpiryEntry : NSObject
+
+- (instancetype) initWithCookie: (NSHTTPCookie *) cookie;
+
+/** The cookie. */
+@property(nonatomic, readonly) NSHTTPCookie *cookie;
+
+/** The cookie's expiry time. */
+@property(nonatomic, readonly) CFAbsoluteTime expiry;
+
+@end
+
+@implementation ANTCookieJarExpiryEntry
+
+/**
+ * Initialize a new instance.
+ *
+ * @param cookie A cookie with a non-nil expiresDate.
+ */
+- (instancetype) initWithCookie: (NSHTTPCookie *) cookie {
+    PLSuperInit();
+
+    _cookie = cookie;
+    _expiry = [cookie.expiresDate timeIntervalSinceReferenceDate];
+
+    return self;
+}
+
+@end
+
+static const void *ANTCookieJarRetainCallBack (CFAllocatorRef allocator, const void *ptr) {
+    return CFRetain(ptr);
+}
+
+static void ANTCookieJarReleaseCallBack (CFAllocatorRef allocator, const void *ptr) {
+    CFRelease(ptr);
+}
+
+static CFComparisonResult ANTCookieJarExpiryCompare (const void *ptr1, const void *ptr2, void *context) {
+    CFAbsoluteTime lhs = ((__bridge ANTCookieJarExpiryEntry *) ptr1).expiry;
+    CFAbsoluteTime rhs = ((__bridge ANTCookieJarExpiryEntry *) ptr2).expiry;
+
+    if (lhs < rhs)
+        return kCFCompareLessThan;
+    else if (lhs > rhs)
+        return kCFCompareGreaterThan;
+    else
+        return kCFCompareEqualTo;
+}
+
+/**
+ * @internal
+ *
+ * Binary heap callbacks for ANTCookieJarExpiryEntry values, ordered by ascending expiry.
+ */
+static const CFBinaryHeapCallBacks ANTCookieJarExpiryCallBacks = {
+    .version = 0,
+    .retain = ANTCookieJarRetainCallBack,
+    .release = ANTCookieJarReleaseCallBack,
+    .copyDescription = CFCopyDescription,
+    .compare = ANTCookieJarExpiryCompare
+};
+
+/**
+ * @internal
+ *
+ * A sharded jar's entry for a single registrable domain.
+ */
+@interface ANTCookieJarShard : NSObject
+
+- (instancetype) initWithDomain: (NSString *) domain jar: (ANTCookieJar *) jar epoch: (int64_t) epoch;
+
+/** The registrable domain of all cookies held by the shard. */
+@property(nonatomic, readonly) NSString *domain;
+
+/** The unsharded jar holding the shard's cookies. */
+@property(nonatomic, readonly) ANTCookieJar *jar;
+
+/** The sharding epoch of the jar that created this entry. If this does not match the epoch of the jar holding the
+ * entry, the shard may be shared with a copy of that jar, and must be copied before it is modified. */
+@property(nonatomic, readonly) int64_t epoch;
+
+@end
+
+@implementation ANTCookieJarShard
+
+/**
+ * Initialize a new instance.
+ *
+ * @param domain The registrable domain of all cookies held by @a jar.
+ * @param jar The unsharded jar holding the shard's cookies.
+ * @param epoch The sharding epoch of the jar creating this entry.
+ */
+- (instancetype) initWithDomain: (NSString *) domain jar: (ANTCookieJar *) jar epoch: (int64_t) epoch {
+    PLSuperInit();
+
+    _domain = domain;
+    _jar = jar;
+    _epoch = epoch;
+
+    return self;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * The default maximum number of cookies held by a jar. This matches Chrome's CookieMonster.
+ */
+static const NSUInteger ANTCookieJarDefaultMaxCookies = 3300;
+
+/**
+ * @internal
+ *
+ * The default maximum number of cookies held by a jar for any one registrable domain. This matches Chrome's CookieMonster.
+ */
+static const NSUInteger ANTCookieJarDefaultMaxCookiesPerDomain = 180;
+
+/**
+ * @internal
+ *
+ * The granularity at which cookie access times are recorded. Lookups only update a cookie's access time if it
+ * is older than this interval.
+ */
+static const CFTimeInterval ANTCookieJarAccessGranularity = 60;
+
+/**
+ * @internal
+ *
+ * Number of low-order bits of each access stamp used to hold an access sequence number, ordering accesses that
+ * occur within the same second.
+ */
+#define ANT_COOKIE_JAR_ACCESS_SEQUENCE_BITS 24
+
+/**
+ * @internal
+ *
+ * The minimum number of entries the access stamp map may hold before entries for removed cookies are compacted.
+ */
+static const NSUInteger ANTCookieJarAccessCompactionMinimum = 64;
+
+@implementation ANTCookieJarAccessStamp {
+@private
+    /** The current stamp. */
+    volatile uint64_t _stamp;
+}
+
+/**
+ * Initialize a new instance.
+ *
+ * @param cookie The stamped cookie.
+ * @param stamp The initial stamp.
+ * @param owner The access stamp owner of the jar that may update the stamp in place.
+ */
+- (instancetype) initWithCookie: (NSHTTPCookie *) cookie stamp: (uint64_t) stamp owner: (int64_t) owner {
+    PLSuperInit();
+
+    _cookie = cookie;
+    _stamp = stamp;
+    _owner = owner;
+
+    return self;
+}
+
+/**
+ * Return the current stamp.
+ */
+- (uint64_t) stamp {
+    return _stamp;
+}
+
+/**
+ * Replace the current stamp. Concurrent updates race, and one will be lost.
+ */
+- (void) setStamp: (uint64_t) stamp {
+    _stamp = stamp;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * Return the access stamp for @a cookie from @a stamps, or nil if none.
+ */
+static inline ANTCookieJarAccessStamp *ANTCookieJarAccessStampForCookie (ANTPersistentMap *stamps, NSHTTPCookie *cookie) {
+    const void *key = (__bridge const void *) cookie;
+    return [stamps objectForKeyBytes: &key length: sizeof(key)];
+}
+
+/**
+ * @internal
+ *
+ * Return a map derived from @a stamps with @a stamp set for its cookie.
+ */
+static inline ANTPersistentMap *ANTCookieJarMapBySettingAccessStamp (ANTPersistentMap *stamps, ANTCookieJarAccessStamp *stamp) {
+    const void *key = (__bridge const void *) stamp.cookie;
+    return [stamps mapBySettingObject: stamp forKeyBytes: &key length: sizeof(key)];
+}
+
+/**
+ * @internal
+ *
+ * Return the number of cookies that should remain once cookies in excess of @a limit are evicted. Evicting beyond
+ * the limit amortizes the cost of eviction over subsequent insertions.
+ */
+static inline NSUInteger ANTCookieJarPurgeTarget (NSUInteger limit) {
+    return limit - MAX(1, limit / 10);
+}
+
+/**
+ * @internal
+ *
+ * Return the lowercase registrable domain (the public suffix plus one label) of the cookie domain or host @a domain,
+ * without any leading '.'. If @a domain is an IP address or public suffix, the domain itself is returned. Cookie limits
+ * are enforced, and sharded jars partition their cookies, per registrable domain.
+ */
+static NSString *ANTCookieJarRegistrableDomain (NSString *domain) {
+    char buffer[ANT_COOKIE_JAR_DOMAIN_BUFSIZE];
+    size_t length;
+    if (!ANTCookieJarCopyLowercaseASCII(domain, buffer, &length, NULL))
+        return [domain lowercaseString];
+
+    const char *name = buffer;
+    if (length > 0 && *name == '.') {
+        name++;
+        length--;
+    }
+
+    /* Include the label to the left of the public suffix */
+    const char *start = name;
+    if (length > 0 && !ANTPublicSuffixIsIPAddress(name, length)) {
+        bool known;
+        size_t suffixLength = ANTPublicSuffixLength(name, length, &known);
+        if (suffixLength < length) {
+            start = name + (length - suffixLength - 1);
+            while (start > name && start[-1] != '.')
+                start--;
+        }
+    }
+
+    return CFBridgingRelease(CFStringCreateWithBytes(NULL, (const UInt8 *) start, (name + length) - start, kCFStringEncodingUTF8, false));
+}
+
+/**
+ * @internal
+ *
+ * A candidate for eviction.
+ */
+typedef struct ANTCookieJarEvictionCandidate {
+    /** The cookie. Borrowed from the caller. */
+    __unsafe_unretained NSHTTPCookie *cookie;
+
+    /** The cookie's eviction rank; lower ranks are evicted first. */
+    uint64_t rank;
+
+    /** When evicting across the shards of a sharded jar, the index of the shard holding the cookie. */
+    NSUInteger shard;
+} ANTCookieJarEvictionCandidate;
+
+/**
+ * @internal
+ *
+ * qsort() comparator for ANTCookieJarEvictionCandidate values, ordered by ascending rank.
+ */
+static int ANTCookieJarEvictionCompare (const void *lhs, const void *rhs) {
+    uint64_t lrank = ((const ANTCookieJarEvictionCandidate *) lhs)->rank;
+    uint64_t rrank = ((const ANTCookieJarEvictionCandidate *) rhs)->rank;
+
+    if (lrank < rrank)
+        return -1;
+    else if (lrank > rrank)
+        return 1;
+    else
+        return 0;
+}
+
+/**
+ * @internal
+ *
+ * The minimum number of entries the expiry heap may hold before stale entries are compacted.
+ */
+static const CFIndex ANTCookieJarExpiryCompactionMinimum = 64;
+
+/**
+ * @internal
+ *
+ * The maximum delay, in seconds, for which the expiry timer will be scheduled. Later expiries are reached by re-arming the
+ * timer each time it fires; this also bounds the delay in noticing a wall clock change.
+ */
+static const CFTimeInterval ANTCookieJarMaximumExpiryTimerDelay = 86400;
+
+/**
+ * @internal
+ *
+ * Return the number of '/' characters in @a path.
+ */
+static NSUInteger ANTCookieJarPathDepth (NSString *path) {
+    NSUInteger depth = 0;
+    NSUInteger length = path.length;
+    for (NSUInteger i = 0; i < length; i++) {
+        if ([path characterAtIndex: i] == '/')
+            depth++;
+    }
+
+    return depth;
+}
+
+/**
+ * @internal
+ *
+ * Initialize the request header cache @a key for the given request properties, without allocating. Request paths are
+ * truncated after the (@a maxPathDepth + 1)th '/' character; no cookie path can distinguish between requests that
+ * share that prefix.
+ *
+ * @param key The key to be initialized. The key borrows @a host and @a path, which must outlive it.
+ * @param host The request host.
+ * @param path The request path.
+ * @param secure YES if the request is secure.
+ * @param maxPathDepth The snapshot's maxPathDepth.
+ */
+static void ANTCookieJarHeaderCacheKeyInit (ANTCookieJarHeaderCacheKey *key, NSString *host, NSString *path, BOOL secure, NSUInteger maxPathDepth) {
+    /* 64-bit FNV-1a, over the security flag, the ASCII-lowercased host, and the path prefix */
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ (secure ? 's' : 'i')) * prime;
+
+    if (host == nil)
+        host = @"";
+    if (path == nil)
+        path = @"";
+
+    CFStringInlineBuffer buffer;
+    CFIndex length = CFStringGetLength((__bridge CFStringRef) host);
+    CFStringInitInlineBuffer((__bridge CFStringRef) host, &buffer, CFRangeMake(0, length));
+    for (CFIndex i = 0; i < length; i++) {
+        UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        hash = (hash ^ c) * prime;
+    }
+
+    /* Hosts may not contain whitespace; use it as an unambiguous separator. */
+    hash = (hash ^ ' ') * prime;
+
+    length = CFStringGetLength((__bridge CFStringRef) path);
+    CFStringInitInlineBuffer((__bridge CFStringRef) path, &buffer, CFRangeMake(0, length));
+    NSUInteger depth = 0;
+    CFIndex significant = length;
+    for (CFIndex i = 0; i < length; i++) {
+        UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        hash = (hash ^ c) * prime;
+        if (c == '/' && ++depth > maxPathDepth) {
+            significant = i + 1;
+            break;
+        }
+    }
+
+    key->hash = hash;
+    key->secure = secure;
+    key->host = host;
+    key->path = path;
+    key->pathLength = significant;
+}
+
+@implementation ANTCookieJarHeaderCacheEntry {
+@private
+    /** The entry's key; the strings are owned by the entry. */
+    BOOL _secure;
+    NSString *_host;
+    NSString *_path;
+
+    /** Non-zero if the entry has been referenced since the clock hand last passed it. */
+    volatile int32_t _referenced;
+
+    /** The time at which the cookies were last marked as accessed via this entry. */
+    volatile CFAbsoluteTime _accessTime;
+}
+
+/**
+ * Initialize a new instance.
+ *
+ * @param key The entry's key.
+ * @param headers The serialized request header fields.
+ * @param cookies The cookies from which @a headers were serialized.
+ * @param accessTime The time at which @a cookies were last marked as accessed.
+ */
+- (instancetype) initWithKey: (const ANTCookieJarHeaderCacheKey *) key headers: (NSDictionary *) headers cookies: (NSArray *) cookies accessTime: (CFAbsoluteTime) accessTime {
+    PLSuperInit();
+
+    _keyHash = key->hash;
+    _secure = key->secure;
+    _host = [key->host copy];
+    _path = [key->path substringToIndex: key->pathLength];
+    _headers = headers;
+    _cookies = cookies;
+    _accessTime = accessTime;
+
+    return self;
+}
+
+/**
+ * Return YES if the receiver's key is equal to @a key.
+ */
+- (BOOL) matchesKey: (const ANTCookieJarHeaderCacheKey *) key {
+    if (_keyHash != key->hash || _secure != key->secure || (CFIndex) [_path length] != key->pathLength)
+        return NO;
+
+    if (CFStringCompare((__bridge CFStringRef) _host, (__bridge CFStringRef) key->host, kCFCompareCaseInsensitive) != kCFCompareEqualTo)
+        return NO;
+
+    return CFStringCompareWithOptions((__bridge CFStringRef) key->path, (__bridge CFStringRef) _path, CFRangeMake(0, key->pathLength), 0) == kCFCompareEqualTo;
+}
+
+/**
+ * Record a cache hit at @a now, marking the entry as referenced.
+ *
+ * @return Returns YES if the entry's cookies were last marked as accessed at least ANTCookieJarAccessGranularity
+ * before @a now, in which case the caller should mark them as accessed again.
+ */
+- (BOOL) markAccessed: (CFAbsoluteTime) now {
+    /* Avoid dirtying the entry's cache line on every hit */
+    if (!_referenced)
+        _referenced = 1;
+
+    if (now - _accessTime < ANTCookieJarAccessGranularity)
+        return NO;
+
+    _accessTime = now;
+    return YES;
+}
+
+/**
+ * Clear the entry's reference bit, returning its previous value.
+ */
+- (BOOL) clearReferenced {
+    if (!_referenced)
+        return NO;
+
+    _referenced = 0;
+    return YES;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * The last sharding epoch assigned by ANTCookieJarNextShardEpoch().
+ */
+static volatile int64_t ANTCookieJarShardEpoch = 0;
+
+/**
+ * @internal
+ *
+ * The last access stamp owner assigned by ANTCookieJarNextAccessStampOwner().
+ */
+static volatile int64_t ANTCookieJarAccessStampOwner = 0;
+
+/**
+ * @internal
+ *
+ * The last access sequence number assigned by -accessStampForTime:. The sequence is shared by all jars, so that the
+ * stamps of a sharded jar's shards may be compared.
+ */
+static volatile int64_t ANTCookieJarAccessSequence = 0;
+
+/**
+ * @internal
+ *
+ * Return the eviction rank of @a cookie. Expired cookies rank lowest, followed by cookies in order of their last access;
+ * cookies with no recorded access rank as least recently accessed.
+ *
+ * @param cookie The cookie.
+ * @param stamps The access stamps of the jar holding @a cookie.
+ * @param now The current time.
+ */
+static inline uint64_t ANTCookieJarEvictionRank (NSHTTPCookie *cookie, ANTPersistentMap *stamps, CFAbsoluteTime now) {
+    if (ANTCookieJarIsExpired(cookie, now))
+        return 0;
+
+    return ANTCookieJarAccessStampForCookie(stamps, cookie).stamp + 1;
+}
+
+/**
+ * @internal
+ *
+ * Return a new, process-unique sharding epoch.
+ */
+static int64_t ANTCookieJarNextShardEpoch (void) {
+    return OSAtomicIncrement64Barrier(&ANTCookieJarShardEpoch);
+}
+
+/**
+ * @internal
+ *
+ * Return a new, process-unique access stamp owner.
+ */
+static int64_t ANTCookieJarNextAccessStampOwner (void) {
+    return OSAtomicIncrement64Barrier(&ANTCookieJarAccessStampOwner);
+}
+
+/**
+ * @internal
+ *
+ * Load and return the object published at @a pointer. This will never block.
+ *
+ * @param pointer A retained object pointer, replaced only via ANTCookieJarPublish().
+ */
+static id ANTCookieJarLoad (void * volatile *pointer) {
+    /* A writer that has swapped out the object we load will not release it until we've left the critical
+     * section, by which time we hold our own reference. */
+    ANTEpochEnter();
+    const void *object = *pointer;
+    CFRetain(object);
+    ANTEpochExit();
+
+    return CFBridgingRelease(object);
+}
+
+/**
+ * @internal
+ *
+ * Replace the object published at @a pointer with @a next. The previous object is released once no reader may
+ * still be loading it; the caller never waits on readers. Publishers must be serialized by the caller.
+ *
+ * @param pointer A retained object pointer.
+ * @param current The currently published object.
+ * @param next The object to be published.
+ */
+static void ANTCookieJarPublish (void * volatile *pointer, void *current, id next) {
+    /* As publishers are serialized, this can't fail. */
+    if (!OSAtomicCompareAndSwapPtrBarrier(current, (__bridge_retained void *) next, pointer))
+        __builtin_trap();
+
+    ANTEpochRetire(current, ANTCookieJarReleaseObject);
+}
+
+/**
+ * Provides a thread-safe, non-singleton replacement for NSHTTPCookieStorage.
+ *
+ * The jar's cookies are held in an immutable ANTCookieTrie snapshot. Readers fetch the current snapshot without
+ * blocking, and never modify it; writers are serialized, derive a new snapshot from the current one, and
+ * publish it with an atomic pointer swap (read-copy-update). Replaced snapshots are released via epoch-based
+ * reclamation (see ANTEpoch.c); neither readers nor writers wait on each other.
+ *
+ * Cookie expiry is tracked by writers in a min-heap ordered by expiry date; expired cookies are popped from the
+ * heap and pruned from the published snapshot either by the next writer, or by a timer scheduled for the earliest
+ * pending expiry. Each snapshot records that earliest expiry, and readers only need to check individual cookies
+ * for expiry if the timer has not yet caught up.
+ *
+ * The number of cookies is bounded, both globally and per registrable domain, following Chrome's CookieMonster. Lookups
+ * record each returned cookie's last access time (at ANTCookieJarAccessGranularity) in a per-cookie stamp reached
+ * through the snapshot, without taking a lock; when a newly set cookie exceeds a limit, expired cookies are evicted
+ * first, followed by the least recently accessed. Eviction removes more cookies than
+ * strictly necessary, so that its cost is amortized over subsequent insertions.
+ *
+ * Jars are never persisted, and are discarded when their session ends (eg, on logout); session cookies are therefore
+ * never carried into a later session, and are not purged separately.
+ *
+ * A sharded jar partitions its cookies by registrable domain into independent, unsharded jars; writers to unrelated
+ * sites never contend, and each site's limit is enforced within its own shard. The global limit is enforced across
+ * all shards by whichever writer first finds it exceeded, while other writers proceed. The shards are held in a
+ * persistent map, published in the same manner as a snapshot. Copies of a sharded jar share their shards, and a shard
+ * is copied (sharing its snapshot's cookies) only when first modified by either jar.
+ */
+@implementation ANTCookieJar {
+    /** Lock that must be held when replacing _snapshot. This serializes writers; it is never taken by readers. */
+    OSSpinLock _writeLock;
+
+    /** The current cookie snapshot, a retained ANTCookieJarSnapshot. This must only be read via -snapshot. */
+    void * volatile _snapshot;
+
+    /** Min-heap of ANTCookieJarExpiryEntry values for all expiring cookies. Entries for cookies that have since been
+     * replaced or deleted are left in place, and discarded when popped or compacted. Must only be accessed with
+     * _writeLock held. */
+    CFBinaryHeapRef _expiryHeap;
+
+    /** If YES, _expiryHeap does not reflect the current snapshot, and must be rebuilt prior to use. */
+    BOOL _expiryHeapStale;
+
+    /** The _expiryHeap count at which stale entries will be compacted. */
+    CFIndex _expiryHeapCompactionThreshold;
+
+    /** Timer used to prune cookies at the snapshot's next expiry, or NULL if not yet required. */
+    dispatch_source_t _expiryTimer;
+
+    /** The maximum number of '/' characters in any cookie path added since the jar was last emptied. Must only be accessed
+     * with _writeLock held. */
+    NSUInteger _maxPathDepth;
+
+    /** ANTCookieJarAccessStamp values, keyed by cookie address, from which each published snapshot's accessStamps are
+     * taken. Entries for cookies that have since been removed are discarded when compacted. Must only be accessed with
+     * _writeLock held; readers use the stamps of their snapshot. */
+    ANTPersistentMap *_accessStamps;
+
+    /** The _accessStamps count at which entries for removed cookies will be compacted. Must only be accessed with _writeLock held. */
+    NSUInteger _accessStampsCompactionThreshold;
+
+    /** The receiver's access stamp owner. Stamps owned by any other jar are shared with a copy, and must be replaced
+     * rather than updated. */
+    volatile int64_t _accessStampOwner;
+
+    /** If YES, the receiver's cookies are held in _shards, and the receiver's own snapshot is unused. */
+    BOOL _sharded;
+
+    /** Lock that must be held when replacing _shards or _shardEpoch. This is never taken by readers, and is only taken by
+     * writers when adding or copying a shard. */
+    OSSpinLock _shardLock;
+
+    /** The current shard map, a retained ANTPersistentMap of ANTCookieJarShard values keyed by their UTF-8 registrable
+     * domain. This must only be read via -shards. */
+    void * volatile _shards;
+
+    /** The receiver's sharding epoch. Shards created at any other epoch may be shared with a copy of the receiver. */
+    volatile int64_t _shardEpoch;
+
+    /** An upper bound on the number of cookies held in _shards. Cookies pruned by a shard's expiry timer are not
+     * discounted until the global limit is next enforced. */
+    volatile int64_t _shardedCookieCount;
+
+    /** Lock held while enforcing the global limit of a sharded jar. Writers that find it held do not wait. */
+    OSSpinLock _shardEvictionLock;
+}
+
+/**
+ * Validate a cookie returned by the resource at @a theURL, rewriting the cookie's domain
+ * if it references a TLD, or otherwise fails to conform to cookie domain rules.
+ *
+ * @param headerFields The header fields as returned from an NSHTTPURLResponse.
+ * @param theURL The URL associated with the created cookies.
+ *
+ * @warning While there are RFCs that specify cookie requirements, none of the browsers actually
+ * seem to follow them. This implementation is modeled on Chrome's CookieMonster
+ * implementation ( http://www.chromium.org/developers/design-documents/network-stack/cookiemonster ),
+ * and uses Mozilla's registry of TLDs (in a whitelist configuration) fetched from
+ * http://publicsuffix.org/list/
+ */
++ (NSHTTPCookie *) validateCookie: (NSHTTPCookie *) cookie forURL: (NSURL *) theURL {
+    NSString *host = theURL.host;
+
+    /* If the cookie domain exactly matches the URL host, there's nothing else to validate */
+    if ([cookie.domain compare: host options: NSCaseInsensitiveSearch] == NSOrderedSame) {
+        return cookie;
+    }
+
+    /* Fetch the lowercase ASCII forms of the host and cookie domain, converting any internationalized labels to punycode.
+     * Neither may exceed the maximum DNS name length. */
+    char hostBuffer[ANT_COOKIE_JAR_DOMAIN_BUFSIZE];
+    char domainBuffer[ANT_COOKIE_JAR_DOMAIN_BUFSIZE];
+    size_t hostLength;
+    size_t domainLength;
+    BOOL domainConverted;
+    if (!ANTCookieJarCopyLowercaseASCII(host, hostBuffer, &hostLength, NULL) || !ANTCookieJarCopyLowercaseASCII(cookie.domain, domainBuffer, &domainLength, &domainConverted))
+        return nil;
+
+    /* If the URL uses an IP address, the cookie domain must also. */
+    if (ANTPublicSuffixIsIPAddress(hostBuffer, hostLength)) {
+        return ANTCookieJarReplaceDomain(cookie, host);
+    }
     
-    /** A wildcard rule; everything *underneath* this rule is a TLD */
-    TLDRuleTypeWildcard = 1,
+    /* If the cookie does not use a .domain host, or is not a suffix of the the URL's host, the cookie domain is invalid; the cookie
+     * will be ignored. */
+    if (domainLength == 0 || domainBuffer[0] != '.')
+        return nil;
+
+    const char *domain = domainBuffer + 1;
+    size_t labelsLength = domainLength - 1;
+    if (labelsLength > hostLength || memcmp(hostBuffer + (hostLength - labelsLength), domain, labelsLength) != 0)
+        return nil;
+
+    if (labelsLength < hostLength && hostBuffer[hostLength - labelsLength - 1] != '.')
+        return nil;
     
-    /** Exception rule; overrides a wildcard rule */
-    TLDRuleTypeException = 2
-} TLDRuleType;
+    /* If we've gotten this far, we know that the cookie is a .domain.cookie, and that it matches the URL. We now
+     * just need to search our TLD whitelist to ensure that:
+     *
+     * 1) The cookie domain is not a TLD.
+     * 2) The cookie domain is within a known TLD. This ensures fail-safe behavior in the case that new TLDs are added.
+     *
+     * If a TLD rule was not found, the domain does not have a whitelisted TLD; we must reset the cookie
+     * to be hostname-only. */
+    bool known;
+    size_t suffixLength = ANTPublicSuffixLength(domain, labelsLength, &known);
+    if (!known || suffixLength >= labelsLength)
+        return ANTCookieJarReplaceDomain(cookie, host);
+
+    /* The domain has a valid TLD! If it was internationalized, store it in the same ASCII form as the hosts against which
+     * it will be matched. */
+    if (domainConverted)
+        return ANTCookieJarReplaceDomain(cookie, CFBridgingRelease(CFStringCreateWithBytes(NULL, (const UInt8 *) domainBuffer, domainLength, kCFStringEncodingASCII, false)));
+
+    return cookie;
+}
+
+/**
+ * Returns an array of NSHTTPCookie objects corresponding to the provided response header fields for the provided URL.
+ * The cookies will be validated to ensure that they correctly match @a theURL. Cookies specifying an invalid host
+ * will be rewritten or discarded as necessary.
+ *
+ * @param headerFields The header fields as returned from an NSHTTPURLResponse.
+ * @param theURL The URL associated with the created cookies.
+ *
+ * @sa ANTCookieJar::validateCookie:forURL:
+ *
+ * @note Unlike NSHTTPCookie's implementation, this method will validate the returned cookies host/domain values correctly
+ * match @a theURL. Cookies specifying an invalid host will be rewritten or discarded as necessary.
+ */
++ (NSArray *) cookiesWithResponseHeaderFields: (NSDictionary *) headerFields forURL: (NSURL *) theURL {
+    NSMutableArray *results = [NSMutableArray array];
+
+    /* Header values are parsed directly; each cookie's domain is validated before it is constructed, and the
+     * host's public suffix is computed at most once per response. */
+    ANTCookieJarResponseContext ctx;
+    NSString *host = nil;
+    NSString *defaultPath = nil;
+    BOOL initialized = NO;
+
+    for (NSString *field in headerFields) {
+        if ([field caseInsensitiveCompare: @"Set-Cookie"] != NSOrderedSame)
+            continue;
+
+        NSString *value = headerFields[field];
+        if (![value isKindOfClass: [NSString class]])
+            continue;
+
+        if (!initialized) {
+            host = theURL.host;
+            defaultPath = ANTCookieJarDefaultPath(theURL);
+            ctx.host = host;
+            ctx.defaultPath = defaultPath;
+            if (!ANTCookieJarCopyLowercaseASCII(host, ctx.hostBuffer, &ctx.hostLength, NULL))
+                return results;
+
+            ctx.hostIsAddress = ANTPublicSuffixIsIPAddress(ctx.hostBuffer, ctx.hostLength);
+            ctx.suffixKnown = false;
+            ctx.suffixLength = 0;
+            if (!ctx.hostIsAddress)
+                ctx.suffixLength = ANTPublicSuffixLength(ctx.hostBuffer, ctx.hostLength, &ctx.suffixKnown);
+
+            ctx.now = CFAbsoluteTimeGetCurrent();
+            initialized = YES;
+        }
+
+        /* Strings that can't be represented as UTF-8 (eg, containing unpaired surrogates) can't be parsed */
+        const char *bytes = [value UTF8String];
+        if (bytes == NULL)
+            continue;
+
+        const char *end = bytes + strlen(bytes);
+        ANTSetCookie parsed;
+        while (ANTSetCookieNext(&bytes, end, &parsed)) {
+            NSHTTPCookie *cookie = ANTCookieJarCreateCookie(&ctx, &parsed);
+            if (cookie != nil)
+                [results addObject: cookie];
+        }
+    }
+
+    return results;
+}
+
+/**
+ * Initialize a new instance with the default cookie limits.
+ */
+- (instancetype) init {
+    return [self initWithMaxCookies: ANTCookieJarDefaultMaxCookies maxCookiesPerDomain: ANTCookieJarDefaultMaxCookiesPerDomain];
+}
+
+/**
+ * Initialize a new instance with the given cookie limits.
+ *
+ * @param maxCookies The maximum number of cookies to be held by the jar. Must be greater than zero.
+ * @param maxCookiesPerDomain The maximum number of cookies to be held for any one registrable domain (eg, example.org
+ * and all of its subdomains). Must be greater than zero.
+ */
+- (instancetype) initWithMaxCookies: (NSUInteger) maxCookies maxCookiesPerDomain: (NSUInteger) maxCookiesPerDomain {
+    ANTCookieJarSnapshot *snapshot = [[ANTCookieJarSnapshot alloc] initWithTrie: [ANTCookieTrie new]
+                                                                   accessStamps: [ANTPersistentMap new]
+                                                                     nextExpiry: INFINITY
+                                                                     generation: 0
+                                                                   maxPathDepth: 0];
+    return [self initWithSnapshot: snapshot maxCookies: maxCookies maxCookiesPerDomain: maxCookiesPerDomain];
+}
+
+/**
+ * @internal
+ *
+ * Initialize a new instance with the given cookie snapshot.
+ *
+ * @param snapshot The initial cookie snapshot. Its access stamps may be shared with other jars.
+ * @param maxCookies The maximum number of cookies to be held by the jar.
+ * @param maxCookiesPerDomain The maximum number of cookies to be held for any one registrable domain.
+ */
+- (instancetype) initWithSnapshot: (ANTCookieJarSnapshot *) snapshot
+                       maxCookies: (NSUInteger) maxCookies
+              maxCookiesPerDomain: (NSUInteger) maxCookiesPerDomain
+{
+    PLSuperInit();
+
+    NSAssert(maxCookies > 0 && maxCookiesPerDomain > 0, @"Cookie limits must be greater than zero");
+
+    _maxCookies = maxCookies;
+    _maxCookiesPerDomain = maxCookiesPerDomain;
+
+    _writeLock = OS_SPINLOCK_INIT;
+    _snapshot = (__bridge_retained void *) snapshot;
+
+    _expiryHeap = CFBinaryHeapCreate(NULL, 0, &ANTCookieJarExpiryCallBacks, NULL);
+    _expiryHeapCompactionThreshold = ANTCookieJarExpiryCompactionMinimum;
+
+    /* If the snapshot contains expiring cookies, the heap will be populated lazily by the first writer. */
+    _expiryHeapStale = isfinite(snapshot.nextExpiry);
+    _maxPathDepth = snapshot.maxPathDepth;
+
+    _accessStamps = snapshot.accessStamps;
+    _accessStampsCompactionThreshold = MAX(ANTCookieJarAccessCompactionMinimum, _accessStamps.count * 2);
+    _accessStampOwner = ANTCookieJarNextAccessStampOwner();
+
+    return self;
+}
+
+/**
+ * Initialize a new sharded instance with the default cookie limits.
+ */
+- (instancetype) initSharded {
+    return [self initShardedWithMaxCookies: ANTCookieJarDefaultMaxCookies maxCookiesPerDomain: ANTCookieJarDefaultMaxCookiesPerDomain];
+}
+
+/**
+ * Initialize a new sharded instance. Cookies are partitioned by registrable domain into independently locked shards;
+ * modifying the cookies of one site never blocks readers or writers of another, and copies of the jar share each
+ * shard until it is first modified.
+ *
+ * Unlike copies of an unsharded jar, which never block, a copy of a sharded jar waits for any writer already modifying
+ * a shard (of any jar) to finish that modification.
+ *
+ * @param maxCookies The maximum number of cookies to be held by the jar, across all shards. Must be greater than zero.
+ * @param maxCookiesPerDomain The maximum number of cookies to be held for any one registrable domain. Must be greater
+ * than zero.
+ */
+- (instancetype) initShardedWithMaxCookies: (NSUInteger) maxCookies maxCookiesPerDomain: (NSUInteger) maxCookiesPerDomain {
+    return [self initWithShards: [ANTPersistentMap new] cookieCount: 0 maxCookies: maxCookies maxCookiesPerDomain: maxCookiesPerDomain];
+}
+
+/**
+ * @internal
+ *
+ * Initialize a new sharded instance with the given shards.
+ *
+ * @param shards The initial shard map. Shards created at any epoch other than the receiver's will be copied
+ * before they are modified.
+ * @param cookieCount An upper bound on the number of cookies held in @a shards.
+ * @param maxCookies The maximum number of cookies to be held across all shards.
+ * @param maxCookiesPerDomain The maximum number of cookies to be held for any one registrable domain.
+ */
+- (instancetype) initWithShards: (ANTPersistentMap *) shards
+                    cookieCount: (int64_t) cookieCount
+                     maxCookies: (NSUInteger) maxCookies
+            maxCookiesPerDomain: (NSUInteger) maxCookiesPerDomain
+{
+    if ((self = [self initWithMaxCookies: maxCookies maxCookiesPerDomain: maxCookiesPerDomain]) == nil)
+        return nil;
+
+    _sharded = YES;
+    _shardLock = OS_SPINLOCK_INIT;
+    _shards = (__bridge_retained void *) shards;
+    _shardEpoch = ANTCookieJarNextShardEpoch();
+    _shardedCookieCount = cookieCount;
+    _shardEvictionLock = OS_SPINLOCK_INIT;
+
+    return self;
+}
+
+- (void) dealloc {
+    if (_expiryTimer != NULL)
+        dispatch_source_cancel(_expiryTimer);
+
+    CFRelease(_expiryHeap);
+    CFRelease(_snapshot);
+
+    if (_shards != NULL)
+        CFRelease(_shards);
+}
+
+// from NSCopying
+- (instancetype) mutableCopyWithZone: (NSZone *) zone {
+    if (_sharded) {
+        /* Shards are shared with the copy. Advancing our epoch ensures that our own writers will copy any shared shard
+         * before modifying it, as will the copy's. */
+        ANTPersistentMap *shards;
+        OSSpinLockLock(&_shardLock); {
+            shards = (__bridge ANTPersistentMap *) _shards;
+            _shardEpoch = ANTCookieJarNextShardEpoch();
+        } OSSpinLockUnlock(&_shardLock);
+
+        /* Wait out any writers that acquired a shard prior to the epoch change, and may still be modifying it. Writers
+         * hold an epoch critical section while modifying a shard; later writers will observe the new shard epoch. This
+         * grace period is the only point at which a copy may block, and is bounded by the duration of a single shard
+         * modification; readers' critical sections never block. */
+        ANTEpochSynchronize();
+
+        return [[ANTCookieJar allocWithZone: zone] initWithShards: shards
+                                                      cookieCount: _shardedCookieCount
+                                                       maxCookies: _maxCookies
+                                                maxCookiesPerDomain: _maxCookiesPerDomain];
+    }
+
+    /* The snapshot's cookies and access stamps are shared with the copy. Taking a new owner ensures that neither jar
+     * updates a shared stamp in place; each replaces a stamp with its own on first access. An access racing with the
+     * owner change may be recorded in both jars, as though it preceded the copy. */
+    ANTCookieJarSnapshot *snapshot = [self snapshot];
+    _accessStampOwner = ANTCookieJarNextAccessStampOwner();
+
+    ANTCookieJarSnapshot *copied = [[ANTCookieJarSnapshot alloc] initWithTrie: snapshot.trie
+                                                                 accessStamps: snapshot.accessStamps
+                                                                   nextExpiry: snapshot.nextExpiry
+                                                                   generation: 0
+                                                                 maxPathDepth: snapshot.maxPathDepth];
+
+    return [[ANTCookieJar allocWithZone: zone] initWithSnapshot: copied maxCookies: _maxCookies maxCookiesPerDomain: _maxCookiesPerDomain];
+}
+
+/**
+ * @internal
+ *
+ * Return the current cookie snapshot. This will never block.
+ */
+- (ANTCookieJarSnapshot *) snapshot {
+    return ANTCookieJarLoad(&_snapshot);
+}
+
+/**
+ * @internal
+ *
+ * Return the current shard map of a sharded jar. This will never block.
+ */
+- (ANTPersistentMap *) shards {
+    return ANTCookieJarLoad(&_shards);
+}
+
+/**
+ * @internal
+ *
+ * Return the shard holding cookies for the registrable domain @a domain, or nil if no such shard exists. The returned
+ * shard may be shared with copies of the receiver, and must not be modified.
+ *
+ * @param domain A registrable domain, as returned by ANTCookieJarRegistrableDomain().
+ */
+- (ANTCookieJar *) shardForDomain: (NSString *) domain {
+    if (domain == nil)
+        return nil;
+
+    const char *key = [domain UTF8String];
+    ANTCookieJarShard *shard = [[self shards] objectForKeyBytes: key length: strlen(key)];
+    return shard.jar;
+}
 
 /**
- * Provides a thread-safe, non-singleton replacement for NSHTTPCookieStorage.
+ * @internal
+ *
+ * Return a shard of the receiver holding cookies for the registrable domain @a domain that may be modified, copying
+ * the shard if it may be shared with a copy of the receiver. Must be called from within -modifyShardForDomain:create:block:.
+ *
+ * @param domain A registrable domain, as returned by ANTCookieJarRegistrableDomain().
+ * @param create If YES, a new shard will be created if none exists.
+ *
+ * @return The shard, or nil if no shard exists and @a create is NO.
  */
-@implementation ANTCookieJar {
-    /** Lock that must be held when accessing _storage. */
-    OSSpinLock _lock;
+- (ANTCookieJar *) writableShardForDomain: (NSString *) domain create: (BOOL) create {
+    const char *key = [domain UTF8String];
+    size_t keyLength = strlen(key);
+
+    /* Fast path; the shard exists, and is owned by the receiver */
+    ANTCookieJarShard *shard = [[self shards] objectForKeyBytes: key length: keyLength];
+    if (shard != nil && shard.epoch == _shardEpoch)
+        return shard.jar;
+    else if (shard == nil && !create)
+        return nil;
+
+    ANTCookieJar *jar;
+    OSSpinLockLock(&_shardLock); {
+        void *current = _shards;
+        ANTPersistentMap *shards = (__bridge ANTPersistentMap *) current;
 
-    /** Cookie storage. Maps (domain -> path -> cookie name -> NSHTTPCookie). */
-    NSMutableDictionary *_storage;
+        /* Another writer may have created or copied the shard while we waited on the lock */
+        shard = [shards objectForKeyBytes: key length: keyLength];
+        if (shard != nil && shard.epoch == _shardEpoch) {
+            jar = shard.jar;
+        } else {
+            if (shard != nil)
+                jar = [shard.jar mutableCopy];
+            else
+                jar = [[ANTCookieJar alloc] initWithMaxCookies: _maxCookiesPerDomain maxCookiesPerDomain: _maxCookiesPerDomain];
+
+            shard = [[ANTCookieJarShard alloc] initWithDomain: domain jar: jar epoch: _shardEpoch];
+            ANTCookieJarPublish(&_shards, current, [shards mapBySettingObject: shard forKeyBytes: key length: keyLength]);
+        }
+    } OSSpinLockUnlock(&_shardLock);
+
+    return jar;
 }
 
 /**
- * Validate a cookie returned by the resource at @a theURL, rewriting the cookie's domain
- * if it references a TLD, or otherwise fails to conform to cookie domain rules.
+ * @internal
  *
- * @param headerFields The header fields as returned from an NSHTTPURLResponse.
- * @param theURL The URL associated with the created cookies.
+ * Call @a block with a modifiable shard of the receiver holding cookies for the registrable domain @a domain.
  *
- * @warning While there are RFCs that specify cookie requirements, none of the browsers actually
- * seem to follow them. This implementation is modeled on Chrome's CookieMonster
- * implementation ( http://www.chromium.org/developers/design-documents/network-stack/cookiemonster ),
- * and uses Mozilla's registry of TLDs (in a whitelist configuration) fetched from
- * http://publicsuffix.org/list/
+ * @param domain A registrable domain, as returned by ANTCookieJarRegistrableDomain().
+ * @param create If YES, a new shard will be created if none exists.
+ * @param block The block to be called with the shard. If no shard exists and @a create is NO, the block will not be
+ * called.
  */
-+ (NSHTTPCookie *) validateCookie: (NSHTTPCookie *) cookie forURL: (NSURL *) theURL {
-    /* A simple block that replaces the cookie's domain with the URL's specified domain */
-    NSHTTPCookie *(^ReplaceDomain)(void)  = ^(void) {
-        NSMutableDictionary *props = [[cookie properties] mutableCopy];
-        [props setObject: theURL.host forKey: NSHTTPCookieDomain];
-        return [NSHTTPCookie cookieWithProperties: props];
-    };
+- (void) modifyShardForDomain: (NSString *) domain create: (BOOL) create block: (void (^)(ANTCookieJar *shard)) block {
+    /* Enter an epoch critical section before checking the shard's epoch; a copy of the receiver will wait for us to
+     * finish with any shard it has since begun to share. Unlike a shared writer count, this touches only per-thread state. */
+    ANTEpochEnter(); {
+        ANTCookieJar *shard = [self writableShardForDomain: domain create: create];
+        if (shard != nil)
+            block(shard);
+    } ANTEpochExit();
+}
 
-    /* If the cookie domain exactly matches the URL host, there's nothing else to validate */
-    if ([cookie.domain compare: theURL.host options: NSCaseInsensitiveSearch] == NSOrderedSame) {
-        return cookie;
+/**
+ * @internal
+ *
+ * Discard the contents of the expiry heap, and repopulate it from @a trie. Must be called with _writeLock held.
+ *
+ * @param trie The trie from which the heap will be populated.
+ */
+- (void) rebuildExpiryHeapWithTrie: (ANTCookieTrie *) trie {
+    CFBinaryHeapRemoveAllValues(_expiryHeap);
+    [trie enumerateCookiesUsingBlock: ^(NSHTTPCookie *cookie) {
+        [self addExpiryEntryForCookie: cookie];
+    }];
+
+    _expiryHeapCompactionThreshold = MAX(ANTCookieJarExpiryCompactionMinimum, CFBinaryHeapGetCount(_expiryHeap) * 2);
+    _expiryHeapStale = NO;
+}
+
+/**
+ * @internal
+ *
+ * Add @a cookie to the expiry heap, if it has an expiry date. Must be called with _writeLock held.
+ *
+ * @param cookie The cookie to be added.
+ */
+- (void) addExpiryEntryForCookie: (NSHTTPCookie *) cookie {
+    if (cookie.expiresDate == nil)
+        return;
+
+    CFBinaryHeapAddValue(_expiryHeap, (__bridge const void *) [[ANTCookieJarExpiryEntry alloc] initWithCookie: cookie]);
+}
+
+/**
+ * @internal
+ *
+ * Remove all cookies that have expired as of @a now from @a trie, popping their entries from the expiry heap.
+ * Must be called with _writeLock held.
+ *
+ * @param trie The trie to be pruned.
+ * @param now The current time.
+ * @param nextExpiry On return, the expiry time of the earliest remaining heap entry, or INFINITY.
+ *
+ * @return The pruned trie.
+ */
+- (ANTCookieTrie *) trieByRemovingExpiredCookies: (ANTCookieTrie *) trie now: (CFAbsoluteTime) now nextExpiry: (CFAbsoluteTime *) nextExpiry {
+    const void *value;
+    while (CFBinaryHeapGetMinimumIfPresent(_expiryHeap, &value)) {
+        ANTCookieJarExpiryEntry *entry = (__bridge ANTCookieJarExpiryEntry *) value;
+        if (entry.expiry > now) {
+            *nextExpiry = entry.expiry;
+            return trie;
+        }
+
+        /* The cookie may have been replaced or deleted since its entry was added, in which case this is a no-op. */
+        trie = [trie trieByRemovingIdenticalCookie: entry.cookie];
+        CFBinaryHeapRemoveMinimumValue(_expiryHeap);
     }
-    
-    /* If the URL uses an IP address, the cookie domain must also. */
-    if ([[PLInet4Address alloc] initWithPresentationFormat: theURL.host] != nil || [[PLInet6Address alloc] initWithPresentationFormat: theURL.host]) {
-        return ReplaceDomain();
+
+    *nextExpiry = INFINITY;
+    return trie;
+}
+
+/**
+ * @internal
+ *
+ * Schedule the expiry timer to fire at @a nextExpiry, creating it if necessary. Must be called with _writeLock held.
+ *
+ * @param nextExpiry The time at which the timer should fire, or INFINITY to disable the timer.
+ */
+- (void) scheduleExpiryTimer: (CFAbsoluteTime) nextExpiry {
+    if (_expiryTimer == NULL) {
+        if (!isfinite(nextExpiry))
+            return;
+
+        __weak ANTCookieJar *weakSelf = self;
+        _expiryTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+        dispatch_source_set_event_handler(_expiryTimer, ^{
+            [weakSelf removeExpiredCookies];
+        });
+        dispatch_resume(_expiryTimer);
     }
-    
-    /* If the cookie does not use a .domain host, or is not a prefix of the the URL's host, the cookie domain is invalid; the cookie
-     * will be ignored. */
-    NSString *lowercaseCookieDomain = [cookie.domain lowercaseString];
-    if (![cookie.domain hasPrefix: @"."])
-        return nil;
-    
-    if (![[@"." stringByAppendingString: [theURL.host lowercaseString]] hasSuffix: lowercaseCookieDomain])
-        return nil;
-    
-    /* If we've gotten this far, we know that the cookie is a .domain.cookie, and that it matches the URL. We now
-     * just need to search our TLD whitelist to ensure that:
-     *
-     * 1) The cookie domain is not a TLD.
-     * 2) The cookie domain is within a known TLD. This ensures fail-safe behavior in the case that new TLDs are added.
-     *
-     * First, we need to strip leading '.' characters. */
-    NSCharacterSet *periodCharSet = [NSCharacterSet characterSetWithCharactersInString: @"."];
-    
-    /* Now, we must walk the domain elements, searching for a valid TLD; if we match on the entirity of the domain,
-     * we have to reject the attempt to set a .domain.tld cookie. */
-    NSRange nextDot = NSMakeRange(0, 0);
-    NSInteger wildCardExceptionDepth = -1;
-    NSInteger domainDepth = 0;
-    while (nextDot.location != NSNotFound) {
-        /* If we've hit the end without matching on a TLD, this TLD isn't whitelisted and we have to enforce a host cookie domain */
-        if (nextDot.location == NSNotFound)
-            return ReplaceDomain();
-        
-        /* Our TLD table uses UTF-8 */
-        NSString *lookupDomain = [lowercaseCookieDomain substringFromIndex: nextDot.location+1];
-        const char *lookupDomainUTF8 = [lookupDomain UTF8String];
-        size_t lookupDomainUTF8Len = strlen(lookupDomainUTF8);
-        /* Ensure that our below cast to (unsigned int) is safe */
-        if (lookupDomainUTF8Len > UINT_MAX) {
-            /* Should never happen ... */
-            NSLog(@"Received an exceptionally long domain name, skipping cookie: %@", lookupDomain);
-            return nil;
-        }
-        
-        /* Look up the rule */
-        const struct TLDRule *rule = ANTTopLevelDomainTableLookup(lookupDomainUTF8, (unsigned int) lookupDomainUTF8Len);
-        
-        /*
-         * Evaluate the rule. A matching rule doesn't necessarily terminate iteration, as we must
-         * locate any wildcard rules for the domain
-         *
-         * Note that we have to validate the match string here, as perfect hashing refers to the items
-         * within the set, and we're evaluating arbitrary domain names.
-         */
-        if (rule != NULL && strcmp(ANTTopLevelDomainTableStringPool+rule->name, lookupDomainUTF8) == 0) {
-
-            /* Handle the rule types */
-            if (rule->type == TLDRuleTypeStandard && domainDepth == 0) {
-                /* The full domain is invalid */
-                return ReplaceDomain();
-
-            } else if (rule->type == TLDRuleTypeStandard) {
-                /* The domain has a valid TLD! */
-                return cookie;
-
-            } else if (rule->type == TLDRuleTypeException) {
-                /* The rule is excepted from a wildcard rule; we need to keep processing
-                 * rules. */
-                wildCardExceptionDepth = domainDepth;
-
-            } else if (rule->type == TLDRuleTypeWildcard && wildCardExceptionDepth != domainDepth-1) {
-                /* There's a wildcard rule, and no exception rule is in place */
-                if (domainDepth == 1) {
-                    /* The full domain is a TLD! */
-                    return ReplaceDomain();
-                } else {
-                    /* The domain has a valid TLD! */
-                    return cookie;
-                }
-
-            } else if (rule->type == TLDRuleTypeWildcard && wildCardExceptionDepth == domainDepth-1) {
-                /* The domain falls within a wildcard TLD, but has an exception rule -- it's valid! */
-                return cookie;
-
-            } else {
-                // Unreachable, unless we screwed up!
-                __builtin_trap();
-            }
+
+    if (!isfinite(nextExpiry)) {
+        dispatch_source_set_timer(_expiryTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+
+    /* Expiry dates are wall clock times, and the timer is one-shot; each firing will reschedule it as required. Far
+     * future expiries would overflow the timer's nanosecond delay, and are clamped. */
+    CFTimeInterval delay = MIN(MAX(0, nextExpiry - CFAbsoluteTimeGetCurrent()), ANTCookieJarMaximumExpiryTimerDelay);
+    dispatch_source_set_timer(_expiryTimer, dispatch_walltime(NULL, (int64_t) (delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, NSEC_PER_SEC);
+}
+
+/**
+ * @internal
+ *
+ * Prune all expired cookies from the receiver, and re-arm the expiry timer.
+ */
+- (void) removeExpiredCookies {
+    [self updateSnapshot: ^(ANTCookieTrie *current) {
+        return current;
+    }];
+
+    /* If the timer was clamped short of the next expiry, nothing was pruned, and it must be re-armed */
+    OSSpinLockLock(&_writeLock); {
+        [self scheduleExpiryTimer: ((__bridge ANTCookieJarSnapshot *) _snapshot).nextExpiry];
+    } OSSpinLockUnlock(&_writeLock);
+}
+
+/**
+ * @internal
+ *
+ * Replace the current snapshot's cookies with the result of @a block. Writers are serialized; readers are not blocked, and
+ * will continue to see the previous snapshot until the new snapshot is published.
+ *
+ * @param block A block that will be called with the current snapshot's cookies, and must return their replacement. The
+ * block is called with _writeLock held, and is responsible for adding entries for any newly added cookies to the
+ * expiry heap. Any expired cookies will be pruned from the returned trie prior to publication.
+ *
+ * @return Returns the change in the number of cookies held by the receiver.
+ */
+- (NSInteger) updateSnapshot: (ANTCookieTrie *(^)(ANTCookieTrie *current)) block {
+    NSInteger delta;
+    OSSpinLockLock(&_writeLock); {
+        void *current = _snapshot;
+        ANTCookieTrie *currentTrie = ((__bridge ANTCookieJarSnapshot *) current).trie;
+        CFAbsoluteTime currentExpiry = ((__bridge ANTCookieJarSnapshot *) current).nextExpiry;
+        uint64_t currentGeneration = ((__bridge ANTCookieJarSnapshot *) current).generation;
+        ANTPersistentMap *currentStamps = _accessStamps;
+
+        if (_expiryHeapStale)
+            [self rebuildExpiryHeapWithTrie: currentTrie];
+
+        CFAbsoluteTime nextExpiry;
+        ANTCookieTrie *trie = block(currentTrie);
+        trie = [self trieByRemovingExpiredCookies: trie now: CFAbsoluteTimeGetCurrent() nextExpiry: &nextExpiry];
+
+        /* Drop entries for replaced and deleted cookies once they outnumber the live entries. */
+        if (CFBinaryHeapGetCount(_expiryHeap) > _expiryHeapCompactionThreshold)
+            [self rebuildExpiryHeapWithTrie: trie];
+
+        delta = (NSInteger) trie.count - (NSInteger) currentTrie.count;
+        if (trie != currentTrie || nextExpiry != currentExpiry || _accessStamps != currentStamps) {
+            ANTCookieJarSnapshot *next = [[ANTCookieJarSnapshot alloc] initWithTrie: trie
+                                                                       accessStamps: _accessStamps
+                                                                         nextExpiry: nextExpiry
+                                                                         generation: currentGeneration + 1
+                                                                       maxPathDepth: _maxPathDepth];
+
+            /* Publish the new snapshot */
+            ANTCookieJarPublish(&_snapshot, current, next);
+
+            if (nextExpiry != currentExpiry)
+                [self scheduleExpiryTimer: nextExpiry];
         }
-        
-        /* Find the next '.' */
-        nextDot = [lowercaseCookieDomain rangeOfCharacterFromSet: periodCharSet options: 0 range: NSMakeRange(nextDot.location+1, lowercaseCookieDomain.length - nextDot.location - 1)];
-    
-        /* Verify that our depth won't rollover. This really should *NEVER* happen ... */
-        if (domainDepth == NSIntegerMax-1) {
-            NSLog(@"The cookie domain components exceeded NSIntegerMax. That's sure some cookie!");
-            return ReplaceDomain();
+    } OSSpinLockUnlock(&_writeLock);
+
+    return delta;
+}
+
+/**
+ * @internal
+ *
+ * Return a new access stamp for @a now.
+ */
+- (uint64_t) accessStampForTime: (CFAbsoluteTime) now {
+    uint64_t seconds = (uint64_t) MAX(0, now);
+    uint64_t sequence = (uint64_t) OSAtomicIncrement64(&ANTCookieJarAccessSequence) & ((1 << ANT_COOKIE_JAR_ACCESS_SEQUENCE_BITS) - 1);
+    return (seconds << ANT_COOKIE_JAR_ACCESS_SEQUENCE_BITS) | sequence;
+}
+
+/**
+ * @internal
+ *
+ * Record @a cookies as having been accessed at @a now. Access stamps are only updated if the recorded time is older
+ * than ANTCookieJarAccessGranularity; otherwise, the stamps are only read. This will never block.
+ *
+ * @param cookies The accessed cookies.
+ * @param stamps The access stamps of the snapshot from which @a cookies were read.
+ * @param now The current time.
+ */
+- (void) markCookiesAccessed: (NSArray *) cookies stamps: (ANTPersistentMap *) stamps now: (CFAbsoluteTime) now {
+    int64_t owner = _accessStampOwner;
+    uint64_t seconds = (uint64_t) MAX(0, now);
+    for (NSHTTPCookie *cookie in cookies) {
+        ANTCookieJarAccessStamp *stamp = ANTCookieJarAccessStampForCookie(stamps, cookie);
+        if (stamp == nil || seconds - (stamp.stamp >> ANT_COOKIE_JAR_ACCESS_SEQUENCE_BITS) < ANTCookieJarAccessGranularity)
+            continue;
+
+        if (stamp.owner == owner)
+            stamp.stamp = [self accessStampForTime: now];
+        else
+            [self replaceAccessStampForCookie: cookie now: now];
+    }
+}
+
+/**
+ * @internal
+ *
+ * Record @a cookie as having been accessed at @a now, replacing its access stamp with one owned by the receiver. The
+ * replacement is published with the next snapshot. If a writer holds _writeLock, the access is not recorded; this will
+ * never block.
+ *
+ * @param cookie The accessed cookie.
+ * @param now The current time.
+ */
+- (void) replaceAccessStampForCookie: (NSHTTPCookie *) cookie now: (CFAbsoluteTime) now {
+    if (!OSSpinLockTry(&_writeLock))
+        return;
+
+    /* The stamp may already have been replaced since our snapshot was published, or the cookie removed */
+    ANTCookieJarAccessStamp *stamp = ANTCookieJarAccessStampForCookie(_accessStamps, cookie);
+    if (stamp != nil) {
+        if (stamp.owner == _accessStampOwner) {
+            stamp.stamp = [self accessStampForTime: now];
+        } else {
+            stamp = [[ANTCookieJarAccessStamp alloc] initWithCookie: cookie stamp: [self accessStampForTime: now] owner: _accessStampOwner];
+            _accessStamps = ANTCookieJarMapBySettingAccessStamp(_accessStamps, stamp);
         }
-        domainDepth++;
-    };
+    }
 
-    /* If a TLD rule was not found, the domain does not have a whitelisted TLD; we must reset the cookie
-     * to be hostname-only */
-    return ReplaceDomain();
+    OSSpinLockUnlock(&_writeLock);
 }
 
 /**
- * Returns an array of NSHTTPCookie objects corresponding to the provided response header fields for the provided URL.
- * The cookies will be validated to ensure that they correctly match @a theURL. Cookies specifying an invalid host
- * will be rewritten or discarded as necessary.
+ * @internal
  *
- * @param headerFields The header fields as returned from an NSHTTPURLResponse.
- * @param theURL The URL associated with the created cookies.
+ * Evict the @a count lowest ranked cookies in @a cookies from @a trie, as ranked by ANTCookieJarEvictionRank(). Must be
+ * called with _writeLock held.
  *
- * @sa ANTCookieJar::validateCookie:forURL:
+ * @param count The number of cookies to evict.
+ * @param cookies The eviction candidates, all of which must be present in @a trie.
+ * @param trie The trie from which cookies will be evicted.
  *
- * @note Unlike NSHTTPCookie's implementation, this method will validate the returned cookies host/domain values correctly
- * match @a theURL. Cookies specifying an invalid host will be rewritten or discarded as necessary.
+ * @return The trie with the evicted cookies removed.
  */
-+ (NSArray *) cookiesWithResponseHeaderFields: (NSDictionary *) headerFields forURL: (NSURL *) theURL {
-    NSArray *unfiltered = [NSHTTPCookie cookiesWithResponseHeaderFields: headerFields forURL: theURL];
-    NSMutableArray *results = [NSMutableArray arrayWithCapacity: unfiltered.count];
-    for (NSHTTPCookie *cookie in unfiltered) {
-        NSHTTPCookie *validated = [self validateCookie: cookie forURL: theURL];
-        if (validated != nil)
-            [results addObject: validated];
+- (ANTCookieTrie *) trieByEvictingCookies: (NSUInteger) count fromCandidates: (NSArray *) cookies trie: (ANTCookieTrie *) trie {
+    NSUInteger candidateCount = cookies.count;
+    count = MIN(count, candidateCount);
+    if (count == 0)
+        return trie;
+
+    ANTCookieJarEvictionCandidate *candidates = malloc(sizeof(ANTCookieJarEvictionCandidate) * candidateCount);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    NSUInteger i = 0;
+    for (NSHTTPCookie *cookie in cookies) {
+        candidates[i].cookie = cookie;
+        candidates[i].rank = ANTCookieJarEvictionRank(cookie, _accessStamps, now);
+        candidates[i].shard = 0;
+        i++;
     }
 
-    return results;
+    qsort(candidates, candidateCount, sizeof(ANTCookieJarEvictionCandidate), ANTCookieJarEvictionCompare);
+
+    for (i = 0; i < count; i++) {
+        const void *key = (__bridge const void *) candidates[i].cookie;
+        trie = [trie trieByRemovingIdenticalCookie: candidates[i].cookie];
+        _accessStamps = [_accessStamps mapByRemovingObjectForKeyBytes: &key length: sizeof(key)];
+    }
+
+    free(candidates);
+    return trie;
 }
 
 /**
- * Initialize a new instance.
+ * @internal
+ *
+ * Enforce the receiver's cookie limits on @a trie, following the addition of a cookie with @a domain. Must be called with
+ * _writeLock held.
+ *
+ * @param trie The trie to which the cookie was added.
+ * @param domain The added cookie's domain.
+ *
+ * @return The trie with any excess cookies evicted.
  */
-- (instancetype) init {
-    PLSuperInit();
-    
-    _lock = OS_SPINLOCK_INIT;
-    _storage = [NSMutableDictionary dictionary];
+- (ANTCookieTrie *) trieByEnforcingLimits: (ANTCookieTrie *) trie domain: (NSString *) domain {
+    /* Per-domain limit */
+    NSString *registrableDomain = ANTCookieJarRegistrableDomain(domain);
+    NSUInteger domainCount = [trie countOfCookiesInDomain: registrableDomain];
+    if (domainCount > _maxCookiesPerDomain) {
+        NSMutableArray *candidates = [NSMutableArray arrayWithCapacity: domainCount];
+        [trie enumerateCookiesInDomain: registrableDomain usingBlock: ^(NSHTTPCookie *cookie) {
+            [candidates addObject: cookie];
+        }];
 
-    return self;
+        trie = [self trieByEvictingCookies: domainCount - ANTCookieJarPurgeTarget(_maxCookiesPerDomain) fromCandidates: candidates trie: trie];
+    }
+
+    /* Global limit */
+    NSUInteger count = trie.count;
+    if (count > _maxCookies) {
+        NSMutableArray *candidates = [NSMutableArray arrayWithCapacity: count];
+        [trie enumerateCookiesUsingBlock: ^(NSHTTPCookie *cookie) {
+            [candidates addObject: cookie];
+        }];
+
+        trie = [self trieByEvictingCookies: count - ANTCookieJarPurgeTarget(_maxCookies) fromCandidates: candidates trie: trie];
+    }
+
+    /* Drop access stamps for replaced and deleted cookies once they outnumber the live entries. */
+    if (_accessStamps.count > _accessStampsCompactionThreshold)
+        [self compactAccessStampsWithTrie: trie];
+
+    return trie;
 }
 
-// from NSCopying
-- (instancetype) mutableCopyWithZone: (NSZone *) zone {
-    ANTCookieJar *copy = [ANTCookieJar new];
-
-    OSSpinLockLock(&_lock); {
-        for (NSString *domain in _storage) {
-            for (NSString *path in _storage[domain]) {
-                for (NSString *name in _storage[domain][path]) {
-                    [copy setCookie: _storage[domain][path][name]];
-                }
-            }
-        }
-    } OSSpinLockUnlock(&_lock);
-    
-    return copy;
+/**
+ * @internal
+ *
+ * Discard all access stamps for cookies not present in @a trie. Must be called with _writeLock held.
+ *
+ * @param trie The live cookies.
+ */
+- (void) compactAccessStampsWithTrie: (ANTCookieTrie *) trie {
+    ANTPersistentMap *stamps = _accessStamps;
+    __block ANTPersistentMap *compacted = [ANTPersistentMap new];
+    [trie enumerateCookiesUsingBlock: ^(NSHTTPCookie *cookie) {
+        ANTCookieJarAccessStamp *stamp = ANTCookieJarAccessStampForCookie(stamps, cookie);
+        if (stamp != nil)
+            compacted = ANTCookieJarMapBySettingAccessStamp(compacted, stamp);
+    }];
+
+    _accessStamps = compacted;
+    _accessStampsCompactionThreshold = MAX(ANTCookieJarAccessCompactionMinimum, compacted.count * 2);
 }
 
 /**
- * Add @a aCookie to the receiver.
+ * Add @a aCookie to the receiver. If the receiver's cookie limits are exceeded, expired and least recently accessed
+ * cookies will be evicted.
  *
  * @param aCookie The cookie to be added.
  */
 - (void) setCookie: (NSHTTPCookie *) aCookie {
-    /* Fetches 'key' in 'source', creating the value via 'create' if not availabile. */
-    id (^getOrCreate)(NSMutableDictionary *source, id key, id (^create)(void)) = ^(NSMutableDictionary *source, id key, id (^create)(void)) {
-        id obj = source[key];
-        if (obj != nil)
-            return obj;
-        
-        obj = create();
-        source[key] = obj;
-        return obj;
-    };
+    if (_sharded) {
+        __block NSInteger delta = 0;
+        [self modifyShardForDomain: ANTCookieJarRegistrableDomain(aCookie.domain) create: YES block: ^(ANTCookieJar *shard) {
+            delta = [shard addCookie: aCookie];
+        }];
+        [self addShardedCookieCount: delta];
+        return;
+    }
+
+    [self addCookie: aCookie];
+}
+
+/**
+ * @internal
+ *
+ * Add @a aCookie to an unsharded receiver, evicting cookies as necessary.
+ *
+ * @param aCookie The cookie to be added.
+ *
+ * @return Returns the change in the number of cookies held by the receiver.
+ */
+- (NSInteger) addCookie: (NSHTTPCookie *) aCookie {
+    return [self updateSnapshot: ^(ANTCookieTrie *current) {
+        [self addExpiryEntryForCookie: aCookie];
+        ANTCookieJarAccessStamp *stamp = [[ANTCookieJarAccessStamp alloc] initWithCookie: aCookie
+                                                                                      stamp: [self accessStampForTime: CFAbsoluteTimeGetCurrent()]
+                                                                                      owner: _accessStampOwner];
+        _accessStamps = ANTCookieJarMapBySettingAccessStamp(_accessStamps, stamp);
+        _maxPathDepth = MAX(_maxPathDepth, ANTCookieJarPathDepth(aCookie.path));
 
-    /* Add the cookie */
-    OSSpinLockLock(&_lock); {
-        NSMutableDictionary *domain = getOrCreate(_storage, aCookie.domain, ^{ return [NSMutableDictionary new]; });
-        NSMutableDictionary *cookies = getOrCreate(domain, aCookie.path, ^{ return [NSMutableDictionary new]; });
-        cookies[aCookie.name] = aCookie;
-    } OSSpinLockUnlock(&_lock);
+        ANTCookieTrie *trie = [current trieByAddingCookie: aCookie];
+        return [self trieByEnforcingLimits: trie domain: aCookie.domain];
+    }];
 }
 
 /**
@@ -270,104 +1977,282 @@ typedef enum {
  * @param aCookie The cookie to be deleted.
  */
 - (void) deleteCookie: (NSHTTPCookie *) aCookie {
-    OSSpinLockLock(&_lock); {
-        [_storage[aCookie.domain][aCookie.path] removeObjectForKey: aCookie.name];
+    if (_sharded) {
+        __block NSInteger delta = 0;
+        [self modifyShardForDomain: ANTCookieJarRegistrableDomain(aCookie.domain) create: NO block: ^(ANTCookieJar *shard) {
+            delta = [shard updateSnapshot: ^(ANTCookieTrie *current) {
+                return [current trieByRemovingCookie: aCookie];
+            }];
+        }];
+        [self addShardedCookieCount: delta];
+        return;
+    }
 
-        /* Clean up empty path entries */
-        if ([_storage[aCookie.domain][aCookie.path] count] == 0)
-            [_storage[aCookie.domain] removeObjectForKey: aCookie.path];
-        
-        /* Clean up empty domains */
-        if ([_storage[aCookie.domain] count] == 0)
-            [_storage removeObjectForKey: aCookie.domain];
-    }; OSSpinLockUnlock(&_lock);
+    [self updateSnapshot: ^(ANTCookieTrie *current) {
+        return [current trieByRemovingCookie: aCookie];
+    }];
 }
 
+/**
+ * @internal
+ *
+ * Remove the given cookie instances from an unsharded receiver.
+ *
+ * @param cookies The cookies to be removed.
+ *
+ * @return Returns the change in the number of cookies held by the receiver.
+ */
+- (NSInteger) removeIdenticalCookies: (NSArray *) cookies {
+    return [self updateSnapshot: ^(ANTCookieTrie *current) {
+        ANTCookieTrie *trie = current;
+        for (NSHTTPCookie *cookie in cookies) {
+            const void *key = (__bridge const void *) cookie;
+            trie = [trie trieByRemovingIdenticalCookie: cookie];
+            _accessStamps = [_accessStamps mapByRemovingObjectForKeyBytes: &key length: sizeof(key)];
+        }
+
+        return trie;
+    }];
+}
 
+/**
+ * @internal
+ *
+ * Add @a delta to the cookie count of a sharded receiver, enforcing the global cookie limit if it may have been exceeded.
+ *
+ * @param delta The change in the number of cookies held by the receiver's shards.
+ */
+- (void) addShardedCookieCount: (NSInteger) delta {
+    int64_t count = OSAtomicAdd64Barrier(delta, &_shardedCookieCount);
+    if (delta > 0 && count > 0 && (uint64_t) count > _maxCookies)
+        [self enforceShardedCookieLimit];
+}
 
 /**
- * Return all cookies associated with @a theURL.
+ * @internal
  *
- * @param theURL The target URL.
+ * Enforce the global cookie limit of a sharded receiver, evicting the lowest ranked cookies (see ANTCookieJarEvictionRank())
+ * from across all shards. The cookie count is recomputed from the shards, discounting any cookies pruned on expiry.
+ *
+ * Only one writer enforces the limit at a time; others return immediately, as the limit will be restored by the writer
+ * already enforcing it, or failing that, by the next writer to exceed it.
  */
-- (NSArray *) cookiesForURL: (NSURL *) theURL {
+- (void) enforceShardedCookieLimit {
+    if (!OSSpinLockTry(&_shardEvictionLock))
+        return;
+
+    /* Writers update the count after modifying their shard; any cookie counted in the observed value will be found
+     * in the shards below. */
+    int64_t observed = _shardedCookieCount;
+
+    /* The snapshots retain the cookies borrowed by the eviction candidates */
+    NSMutableArray *snapshots = [NSMutableArray array];
+    NSMutableArray *domains = [NSMutableArray array];
+    __block NSUInteger total = 0;
+    [[self shards] enumerateObjectsUsingBlock: ^(ANTCookieJarShard *shard) {
+        ANTCookieJarSnapshot *snapshot = [shard.jar snapshot];
+        [snapshots addObject: snapshot];
+        [domains addObject: shard.domain];
+        total += snapshot.trie.count;
+    }];
+
+    /* The (non-positive) change in the number of cookies held by the shards due to eviction */
+    __block NSInteger delta = 0;
+
+    if (total > _maxCookies) {
+        ANTCookieJarEvictionCandidate *candidates = malloc(sizeof(ANTCookieJarEvictionCandidate) * total);
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+        __block NSUInteger candidateCount = 0;
+        for (NSUInteger i = 0; i < snapshots.count; i++) {
+            ANTCookieJarSnapshot *snapshot = snapshots[i];
+            ANTPersistentMap *stamps = snapshot.accessStamps;
+            [snapshot.trie enumerateCookiesUsingBlock: ^(NSHTTPCookie *cookie) {
+                candidates[candidateCount].cookie = cookie;
+                candidates[candidateCount].rank = ANTCookieJarEvictionRank(cookie, stamps, now);
+                candidates[candidateCount].shard = i;
+                candidateCount++;
+            }];
+        }
+
+        qsort(candidates, candidateCount, sizeof(ANTCookieJarEvictionCandidate), ANTCookieJarEvictionCompare);
+
+        /* Group the evicted cookies by shard, so that each shard is updated once */
+        NSMutableDictionary *evicted = [NSMutableDictionary dictionary];
+        NSUInteger count = MIN(candidateCount, total - ANTCookieJarPurgeTarget(_maxCookies));
+        for (NSUInteger i = 0; i < count; i++) {
+            NSMutableArray *cookies = evicted[@(candidates[i].shard)];
+            if (cookies == nil) {
+                cookies = [NSMutableArray array];
+                evicted[@(candidates[i].shard)] = cookies;
+            }
+            [cookies addObject: candidates[i].cookie];
+        }
+        free(candidates);
+
+        [evicted enumerateKeysAndObjectsUsingBlock: ^(NSNumber *shard, NSArray *cookies, BOOL *stop) {
+            [self modifyShardForDomain: domains[[shard unsignedIntegerValue]] create: NO block: ^(ANTCookieJar *writable) {
+                delta += [writable removeIdenticalCookies: cookies];
+            }];
+        }];
+    }
+
+    OSAtomicAdd64Barrier((int64_t) total + (int64_t) delta - observed, &_shardedCookieCount);
+    OSSpinLockUnlock(&_shardEvictionLock);
+}
+
+/**
+ * @internal
+ *
+ * Return YES if @a theURL uses a scheme supported by the cookie jar, setting @a secure to YES if the scheme is secure.
+ */
+static BOOL ANTCookieJarSchemeIsSupported (NSURL *theURL, BOOL *secure) {
     /* Check if secure */
-    BOOL secure = NO;
+    *secure = NO;
     if ([[theURL scheme] compare: @"https" options: NSCaseInsensitiveSearch] == NSOrderedSame)
-        secure = YES;
+        *secure = YES;
 
     /* Only HTTP/HTTPS are supported */
     if (![theURL.scheme isEqual: @"http"] && ![theURL.scheme isEqual: @"https"])
-        return @[];
+        return NO;
 
+    return YES;
+}
+
+/**
+ * @internal
+ *
+ * Return all cookies in @a snapshot associated with @a theURL.
+ *
+ * @param snapshot The snapshot to be searched.
+ * @param theURL The target URL.
+ * @param secure YES if @a theURL uses a secure scheme.
+ */
+static NSArray *ANTCookieJarCookiesForURL (ANTCookieJarSnapshot *snapshot, NSURL *theURL, BOOL secure) {
     /* As per RFC 2965, we can ignore the port list attribute; cookies
      * do not provide isolation by port within a given domain. */
     NSMutableArray *results = [NSMutableArray array];
-    OSSpinLockLock(&_lock); {
-        for (NSString *domain in _storage) {
-            /* Verify that the domain matches */
-            NSString *urlPrefixHost = theURL.host;
-            if (![urlPrefixHost hasPrefix: @"."])
-                urlPrefixHost = [@"." stringByAppendingString: urlPrefixHost];
-            
-            if (![domain isEqual: theURL.host] && !([domain hasPrefix: @"."] && [urlPrefixHost hasSuffix: domain]))
-                continue;
-            
-            /* Find all matching paths */
-            for (NSString *path in _storage[domain]) {
-                /* Check the path -- we rewrite empty paths to '/' for comparison. */
-                NSString *urlPath = theURL.path;
-                if ([urlPath length] == 0)
-                    urlPath = @"/";
-
-                if (![urlPath hasPrefix: path])
-                    continue;
-                
-                /* Iterate all cookies within the path */
-                NSDate *now = [NSDate date];
-                NSMutableArray *expired = [NSMutableArray array];
-                for (NSString *name in _storage[domain][path]) {
-                    NSHTTPCookie *cookie = _storage[domain][path][name];
-                    
-                    /* Check for expiration */
-                    if (cookie.expiresDate != nil && [[cookie.expiresDate laterDate: now] isEqual: now]) {
-                        [expired addObject: name];
-                        continue;
-                    }
-                    
-                    /* Check for 'secure' flag; we don't provide non-secure cookies for secure connections. */
-                    if (cookie.isSecure != secure)
-                        continue;
-                    
-                    /* Add to results */
-                    [results addObject: cookie];
-                }
-                
-                /* Clean up expired cookies */
-                for (NSString *name in expired) {
-                    [_storage[domain][path] removeObjectForKey: name];
-                }
-                
-                if ([_storage[domain][path] count] == 0)
-                    [_storage[domain] removeObjectForKey: path];
-            }
-            
-            /* Clean up empty domains */
-            if ([_storage[domain] count] == 0)
-                [_storage removeObjectForKey: domain];
-        }
-    } OSSpinLockUnlock(&_lock);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    /* Individual cookies only need to be checked if the expiry timer has not yet pruned the snapshot. */
+    BOOL checkExpiry = (now >= snapshot.nextExpiry);
+
+    [snapshot.trie enumerateCookiesForHost: theURL.host path: theURL.path usingBlock: ^(NSHTTPCookie *cookie) {
+        /* Skip expired cookies; they'll be pruned by the expiry timer or the next writer. */
+        if (checkExpiry && ANTCookieJarIsExpired(cookie, now))
+            return;
+        
+        /* Check for 'secure' flag; we don't provide non-secure cookies for secure connections. */
+        if (cookie.isSecure != secure)
+            return;
+        
+        /* Add to results */
+        [results addObject: cookie];
+    }];
     
     return results;
 }
 
+/**
+ * Return all cookies associated with @a theURL.
+ *
+ * @param theURL The target URL.
+ */
+- (NSArray *) cookiesForURL: (NSURL *) theURL {
+    if (_sharded) {
+        ANTCookieJar *shard = [self shardForDomain: ANTCookieJarRegistrableDomain(theURL.host)];
+        return shard != nil ? [shard cookiesForURL: theURL] : @[];
+    }
+
+    BOOL secure;
+    if (!ANTCookieJarSchemeIsSupported(theURL, &secure))
+        return @[];
+
+    ANTCookieJarSnapshot *snapshot = [self snapshot];
+    NSArray *cookies = ANTCookieJarCookiesForURL(snapshot, theURL, secure);
+    [self markCookiesAccessed: cookies stamps: snapshot.accessStamps now: CFAbsoluteTimeGetCurrent()];
+
+    return cookies;
+}
+
+/**
+ * Return the request header fields for all cookies associated with @a theURL, as per
+ * +[NSHTTPCookie requestHeaderFieldsWithCookies:].
+ *
+ * Serialized header fields are cached by request host, path, and security, and are reused until the receiver
+ * is next modified; repeated requests to the same resource do not need to re-enumerate or re-serialize the
+ * matching cookies.
+ *
+ * @param theURL The target URL.
+ */
+- (NSDictionary *) requestHeaderFieldsForURL: (NSURL *) theURL {
+    if (_sharded) {
+        ANTCookieJar *shard = [self shardForDomain: ANTCookieJarRegistrableDomain(theURL.host)];
+        return shard != nil ? [shard requestHeaderFieldsForURL: theURL] : @{};
+    }
+
+    BOOL secure;
+    if (!ANTCookieJarSchemeIsSupported(theURL, &secure))
+        return @{};
+
+    /* Cached entries are only valid until the next cookie expiry; the expiry timer will publish a new snapshot shortly after. */
+    ANTCookieJarSnapshot *snapshot = [self snapshot];
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    if (now >= snapshot.nextExpiry) {
+        NSArray *cookies = ANTCookieJarCookiesForURL(snapshot, theURL, secure);
+        [self markCookiesAccessed: cookies stamps: snapshot.accessStamps now: now];
+        return [NSHTTPCookie requestHeaderFieldsWithCookies: cookies];
+    }
+
+    NSString *host = theURL.host;
+    NSString *path = theURL.path;
+    ANTCookieJarHeaderCacheKey key;
+    ANTCookieJarHeaderCacheKeyInit(&key, host, path, secure, snapshot.maxPathDepth);
+
+    ANTCookieJarHeaderCacheEntry *entry = [snapshot headerCacheEntryForKey: &key];
+    if (entry != nil) {
+        /* Cache hits only need to update the cookies' access times once per access granularity interval */
+        if ([entry markAccessed: now])
+            [self markCookiesAccessed: entry.cookies stamps: snapshot.accessStamps now: now];
+        return entry.headers;
+    }
+
+    /* Populate the snapshot's cache */
+    NSArray *cookies = ANTCookieJarCookiesForURL(snapshot, theURL, secure);
+    [self markCookiesAccessed: cookies stamps: snapshot.accessStamps now: now];
+
+    NSDictionary *headers = [NSHTTPCookie requestHeaderFieldsWithCookies: cookies];
+    [snapshot addHeaderCacheEntry: [[ANTCookieJarHeaderCacheEntry alloc] initWithKey: &key headers: headers cookies: cookies accessTime: now]];
+
+    return headers;
+}
+
 /**
  * Delete all cookies stored in the receiver.
  */
 - (void) deleteAllCookies {
-    OSSpinLockLock(&_lock); {
-        [_storage removeAllObjects];
-    } OSSpinLockUnlock(&_lock);
+    if (_sharded) {
+        /* Shards may be shared with copies of the receiver; rather than emptying them, they're discarded. */
+        OSSpinLockLock(&_shardLock); {
+            ANTCookieJarPublish(&_shards, _shards, [ANTPersistentMap new]);
+        } OSSpinLockUnlock(&_shardLock);
+
+        /* Concurrent writers may have counted cookies added to the discarded shards; the count is an upper bound, and
+         * will be corrected when the limit is next enforced. */
+        OSAtomicAdd64Barrier(-_shardedCookieCount, &_shardedCookieCount);
+        return;
+    }
+
+    [self updateSnapshot: ^(ANTCookieTrie *current) {
+        CFBinaryHeapRemoveAllValues(_expiryHeap);
+        _expiryHeapStale = NO;
+        _maxPathDepth = 0;
+
+        _accessStamps = [ANTPersistentMap new];
+        _accessStampsCompactionThreshold = ANTCookieJarAccessCompactionMinimum;
+
+        return [ANTCookieTrie new];
+    }];
 }
 
 @end
@@ -79,6 +79,59 @@
     /* Unknown TLD handling */
     TestCookie(@"n=v;domain=.domain.invaltld", @"http://host.domain.invaltld", @"host.domain.invaltld");
 
+    /* Internationalized domains are matched, and stored, in their ASCII form */
+    TestCookie(@"n=v;domain=.b\u00FCcher.de", @"http://www.xn--bcher-kva.de", @".xn--bcher-kva.de");
+    TestCookie(@"n=v;domain=.B\u00DCCHER.de", @"http://www.xn--bcher-kva.de", @".xn--bcher-kva.de");
+    TestCookie(@"n=v;domain=.XN--BCHER-KVA.de", @"http://www.xn--bcher-kva.de", @".xn--bcher-kva.de");
+    TestCookie(@"n=v;domain=.\u516C\u53F8.cn", @"http://host.xn--55qx5d.cn", @"host.xn--55qx5d.cn");
+
+    NSHTTPCookie *cookie = [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".b\u00FCcher.de",
+        NSHTTPCookieName : @"n",
+        NSHTTPCookiePath : @"/",
+        NSHTTPCookieValue : @"v"
+    }];
+    XCTAssertEqualObjects([ANTCookieJar validateCookie: cookie forURL: [NSURL URLWithString: @"http://www.xn--bcher-kva.de"]].domain, @".xn--bcher-kva.de", @"The domain was not converted");
+}
+
+/**
+ * Test parsing of coalesced Set-Cookie headers and cookie attributes.
+ */
+- (void) testParseCookieAttributes {
+    NSString *header = @"a=1; Expires=Wed, 09 Jun 2021 10:18:14 GMT; Path=/x; Secure, b=2; Domain=Example.ORG; Max-Age=60, noequals, c=3";
+    NSArray *cookies = [ANTCookieJar cookiesWithResponseHeaderFields: @{ @"Set-Cookie": header } forURL: [NSURL URLWithString: @"https://www.example.org/dir/page"]];
+    XCTAssertEqual([cookies count], (NSUInteger) 3, @"Incorrect number of cookies parsed: %@", cookies);
+    if (cookies.count != 3)
+        return;
+
+    NSHTTPCookie *a = cookies[0];
+    XCTAssertEqualObjects(a.name, @"a", @"Incorrect name");
+    XCTAssertEqualObjects(a.path, @"/x", @"Incorrect path");
+    XCTAssertEqualObjects(a.domain, @"www.example.org", @"Host-only cookie should use the URL host");
+    XCTAssertTrue(a.isSecure, @"Cookie should be secure");
+    XCTAssertEqual([a.expiresDate timeIntervalSince1970], (NSTimeInterval) 1623233894, @"Incorrect expiry");
+
+    NSHTTPCookie *b = cookies[1];
+    XCTAssertEqualObjects(b.domain, @".example.org", @"Domain should be normalized");
+    XCTAssertEqualObjects(b.path, @"/dir", @"The default path should be used");
+    XCTAssertEqualWithAccuracy([b.expiresDate timeIntervalSinceNow], (NSTimeInterval) 60, 5, @"Max-Age was not applied");
+
+    NSHTTPCookie *c = cookies[2];
+    XCTAssertEqualObjects(c.value, @"3", @"Incorrect value");
+    XCTAssertTrue(c.isSessionOnly, @"Cookie should be session-only");
+}
+
+/**
+ * Test that Set-Cookie values that can't be parsed as UTF-8 strings are skipped.
+ */
+- (void) testParseInvalidHeaderValues {
+    const unichar unpaired[] = { 'a', '=', 0xD800 };
+    NSString *invalid = [NSString stringWithCharacters: unpaired length: sizeof(unpaired) / sizeof(unpaired[0])];
+    NSURL *url = [NSURL URLWithString: @"https://www.example.org/"];
+
+    XCTAssertEqual([[ANTCookieJar cookiesWithResponseHeaderFields: @{ @"Set-Cookie": invalid } forURL: url] count], (NSUInteger) 0, @"Cookie parsed from an invalid string");
+    XCTAssertEqual([[ANTCookieJar cookiesWithResponseHeaderFields: @{ @"Set-Cookie": @[ @"a=1" ] } forURL: url] count], (NSUInteger) 0, @"Cookie parsed from a non-string value");
+    XCTAssertEqual([[ANTCookieJar cookiesWithResponseHeaderFields: @{ @"Set-Cookie": invalid, @"set-cookie": @"b=2" } forURL: url] count], (NSUInteger) 1, @"Valid header skipped");
 }
 
 - (void) testSetDeleteCookie {
@@ -101,6 +154,67 @@
     XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"https://example.org/path"]] count], (NSUInteger) 0, @"Cookie not deleted");
 }
 
+- (void) testCookieLimits {
+    ANTCookieJar *jar = [[ANTCookieJar alloc] initWithMaxCookies: 20 maxCookiesPerDomain: 10];
+    NSHTTPCookie *(^MakeCookie)(NSString *domain, NSUInteger i) = ^(NSString *domain, NSUInteger i) {
+        return [NSHTTPCookie cookieWithProperties: @{
+            NSHTTPCookieDomain : domain,
+            NSHTTPCookieName : [NSString stringWithFormat: @"c%lu", (unsigned long) i],
+            NSHTTPCookiePath : @"/",
+            NSHTTPCookieValue : @"val"
+        }];
+    };
+
+    /* Subdomains share their registrable domain's limit */
+    for (NSUInteger i = 0; i < 10; i++)
+        [jar setCookie: MakeCookie(i % 2 ? @".example.org" : @"www.example.org", i)];
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://www.example.org/"]] count], (NSUInteger) 10, @"Cookies should not have been evicted");
+
+    /* Exceeding the limit evicts in bulk */
+    [jar setCookie: MakeCookie(@".example.org", 10)];
+    NSArray *cookies = [jar cookiesForURL: [NSURL URLWithString: @"http://www.example.org/"]];
+    XCTAssertEqual([cookies count], (NSUInteger) 9, @"Excess cookies were not evicted");
+    XCTAssertTrue([[cookies valueForKey: @"name"] containsObject: @"c10"], @"The new cookie should not have been evicted");
+
+    /* The global limit applies across domains */
+    for (NSUInteger i = 0; i < 30; i++)
+        [jar setCookie: MakeCookie([NSString stringWithFormat: @"host%lu.org", (unsigned long) i], i)];
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://host29.org/"]] count], (NSUInteger) 1, @"The most recent cookie should not have been evicted");
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://host0.org/"]] count], (NSUInteger) 0, @"The least recently used cookie should have been evicted");
+}
+
+- (void) testShardedCookieLimits {
+    ANTCookieJar *jar = [[ANTCookieJar alloc] initShardedWithMaxCookies: 20 maxCookiesPerDomain: 10];
+    NSHTTPCookie *(^MakeCookie)(NSString *domain, NSUInteger i) = ^(NSString *domain, NSUInteger i) {
+        return [NSHTTPCookie cookieWithProperties: @{
+            NSHTTPCookieDomain : domain,
+            NSHTTPCookieName : [NSString stringWithFormat: @"c%lu", (unsigned long) i],
+            NSHTTPCookiePath : @"/",
+            NSHTTPCookieValue : @"val"
+        }];
+    };
+
+    /* The per-domain limit is enforced within the domain's shard */
+    for (NSUInteger i = 0; i < 11; i++)
+        [jar setCookie: MakeCookie(@".example.org", i)];
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://www.example.org/"]] count], (NSUInteger) 9, @"Excess cookies were not evicted");
+
+    /* The global limit applies across shards */
+    for (NSUInteger i = 0; i < 30; i++)
+        [jar setCookie: MakeCookie([NSString stringWithFormat: @"host%lu.org", (unsigned long) i], i)];
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://host29.org/"]] count], (NSUInteger) 1, @"The most recent cookie should not have been evicted");
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://host0.org/"]] count], (NSUInteger) 0, @"The least recently used cookie should have been evicted");
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://www.example.org/"]] count], (NSUInteger) 0, @"The least recently used shard should have been emptied");
+
+    /* Copies enforce the same limit */
+    ANTCookieJar *copy = [jar mutableCopy];
+    XCTAssertEqual(copy.maxCookies, (NSUInteger) 20, @"Incorrect limit");
+    for (NSUInteger i = 30; i < 60; i++)
+        [copy setCookie: MakeCookie([NSString stringWithFormat: @"host%lu.org", (unsigned long) i], i)];
+    XCTAssertEqual([[copy cookiesForURL: [NSURL URLWithString: @"http://host29.org/"]] count], (NSUInteger) 0, @"The least recently used cookie should have been evicted");
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://host29.org/"]] count], (NSUInteger) 1, @"Evicting from a copy should not modify the original");
+}
+
 - (void) testCopy {
     /* Test set */
     ANTCookieJar *jar = [ANTCookieJar new];
@@ -118,6 +232,95 @@
     
     XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"https://example.org"]] count], (NSUInteger) 1, @"Cookie not found");
     XCTAssertEqual([[copy cookiesForURL: [NSURL URLWithString: @"https://example.org"]] count], (NSUInteger) 1, @"Cookie not found");
+    
+    /* Modifications to the copy must not be visible in the original */
+    [copy deleteCookie: cookie];
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"https://example.org"]] count], (NSUInteger) 1, @"Cookie deleted from the original");
+    XCTAssertEqual([[copy cookiesForURL: [NSURL URLWithString: @"https://example.org"]] count], (NSUInteger) 0, @"Cookie not deleted from the copy");
+}
+
+/**
+ * Copies share their cookies and access stamps with the original; the cost of a copy must not grow with the number
+ * of cookies in the jar.
+ */
+- (void) testCopyCost {
+    ANTCookieJar *(^MakeJar)(NSUInteger count) = ^(NSUInteger count) {
+        ANTCookieJar *jar = [[ANTCookieJar alloc] initWithMaxCookies: NSUIntegerMax maxCookiesPerDomain: NSUIntegerMax];
+        for (NSUInteger i = 0; i < count; i++) {
+            [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+                NSHTTPCookieDomain : [NSString stringWithFormat: @"host%lu.org", (unsigned long) (i % 100)],
+                NSHTTPCookieName : [NSString stringWithFormat: @"c%lu", (unsigned long) i],
+                NSHTTPCookiePath : @"/",
+                NSHTTPCookieValue : @"val"
+            }]];
+        }
+        return jar;
+    };
+
+    /* Return the fastest of several batches of copies, in seconds */
+    NSTimeInterval (^MeasureCopy)(ANTCookieJar *jar) = ^(ANTCookieJar *jar) {
+        NSTimeInterval best = INFINITY;
+        for (NSUInteger batch = 0; batch < 5; batch++) {
+            NSTimeInterval start = [[NSProcessInfo processInfo] systemUptime];
+            for (NSUInteger i = 0; i < 200; i++) {
+                @autoreleasepool {
+                    (void) [jar mutableCopy];
+                }
+            }
+            best = MIN(best, [[NSProcessInfo processInfo] systemUptime] - start);
+        }
+        return best;
+    };
+
+    /* A copy that visited every cookie would be ~100x slower for the larger jar */
+    NSTimeInterval small = MeasureCopy(MakeJar(30));
+    NSTimeInterval large = MeasureCopy(MakeJar(3000));
+    XCTAssertLessThan(large, MAX(small, 0.001) * 10, @"Copy cost grows with the number of cookies (%f vs %f)", large, small);
+
+    /* The copy's cookies are unaffected by accesses and modifications of the original */
+    ANTCookieJar *jar = MakeJar(3000);
+    ANTCookieJar *copy = [jar mutableCopy];
+    [jar deleteAllCookies];
+    XCTAssertEqual([[copy cookiesForURL: [NSURL URLWithString: @"http://host0.org/"]] count], (NSUInteger) 30, @"Cookies not found in the copy");
+}
+
+- (void) testShardedCopy {
+    ANTCookieJar *jar = [[ANTCookieJar alloc] initSharded];
+    NSHTTPCookie *(^MakeCookie)(NSString *domain) = ^(NSString *domain) {
+        return [NSHTTPCookie cookieWithProperties: @{
+            NSHTTPCookieDomain : domain,
+            NSHTTPCookieName : @"peanut",
+            NSHTTPCookiePath : @"/",
+            NSHTTPCookieValue : @"val"
+        }];
+    };
+    NSURL *orgURL = [NSURL URLWithString: @"http://www.example.org/"];
+    NSURL *netURL = [NSURL URLWithString: @"http://www.example.net/"];
+
+    /* Cookies for a registrable domain are found from any of its hosts */
+    [jar setCookie: MakeCookie(@".example.org")];
+    [jar setCookie: MakeCookie(@"www.example.net")];
+    XCTAssertEqual([[jar cookiesForURL: orgURL] count], (NSUInteger) 1, @"Cookie not found");
+    XCTAssertEqual([[jar cookiesForURL: netURL] count], (NSUInteger) 1, @"Cookie not found");
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://example.com/"]] count], (NSUInteger) 0, @"Unexpected cookie");
+
+    /* Shards are shared with the copy until modified by either jar */
+    ANTCookieJar *copy = [jar mutableCopy];
+    [copy deleteCookie: MakeCookie(@".example.org")];
+    [jar deleteCookie: MakeCookie(@"www.example.net")];
+    [copy setCookie: MakeCookie(@".example.com")];
+
+    XCTAssertEqual([[jar cookiesForURL: orgURL] count], (NSUInteger) 1, @"Cookie deleted from the original");
+    XCTAssertEqual([[jar cookiesForURL: netURL] count], (NSUInteger) 0, @"Cookie not deleted from the original");
+    XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"http://example.com/"]] count], (NSUInteger) 0, @"Cookie added to the original");
+
+    XCTAssertEqual([[copy cookiesForURL: orgURL] count], (NSUInteger) 0, @"Cookie not deleted from the copy");
+    XCTAssertEqual([[copy cookiesForURL: netURL] count], (NSUInteger) 1, @"Cookie deleted from the copy");
+    XCTAssertEqual([[copy cookiesForURL: [NSURL URLWithString: @"http://example.com/"]] count], (NSUInteger) 1, @"Cookie not added to the copy");
+
+    [copy deleteAllCookies];
+    XCTAssertEqual([[copy cookiesForURL: netURL] count], (NSUInteger) 0, @"Cookie not deleted from the copy");
+    XCTAssertEqual([[jar cookiesForURL: orgURL] count], (NSUInteger) 1, @"Cookie deleted from the original");
 }
 
 - (void) testNonHTTP {
@@ -136,6 +339,66 @@
     XCTAssertEqual([[jar cookiesForURL: [NSURL URLWithString: @"x-wat-protocol://example.org"]] count], (NSUInteger) 0, @"Cookie not found");
 }
 
+- (void) testRequestHeaderFieldsForURL {
+    ANTCookieJar *jar = [ANTCookieJar new];
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"name",
+        NSHTTPCookiePath : @"/path",
+        NSHTTPCookieValue : @"value"
+    }]];
+
+    NSURL *url = [NSURL URLWithString: @"http://www.example.org/path/subpath"];
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: url], @{ @"Cookie" : @"name=value" }, @"Incorrect header fields returned");
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: url], @{ @"Cookie" : @"name=value" }, @"Incorrect cached header fields returned");
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: [NSURL URLWithString: @"http://www.example.org/pathological"]], @{}, @"Header fields returned for a non-matching path");
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: [NSURL URLWithString: @"https://www.example.org/path"]], @{}, @"Non-secure cookie returned for a secure URL");
+
+    /* Modifications must invalidate cached header fields */
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"name",
+        NSHTTPCookiePath : @"/path",
+        NSHTTPCookieValue : @"updated"
+    }]];
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: url], @{ @"Cookie" : @"name=updated" }, @"Stale header fields returned");
+
+    /* Deeper cookie paths must not be masked by cached entries for their parent paths */
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"deep",
+        NSHTTPCookiePath : @"/path/subpath/leaf",
+        NSHTTPCookieValue : @"value"
+    }]];
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: url], @{ @"Cookie" : @"name=updated" }, @"Incorrect header fields returned");
+    XCTAssertEqual([[jar requestHeaderFieldsForURL: [NSURL URLWithString: @"http://www.example.org/path/subpath/leaf"]][@"Cookie"] length], [@"deep=value; name=updated" length], @"Incorrect header fields returned");
+}
+
+/**
+ * Verify that the request header cache continues to return correct results once it is full, and that cache keys
+ * match hosts case-insensitively.
+ */
+- (void) testRequestHeaderFieldsCacheReplacement {
+    ANTCookieJar *jar = [ANTCookieJar new];
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"name",
+        NSHTTPCookiePath : @"/",
+        NSHTTPCookieValue : @"value"
+    }]];
+
+    for (NSUInteger pass = 0; pass < 2; pass++) {
+        for (NSUInteger i = 0; i < 1024; i++) {
+            NSURL *url = [NSURL URLWithString: [NSString stringWithFormat: @"http://host%lu.example.org/", (unsigned long) i]];
+            XCTAssertEqualObjects([jar requestHeaderFieldsForURL: url], @{ @"Cookie" : @"name=value" }, @"Incorrect header fields returned");
+        }
+    }
+
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: [NSURL URLWithString: @"http://www.example.org/"]], @{ @"Cookie" : @"name=value" }, @"Incorrect header fields returned");
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: [NSURL URLWithString: @"http://WWW.Example.ORG/"]], @{ @"Cookie" : @"name=value" }, @"Incorrect header fields returned");
+    XCTAssertEqualObjects([jar requestHeaderFieldsForURL: [NSURL URLWithString: @"http://www.example.com/"]], @{}, @"Header fields returned for a non-matching host");
+}
+
 - (void) testCookiesForURL {
     ANTCookieJar *jar = [ANTCookieJar new];
     
@@ -188,6 +451,34 @@
     XCTAssertEqualObjects([[cookies objectAtIndex: 1] path], @"/", @"Incorrect cookie returned");
     [jar deleteAllCookies];
     
+    /* Test path segment boundaries */
+    AddCookie(@".example.org", YES, @"/pa", @"partial", @"v");
+    AddCookie(@".example.org", YES, @"/path/", @"directory", @"v");
+    
+    cookies = CookiesForURL(@"https://www.example.org/path");
+    XCTAssertEqual([cookies count], (NSUInteger) 0, @"Incorrect number of cookies returned: %@", cookies);
+    
+    cookies = CookiesForURL(@"https://www.example.org/path/subpath");
+    XCTAssertEqual([cookies count], (NSUInteger) 1, @"Incorrect number of cookies returned: %@", cookies);
+    XCTAssertEqualObjects([[cookies objectAtIndex: 0] name], @"directory", @"Incorrect cookie returned");
+    [jar deleteAllCookies];
+    
+    /* Test nested subdomain handling */
+    AddCookie(@".example.org", YES, @"/", @"domain", @"v");
+    AddCookie(@".b.example.org", YES, @"/", @"subdomain", @"v");
+    AddCookie(@"example.org", YES, @"/", @"host", @"v");
+    
+    cookies = [CookiesForURL(@"https://a.b.example.org/") sortedArrayUsingSelector: @selector(name)];
+    XCTAssertEqual([cookies count], (NSUInteger) 2, @"Incorrect number of cookies returned: %@", cookies);
+    XCTAssertEqualObjects([[cookies objectAtIndex: 0] name], @"domain", @"Incorrect cookie returned");
+    XCTAssertEqualObjects([[cookies objectAtIndex: 1] name], @"subdomain", @"Incorrect cookie returned");
+    
+    cookies = [CookiesForURL(@"https://EXAMPLE.org/") sortedArrayUsingSelector: @selector(name)];
+    XCTAssertEqual([cookies count], (NSUInteger) 2, @"Incorrect number of cookies returned: %@", cookies);
+    XCTAssertEqualObjects([[cookies objectAtIndex: 0] name], @"domain", @"Incorrect cookie returned");
+    XCTAssertEqualObjects([[cookies objectAtIndex: 1] name], @"host", @"Incorrect cookie returned");
+    [jar deleteAllCookies];
+
     /* Test 'secure' flag handling */
     AddCookie(@".example.org", YES, @"/", @"secure", @"v");
     AddCookie(@".example.org", NO, @"/", @"non-secure", @"v");
@@ -218,6 +509,37 @@
     cookies = CookiesForURL(@"http://www.example.org/");
     XCTAssertEqual([cookies count], (NSUInteger) 1, @"Incorrect number of cookies returned");
     [jar deleteAllCookies];
+
+    /* Test expiry of a cookie that was live when set, and that a replaced cookie is not pruned on its predecessor's expiry */
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"short-lived",
+        NSHTTPCookiePath : @"/",
+        NSHTTPCookieValue : @"value",
+        NSHTTPCookieExpires : [NSDate dateWithTimeIntervalSinceNow: 0.5]
+    }]];
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"replaced",
+        NSHTTPCookiePath : @"/",
+        NSHTTPCookieValue : @"old",
+        NSHTTPCookieExpires : [NSDate dateWithTimeIntervalSinceNow: 0.5]
+    }]];
+    [jar setCookie: [NSHTTPCookie cookieWithProperties: @{
+        NSHTTPCookieDomain : @".example.org",
+        NSHTTPCookieName : @"replaced",
+        NSHTTPCookiePath : @"/",
+        NSHTTPCookieValue : @"new",
+        NSHTTPCookieExpires : [NSDate distantFuture]
+    }]];
+    cookies = CookiesForURL(@"http://www.example.org/");
+    XCTAssertEqual([cookies count], (NSUInteger) 2, @"Incorrect number of cookies returned");
+
+    [NSThread sleepForTimeInterval: 1.0];
+    cookies = CookiesForURL(@"http://www.example.org/");
+    XCTAssertEqual([cookies count], (NSUInteger) 1, @"Incorrect number of cookies returned");
+    XCTAssertEqualObjects([[cookies lastObject] value], @"new", @"Incorrect cookie returned");
+    [jar deleteAllCookies];
 }
 
 @end
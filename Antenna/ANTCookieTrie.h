@@ -0,0 +1,46 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface ANTCookieTrie : NSObject
+
+- (ANTCookieTrie *) trieByAddingCookie: (NSHTTPCookie *) cookie;
+- (ANTCookieTrie *) trieByRemovingCookie: (NSHTTPCookie *) cookie;
+- (ANTCookieTrie *) trieByRemovingIdenticalCookie: (NSHTTPCookie *) cookie;
+
+- (void) enumerateCookiesForHost: (NSString *) host path: (NSString *) path usingBlock: (void (^)(NSHTTPCookie *cookie)) block;
+- (void) enumerateCookiesUsingBlock: (void (^)(NSHTTPCookie *cookie)) block;
+
+- (NSUInteger) countOfCookiesInDomain: (NSString *) domain;
+- (void) enumerateCookiesInDomain: (NSString *) domain usingBlock: (void (^)(NSHTTPCookie *cookie)) block;
+
+/** The total number of cookies in the trie. */
+@property(nonatomic, readonly) NSUInteger count;
+
+@end
@@ -0,0 +1,818 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTCookieTrie.h"
+#import "ANTPersistentMap.h"
+#import <PLFoundation/PLFoundation.h>
+
+/** Size of the on-stack host buffer used for lookups. Longer hosts fall back to a heap allocated buffer. */
+#define ANT_COOKIE_TRIE_HOST_BUFSIZE 256
+
+/** Size of the on-stack path buffer used for lookups. Longer paths fall back to a heap allocated buffer. */
+#define ANT_COOKIE_TRIE_PATH_BUFSIZE 1024
+
+/**
+ * @internal
+ *
+ * A normalized cookie location within the trie.
+ */
+typedef struct ANTCookieTrieKey {
+    /** The lowercase domain, sans any leading '.'. Labels are walked from right to left. */
+    const char *domain;
+
+    /** The end of the domain. */
+    const char *domainEnd;
+
+    /** YES if this is a domain (.example.org) cookie, NO if it is a host-only cookie. */
+    BOOL domainCookie;
+
+    /** The path segments, sans the leading '/' and any trailing '/'. */
+    const char *path;
+
+    /** The end of the path segments. */
+    const char *pathEnd;
+
+    /** YES if the path contains at least one (possibly empty) segment. */
+    BOOL hasSegments;
+
+    /** YES if the path had a trailing '/', in which case it only matches request paths that continue past the final segment. */
+    BOOL directory;
+} ANTCookieTrieKey;
+
+/**
+ * @internal
+ *
+ * Fetch the UTF-8 representation of @a string, writing it to @a buffer if it fits, or to a newly
+ * allocated heap buffer otherwise. If the returned pointer does not equal @a buffer, the caller is
+ * responsible for free()ing it.
+ *
+ * @param string The string to convert.
+ * @param buffer The preferred destination buffer.
+ * @param bufsize The size of @a buffer.
+ * @param lowercase If YES, ASCII characters will be lowercased in place.
+ * @param length On return, the length of the UTF-8 data.
+ */
+static char *ANTCookieTrieCopyUTF8 (NSString *string, char *buffer, size_t bufsize, BOOL lowercase, size_t *length) {
+    CFStringRef cfstr = (__bridge CFStringRef) string;
+    CFRange range = CFRangeMake(0, CFStringGetLength(cfstr));
+    CFIndex used = 0;
+    char *result = buffer;
+
+    if (CFStringGetBytes(cfstr, range, kCFStringEncodingUTF8, 0, false, (UInt8 *) buffer, bufsize, &used) != range.length) {
+        CFIndex maxSize = CFStringGetMaximumSizeForEncoding(range.length, kCFStringEncodingUTF8);
+        result = malloc(maxSize);
+        CFStringGetBytes(cfstr, range, kCFStringEncodingUTF8, 0, false, (UInt8 *) result, maxSize, &used);
+    }
+
+    if (lowercase) {
+        for (CFIndex i = 0; i < used; i++) {
+            if (result[i] >= 'A' && result[i] <= 'Z')
+                result[i] += 'a' - 'A';
+        }
+    }
+
+    *length = used;
+    return result;
+}
+
+/**
+ * @internal
+ *
+ * Return the start of the domain label that terminates at @a end.
+ */
+static inline const char *ANTCookieTrieLabelStart (const char *start, const char *end) {
+    const char *p = end;
+    while (p > start && p[-1] != '.')
+        p--;
+
+    return p;
+}
+
+/**
+ * @internal
+ *
+ * Return the end of the path segment that starts at @a p.
+ */
+static inline const char *ANTCookieTrieSegmentEnd (const char *p, const char *end) {
+    const char *slash = memchr(p, '/', end - p);
+    if (slash == NULL)
+        return end;
+
+    return slash;
+}
+
+/**
+ * @internal
+ *
+ * Normalize @a cookie's domain and path, and call @a block with the resulting trie key.
+ */
+static void ANTCookieTrieWithKey (NSHTTPCookie *cookie, void (^block)(const ANTCookieTrieKey *key)) {
+    char domainBuffer[ANT_COOKIE_TRIE_HOST_BUFSIZE];
+    char pathBuffer[ANT_COOKIE_TRIE_PATH_BUFSIZE];
+    size_t domainLength;
+    size_t pathLength;
+
+    NSString *path = cookie.path;
+    if ([path length] == 0)
+        path = @"/";
+
+    char *domain = ANTCookieTrieCopyUTF8(cookie.domain, domainBuffer, sizeof(domainBuffer), YES, &domainLength);
+    char *segments = ANTCookieTrieCopyUTF8(path, pathBuffer, sizeof(pathBuffer), NO, &pathLength);
+
+    ANTCookieTrieKey key;
+    key.domain = domain;
+    key.domainEnd = domain + domainLength;
+    key.domainCookie = NO;
+    if (key.domain < key.domainEnd && *key.domain == '.') {
+        key.domain++;
+        key.domainCookie = YES;
+    }
+
+    key.path = segments;
+    key.pathEnd = segments + pathLength;
+    if (key.path < key.pathEnd && *key.path == '/')
+        key.path++;
+
+    key.hasSegments = (key.path < key.pathEnd);
+    key.directory = NO;
+    if (pathLength > 0 && key.pathEnd[-1] == '/') {
+        key.directory = YES;
+        if (key.hasSegments)
+            key.pathEnd--;
+    }
+
+    block(&key);
+
+    if (domain != domainBuffer)
+        free(domain);
+
+    if (segments != pathBuffer)
+        free(segments);
+}
+
+/**
+ * @internal
+ *
+ * A trie node. Children are keyed by label; for domain nodes, the labels are the host's labels from right
+ * to left, and for path nodes, the labels are the path's '/' separated segments.
+ *
+ * Nodes are immutable once they are reachable from a published ANTCookieTrie; modifications are made by
+ * copying (via -copy) each node along the path to the modified node, and mutating the private copies. Child and
+ * cookie tables are persistent maps shared between a node and its copies, so copying a node is O(1), and
+ * modifying a copy's tables only copies the map nodes along the path to the modified entry.
+ */
+@interface ANTCookieTrieNode : NSObject <NSCopying>
+
+- (id) childForLabel: (const char *) bytes length: (size_t) length;
+- (void) setChild: (ANTCookieTrieNode *) child forLabel: (const char *) bytes length: (size_t) length;
+- (void) removeChildForLabel: (const char *) bytes length: (size_t) length;
+- (void) enumerateChildrenUsingBlock: (void (^)(id child)) block;
+
+/** YES if the receiver has any children. */
+@property(nonatomic, readonly) BOOL hasChildren;
+
+/** The total number of cookies held by the receiver and all of its descendants. */
+@property(nonatomic) NSUInteger cookieCount;
+
+/** YES if the receiver has no children and no associated cookies. */
+@property(nonatomic, readonly, getter=isEmpty) BOOL empty;
+
+@end
+
+/**
+ * @internal
+ *
+ * A node in a path segment trie.
+ */
+@interface ANTCookieTriePathNode : ANTCookieTrieNode
+
+/** Cookies whose path terminates at this node, keyed by UTF-8 name. */
+@property(nonatomic) ANTPersistentMap *cookies;
+
+/** Cookies whose path terminates at this node with a trailing '/', keyed by UTF-8 name. These only match request paths that
+ * continue past this node. */
+@property(nonatomic) ANTPersistentMap *directoryCookies;
+
+@end
+
+/**
+ * @internal
+ *
+ * A node in the reversed domain label trie.
+ */
+@interface ANTCookieTrieDomainNode : ANTCookieTrieNode
+
+/** Host-only cookies that match this node's domain exactly, or nil if none. */
+@property(nonatomic) ANTCookieTriePathNode *hostCookies;
+
+/** Domain cookies that match this node's domain and all of its subdomains, or nil if none. */
+@property(nonatomic) ANTCookieTriePathNode *domainCookies;
+
+@end
+
+@implementation ANTCookieTrieNode {
+@private
+    /** Child nodes, keyed by label. nil if the node has never had children. */
+    ANTPersistentMap *_children;
+}
+
+// from NSCopying
+- (instancetype) copyWithZone: (NSZone *) zone {
+    ANTCookieTrieNode *copy = [[[self class] allocWithZone: zone] init];
+    copy->_children = _children;
+    copy->_cookieCount = _cookieCount;
+
+    return copy;
+}
+
+/**
+ * Return the child node for the given label, or nil if none.
+ *
+ * @param bytes The label bytes.
+ * @param length The label length.
+ */
+- (id) childForLabel: (const char *) bytes length: (size_t) length {
+    return [_children objectForKeyBytes: bytes length: length];
+}
+
+/**
+ * Set the child node for the given label, replacing any existing child.
+ *
+ * @param child The child node.
+ * @param bytes The label bytes.
+ * @param length The label length.
+ */
+- (void) setChild: (ANTCookieTrieNode *) child forLabel: (const char *) bytes length: (size_t) length {
+    if (_children == nil)
+        _children = [ANTPersistentMap new];
+
+    _children = [_children mapBySettingObject: child forKeyBytes: bytes length: length];
+}
+
+/**
+ * Remove the child node for the given label, if any.
+ *
+ * @param bytes The label bytes.
+ * @param length The label length.
+ */
+- (void) removeChildForLabel: (const char *) bytes length: (size_t) length {
+    _children = [_children mapByRemovingObjectForKeyBytes: bytes length: length];
+}
+
+/**
+ * Enumerate all direct children of the receiver.
+ */
+- (void) enumerateChildrenUsingBlock: (void (^)(id child)) block {
+    [_children enumerateObjectsUsingBlock: block];
+}
+
+// property getter
+- (BOOL) hasChildren {
+    return _children.count > 0;
+}
+
+// property getter
+- (BOOL) isEmpty {
+    return !self.hasChildren;
+}
+
+@end
+
+@implementation ANTCookieTriePathNode
+
+- (instancetype) init {
+    PLSuperInit();
+
+    _cookies = [ANTPersistentMap new];
+    _directoryCookies = [ANTPersistentMap new];
+
+    return self;
+}
+
+// from NSCopying
+- (instancetype) copyWithZone: (NSZone *) zone {
+    ANTCookieTriePathNode *copy = [super copyWithZone: zone];
+    copy->_cookies = _cookies;
+    copy->_directoryCookies = _directoryCookies;
+
+    return copy;
+}
+
+// property getter
+- (BOOL) isEmpty {
+    return _cookies.count == 0 && _directoryCookies.count == 0 && !self.hasChildren;
+}
+
+@end
+
+@implementation ANTCookieTrieDomainNode
+
+// from NSCopying
+- (instancetype) copyWithZone: (NSZone *) zone {
+    ANTCookieTrieDomainNode *copy = [super copyWithZone: zone];
+    copy->_hostCookies = _hostCookies;
+    copy->_domainCookies = _domainCookies;
+
+    return copy;
+}
+
+// property getter
+- (BOOL) isEmpty {
+    return _hostCookies == nil && _domainCookies == nil && !self.hasChildren;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * Pass all values in @a table to @a block.
+ */
+static inline void ANTCookieTrieEmit (ANTPersistentMap *table, void (^block)(NSHTTPCookie *cookie)) {
+    if (table.count == 0)
+        return;
+
+    [table enumerateObjectsUsingBlock: block];
+}
+
+/**
+ * @internal
+ *
+ * Enumerate all cookies in the path trie rooted at @a root that match the request path @a path.
+ */
+static void ANTCookieTrieEnumeratePath (ANTCookieTriePathNode *root, const char *path, const char *end, void (^block)(NSHTTPCookie *cookie)) {
+    if (root == nil)
+        return;
+
+    /* Every request path matches the root */
+    ANTCookieTrieEmit(root.cookies, block);
+    ANTCookieTrieEmit(root.directoryCookies, block);
+
+    const char *p = path;
+    if (p < end && *p == '/')
+        p++;
+
+    ANTCookieTriePathNode *node = root;
+    while (p < end) {
+        const char *segmentEnd = ANTCookieTrieSegmentEnd(p, end);
+        if ((node = [node childForLabel: p length: segmentEnd - p]) == nil)
+            return;
+
+        /* The request path either terminates here, or continues with a '/' -- either way, the node's path matches. */
+        ANTCookieTrieEmit(node.cookies, block);
+        if (segmentEnd == end)
+            return;
+
+        /* The request path continues; directory paths match, too */
+        ANTCookieTrieEmit(node.directoryCookies, block);
+        p = segmentEnd + 1;
+    }
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a node (or a new node, if @a node is nil), with @a cookie inserted into the path trie at the
+ * segments starting at @a p. Nodes along the path are copied; all other nodes are shared with @a node.
+ *
+ * On return, @a added is set to 1 if the cookie was newly added, or 0 if it replaced an existing cookie.
+ */
+static ANTCookieTriePathNode *ANTCookieTrieAddPath (ANTCookieTriePathNode *node, const ANTCookieTrieKey *key, const char *p, BOOL done, NSHTTPCookie *cookie, NSUInteger *added) {
+    ANTCookieTriePathNode *copy = (node != nil) ? [node copy] : [ANTCookieTriePathNode new];
+    if (done) {
+        const char *name = [cookie.name UTF8String];
+        size_t nameLength = strlen(name);
+        ANTPersistentMap *table = key->directory ? copy.directoryCookies : copy.cookies;
+
+        *added = ([table objectForKeyBytes: name length: nameLength] == nil) ? 1 : 0;
+        table = [table mapBySettingObject: cookie forKeyBytes: name length: nameLength];
+        if (key->directory) {
+            copy.directoryCookies = table;
+        } else {
+            copy.cookies = table;
+        }
+
+        copy.cookieCount += *added;
+        return copy;
+    }
+
+    const char *segmentEnd = ANTCookieTrieSegmentEnd(p, key->pathEnd);
+    BOOL last = (segmentEnd == key->pathEnd);
+    ANTCookieTriePathNode *child = [node childForLabel: p length: segmentEnd - p];
+    child = ANTCookieTrieAddPath(child, key, last ? segmentEnd : segmentEnd + 1, last, cookie, added);
+    [copy setChild: child forLabel: p length: segmentEnd - p];
+
+    copy.cookieCount += *added;
+    return copy;
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of the domain node @a node (or a new node, if @a node is nil), with @a cookie inserted into the trie
+ * at the labels to the left of @a labelsEnd. Nodes along the path are copied; all other nodes are shared with @a node.
+ *
+ * On return, @a added is set to 1 if the cookie was newly added, or 0 if it replaced an existing cookie.
+ */
+static ANTCookieTrieDomainNode *ANTCookieTrieAddDomain (ANTCookieTrieDomainNode *node, const ANTCookieTrieKey *key, const char *labelsEnd, BOOL done, NSHTTPCookie *cookie, NSUInteger *added) {
+    ANTCookieTrieDomainNode *copy = (node != nil) ? [node copy] : [ANTCookieTrieDomainNode new];
+    if (done) {
+        const char *p = key->hasSegments ? key->path : key->pathEnd;
+        if (key->domainCookie) {
+            copy.domainCookies = ANTCookieTrieAddPath(copy.domainCookies, key, p, !key->hasSegments, cookie, added);
+        } else {
+            copy.hostCookies = ANTCookieTrieAddPath(copy.hostCookies, key, p, !key->hasSegments, cookie, added);
+        }
+
+        copy.cookieCount += *added;
+        return copy;
+    }
+
+    const char *labelStart = ANTCookieTrieLabelStart(key->domain, labelsEnd);
+    BOOL last = (labelStart == key->domain);
+    ANTCookieTrieDomainNode *child = [node childForLabel: labelStart length: labelsEnd - labelStart];
+    child = ANTCookieTrieAddDomain(child, key, last ? labelStart : labelStart - 1, last, cookie, added);
+    [copy setChild: child forLabel: labelStart length: labelsEnd - labelStart];
+
+    copy.cookieCount += *added;
+    return copy;
+}
+
+/**
+ * @internal
+ *
+ * Remove the cookie matching @a cookie's name from the path trie rooted at @a node. If @a identical is YES, the
+ * stored cookie will only be removed if it is the same instance as @a cookie.
+ *
+ * @return Returns @a node if the cookie was not found, nil if the resulting node would be empty, or
+ * a modified copy of @a node.
+ */
+static ANTCookieTriePathNode *ANTCookieTrieRemovePath (ANTCookieTriePathNode *node, const ANTCookieTrieKey *key, const char *p, BOOL done, NSHTTPCookie *cookie, BOOL identical) {
+    ANTCookieTriePathNode *copy;
+
+    if (done) {
+        const char *name = [cookie.name UTF8String];
+        ANTPersistentMap *table = key->directory ? node.directoryCookies : node.cookies;
+        NSHTTPCookie *existing = [table objectForKeyBytes: name length: strlen(name)];
+        if (existing == nil || (identical && existing != cookie))
+            return node;
+
+        copy = [node copy];
+        if (key->directory) {
+            copy.directoryCookies = [table mapByRemovingObjectForKeyBytes: name length: strlen(name)];
+        } else {
+            copy.cookies = [table mapByRemovingObjectForKeyBytes: name length: strlen(name)];
+        }
+        copy.cookieCount--;
+    } else {
+        const char *segmentEnd = ANTCookieTrieSegmentEnd(p, key->pathEnd);
+        ANTCookieTriePathNode *child = [node childForLabel: p length: segmentEnd - p];
+        if (child == nil)
+            return node;
+
+        BOOL last = (segmentEnd == key->pathEnd);
+        ANTCookieTriePathNode *replacement = ANTCookieTrieRemovePath(child, key, last ? segmentEnd : segmentEnd + 1, last, cookie, identical);
+        if (replacement == child)
+            return node;
+
+        copy = [node copy];
+        if (replacement == nil) {
+            [copy removeChildForLabel: p length: segmentEnd - p];
+        } else {
+            [copy setChild: replacement forLabel: p length: segmentEnd - p];
+        }
+        copy.cookieCount--;
+    }
+
+    return copy.isEmpty ? nil : copy;
+}
+
+/**
+ * @internal
+ *
+ * Remove the cookie matching @a cookie from the domain trie rooted at @a node, consuming labels to the left of @a labelsEnd.
+ * If @a identical is YES, the stored cookie will only be removed if it is the same instance as @a cookie.
+ *
+ * @return Returns @a node if the cookie was not found, nil if the resulting node would be empty, or
+ * a modified copy of @a node.
+ */
+static ANTCookieTrieDomainNode *ANTCookieTrieRemoveDomain (ANTCookieTrieDomainNode *node, const ANTCookieTrieKey *key, const char *labelsEnd, BOOL done, NSHTTPCookie *cookie, BOOL identical) {
+    ANTCookieTrieDomainNode *copy;
+
+    if (done) {
+        const char *p = key->hasSegments ? key->path : key->pathEnd;
+        ANTCookieTriePathNode *paths = key->domainCookie ? node.domainCookies : node.hostCookies;
+        if (paths == nil)
+            return node;
+
+        ANTCookieTriePathNode *replacement = ANTCookieTrieRemovePath(paths, key, p, !key->hasSegments, cookie, identical);
+        if (replacement == paths)
+            return node;
+
+        copy = [node copy];
+        if (key->domainCookie) {
+            copy.domainCookies = replacement;
+        } else {
+            copy.hostCookies = replacement;
+        }
+        copy.cookieCount--;
+    } else {
+        const char *labelStart = ANTCookieTrieLabelStart(key->domain, labelsEnd);
+        ANTCookieTrieDomainNode *child = [node childForLabel: labelStart length: labelsEnd - labelStart];
+        if (child == nil)
+            return node;
+
+        BOOL last = (labelStart == key->domain);
+        ANTCookieTrieDomainNode *replacement = ANTCookieTrieRemoveDomain(child, key, last ? labelStart : labelStart - 1, last, cookie, identical);
+        if (replacement == child)
+            return node;
+
+        copy = [node copy];
+        if (replacement == nil) {
+            [copy removeChildForLabel: labelStart length: labelsEnd - labelStart];
+        } else {
+            [copy setChild: replacement forLabel: labelStart length: labelsEnd - labelStart];
+        }
+        copy.cookieCount--;
+    }
+
+    return copy.isEmpty ? nil : copy;
+}
+
+/**
+ * @internal
+ *
+ * Recursively enumerate all cookies in the path trie rooted at @a node.
+ */
+static void ANTCookieTrieEnumerateAllPaths (ANTCookieTriePathNode *node, void (^block)(NSHTTPCookie *cookie)) {
+    if (node == nil)
+        return;
+
+    ANTCookieTrieEmit(node.cookies, block);
+    ANTCookieTrieEmit(node.directoryCookies, block);
+    [node enumerateChildrenUsingBlock: ^(ANTCookieTriePathNode *child) {
+        ANTCookieTrieEnumerateAllPaths(child, block);
+    }];
+}
+
+/**
+ * @internal
+ *
+ * Recursively enumerate all cookies in the domain trie rooted at @a node.
+ */
+static void ANTCookieTrieEnumerateAllDomains (ANTCookieTrieDomainNode *node, void (^block)(NSHTTPCookie *cookie)) {
+    ANTCookieTrieEnumerateAllPaths(node.hostCookies, block);
+    ANTCookieTrieEnumerateAllPaths(node.domainCookies, block);
+    [node enumerateChildrenUsingBlock: ^(ANTCookieTrieDomainNode *child) {
+        ANTCookieTrieEnumerateAllDomains(child, block);
+    }];
+}
+
+/**
+ * An immutable cookie index used by ANTCookieJar.
+ *
+ * Cookies are indexed in a trie keyed on the reversed labels of their domain (org -> example -> www), with each
+ * domain node holding a second trie keyed on the '/' separated segments of the cookie paths. Looking up the cookies
+ * for a request costs O(host labels + path segments + matching cookies), independent of the total number of domains
+ * stored, and is performed directly on the UTF-8 bytes of the request host and path without allocating any
+ * temporary strings.
+ *
+ * Path matching follows RFC 6265, section 5.1.4: a cookie path matches if it is identical to the request
+ * path, or is a prefix of the request path that terminates on a '/' boundary.
+ *
+ * Instances are immutable, and may be safely shared between threads. Modifications return a new trie that
+ * shares all nodes with the receiver, except for the nodes along the path to the modified cookie.
+ */
+@implementation ANTCookieTrie {
+@private
+    /** The root domain node. */
+    ANTCookieTrieDomainNode *_root;
+}
+
+/**
+ * Initialize a new, empty instance.
+ */
+- (instancetype) init {
+    return [self initWithRoot: [ANTCookieTrieDomainNode new]];
+}
+
+/**
+ * @internal
+ *
+ * Initialize a new instance with the given root node.
+ *
+ * @param root The root node. This node must not be modified after initialization.
+ */
+- (instancetype) initWithRoot: (ANTCookieTrieDomainNode *) root {
+    PLSuperInit();
+
+    _root = root;
+
+    return self;
+}
+
+/**
+ * Return a new trie containing all of the receiver's cookies, as well as @a cookie. Any existing cookie with the
+ * same domain, path, and name will be replaced.
+ *
+ * @param cookie The cookie to be added.
+ */
+- (ANTCookieTrie *) trieByAddingCookie: (NSHTTPCookie *) cookie {
+    __block ANTCookieTrieDomainNode *root;
+    ANTCookieTrieWithKey(cookie, ^(const ANTCookieTrieKey *key) {
+        NSUInteger added;
+        root = ANTCookieTrieAddDomain(_root, key, key->domainEnd, NO, cookie, &added);
+    });
+
+    return [[ANTCookieTrie alloc] initWithRoot: root];
+}
+
+/**
+ * Return a new trie containing all of the receiver's cookies, except for any cookie with the same domain, path,
+ * and name as @a cookie. Any empty trie nodes will be pruned. If no such cookie is found, the receiver is returned.
+ *
+ * @param cookie The cookie to be removed.
+ */
+- (ANTCookieTrie *) trieByRemovingCookie: (NSHTTPCookie *) cookie {
+    return [self trieByRemovingCookie: cookie identical: NO];
+}
+
+/**
+ * Return a new trie containing all of the receiver's cookies, except for @a cookie. Unlike trieByRemovingCookie:,
+ * a stored cookie with the same domain, path, and name will only be removed if it is the same instance as
+ * @a cookie. If @a cookie is not found, the receiver is returned.
+ *
+ * @param cookie The cookie to be removed.
+ */
+- (ANTCookieTrie *) trieByRemovingIdenticalCookie: (NSHTTPCookie *) cookie {
+    return [self trieByRemovingCookie: cookie identical: YES];
+}
+
+/**
+ * @internal
+ *
+ * Implements trieByRemovingCookie: and trieByRemovingIdenticalCookie:.
+ */
+- (ANTCookieTrie *) trieByRemovingCookie: (NSHTTPCookie *) cookie identical: (BOOL) identical {
+    __block ANTCookieTrieDomainNode *root;
+    ANTCookieTrieWithKey(cookie, ^(const ANTCookieTrieKey *key) {
+        root = ANTCookieTrieRemoveDomain(_root, key, key->domainEnd, NO, cookie, identical);
+    });
+
+    if (root == _root)
+        return self;
+
+    if (root == nil)
+        return [ANTCookieTrie new];
+
+    return [[ANTCookieTrie alloc] initWithRoot: root];
+}
+
+/**
+ * Enumerate all cookies whose domain and path match @a host and @a path. No expiration or security
+ * checks are performed.
+ *
+ * @param host The request host.
+ * @param path The request path. An empty path is treated as '/'.
+ * @param block The block to be called for each matching cookie.
+ */
+- (void) enumerateCookiesForHost: (NSString *) host path: (NSString *) path usingBlock: (void (^)(NSHTTPCookie *cookie)) block {
+    if (host == nil)
+        return;
+
+    if ([path length] == 0)
+        path = @"/";
+
+    char hostBuffer[ANT_COOKIE_TRIE_HOST_BUFSIZE];
+    char pathBuffer[ANT_COOKIE_TRIE_PATH_BUFSIZE];
+    size_t hostLength;
+    size_t pathLength;
+
+    char *hostBytes = ANTCookieTrieCopyUTF8(host, hostBuffer, sizeof(hostBuffer), YES, &hostLength);
+    char *pathBytes = ANTCookieTrieCopyUTF8(path, pathBuffer, sizeof(pathBuffer), NO, &pathLength);
+    const char *pathEnd = pathBytes + pathLength;
+
+    /* Walk the host labels from right to left, collecting domain cookies along the way, and host-only cookies
+     * from the final node. */
+    ANTCookieTrieDomainNode *node = _root;
+    ANTCookieTrieEnumeratePath(node.domainCookies, pathBytes, pathEnd, block);
+
+    const char *labelsEnd = hostBytes + hostLength;
+    while (YES) {
+        const char *labelStart = ANTCookieTrieLabelStart(hostBytes, labelsEnd);
+        if ((node = [node childForLabel: labelStart length: labelsEnd - labelStart]) == nil)
+            break;
+
+        ANTCookieTrieEnumeratePath(node.domainCookies, pathBytes, pathEnd, block);
+
+        if (labelStart == hostBytes) {
+            ANTCookieTrieEnumeratePath(node.hostCookies, pathBytes, pathEnd, block);
+            break;
+        }
+
+        labelsEnd = labelStart - 1;
+    }
+
+    if (hostBytes != hostBuffer)
+        free(hostBytes);
+
+    if (pathBytes != pathBuffer)
+        free(pathBytes);
+}
+
+/**
+ * Enumerate all cookies in the receiver.
+ *
+ * @param block The block to be called for each cookie.
+ */
+- (void) enumerateCookiesUsingBlock: (void (^)(NSHTTPCookie *cookie)) block {
+    ANTCookieTrieEnumerateAllDomains(_root, block);
+}
+
+/**
+ * @internal
+ *
+ * Return the domain node for @a domain, or nil if the receiver holds no cookies within @a domain.
+ */
+- (ANTCookieTrieDomainNode *) nodeForDomain: (NSString *) domain {
+    if (domain == nil)
+        return nil;
+
+    char domainBuffer[ANT_COOKIE_TRIE_HOST_BUFSIZE];
+    size_t domainLength;
+    char *domainBytes = ANTCookieTrieCopyUTF8(domain, domainBuffer, sizeof(domainBuffer), YES, &domainLength);
+
+    const char *start = domainBytes;
+    if (domainLength > 0 && *start == '.')
+        start++;
+
+    ANTCookieTrieDomainNode *node = _root;
+    const char *labelsEnd = domainBytes + domainLength;
+    while (node != nil && labelsEnd > start) {
+        const char *labelStart = ANTCookieTrieLabelStart(start, labelsEnd);
+        node = [node childForLabel: labelStart length: labelsEnd - labelStart];
+        if (labelStart == start)
+            break;
+
+        labelsEnd = labelStart - 1;
+    }
+
+    if (domainBytes != domainBuffer)
+        free(domainBytes);
+
+    return node;
+}
+
+/**
+ * Return the number of cookies set on @a domain or any of its subdomains, including both domain and host-only
+ * cookies. This does not require enumerating the cookies.
+ *
+ * @param domain The domain, with or without a leading '.'.
+ */
+- (NSUInteger) countOfCookiesInDomain: (NSString *) domain {
+    return [self nodeForDomain: domain].cookieCount;
+}
+
+/**
+ * Enumerate all cookies set on @a domain or any of its subdomains.
+ *
+ * @param domain The domain, with or without a leading '.'.
+ * @param block The block to be called for each cookie.
+ */
+- (void) enumerateCookiesInDomain: (NSString *) domain usingBlock: (void (^)(NSHTTPCookie *cookie)) block {
+    ANTCookieTrieDomainNode *node = [self nodeForDomain: domain];
+    if (node != nil)
+        ANTCookieTrieEnumerateAllDomains(node, block);
+}
+
+// property getter
+- (NSUInteger) count {
+    return _root.cookieCount;
+}
+
+@end
@@ -0,0 +1,303 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTEpoch.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <libkern/OSAtomic.h>
+
+/*
+ * Epoch-based reclamation of objects published via an atomic pointer swap.
+ *
+ * Readers bracket their use of a published pointer with ANTEpochEnter() and ANTEpochExit(), which record the global
+ * epoch in a per-thread record; readers never write to memory shared with other readers, and never block. A writer
+ * that has replaced a published object passes the previous object to ANTEpochRetire(), which advances the global
+ * epoch, and defers the release until every thread that was inside a critical section at the time of the swap has
+ * exited it. Writers never wait on readers; retired objects are released by the next writer, or by the next reader
+ * to exit a critical section, once no reader can still be using them.
+ */
+
+/**
+ * @internal
+ *
+ * A thread's epoch record. Records are never freed; the record of an exited thread is reused by the next
+ * thread to register.
+ */
+typedef struct ANTEpochRecord {
+    /** The global epoch observed on entry to the thread's outermost critical section, or 0 if the thread is not
+     * within a critical section. Written only by the owning thread. */
+    volatile int64_t epoch;
+
+    /** The critical section nesting depth. Accessed only by the owning thread. */
+    uint32_t depth;
+
+    /** Non-zero if the record is owned by a live thread. */
+    volatile int32_t inUse;
+
+    /** The next record in the global record list. Immutable once the record has been published. */
+    struct ANTEpochRecord *next;
+} ANTEpochRecord;
+
+/** Records are aligned to (and padded out to) a cache line, so that readers on different threads never share one. */
+#define ANT_EPOCH_RECORD_ALIGNMENT 64
+
+/**
+ * @internal
+ *
+ * A retired object, pending release.
+ */
+typedef struct ANTEpochRetiredObject {
+    /** The retired object. */
+    void *object;
+
+    /** The function to be called to release @a object. */
+    ANTEpochReleaseFunction release;
+
+    /** The global epoch at the time the object was retired. */
+    int64_t epoch;
+
+    /** The next pending object. */
+    struct ANTEpochRetiredObject *next;
+} ANTEpochRetiredObject;
+
+/** The global epoch. Starts at 1; a record epoch of 0 denotes a quiescent thread. */
+static volatile int64_t ANTEpochGlobal = 1;
+
+/** All registered thread records. Records are only ever pushed to the head of the list. */
+static ANTEpochRecord * volatile ANTEpochRecords = NULL;
+
+/** Lock that must be held when accessing ANTEpochRetired. Never taken by readers on the fast path. */
+static OSSpinLock ANTEpochRetiredLock = OS_SPINLOCK_INIT;
+
+/** Objects pending release. */
+static ANTEpochRetiredObject *ANTEpochRetired = NULL;
+
+/** Non-zero if ANTEpochRetired may be non-empty. Checked by readers as they exit a critical section. */
+static volatile int32_t ANTEpochPending = 0;
+
+/** The thread-specific key holding each thread's ANTEpochRecord. */
+static pthread_key_t ANTEpochRecordKey;
+
+/** Initialization guard for ANTEpochRecordKey. */
+static pthread_once_t ANTEpochRecordKeyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @internal
+ *
+ * Release ownership of a thread's record on thread exit.
+ */
+static void ANTEpochRecordDestructor (void *value) {
+    ANTEpochRecord *record = value;
+    record->depth = 0;
+    record->epoch = 0;
+    OSMemoryBarrier();
+    record->inUse = 0;
+}
+
+/**
+ * @internal
+ *
+ * Create ANTEpochRecordKey.
+ */
+static void ANTEpochRecordKeyInit (void) {
+    if (pthread_key_create(&ANTEpochRecordKey, ANTEpochRecordDestructor) != 0)
+        __builtin_trap();
+}
+
+/**
+ * @internal
+ *
+ * Return the calling thread's record, registering a record on first use.
+ */
+static ANTEpochRecord *ANTEpochCurrentRecord (void) {
+    pthread_once(&ANTEpochRecordKeyOnce, ANTEpochRecordKeyInit);
+
+    ANTEpochRecord *record = pthread_getspecific(ANTEpochRecordKey);
+    if (record != NULL)
+        return record;
+
+    /* Reuse the record of an exited thread, if any */
+    for (record = ANTEpochRecords; record != NULL; record = record->next) {
+        if (record->inUse == 0 && OSAtomicCompareAndSwap32Barrier(0, 1, &record->inUse))
+            break;
+    }
+
+    if (record == NULL) {
+        void *allocation;
+        size_t size = (sizeof(ANTEpochRecord) + ANT_EPOCH_RECORD_ALIGNMENT - 1) & ~(size_t) (ANT_EPOCH_RECORD_ALIGNMENT - 1);
+        if (posix_memalign(&allocation, ANT_EPOCH_RECORD_ALIGNMENT, size) != 0)
+            __builtin_trap();
+
+        record = allocation;
+        record->epoch = 0;
+        record->depth = 0;
+        record->inUse = 1;
+
+        ANTEpochRecord *head;
+        do {
+            head = ANTEpochRecords;
+            record->next = head;
+        } while (!OSAtomicCompareAndSwapPtrBarrier(head, record, (void * volatile *) &ANTEpochRecords));
+    }
+
+    pthread_setspecific(ANTEpochRecordKey, record);
+    return record;
+}
+
+/**
+ * @internal
+ *
+ * Release all retired objects that can no longer be observed by any reader. If @a wait is false and another
+ * thread is already collecting, returns immediately.
+ */
+static void ANTEpochCollect (bool wait) {
+    if (wait)
+        OSSpinLockLock(&ANTEpochRetiredLock);
+    else if (!OSSpinLockTry(&ANTEpochRetiredLock))
+        return;
+
+    /* Find the oldest epoch that may be held by a reader. Any reader that loaded a pointer prior to its replacement
+     * entered its critical section at or before the epoch at which the previous object was retired. */
+    OSMemoryBarrier();
+    int64_t oldest = INT64_MAX;
+    for (ANTEpochRecord *record = ANTEpochRecords; record != NULL; record = record->next) {
+        int64_t epoch = record->epoch;
+        if (epoch != 0 && epoch < oldest)
+            oldest = epoch;
+    }
+
+    /* Detach the releasable objects; they're released once the lock has been dropped */
+    ANTEpochRetiredObject *releasable = NULL;
+    ANTEpochRetiredObject **link = &ANTEpochRetired;
+    while (*link != NULL) {
+        ANTEpochRetiredObject *retired = *link;
+        if (retired->epoch < oldest) {
+            *link = retired->next;
+            retired->next = releasable;
+            releasable = retired;
+        } else {
+            link = &retired->next;
+        }
+    }
+
+    ANTEpochPending = (ANTEpochRetired != NULL);
+    OSSpinLockUnlock(&ANTEpochRetiredLock);
+
+    while (releasable != NULL) {
+        ANTEpochRetiredObject *next = releasable->next;
+        releasable->release(releasable->object);
+        free(releasable);
+        releasable = next;
+    }
+}
+
+/**
+ * Enter a read-side critical section on the calling thread. Any object loaded from a pointer published by a writer that
+ * uses ANTEpochRetire() will not be released until the matching call to ANTEpochExit(). Critical sections may be nested.
+ *
+ * This will never block, and writes only to memory owned by the calling thread.
+ */
+void ANTEpochEnter (void) {
+    ANTEpochRecord *record = ANTEpochCurrentRecord();
+    if (record->depth++ > 0)
+        return;
+
+    /* The epoch must be visible to writers before any published pointer is loaded. */
+    record->epoch = ANTEpochGlobal;
+    OSMemoryBarrier();
+}
+
+/**
+ * Exit a critical section entered via ANTEpochEnter(). On exit from the outermost critical section, any retired objects
+ * that can no longer be observed may be released on the calling thread.
+ */
+void ANTEpochExit (void) {
+    ANTEpochRecord *record = ANTEpochCurrentRecord();
+    if (--record->depth > 0)
+        return;
+
+    /* All loads from within the critical section must complete before the exit is visible to writers. */
+    OSMemoryBarrier();
+    record->epoch = 0;
+
+    if (ANTEpochPending)
+        ANTEpochCollect(false);
+}
+
+/**
+ * Release @a object via @a release once no thread can still be observing it. The caller must already have replaced
+ * every published pointer to @a object; readers that enter a critical section after this call can only observe
+ * the replacement. This will never wait on readers. If the calling thread is itself within a critical section, the
+ * release is deferred until after it exits.
+ *
+ * @param object The retired object.
+ * @param release The function to be called, on an unspecified thread, to release @a object.
+ */
+void ANTEpochRetire (void *object, ANTEpochReleaseFunction release) {
+    ANTEpochRetiredObject *retired = malloc(sizeof(ANTEpochRetiredObject));
+    if (retired == NULL) {
+        /* Leaking the object is always safe; releasing it early is not. */
+        return;
+    }
+
+    retired->object = object;
+    retired->release = release;
+
+    OSSpinLockLock(&ANTEpochRetiredLock); {
+        /* The pointer swap has been made visible by the caller's barrier; any reader that has yet to load the
+         * pointer will enter at an epoch after this one. */
+        retired->epoch = OSAtomicIncrement64Barrier(&ANTEpochGlobal) - 1;
+        retired->next = ANTEpochRetired;
+        ANTEpochRetired = retired;
+        ANTEpochPending = 1;
+    } OSSpinLockUnlock(&ANTEpochRetiredLock);
+
+    ANTEpochCollect(true);
+}
+
+/**
+ * Wait until every thread that was within a critical section at the time of the call has exited it. Threads that
+ * enter a critical section after the call do not delay it, so the wait is bounded by the longest critical section
+ * in progress. Must not be called from within a critical section.
+ */
+void ANTEpochSynchronize (void) {
+    int64_t target = OSAtomicIncrement64Barrier(&ANTEpochGlobal);
+
+    for (ANTEpochRecord *record = ANTEpochRecords; record != NULL; record = record->next) {
+        int64_t epoch;
+        while ((epoch = record->epoch) != 0 && epoch < target)
+            sched_yield();
+    }
+
+    OSMemoryBarrier();
+}
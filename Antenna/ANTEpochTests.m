@@ -0,0 +1,99 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTEpoch.h"
+
+#import <libkern/OSAtomic.h>
+
+@interface ANTEpochTests : XCTestCase @end
+
+@implementation ANTEpochTests
+
+/** Number of times ANTEpochTestsRelease() has been called. */
+static volatile int32_t ANTEpochTestsReleaseCount = 0;
+
+static void ANTEpochTestsRelease (void *object) {
+    OSAtomicIncrement32Barrier(&ANTEpochTestsReleaseCount);
+    free(object);
+}
+
+- (void) setUp {
+    ANTEpochTestsReleaseCount = 0;
+}
+
+- (void) testRetireDefersToReaders {
+    /* With no readers, the object is released immediately */
+    ANTEpochRetire(malloc(1), ANTEpochTestsRelease);
+    XCTAssertEqual(ANTEpochTestsReleaseCount, 1, @"Object was not released");
+
+    /* An active reader on another thread defers the release until it exits */
+    dispatch_semaphore_t entered = dispatch_semaphore_create(0);
+    dispatch_semaphore_t retired = dispatch_semaphore_create(0);
+    dispatch_semaphore_t exited = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        ANTEpochEnter(); {
+            dispatch_semaphore_signal(entered);
+            dispatch_semaphore_wait(retired, DISPATCH_TIME_FOREVER);
+        } ANTEpochExit();
+        dispatch_semaphore_signal(exited);
+    });
+
+    dispatch_semaphore_wait(entered, DISPATCH_TIME_FOREVER);
+    ANTEpochRetire(malloc(1), ANTEpochTestsRelease);
+    XCTAssertEqual(ANTEpochTestsReleaseCount, 1, @"Object was released while a reader was active");
+
+    dispatch_semaphore_signal(retired);
+    dispatch_semaphore_wait(exited, DISPATCH_TIME_FOREVER);
+    XCTAssertEqual(ANTEpochTestsReleaseCount, 2, @"Object was not released on reader exit");
+
+    /* A writer within its own critical section defers the release until it exits */
+    ANTEpochEnter(); {
+        ANTEpochRetire(malloc(1), ANTEpochTestsRelease);
+        XCTAssertEqual(ANTEpochTestsReleaseCount, 2, @"Object was released within the critical section");
+    } ANTEpochExit();
+    XCTAssertEqual(ANTEpochTestsReleaseCount, 3, @"Object was not released on exit");
+}
+
+- (void) testSynchronize {
+    __block volatile int32_t finished = 0;
+    dispatch_semaphore_t entered = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        ANTEpochEnter(); {
+            dispatch_semaphore_signal(entered);
+            usleep(50000);
+            finished = 1;
+        } ANTEpochExit();
+    });
+
+    dispatch_semaphore_wait(entered, DISPATCH_TIME_FOREVER);
+    ANTEpochSynchronize();
+    XCTAssertEqual(finished, 1, @"Synchronize returned before the critical section exited");
+}
+
+@end
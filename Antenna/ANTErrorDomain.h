@@ -27,6 +27,7 @@
  */
 
 extern NSString *ANTErrorDomain;
+extern NSString *ANTErrorKeyPathKey;
 
 /**
  * NSError codes in the ANTErrorDomain.
@@ -31,4 +31,12 @@
  *
  * Antenna NSError Domain.
  */
-NSString *ANTErrorDomain = @"ANTErrorDomain";
\ No newline at end of file
+NSString *ANTErrorDomain = @"ANTErrorDomain";
+
+/**
+ * @ingroup globals
+ *
+ * The NSError userInfo key for the key path of an invalid value within a server response, eg,
+ * "List.RDRGetMyOrignatedProblems[3].problemTitle".
+ */
+NSString *ANTErrorKeyPathKey = @"ANTErrorKeyPathKey";
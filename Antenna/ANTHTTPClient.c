@@ -0,0 +1,930 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTHTTPClient.h"
+
+#include <curl/curl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * A portable HTTP/1.1 client built on the libcurl multi interface.
+ *
+ * All transfers are driven by a single I/O thread. Connections are held in the multi handle's connection cache, which
+ * is keyed by scheme, host, and port; a connection is returned to the cache when a transfer completes, and is reused
+ * by the next transfer to the same host. This provides a per-host keep-alive pool without any coordination between
+ * requests.
+ *
+ * The client must run against the libcurl release shipped with the minimum supported OS (7.24 on Mac OS X 10.8), and
+ * so avoids the newer curl_multi_wait()/curl_multi_poll() APIs; the I/O thread instead waits in select() on the multi
+ * handle's descriptors and a self-pipe, to which other threads write to wake it. Options introduced by later releases
+ * are set only when available; where libcurl does not support CURLMOPT_MAX_HOST_CONNECTIONS, the per-host limit is
+ * left to the caller.
+ */
+
+/** The maximum number of redirects that will be followed. */
+#define ANT_HTTP_CLIENT_MAX_REDIRECTS 10
+
+/** The maximum number of idle easy handles retained for reuse. */
+#define ANT_HTTP_CLIENT_MAX_FREE_HANDLES 16
+
+/** The maximum time the I/O thread will block waiting for activity, in milliseconds. */
+#define ANT_HTTP_CLIENT_POLL_TIMEOUT 1000
+
+/**
+ * @internal
+ *
+ * A growable byte buffer. The buffer is always NUL terminated once non-empty.
+ */
+typedef struct ANTHTTPClientBuffer {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} ANTHTTPClientBuffer;
+
+/**
+ * @internal
+ *
+ * A single request transfer.
+ */
+typedef struct ANTHTTPClientTransfer {
+    /** The request identifier. */
+    uint64_t identifier;
+
+    /** The transfer's easy handle. */
+    CURL *easy;
+
+    /** The request headers. */
+    struct curl_slist *headers;
+
+    /** The header block of the most recent response. */
+    ANTHTTPClientBuffer responseHeaders;
+
+    /** The URL from which the most recent response was received, or NULL. */
+    char *responseURL;
+
+    /** The response body. Unused if the body is streamed to dataCallback. */
+    ANTHTTPClientBuffer responseBody;
+
+    /** The response body callback, or NULL if the body is to be buffered. */
+    ANTHTTPClientDataCallback dataCallback;
+
+    /** The number of response body bytes delivered, after any content decoding. */
+    uint64_t bodyBytesDecoded;
+
+    /** The transfer's error message buffer. */
+    char errorBuffer[CURL_ERROR_SIZE];
+
+    /** The completion callback and its context. */
+    ANTHTTPClientCallback callback;
+    void *context;
+
+    /** The next transfer in the list to which this transfer belongs. */
+    struct ANTHTTPClientTransfer *next;
+} ANTHTTPClientTransfer;
+
+/**
+ * @internal
+ *
+ * Client state.
+ */
+struct ANTHTTPClient {
+    /** The multi handle; owned by the I/O thread once started. */
+    CURLM *multi;
+
+    /** The I/O thread. */
+    pthread_t thread;
+
+    /** Lock that must be held when accessing the fields below. */
+    pthread_mutex_t lock;
+
+    /** Transfers submitted, but not yet added to the multi handle. Held in reverse submission order. */
+    ANTHTTPClientTransfer *pending;
+
+    /** Request identifiers for which cancellation has been requested. */
+    uint64_t *cancellations;
+    size_t cancellationCount;
+    size_t cancellationCapacity;
+
+    /** Idle easy handles available for reuse. */
+    CURL *freeHandles[ANT_HTTP_CLIENT_MAX_FREE_HANDLES];
+    size_t freeHandleCount;
+
+    /** The last assigned request identifier. */
+    uint64_t lastIdentifier;
+
+    /** True if the client is being destroyed. */
+    bool stopping;
+
+    /** Pool statistics. */
+    ANTHTTPClientStatistics statistics;
+
+    /** Transfers that have been added to the multi handle; accessed only from the I/O thread. */
+    ANTHTTPClientTransfer *active;
+
+    /** The self-pipe used to wake the I/O thread; the read end is polled alongside the multi handle's descriptors. */
+    int wakeupPipe[2];
+};
+
+/**
+ * @internal
+ *
+ * Initialize libcurl.
+ */
+static void ANTHTTPClientGlobalInit (void) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+}
+
+/**
+ * @internal
+ *
+ * Append @a length bytes to @a buffer. Returns false if memory could not be allocated.
+ */
+static bool ANTHTTPClientBufferAppend (ANTHTTPClientBuffer *buffer, const char *bytes, size_t length) {
+    if (buffer->length + length + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : 512;
+        while (capacity < buffer->length + length + 1)
+            capacity *= 2;
+
+        char *bytes = realloc(buffer->bytes, capacity);
+        if (bytes == NULL)
+            return false;
+
+        buffer->bytes = bytes;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+    buffer->bytes[buffer->length] = '\0';
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * libcurl body callback.
+ */
+static size_t ANTHTTPClientWriteBody (char *bytes, size_t size, size_t count, void *userdata) {
+    ANTHTTPClientTransfer *transfer = userdata;
+    transfer->bodyBytesDecoded += size * count;
+
+    if (transfer->dataCallback != NULL) {
+        transfer->dataCallback(transfer->context, bytes, size * count);
+        return size * count;
+    }
+
+    if (!ANTHTTPClientBufferAppend(&transfer->responseBody, bytes, size * count))
+        return 0;
+
+    return size * count;
+}
+
+/**
+ * @internal
+ *
+ * Return the host component of @a url, and its length, in @a length. Returns NULL if @a url is not absolute.
+ */
+static const char *ANTHTTPClientURLHost (const char *url, size_t *length) {
+    const char *host = strstr(url, "://");
+    if (host == NULL)
+        return NULL;
+    host += 3;
+
+    size_t authority = strcspn(host, "/?#");
+    for (size_t i = authority; i > 0; i--) {
+        if (host[i - 1] == '@') {
+            host += i;
+            authority -= i;
+            break;
+        }
+    }
+
+    *length = strcspn(host, ":");
+    if (*length > authority)
+        *length = authority;
+
+    return host;
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a url and @a other name the same host.
+ */
+static bool ANTHTTPClientSameHost (const char *url, const char *other) {
+    size_t length, otherLength;
+    const char *host = ANTHTTPClientURLHost(url, &length);
+    const char *otherHost = ANTHTTPClientURLHost(other, &otherLength);
+
+    if (host == NULL || otherHost == NULL || length != otherLength)
+        return false;
+
+    return strncasecmp(host, otherHost, length) == 0;
+}
+
+/**
+ * @internal
+ *
+ * Append the Set-Cookie lines of the header block @a headers to @a buffer. Returns false if memory could not be allocated.
+ */
+static bool ANTHTTPClientCopySetCookieLines (ANTHTTPClientBuffer *buffer, const char *headers, size_t length) {
+    static const char name[] = "Set-Cookie:";
+    const char *end = headers + length;
+
+    for (const char *line = headers; line < end;) {
+        const char *next = memchr(line, '\n', (size_t) (end - line));
+        next = next != NULL ? next + 1 : end;
+
+        if ((size_t) (next - line) > sizeof(name) - 1 && strncasecmp(line, name, sizeof(name) - 1) == 0) {
+            if (!ANTHTTPClientBufferAppend(buffer, line, (size_t) (next - line)))
+                return false;
+        }
+
+        line = next;
+    }
+
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * libcurl header callback. Only the header block of the final response is retained; the status line of each
+ * interim or redirect response resets the buffer. The Set-Cookie lines of a response are carried into the block of the
+ * response that follows it if both were received from the same host, so that the cookies set by a redirect within a
+ * site are not lost. Cookies set by a redirect from another host are discarded, as they could not be attributed to the
+ * final response's URL.
+ */
+static size_t ANTHTTPClientWriteHeader (char *bytes, size_t size, size_t count, void *userdata) {
+    ANTHTTPClientTransfer *transfer = userdata;
+    size_t length = size * count;
+
+    if (length >= 5 && memcmp(bytes, "HTTP/", 5) == 0) {
+        /* libcurl updates the effective URL before each redirect is requested */
+        char *url = NULL;
+        curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &url);
+        if (url == NULL || (url = strdup(url)) == NULL)
+            return 0;
+
+        ANTHTTPClientBuffer cookies = { NULL, 0, 0 };
+        if (transfer->responseURL != NULL && ANTHTTPClientSameHost(transfer->responseURL, url)) {
+            if (!ANTHTTPClientCopySetCookieLines(&cookies, transfer->responseHeaders.bytes, transfer->responseHeaders.length)) {
+                free(url);
+                return 0;
+            }
+        }
+
+        free(transfer->responseURL);
+        transfer->responseURL = url;
+        transfer->responseHeaders.length = 0;
+
+        bool ok = ANTHTTPClientBufferAppend(&transfer->responseHeaders, bytes, length) &&
+            ANTHTTPClientBufferAppend(&transfer->responseHeaders, cookies.bytes, cookies.length);
+        free(cookies.bytes);
+
+        return ok ? length : 0;
+    }
+
+    if (!ANTHTTPClientBufferAppend(&transfer->responseHeaders, bytes, length))
+        return 0;
+
+    return length;
+}
+
+/**
+ * @internal
+ *
+ * Map a libcurl result code to an ANTHTTPClientError.
+ */
+static ANTHTTPClientError ANTHTTPClientMapError (CURLcode code) {
+    switch (code) {
+        case CURLE_OK:
+            return ANTHTTPClientErrorNone;
+
+        case CURLE_UNSUPPORTED_PROTOCOL:
+        case CURLE_URL_MALFORMAT:
+            return ANTHTTPClientErrorBadURL;
+
+        case CURLE_COULDNT_RESOLVE_PROXY:
+        case CURLE_COULDNT_RESOLVE_HOST:
+            return ANTHTTPClientErrorCannotFindHost;
+
+        case CURLE_COULDNT_CONNECT:
+            return ANTHTTPClientErrorCannotConnect;
+
+        case CURLE_OPERATION_TIMEDOUT:
+            return ANTHTTPClientErrorTimedOut;
+
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_PEER_FAILED_VERIFICATION:
+#if LIBCURL_VERSION_NUM < 0x073e00
+        /* Since 7.62, CURLE_SSL_CACERT is an alias of CURLE_PEER_FAILED_VERIFICATION */
+        case CURLE_SSL_CACERT:
+#endif
+        case CURLE_SSL_CERTPROBLEM:
+        case CURLE_SSL_CIPHER:
+        case CURLE_SSL_CACERT_BADFILE:
+            return ANTHTTPClientErrorSecureConnectionFailed;
+
+        case CURLE_PARTIAL_FILE:
+        case CURLE_GOT_NOTHING:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+#if LIBCURL_VERSION_NUM >= 0x073300
+        case CURLE_WEIRD_SERVER_REPLY:
+#endif
+            return ANTHTTPClientErrorConnectionLost;
+
+        default:
+            return ANTHTTPClientErrorUnknown;
+    }
+}
+
+/**
+ * @internal
+ *
+ * Release all resources held by @a transfer, returning its easy handle to the free list if space is available.
+ */
+static void ANTHTTPClientTransferFree (ANTHTTPClient *client, ANTHTTPClientTransfer *transfer) {
+    CURL *easy = transfer->easy;
+
+    curl_slist_free_all(transfer->headers);
+    free(transfer->responseURL);
+    free(transfer->responseHeaders.bytes);
+    free(transfer->responseBody.bytes);
+    free(transfer);
+
+    if (easy == NULL)
+        return;
+
+    pthread_mutex_lock(&client->lock);
+    if (client->freeHandleCount < ANT_HTTP_CLIENT_MAX_FREE_HANDLES) {
+        curl_easy_reset(easy);
+        client->freeHandles[client->freeHandleCount++] = easy;
+        easy = NULL;
+    }
+    pthread_mutex_unlock(&client->lock);
+
+    if (easy != NULL)
+        curl_easy_cleanup(easy);
+}
+
+/**
+ * @internal
+ *
+ * Return the number of response body bytes read from the connection by @a easy, prior to content decoding.
+ */
+static uint64_t ANTHTTPClientBodyBytesReceived (CURL *easy) {
+#if LIBCURL_VERSION_NUM >= 0x073700
+    curl_off_t received = 0;
+    if (curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &received) == CURLE_OK)
+        return (uint64_t) received;
+#endif
+
+    /* CURLINFO_SIZE_DOWNLOAD_T is unavailable prior to libcurl 7.55, regardless of the headers we were built against;
+     * a double represents any realistic byte count exactly. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    double size = 0;
+    curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD, &size);
+#pragma GCC diagnostic pop
+
+    return (uint64_t) size;
+}
+
+/**
+ * @internal
+ *
+ * Invoke @a transfer's callback with the given result, update the pool statistics, and free the transfer. The transfer must
+ * not be attached to the multi handle.
+ *
+ * @param client The owning client.
+ * @param transfer The completed transfer.
+ * @param error The transfer result.
+ * @param code The libcurl result code, used to produce an error message if @a error is not ANTHTTPClientErrorNone.
+ */
+static void ANTHTTPClientComplete (ANTHTTPClient *client, ANTHTTPClientTransfer *transfer, ANTHTTPClientError error, CURLcode code) {
+    ANTHTTPClientResponse response;
+    long connects = 0;
+
+    if (error == ANTHTTPClientErrorNone) {
+        char *url = NULL;
+
+        memset(&response, 0, sizeof(response));
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &response.statusCode);
+        curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &url);
+        response.url = url;
+        response.headers = transfer->responseHeaders.bytes != NULL ? transfer->responseHeaders.bytes : "";
+        response.headersLength = transfer->responseHeaders.length;
+        response.body = transfer->responseBody.bytes;
+        response.bodyLength = transfer->responseBody.length;
+
+        response.bodyBytesReceived = ANTHTTPClientBodyBytesReceived(transfer->easy);
+        response.bodyBytesDecoded = transfer->bodyBytesDecoded;
+    }
+
+    if (error != ANTHTTPClientErrorCancelled)
+        curl_easy_getinfo(transfer->easy, CURLINFO_NUM_CONNECTS, &connects);
+
+    pthread_mutex_lock(&client->lock); {
+        client->statistics.requests++;
+        client->statistics.activeRequests--;
+        client->statistics.connectionsOpened += (uint64_t) connects;
+
+        if (error == ANTHTTPClientErrorNone && connects == 0)
+            client->statistics.connectionsReused++;
+
+        if (error == ANTHTTPClientErrorNone) {
+            client->statistics.bodyBytesReceived += response.bodyBytesReceived;
+            client->statistics.bodyBytesDecoded += response.bodyBytesDecoded;
+        }
+
+        if (error == ANTHTTPClientErrorCancelled)
+            client->statistics.cancelled++;
+    } pthread_mutex_unlock(&client->lock);
+
+    const char *message = NULL;
+    if (error == ANTHTTPClientErrorCancelled)
+        message = "The request was cancelled";
+    else if (error != ANTHTTPClientErrorNone)
+        message = transfer->errorBuffer[0] != '\0' ? transfer->errorBuffer : curl_easy_strerror(code);
+
+    transfer->callback(transfer->context, error == ANTHTTPClientErrorNone ? &response : NULL, error, message);
+    ANTHTTPClientTransferFree(client, transfer);
+}
+
+/**
+ * @internal
+ *
+ * Cancel the active transfer with @a identifier, if any. Must be called on the I/O thread.
+ */
+static void ANTHTTPClientCancelActive (ANTHTTPClient *client, uint64_t identifier) {
+    for (ANTHTTPClientTransfer **link = &client->active; *link != NULL; link = &(*link)->next) {
+        ANTHTTPClientTransfer *transfer = *link;
+        if (transfer->identifier != identifier)
+            continue;
+
+        *link = transfer->next;
+        curl_multi_remove_handle(client->multi, transfer->easy);
+        ANTHTTPClientComplete(client, transfer, ANTHTTPClientErrorCancelled, CURLE_OK);
+        return;
+    }
+}
+
+/**
+ * @internal
+ *
+ * Wake the I/O thread, if it is waiting in ANTHTTPClientWait(). Safe to call from any thread.
+ */
+static void ANTHTTPClientWakeup (ANTHTTPClient *client) {
+    /* The pipe is non-blocking; if it is full, a wakeup is already pending */
+    ssize_t result;
+    do {
+        result = write(client->wakeupPipe[1], "", 1);
+    } while (result < 0 && errno == EINTR);
+}
+
+/**
+ * @internal
+ *
+ * Wait until a transfer's descriptors are ready, libcurl's next timeout expires, or the I/O thread is woken by
+ * ANTHTTPClientWakeup(), for no longer than ANT_HTTP_CLIENT_POLL_TIMEOUT. Must be called on the I/O thread.
+ */
+static void ANTHTTPClientWait (ANTHTTPClient *client) {
+    fd_set readfds, writefds, exceptfds;
+    int maxfd = -1;
+
+    FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
+    FD_ZERO(&exceptfds);
+
+    /* FD_SET() of a descriptor of FD_SETSIZE or above is undefined; the wakeup pipe and transfer sockets are rejected at
+     * creation if they can not be represented */
+    curl_multi_fdset(client->multi, &readfds, &writefds, &exceptfds, &maxfd);
+
+    long timeout = -1;
+    curl_multi_timeout(client->multi, &timeout);
+    if (timeout < 0 || timeout > ANT_HTTP_CLIENT_POLL_TIMEOUT)
+        timeout = ANT_HTTP_CLIENT_POLL_TIMEOUT;
+
+    int wakeup = client->wakeupPipe[0];
+    FD_SET(wakeup, &readfds);
+    if (wakeup > maxfd)
+        maxfd = wakeup;
+
+    struct timeval tv = { .tv_sec = timeout / 1000, .tv_usec = (int) (timeout % 1000) * 1000 };
+    if (select(maxfd + 1, &readfds, &writefds, &exceptfds, &tv) <= 0)
+        return;
+
+    /* Drain any pending wakeups */
+    if (FD_ISSET(wakeup, &readfds)) {
+        char bytes[64];
+        while (read(wakeup, bytes, sizeof(bytes)) > 0);
+    }
+}
+
+/**
+ * @internal
+ *
+ * The I/O thread's run loop.
+ */
+static void *ANTHTTPClientRun (void *arg) {
+    ANTHTTPClient *client = arg;
+    uint64_t *cancellations = NULL;
+    size_t cancellationCapacity = 0;
+
+    while (true) {
+        ANTHTTPClientTransfer *pending;
+        size_t cancellationCount;
+        bool stopping;
+
+        /* Claim newly submitted transfers and cancellation requests */
+        pthread_mutex_lock(&client->lock); {
+            pending = client->pending;
+            client->pending = NULL;
+
+            /* Swap cancellation buffers, rather than copying */
+            uint64_t *swap = cancellations;
+            size_t swapCapacity = cancellationCapacity;
+            cancellations = client->cancellations;
+            cancellationCapacity = client->cancellationCapacity;
+            cancellationCount = client->cancellationCount;
+            client->cancellations = swap;
+            client->cancellationCapacity = swapCapacity;
+            client->cancellationCount = 0;
+
+            stopping = client->stopping;
+        } pthread_mutex_unlock(&client->lock);
+
+        /* Reverse the pending list, restoring submission order, and start the transfers */
+        ANTHTTPClientTransfer *ordered = NULL;
+        while (pending != NULL) {
+            ANTHTTPClientTransfer *next = pending->next;
+            pending->next = ordered;
+            ordered = pending;
+            pending = next;
+        }
+
+        while (ordered != NULL) {
+            ANTHTTPClientTransfer *transfer = ordered;
+            ordered = transfer->next;
+
+            if (stopping) {
+                ANTHTTPClientComplete(client, transfer, ANTHTTPClientErrorCancelled, CURLE_OK);
+                continue;
+            }
+
+            CURLMcode code = curl_multi_add_handle(client->multi, transfer->easy);
+            if (code != CURLM_OK) {
+                ANTHTTPClientComplete(client, transfer, ANTHTTPClientErrorUnknown, CURLE_FAILED_INIT);
+                continue;
+            }
+
+            transfer->next = client->active;
+            client->active = transfer;
+        }
+
+        for (size_t i = 0; i < cancellationCount; i++)
+            ANTHTTPClientCancelActive(client, cancellations[i]);
+
+        /* On shutdown, cancel everything that remains */
+        if (stopping) {
+            while (client->active != NULL)
+                ANTHTTPClientCancelActive(client, client->active->identifier);
+            break;
+        }
+
+        /* Drive the transfers */
+        int running;
+        curl_multi_perform(client->multi, &running);
+
+        CURLMsg *msg;
+        int remaining;
+        while ((msg = curl_multi_info_read(client->multi, &remaining)) != NULL) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            ANTHTTPClientTransfer *transfer = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &transfer);
+            CURLcode result = msg->data.result;
+
+            for (ANTHTTPClientTransfer **link = &client->active; *link != NULL; link = &(*link)->next) {
+                if (*link == transfer) {
+                    *link = transfer->next;
+                    break;
+                }
+            }
+
+            curl_multi_remove_handle(client->multi, transfer->easy);
+            ANTHTTPClientComplete(client, transfer, ANTHTTPClientMapError(result), result);
+        }
+
+        ANTHTTPClientWait(client);
+    }
+
+    free(cancellations);
+    return NULL;
+}
+
+/**
+ * @internal
+ *
+ * libcurl socket creation callback. Sockets are waited on with select(), which can not represent a descriptor of
+ * FD_SETSIZE or above; as the lowest free descriptor is always allocated, no usable descriptor is available, and the
+ * connection attempt fails.
+ */
+static curl_socket_t ANTHTTPClientOpenSocket (void *context, curlsocktype purpose, struct curl_sockaddr *address) {
+    curl_socket_t fd = socket(address->family, address->socktype, address->protocol);
+    if (fd != CURL_SOCKET_BAD && fd >= FD_SETSIZE) {
+        close(fd);
+        errno = EMFILE;
+        return CURL_SOCKET_BAD;
+    }
+
+    return fd;
+}
+
+/**
+ * @internal
+ *
+ * Create a non-blocking, close-on-exec pipe in @a fds. Returns false on failure, including if the read end can not be
+ * passed to select().
+ */
+static bool ANTHTTPClientCreatePipe (int fds[2]) {
+    if (pipe(fds) != 0)
+        return false;
+
+    if (fds[0] >= FD_SETSIZE) {
+        close(fds[0]);
+        close(fds[1]);
+        errno = EMFILE;
+        return false;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK) != 0 || fcntl(fds[i], F_SETFD, FD_CLOEXEC) != 0) {
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Create a new HTTP client, and start its I/O thread.
+ *
+ * @param maxConnectionsPerHost The maximum number of concurrent connections to any one host, or 0 for no limit. Requests
+ * beyond this limit are queued until a connection becomes available.
+ * @param maxIdleConnections The maximum number of connections retained in the keep-alive pool, across all hosts.
+ *
+ * @return Returns the new client, or NULL on failure. The client must be freed with ANTHTTPClientDestroy().
+ */
+ANTHTTPClient *ANTHTTPClientCreate (size_t maxConnectionsPerHost, size_t maxIdleConnections) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, ANTHTTPClientGlobalInit);
+
+    ANTHTTPClient *client = calloc(1, sizeof(ANTHTTPClient));
+    if (client == NULL)
+        return NULL;
+
+    if (!ANTHTTPClientCreatePipe(client->wakeupPipe)) {
+        free(client);
+        return NULL;
+    }
+
+    if ((client->multi = curl_multi_init()) == NULL) {
+        close(client->wakeupPipe[0]);
+        close(client->wakeupPipe[1]);
+        free(client);
+        return NULL;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x071e00
+    curl_multi_setopt(client->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) maxConnectionsPerHost);
+#endif
+    curl_multi_setopt(client->multi, CURLMOPT_MAXCONNECTS, (long) maxIdleConnections);
+
+    pthread_mutex_init(&client->lock, NULL);
+    if (pthread_create(&client->thread, NULL, ANTHTTPClientRun, client) != 0) {
+        pthread_mutex_destroy(&client->lock);
+        curl_multi_cleanup(client->multi);
+        close(client->wakeupPipe[0]);
+        close(client->wakeupPipe[1]);
+        free(client);
+        return NULL;
+    }
+
+    return client;
+}
+
+/**
+ * Destroy @a client. All outstanding requests are cancelled, and their callbacks are called before this function returns.
+ *
+ * @param client The client to destroy. Must not be called from within a request callback.
+ */
+void ANTHTTPClientDestroy (ANTHTTPClient *client) {
+    pthread_mutex_lock(&client->lock);
+    client->stopping = true;
+    pthread_mutex_unlock(&client->lock);
+
+    ANTHTTPClientWakeup(client);
+    pthread_join(client->thread, NULL);
+
+    for (size_t i = 0; i < client->freeHandleCount; i++)
+        curl_easy_cleanup(client->freeHandles[i]);
+
+    curl_multi_cleanup(client->multi);
+    close(client->wakeupPipe[0]);
+    close(client->wakeupPipe[1]);
+    pthread_mutex_destroy(&client->lock);
+    free(client->cancellations);
+    free(client);
+}
+
+/**
+ * Submit @a request.
+ *
+ * @param client The client.
+ * @param request The request to send. The request's values are copied.
+ * @param callback The callback to be called upon completion.
+ * @param context A context pointer to be passed to @a callback.
+ *
+ * @return Returns a non-zero request identifier that may be passed to ANTHTTPClientCancel(), or 0 if the request could
+ * not be submitted, in which case @a callback will never be called.
+ */
+uint64_t ANTHTTPClientSend (ANTHTTPClient *client, const ANTHTTPClientRequest *request, ANTHTTPClientCallback callback, void *context) {
+    ANTHTTPClientTransfer *transfer = calloc(1, sizeof(ANTHTTPClientTransfer));
+    if (transfer == NULL)
+        return 0;
+
+    transfer->callback = callback;
+    transfer->context = context;
+    transfer->dataCallback = request->dataCallback;
+
+    /* Fetch a reusable handle */
+    pthread_mutex_lock(&client->lock);
+    if (client->freeHandleCount > 0)
+        transfer->easy = client->freeHandles[--client->freeHandleCount];
+    pthread_mutex_unlock(&client->lock);
+
+    if (transfer->easy == NULL && (transfer->easy = curl_easy_init()) == NULL) {
+        free(transfer);
+        return 0;
+    }
+
+    /* Request headers. An empty Expect header disables libcurl's default 'Expect: 100-continue' handling of large bodies,
+     * which costs a round trip. */
+    bool ok = true;
+    for (size_t i = 0; i < request->headerCount && ok; i++) {
+        struct curl_slist *headers = curl_slist_append(transfer->headers, request->headers[i]);
+        if (headers == NULL)
+            ok = false;
+        else
+            transfer->headers = headers;
+    }
+
+    struct curl_slist *headers = ok ? curl_slist_append(transfer->headers, "Expect:") : NULL;
+    if (headers == NULL) {
+        ANTHTTPClientTransferFree(client, transfer);
+        return 0;
+    }
+    transfer->headers = headers;
+
+    CURL *easy = transfer->easy;
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(easy, CURLOPT_URL, request->url);
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_OPENSOCKETFUNCTION, ANTHTTPClientOpenSocket);
+#if LIBCURL_VERSION_NUM >= 0x071900
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_MAXREDIRS, (long) ANT_HTTP_CLIENT_MAX_REDIRECTS);
+
+    /* Compressed responses are inflated incrementally as they are received, before being passed to the body callback. An
+     * Accept-Encoding request header overrides the default advertisement of all encodings supported by libcurl. */
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, transfer->errorBuffer);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, ANTHTTPClientWriteBody);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, ANTHTTPClientWriteHeader);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer);
+
+    if (request->timeout > 0)
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, (long) (request->timeout * 1000.0));
+
+    /* Configure the method and body */
+    const char *method = request->method != NULL ? request->method : "GET";
+    if (strcmp(method, "HEAD") == 0) {
+        curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+    } else if (request->body != NULL) {
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t) request->bodyLength);
+        curl_easy_setopt(easy, CURLOPT_COPYPOSTFIELDS, request->body);
+        if (strcmp(method, "POST") != 0)
+            curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, method);
+    } else if (strcmp(method, "GET") != 0) {
+        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, method);
+    }
+
+    /* Enqueue */
+    uint64_t identifier = 0;
+    bool stopping;
+    pthread_mutex_lock(&client->lock); {
+        stopping = client->stopping;
+        if (!stopping) {
+            identifier = transfer->identifier = ++client->lastIdentifier;
+            transfer->next = client->pending;
+            client->pending = transfer;
+            client->statistics.activeRequests++;
+        }
+    } pthread_mutex_unlock(&client->lock);
+
+    if (stopping) {
+        ANTHTTPClientTransferFree(client, transfer);
+        return 0;
+    }
+
+    ANTHTTPClientWakeup(client);
+    return identifier;
+}
+
+/**
+ * Cancel the request with @a requestId. If the request has not yet completed, its callback will be called with
+ * ANTHTTPClientErrorCancelled, and its connection will be closed. If the request has already completed, this function
+ * does nothing.
+ *
+ * @param client The client.
+ * @param requestId The request identifier returned by ANTHTTPClientSend().
+ */
+void ANTHTTPClientCancel (ANTHTTPClient *client, uint64_t requestId) {
+    if (requestId == 0)
+        return;
+
+    pthread_mutex_lock(&client->lock); {
+        if (client->cancellationCount == client->cancellationCapacity) {
+            size_t capacity = client->cancellationCapacity > 0 ? client->cancellationCapacity * 2 : 16;
+            uint64_t *cancellations = realloc(client->cancellations, capacity * sizeof(uint64_t));
+            if (cancellations == NULL) {
+                pthread_mutex_unlock(&client->lock);
+                return;
+            }
+
+            client->cancellations = cancellations;
+            client->cancellationCapacity = capacity;
+        }
+
+        client->cancellations[client->cancellationCount++] = requestId;
+    } pthread_mutex_unlock(&client->lock);
+
+    ANTHTTPClientWakeup(client);
+}
+
+/**
+ * Fetch @a client's connection pool statistics.
+ *
+ * @param client The client.
+ * @param statistics On return, the current statistics.
+ */
+void ANTHTTPClientGetStatistics (ANTHTTPClient *client, ANTHTTPClientStatistics *statistics) {
+    pthread_mutex_lock(&client->lock);
+    *statistics = client->statistics;
+    pthread_mutex_unlock(&client->lock);
+}
@@ -0,0 +1,186 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ANT_HTTP_CLIENT_H
+#define ANT_HTTP_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * HTTP client error codes.
+ */
+typedef enum {
+    /** The request completed; the response may still carry an HTTP error status. */
+    ANTHTTPClientErrorNone = 0,
+
+    /** The request was cancelled via ANTHTTPClientCancel(). */
+    ANTHTTPClientErrorCancelled = 1,
+
+    /** The request URL was malformed or uses an unsupported scheme. */
+    ANTHTTPClientErrorBadURL = 2,
+
+    /** The host name could not be resolved. */
+    ANTHTTPClientErrorCannotFindHost = 3,
+
+    /** A connection to the host could not be established. */
+    ANTHTTPClientErrorCannotConnect = 4,
+
+    /** The request timed out. */
+    ANTHTTPClientErrorTimedOut = 5,
+
+    /** The TLS handshake or certificate validation failed. */
+    ANTHTTPClientErrorSecureConnectionFailed = 6,
+
+    /** The connection was lost, or the server sent a malformed response. */
+    ANTHTTPClientErrorConnectionLost = 7,
+
+    /** Any other failure. */
+    ANTHTTPClientErrorUnknown = 8
+} ANTHTTPClientError;
+
+/**
+ * A response body callback. Called on the client's I/O thread, in order, as each portion of the final response's body
+ * is received, and before the request's completion callback.
+ *
+ * @param context The context pointer supplied to ANTHTTPClientSend().
+ * @param bytes The received bytes, which are only valid for the duration of the callback.
+ * @param length The number of bytes.
+ */
+typedef void (*ANTHTTPClientDataCallback) (void *context, const void *bytes, size_t length);
+
+/**
+ * An HTTP request. All values are borrowed, and need only remain valid for the duration of the ANTHTTPClientSend() call.
+ */
+typedef struct ANTHTTPClientRequest {
+    /** The request method, eg, "GET". */
+    const char *method;
+
+    /** The absolute request URL. */
+    const char *url;
+
+    /** Request header lines of the form "Name: value". */
+    const char * const *headers;
+
+    /** The number of entries in @a headers. */
+    size_t headerCount;
+
+    /** The request body, or NULL. */
+    const void *body;
+
+    /** The length of @a body, in bytes. */
+    size_t bodyLength;
+
+    /** The request timeout, in seconds, or 0 for no timeout. */
+    double timeout;
+
+    /** If non-NULL, the response body is streamed to this callback as it is received, and is not buffered; the body
+     * provided to the completion callback will be empty. */
+    ANTHTTPClientDataCallback dataCallback;
+} ANTHTTPClientRequest;
+
+/**
+ * An HTTP response. All values are owned by the client, and are only valid for the duration of the completion callback.
+ */
+typedef struct ANTHTTPClientResponse {
+    /** The HTTP status code of the final response. */
+    long statusCode;
+
+    /** The URL of the final response, after following any redirects. */
+    const char *url;
+
+    /** The raw header block of the final response, including the status line. Includes the Set-Cookie lines of any
+     * redirect responses received from the same host as the final response. */
+    const char *headers;
+
+    /** The length of @a headers, in bytes. */
+    size_t headersLength;
+
+    /** The response body. */
+    const void *body;
+
+    /** The length of @a body, in bytes. */
+    size_t bodyLength;
+
+    /** The number of response body bytes received from the server, prior to any content decoding. */
+    uint64_t bodyBytesReceived;
+
+    /** The number of response body bytes after content decoding. Equal to bodyBytesReceived if the response was not
+     * compressed. */
+    uint64_t bodyBytesDecoded;
+} ANTHTTPClientResponse;
+
+/**
+ * Connection pool statistics.
+ */
+typedef struct ANTHTTPClientStatistics {
+    /** The number of requests that have completed, successfully or otherwise. */
+    uint64_t requests;
+
+    /** The number of requests currently queued or in flight. */
+    uint64_t activeRequests;
+
+    /** The number of new connections opened. */
+    uint64_t connectionsOpened;
+
+    /** The number of completed requests that were sent over an existing keep-alive connection. */
+    uint64_t connectionsReused;
+
+    /** The number of requests that were cancelled. */
+    uint64_t cancelled;
+
+    /** The total number of response body bytes received from the server by successful requests, prior to any content
+     * decoding. */
+    uint64_t bodyBytesReceived;
+
+    /** The total number of response body bytes delivered by successful requests, after content decoding. */
+    uint64_t bodyBytesDecoded;
+} ANTHTTPClientStatistics;
+
+/**
+ * A request completion callback. Called exactly once per request, on the client's I/O thread.
+ *
+ * @param context The context pointer supplied to ANTHTTPClientSend().
+ * @param response The response, or NULL if @a error is not ANTHTTPClientErrorNone.
+ * @param error The request result.
+ * @param message A human readable description of the error, or NULL.
+ */
+typedef void (*ANTHTTPClientCallback) (void *context, const ANTHTTPClientResponse *response, ANTHTTPClientError error, const char *message);
+
+typedef struct ANTHTTPClient ANTHTTPClient;
+
+ANTHTTPClient *ANTHTTPClientCreate (size_t maxConnectionsPerHost, size_t maxIdleConnections);
+void ANTHTTPClientDestroy (ANTHTTPClient *client);
+
+uint64_t ANTHTTPClientSend (ANTHTTPClient *client, const ANTHTTPClientRequest *request, ANTHTTPClientCallback callback, void *context);
+void ANTHTTPClientCancel (ANTHTTPClient *client, uint64_t requestId);
+
+void ANTHTTPClientGetStatistics (ANTHTTPClient *client, ANTHTTPClientStatistics *statistics);
+
+#endif /* ANT_HTTP_CLIENT_H */
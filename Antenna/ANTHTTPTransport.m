@@ -0,0 +1,314 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTHTTPTransport.h"
+
+/**
+ * @internal
+ *
+ * State for a single in-flight request, retained by the ANTHTTPClient callback context until completion.
+ */
+@interface ANTHTTPTransportRequest : NSObject
+
+/** The request URL. */
+@property(nonatomic, strong) NSURL *URL;
+
+/** The request's cancellation ticket. */
+@property(nonatomic, strong) PLCancelTicket *ticket;
+
+/** The completion handler. */
+@property(nonatomic, copy) ANTNetworkTransportCallback handler;
+
+/** The response body handler, or nil if the response body is buffered. */
+@property(nonatomic, copy) ANTNetworkTransportDataHandler dataHandler;
+
+/** The serial queue on which the response body and completion are delivered, or nil if the response body is buffered. */
+@property(nonatomic, strong) dispatch_queue_t queue;
+
+@end
+
+@implementation ANTHTTPTransportRequest
+@end
+
+/**
+ * An ANTNetworkTransport backed by ANTHTTPClient, a portable HTTP/1.1 client that maintains a per-host pool of
+ * keep-alive connections.
+ *
+ * Unlike the URL loading system, the pool's behavior is fully configurable and observable via the statistics
+ * property, and the transport has no dependency on platform networking APIs.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used concurrently from any thread.
+ */
+@implementation ANTHTTPTransport {
+@private
+    /** The backing client. */
+    ANTHTTPClient *_client;
+}
+
+/**
+ * Initialize a new transport, retaining up to twice @a maxConnectionsPerHost idle connections.
+ *
+ * @param maxConnectionsPerHost The maximum number of concurrent connections to any one host, or 0 for no limit.
+ */
+- (instancetype) initWithMaxConnectionsPerHost: (NSUInteger) maxConnectionsPerHost {
+    return [self initWithMaxConnectionsPerHost: maxConnectionsPerHost maxIdleConnections: MAX(8, maxConnectionsPerHost * 2)];
+}
+
+/**
+ * Initialize a new transport.
+ *
+ * @param maxConnectionsPerHost The maximum number of concurrent connections to any one host, or 0 for no limit. Requests
+ * beyond this limit are queued until a connection becomes available.
+ * @param maxIdleConnections The maximum number of keep-alive connections retained across all hosts.
+ */
+- (instancetype) initWithMaxConnectionsPerHost: (NSUInteger) maxConnectionsPerHost maxIdleConnections: (NSUInteger) maxIdleConnections {
+    PLSuperInit();
+
+    if ((_client = ANTHTTPClientCreate(maxConnectionsPerHost, maxIdleConnections)) == NULL) {
+        NSLog(@"Failed to create the HTTP client");
+        return nil;
+    }
+
+    return self;
+}
+
+- (void) dealloc {
+    if (_client != NULL)
+        ANTHTTPClientDestroy(_client);
+}
+
+/**
+ * @internal
+ *
+ * Parse the raw header block of an HTTP response, returning the header fields and HTTP version. Repeated
+ * header fields are joined with ", ", matching NSURLConnection's behavior.
+ */
+static NSDictionary *ANTHTTPTransportParseHeaders (const ANTHTTPClientResponse *response, NSString **version) {
+    NSMutableDictionary *fields = [NSMutableDictionary dictionary];
+    NSString *block = [[NSString alloc] initWithBytes: response->headers length: response->headersLength encoding: NSISOLatin1StringEncoding];
+
+    *version = @"HTTP/1.1";
+
+    __block BOOL statusLine = YES;
+    [block enumerateLinesUsingBlock: ^(NSString *line, BOOL *stop) {
+        if (statusLine) {
+            statusLine = NO;
+            NSRange space = [line rangeOfString: @" "];
+            if (space.location != NSNotFound)
+                *version = [line substringToIndex: space.location];
+            return;
+        }
+
+        NSRange colon = [line rangeOfString: @":"];
+        if (colon.location == NSNotFound || colon.location == 0)
+            return;
+
+        NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
+        NSString *name = [[line substringToIndex: colon.location] stringByTrimmingCharactersInSet: whitespace];
+        NSString *value = [[line substringFromIndex: NSMaxRange(colon)] stringByTrimmingCharactersInSet: whitespace];
+
+        NSString *existing = fields[name];
+        fields[name] = existing != nil ? [NSString stringWithFormat: @"%@, %@", existing, value] : value;
+    }];
+
+    return fields;
+}
+
+/**
+ * @internal
+ *
+ * Map an ANTHTTPClientError to an NSURLErrorDomain code.
+ */
+static NSInteger ANTHTTPTransportErrorCode (ANTHTTPClientError error) {
+    switch (error) {
+        case ANTHTTPClientErrorNone:
+            break;
+        case ANTHTTPClientErrorCancelled:
+            return NSURLErrorCancelled;
+        case ANTHTTPClientErrorBadURL:
+            return NSURLErrorBadURL;
+        case ANTHTTPClientErrorCannotFindHost:
+            return NSURLErrorCannotFindHost;
+        case ANTHTTPClientErrorCannotConnect:
+            return NSURLErrorCannotConnectToHost;
+        case ANTHTTPClientErrorTimedOut:
+            return NSURLErrorTimedOut;
+        case ANTHTTPClientErrorSecureConnectionFailed:
+            return NSURLErrorSecureConnectionFailed;
+        case ANTHTTPClientErrorConnectionLost:
+            return NSURLErrorNetworkConnectionLost;
+        case ANTHTTPClientErrorUnknown:
+            return NSURLErrorUnknown;
+    }
+
+    // Unreachable
+    __builtin_trap();
+}
+
+/**
+ * @internal
+ *
+ * ANTHTTPClient response body callback.
+ */
+static void ANTHTTPTransportReceiveData (void *context, const void *bytes, size_t length) {
+    ANTHTTPTransportRequest *request = (__bridge ANTHTTPTransportRequest *) context;
+
+    /* Hand the data off to the request's serial queue, keeping the I/O thread free of response parsing */
+    NSData *data = [NSData dataWithBytes: bytes length: length];
+    dispatch_async(request.queue, ^{
+        if (!request.ticket.isCancelled)
+            request.dataHandler(data);
+    });
+}
+
+/**
+ * @internal
+ *
+ * ANTHTTPClient completion callback.
+ */
+static void ANTHTTPTransportComplete (void *context, const ANTHTTPClientResponse *response, ANTHTTPClientError error, const char *message) {
+    ANTHTTPTransportRequest *request = (__bridge_transfer ANTHTTPTransportRequest *) context;
+
+    /* Handlers are called on a concurrent queue, keeping the client's I/O thread free of response parsing. Streamed
+     * requests complete on their serial queue, after all response data has been delivered. */
+    dispatch_queue_t queue = request.queue;
+    if (queue == nil)
+        queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    /* Cancelled requests are never reported */
+    if (error == ANTHTTPClientErrorCancelled || request.ticket.isCancelled)
+        return;
+
+    if (error != ANTHTTPClientErrorNone) {
+        NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject: request.URL forKey: NSURLErrorFailingURLErrorKey];
+        if (message != NULL)
+            userInfo[NSLocalizedDescriptionKey] = @(message);
+
+        NSError *nsError = [NSError errorWithDomain: NSURLErrorDomain code: ANTHTTPTransportErrorCode(error) userInfo: userInfo];
+        dispatch_async(queue, ^{
+            request.handler(nil, nil, (ANTNetworkTransferSize) { 0, 0 }, nsError);
+        });
+        return;
+    }
+
+    /* Copy out the response; the client's buffers are only valid for the duration of this callback */
+    NSString *version;
+    NSDictionary *headerFields = ANTHTTPTransportParseHeaders(response, &version);
+    NSURL *url = response->url != NULL ? [NSURL URLWithString: @(response->url)] : nil;
+    NSHTTPURLResponse *httpResponse = [[NSHTTPURLResponse alloc] initWithURL: url != nil ? url : request.URL
+                                                                  statusCode: response->statusCode
+                                                                 HTTPVersion: version
+                                                                headerFields: headerFields];
+    NSData *data = nil;
+    if (request.dataHandler == nil)
+        data = [NSData dataWithBytes: response->body length: response->bodyLength];
+
+    ANTNetworkTransferSize size = { response->bodyBytesReceived, response->bodyBytesDecoded };
+    dispatch_async(queue, ^{
+        if (!request.ticket.isCancelled)
+            request.handler(httpResponse, data, size, nil);
+    });
+}
+
+// from ANTNetworkTransport protocol
+- (void) sendRequest: (NSURLRequest *) request cancelTicket: (PLCancelTicket *) ticket completionHandler: (ANTNetworkTransportCallback) handler {
+    [self sendRequest: request cancelTicket: ticket dataHandler: nil completionHandler: handler];
+}
+
+// from ANTNetworkTransport protocol
+- (void) sendRequest: (NSURLRequest *) request
+        cancelTicket: (PLCancelTicket *) ticket
+         dataHandler: (ANTNetworkTransportDataHandler) dataHandler
+   completionHandler: (ANTNetworkTransportCallback) handler
+{
+    if (ticket.isCancelled)
+        return;
+
+    ANTHTTPTransportRequest *state = [ANTHTTPTransportRequest new];
+    state.URL = [request.URL absoluteURL];
+    state.ticket = ticket;
+    state.handler = handler;
+    if (dataHandler != nil) {
+        state.dataHandler = dataHandler;
+        state.queue = dispatch_queue_create("coop.plausible.antenna.http-transport.request", DISPATCH_QUEUE_SERIAL);
+    }
+
+    /* Formulate the client request. The client copies all values before ANTHTTPClientSend() returns. */
+    NSDictionary *headerFields = [request allHTTPHeaderFields];
+    NSMutableArray *headerLines = [NSMutableArray arrayWithCapacity: [headerFields count]];
+    for (NSString *name in headerFields)
+        [headerLines addObject: [NSString stringWithFormat: @"%@: %@", name, headerFields[name]]];
+
+    const char **headers = calloc(MAX([headerLines count], 1), sizeof(const char *));
+    for (NSUInteger i = 0; i < [headerLines count]; i++)
+        headers[i] = [headerLines[i] UTF8String];
+
+    NSData *body = [request HTTPBody];
+    ANTHTTPClientRequest clientRequest = {
+        .method = [[request HTTPMethod] UTF8String],
+        .url = [[state.URL absoluteString] UTF8String],
+        .headers = headers,
+        .headerCount = [headerLines count],
+        .body = [body bytes],
+        .bodyLength = [body length],
+        .timeout = [request timeoutInterval],
+        .dataCallback = dataHandler != nil ? ANTHTTPTransportReceiveData : NULL
+    };
+
+    void *context = (__bridge_retained void *) state;
+    uint64_t requestId = ANTHTTPClientSend(_client, &clientRequest, ANTHTTPTransportComplete, context);
+    free(headers);
+
+    if (requestId == 0) {
+        /* The callback will never be called; release the context and report the failure */
+        CFBridgingRelease(context);
+        NSError *error = [NSError errorWithDomain: NSURLErrorDomain code: NSURLErrorUnknown userInfo: @{NSURLErrorFailingURLErrorKey : state.URL}];
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            handler(nil, nil, (ANTNetworkTransferSize) { 0, 0 }, error);
+        });
+        return;
+    }
+
+    /* Abort the request on cancellation. The client ignores cancellation of requests that have already completed. */
+    __weak ANTHTTPTransport *weakSelf = self;
+    [ticket addCancelHandler: ^(PLCancelTicketReason reason) {
+        ANTHTTPTransport *strongSelf = weakSelf;
+        if (strongSelf != nil)
+            ANTHTTPClientCancel(strongSelf->_client, requestId);
+    } dispatchContext: [PLDirectDispatchContext context]];
+}
+
+// property getter
+- (ANTHTTPClientStatistics) statistics {
+    ANTHTTPClientStatistics statistics;
+    ANTHTTPClientGetStatistics(_client, &statistics);
+    return statistics;
+}
+
+@end
@@ -0,0 +1,222 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import <libkern/OSAtomic.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+#import "ANTHTTPTransport.h"
+
+/**
+ * A minimal HTTP/1.1 stand-in server, bound to the loopback interface. Each response body echoes the request path;
+ * requests for '/stall' are never answered, and requests for '/redirect' set a cookie and redirect to '/final'. All
+ * connections are kept alive.
+ */
+@interface ANTHTTPTransportTestServer : NSObject
+- (void) stop;
+@property(nonatomic, readonly) NSURL *baseURL;
+@property(nonatomic, readonly) int32_t acceptedConnections;
+@end
+
+@implementation ANTHTTPTransportTestServer {
+    int _listenSocket;
+    volatile int32_t _acceptedConnections;
+}
+
+- (instancetype) init {
+    PLSuperInit();
+
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addrLen = sizeof(addr);
+
+    _listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (bind(_listenSocket, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(_listenSocket, 16) != 0 ||
+        getsockname(_listenSocket, (struct sockaddr *) &addr, &addrLen) != 0)
+    {
+        close(_listenSocket);
+        return nil;
+    }
+
+    _baseURL = [NSURL URLWithString: [NSString stringWithFormat: @"http://127.0.0.1:%u", ntohs(addr.sin_port)]];
+
+    int listenSocket = _listenSocket;
+    [NSThread detachNewThreadSelector: @selector(acceptConnectionsOnSocket:) toTarget: self withObject: @(listenSocket)];
+
+    return self;
+}
+
+- (void) acceptConnectionsOnSocket: (NSNumber *) listenSocket {
+    int fd;
+    while ((fd = accept([listenSocket intValue], NULL, NULL)) >= 0) {
+        OSAtomicIncrement32(&_acceptedConnections);
+        [NSThread detachNewThreadSelector: @selector(serveConnection:) toTarget: self withObject: @(fd)];
+    }
+}
+
+- (void) serveConnection: (NSNumber *) connection {
+    int fd = [connection intValue];
+    NSMutableData *buffer = [NSMutableData data];
+    char bytes[4096];
+    ssize_t nread;
+
+    while ((nread = read(fd, bytes, sizeof(bytes))) > 0) {
+        [buffer appendBytes: bytes length: nread];
+
+        /* Answer every complete (bodiless) request in the buffer */
+        NSRange end;
+        while ((end = [buffer rangeOfData: [@"\r\n\r\n" dataUsingEncoding: NSASCIIStringEncoding] options: 0 range: NSMakeRange(0, [buffer length])]).location != NSNotFound) {
+            NSString *head = [[NSString alloc] initWithData: [buffer subdataWithRange: NSMakeRange(0, end.location)] encoding: NSISOLatin1StringEncoding];
+            [buffer replaceBytesInRange: NSMakeRange(0, NSMaxRange(end)) withBytes: NULL length: 0];
+
+            NSArray *requestLine = [[[head componentsSeparatedByString: @"\r\n"] firstObject] componentsSeparatedByString: @" "];
+            NSString *path = [requestLine count] > 1 ? requestLine[1] : @"/";
+            if ([path isEqualToString: @"/stall"])
+                continue;
+
+            if ([path isEqualToString: @"/redirect"]) {
+                NSData *redirect = [@"HTTP/1.1 302 Found\r\nSet-Cookie: redirect=1; Path=/\r\nLocation: /final\r\nContent-Length: 0\r\n\r\n" dataUsingEncoding: NSISOLatin1StringEncoding];
+                write(fd, [redirect bytes], [redirect length]);
+                continue;
+            }
+
+            NSString *response = [NSString stringWithFormat: @"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nX-Test: 1\r\nX-Test: 2\r\nContent-Length: %lu\r\n\r\n%@",
+                                  (unsigned long) [path length], path];
+            NSData *responseData = [response dataUsingEncoding: NSISOLatin1StringEncoding];
+            write(fd, [responseData bytes], [responseData length]);
+        }
+    }
+
+    close(fd);
+}
+
+- (void) stop {
+    shutdown(_listenSocket, SHUT_RDWR);
+    close(_listenSocket);
+}
+
+- (int32_t) acceptedConnections {
+    return _acceptedConnections;
+}
+
+@end
+
+@interface ANTHTTPTransportTests : XCTestCase @end
+
+@implementation ANTHTTPTransportTests {
+    ANTHTTPTransportTestServer *_server;
+}
+
+- (void) setUp {
+    _server = [ANTHTTPTransportTestServer new];
+    XCTAssertNotNil(_server, @"Failed to start the stand-in server");
+}
+
+- (void) tearDown {
+    [_server stop];
+}
+
+/* Send a GET for @a path, waiting for the result */
+static NSHTTPURLResponse *SendSync (ANTHTTPTransport *transport, NSURL *baseURL, NSString *path, NSData **data, ANTNetworkTransferSize *size) {
+    dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+    __block NSHTTPURLResponse *result = nil;
+    __block NSData *resultData = nil;
+    __block ANTNetworkTransferSize resultSize = { 0, 0 };
+    NSURLRequest *req = [NSURLRequest requestWithURL: [NSURL URLWithString: path relativeToURL: baseURL]];
+
+    [transport sendRequest: req cancelTicket: [PLCancelTicketSource new].ticket completionHandler: ^(NSURLResponse *response, NSData *responseData, ANTNetworkTransferSize size, NSError *error) {
+        result = (NSHTTPURLResponse *) response;
+        resultData = responseData;
+        resultSize = size;
+        dispatch_semaphore_signal(sem);
+    }];
+
+    dispatch_semaphore_wait(sem, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    *data = resultData;
+    if (size != NULL)
+        *size = resultSize;
+    return result;
+}
+
+- (void) testKeepAliveReuse {
+    ANTHTTPTransport *transport = [[ANTHTTPTransport alloc] initWithMaxConnectionsPerHost: 4];
+    const NSUInteger count = 20;
+
+    for (NSUInteger i = 0; i < count; i++) {
+        NSData *data = nil;
+        NSString *path = [NSString stringWithFormat: @"/developer/problem/openProblem/%lu", (unsigned long) i];
+        ANTNetworkTransferSize size;
+        NSHTTPURLResponse *response = SendSync(transport, _server.baseURL, path, &data, &size);
+
+        XCTAssertEqual([response statusCode], (NSInteger) 200, @"Unexpected status");
+        XCTAssertEqualObjects([[NSString alloc] initWithData: data encoding: NSUTF8StringEncoding], path, @"Incorrect body");
+        XCTAssertEqual(size.bodyBytesReceived, (uint64_t) [path length], @"Incorrect received byte count");
+        XCTAssertEqual(size.bodyBytesDecoded, (uint64_t) [path length], @"Incorrect decoded byte count");
+        XCTAssertEqualObjects([response allHeaderFields][@"X-Test"], @"1, 2", @"Repeated headers were not joined");
+    }
+
+    /* Sequential requests must share a single connection */
+    ANTHTTPClientStatistics statistics = transport.statistics;
+    XCTAssertEqual(statistics.requests, (uint64_t) count, @"Incorrect request count");
+    XCTAssertEqual(statistics.connectionsOpened, (uint64_t) 1, @"Connection was not reused");
+    XCTAssertEqual(statistics.connectionsReused, (uint64_t) count - 1, @"Connection was not reused");
+    XCTAssertEqual(_server.acceptedConnections, (int32_t) 1, @"Server accepted more than one connection");
+}
+
+- (void) testRedirectCookies {
+    ANTHTTPTransport *transport = [[ANTHTTPTransport alloc] initWithMaxConnectionsPerHost: 4];
+    NSData *data = nil;
+    NSHTTPURLResponse *response = SendSync(transport, _server.baseURL, @"/redirect", &data, NULL);
+
+    XCTAssertEqual([response statusCode], (NSInteger) 200, @"Unexpected status");
+    XCTAssertEqualObjects([[NSString alloc] initWithData: data encoding: NSUTF8StringEncoding], @"/final", @"Redirect was not followed");
+    XCTAssertEqualObjects([response allHeaderFields][@"Set-Cookie"], @"redirect=1; Path=/", @"Cookies set by the redirect were lost");
+}
+
+- (void) testCancel {
+    ANTHTTPTransport *transport = [[ANTHTTPTransport alloc] initWithMaxConnectionsPerHost: 4];
+    PLCancelTicketSource *source = [PLCancelTicketSource new];
+    __block BOOL called = NO;
+
+    NSURLRequest *req = [NSURLRequest requestWithURL: [NSURL URLWithString: @"/stall" relativeToURL: _server.baseURL]];
+    [transport sendRequest: req cancelTicket: source.ticket completionHandler: ^(NSURLResponse *response, NSData *data, ANTNetworkTransferSize size, NSError *error) {
+        called = YES;
+    }];
+    [source cancel];
+
+    /* Wait for the client to process the cancellation */
+    for (NSUInteger i = 0; i < 100 && transport.statistics.cancelled == 0; i++)
+        [NSThread sleepForTimeInterval: 0.05];
+
+    XCTAssertEqual(transport.statistics.cancelled, (uint64_t) 1, @"Request was not cancelled");
+    XCTAssertEqual(transport.statistics.activeRequests, (uint64_t) 0, @"Cancelled request remains active");
+    XCTAssertFalse(called, @"Handler called for a cancelled request");
+}
+
+@end
@@ -0,0 +1,62 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface ANTJSONSchemaField : NSObject
+
++ (instancetype) requiredField: (NSString *) key type: (Class) type;
++ (instancetype) optionalField: (NSString *) key type: (Class) type defaultValue: (id) defaultValue;
+
+/** The object member name. */
+@property(nonatomic, readonly) NSString *key;
+
+/** The class of which the member's value must be an instance. */
+@property(nonatomic, readonly) Class type;
+
+/** YES if the member must be present. */
+@property(nonatomic, readonly) BOOL required;
+
+/** The value to be used if an optional member is absent, null, or of the wrong type. May be nil. */
+@property(nonatomic, readonly) id defaultValue;
+
+@end
+
+@interface ANTJSONSchema : NSObject
+
+- (instancetype) initWithFields: (NSArray *) fields;
+
+- (BOOL) decodeObject: (id) object
+               values: (__unsafe_unretained id *) values
+              keyPath: (NSString *(^)(void)) keyPath
+                error: (NSError **) outError;
+
+/** The number of fields in the schema. */
+@property(nonatomic, readonly) NSUInteger fieldCount;
+
+@end
@@ -0,0 +1,213 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTJSONSchema.h"
+#import "ANTErrorDomain.h"
+
+#import <PLFoundation/PLFoundation.h>
+
+/**
+ * A single field of an ANTJSONSchema.
+ */
+@implementation ANTJSONSchemaField
+
+/**
+ * Return a field that must be present, and must be an instance of @a type.
+ *
+ * @param key The object member name.
+ * @param type The required value class.
+ */
++ (instancetype) requiredField: (NSString *) key type: (Class) type {
+    return [[self alloc] initWithKey: key type: type required: YES defaultValue: nil];
+}
+
+/**
+ * Return a field that may be absent, in which case @a defaultValue will be used.
+ *
+ * @param key The object member name.
+ * @param type The required value class. Values of any other class are treated as absent.
+ * @param defaultValue The value to be used if the member is absent, or nil.
+ */
++ (instancetype) optionalField: (NSString *) key type: (Class) type defaultValue: (id) defaultValue {
+    return [[self alloc] initWithKey: key type: type required: NO defaultValue: defaultValue];
+}
+
+/**
+ * @internal
+ *
+ * Initialize a new field.
+ */
+- (instancetype) initWithKey: (NSString *) key type: (Class) type required: (BOOL) required defaultValue: (id) defaultValue {
+    PLSuperInit();
+
+    _key = [key copy];
+    _type = type;
+    _required = required;
+    _defaultValue = defaultValue;
+
+    return self;
+}
+
+@end
+
+/**
+ * A declarative description of the members of a JSON object, used to decode and type-check the object's values
+ * in a single pass.
+ *
+ * The schema's fields are flattened into plain C arrays at initialization, so that decoding performs only one
+ * dictionary lookup and one class check per field, with no intermediate proxies or allocations. Errors, including
+ * the key path of the offending value, are only constructed on failure.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be shared across threads.
+ */
+@implementation ANTJSONSchema {
+@private
+    /** The schema fields, which own the values referenced by the arrays below. */
+    NSArray *_fields;
+
+    /** Field member names, in schema order. */
+    __unsafe_unretained NSString **_keys;
+
+    /** Field value classes, in schema order. */
+    __unsafe_unretained Class *_types;
+
+    /** Field default values, in schema order. */
+    __unsafe_unretained id *_defaults;
+
+    /** YES for each required field, in schema order. */
+    BOOL *_required;
+}
+
+/**
+ * Initialize a new schema.
+ *
+ * @param fields An ordered array of ANTJSONSchemaField instances. Decoded values are returned in this order.
+ */
+- (instancetype) initWithFields: (NSArray *) fields {
+    PLSuperInit();
+
+    _fields = [fields copy];
+    _fieldCount = [_fields count];
+
+    _keys = (__unsafe_unretained NSString **) calloc(MAX(_fieldCount, 1), sizeof(NSString *));
+    _types = (__unsafe_unretained Class *) calloc(MAX(_fieldCount, 1), sizeof(Class));
+    _defaults = (__unsafe_unretained id *) calloc(MAX(_fieldCount, 1), sizeof(id));
+    _required = calloc(MAX(_fieldCount, 1), sizeof(BOOL));
+
+    for (NSUInteger i = 0; i < _fieldCount; i++) {
+        ANTJSONSchemaField *field = _fields[i];
+        _keys[i] = field.key;
+        _types[i] = field.type;
+        _defaults[i] = field.defaultValue;
+        _required[i] = field.required;
+    }
+
+    return self;
+}
+
+- (void) dealloc {
+    free(_keys);
+    free(_types);
+    free(_defaults);
+    free(_required);
+}
+
+/**
+ * @internal
+ *
+ * Return a decoding error for the value at @a key, relative to the object at @a keyPath.
+ */
+static NSError *ANTJSONSchemaError (NSString *(^keyPath)(void), NSString *key, NSString *reason) {
+    NSString *path = keyPath != nil ? keyPath() : nil;
+    if (key != nil)
+        path = [path length] > 0 ? [NSString stringWithFormat: @"%@.%@", path, key] : key;
+
+    if (path == nil)
+        path = @"";
+
+    NSLog(@"Invalid server response at '%@': %@", path, reason);
+    return [NSError pl_errorWithDomain: ANTErrorDomain
+                                  code: ANTErrorInvalidResponse
+                  localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
+                localizedFailureReason: reason
+                       underlyingError: nil
+                              userInfo: @{ANTErrorKeyPathKey : path}];
+}
+
+/**
+ * Decode the members of @a object.
+ *
+ * @param object The parsed JSON object to be decoded.
+ * @param values An array of at least fieldCount elements, to which the decoded values will be written in schema order. The
+ * values are borrowed from @a object and from the schema; the caller must retain them if they are to outlive either.
+ * @param keyPath A block that returns the key path of @a object within the response, or nil. The block is only called to
+ * produce an error.
+ * @param outError If an error occurs and this pointer is non-NULL, an ANTErrorInvalidResponse error will be returned via this
+ * pointer. The key path of the invalid value is provided via the ANTErrorKeyPathKey userInfo key.
+ *
+ * @return Returns YES if all required fields were present and of the correct type, or NO otherwise.
+ */
+- (BOOL) decodeObject: (id) object
+               values: (__unsafe_unretained id *) values
+              keyPath: (NSString *(^)(void)) keyPath
+                error: (NSError **) outError
+{
+    if (![object isKindOfClass: [NSDictionary class]]) {
+        if (outError != NULL)
+            *outError = ANTJSONSchemaError(keyPath, nil, NSLocalizedString(@"Response data contains an unexpected value.", nil));
+        return NO;
+    }
+
+    NSDictionary *dict = object;
+    for (NSUInteger i = 0; i < _fieldCount; i++) {
+        id value = [dict objectForKey: _keys[i]];
+
+        if (value != nil && [value isKindOfClass: _types[i]]) {
+            values[i] = value;
+            continue;
+        }
+
+        /* Absent, null, or mistyped */
+        if (_required[i]) {
+            if (outError != NULL) {
+                NSString *reason = (value == nil || value == [NSNull null]) ?
+                    NSLocalizedString(@"Response data is missing a required value.", nil) :
+                    NSLocalizedString(@"Response data contains an unexpected value.", nil);
+                *outError = ANTJSONSchemaError(keyPath, _keys[i], reason);
+            }
+            return NO;
+        }
+
+        values[i] = _defaults[i];
+    }
+
+    return YES;
+}
+
+@end
@@ -0,0 +1,80 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTJSONSchema.h"
+#import "ANTErrorDomain.h"
+
+@interface ANTJSONSchemaTests : XCTestCase @end
+
+@implementation ANTJSONSchemaTests {
+    ANTJSONSchema *_schema;
+}
+
+- (void) setUp {
+    _schema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"id" type: [NSNumber class]],
+        [ANTJSONSchemaField requiredField: @"title" type: [NSString class]],
+        [ANTJSONSchemaField optionalField: @"component" type: [NSString class] defaultValue: @"Unknown"]
+    ]];
+}
+
+- (void) testDecode {
+    __unsafe_unretained id values[3];
+    NSError *error;
+
+    XCTAssertTrue([_schema decodeObject: @{@"id": @1, @"title": @"Title", @"component": @"Xcode"} values: values keyPath: nil error: &error], @"Failed to decode: %@", error);
+    XCTAssertEqualObjects(values[0], @1, @"Incorrect value");
+    XCTAssertEqualObjects(values[1], @"Title", @"Incorrect value");
+    XCTAssertEqualObjects(values[2], @"Xcode", @"Incorrect value");
+
+    /* Absent, null, and mistyped optional values all take the default */
+    for (id component in @[[NSNull null], @42]) {
+        XCTAssertTrue([_schema decodeObject: @{@"id": @1, @"title": @"Title", @"component": component} values: values keyPath: nil error: &error], @"Failed to decode: %@", error);
+        XCTAssertEqualObjects(values[2], @"Unknown", @"Default value not used");
+    }
+}
+
+- (void) testErrors {
+    __unsafe_unretained id values[3];
+    NSError *error;
+
+    /* The key path block is used to report the location of the invalid value */
+    XCTAssertFalse([_schema decodeObject: @{@"id": @1} values: values keyPath: ^{ return @"List[3]"; } error: &error], @"Decoded without a required value");
+    XCTAssertEqualObjects(error.domain, ANTErrorDomain, @"Incorrect error domain");
+    XCTAssertEqual(error.code, (NSInteger) ANTErrorInvalidResponse, @"Incorrect error code");
+    XCTAssertEqualObjects(error.userInfo[ANTErrorKeyPathKey], @"List[3].title", @"Incorrect key path");
+
+    XCTAssertFalse([_schema decodeObject: @{@"id": @"1", @"title": @"Title"} values: values keyPath: nil error: &error], @"Decoded a mistyped value");
+    XCTAssertEqualObjects(error.userInfo[ANTErrorKeyPathKey], @"id", @"Incorrect key path");
+
+    XCTAssertFalse([_schema decodeObject: @[] values: values keyPath: ^{ return @"List"; } error: &error], @"Decoded a non-object");
+    XCTAssertEqualObjects(error.userInfo[ANTErrorKeyPathKey], @"List", @"Incorrect key path");
+}
+
+@end
@@ -0,0 +1,340 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTJSONStreamParser.h"
+#import "ANTJSONTokenizer.h"
+
+#import <PLFoundation/PLFoundation.h>
+
+#import <errno.h>
+#import <xlocale.h>
+
+static bool ANTJSONStreamParserToken (void *context, ANTJSONTokenType type, const char *bytes, size_t length);
+
+/**
+ * Incrementally parses a JSON document into Foundation objects, as the document's bytes arrive.
+ *
+ * The parser produces the same object graph as NSJSONSerialization, with one exception: the elements of a single
+ * array, identified by its key path, may be handed to an element handler as each element is completed. These elements
+ * are never added to the document, and the array is left empty. This allows large responses to be consumed one element
+ * at a time, with the parser's memory bounded by the largest element, rather than by the size of the document.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads without external synchronization.
+ */
+@implementation ANTJSONStreamParser {
+@private
+    /** The backing tokenizer. */
+    ANTJSONTokenizer *_tokenizer;
+
+    /** The key path of the streamed array, or nil. */
+    NSArray *_elementPath;
+
+    /** The streamed array's element handler, or nil. */
+    BOOL (^_elementHandler)(id element);
+
+    /** Open containers, outermost first. */
+    NSMutableArray *_containers;
+
+    /** The pending member name of each open container, or NSNull for arrays and for objects awaiting a member name. */
+    NSMutableArray *_keys;
+
+    /** The index of the streamed array within _containers, or NSNotFound if the streamed array is not open. */
+    NSUInteger _streamIndex;
+
+    /** The completed top-level value, or nil. */
+    id _root;
+
+    /** YES if the element handler aborted parsing. */
+    BOOL _aborted;
+}
+
+/**
+ * Initialize a new parser that will parse the entire document.
+ */
+- (instancetype) init {
+    return [self initWithElementPath: nil elementHandler: nil];
+}
+
+/**
+ * Initialize a new parser that will stream the elements of the array at @a elementPath to @a elementHandler.
+ *
+ * @param elementPath The sequence of object member names that lead from the top-level object to the streamed array,
+ * eg, @[@"List", @"RDRGetMyOrignatedProblems"]. If nil, no elements are streamed.
+ * @param elementHandler The block to call, synchronously from parseData:error:, with each complete element of the streamed
+ * array. Return NO to abort parsing.
+ */
+- (instancetype) initWithElementPath: (NSArray *) elementPath elementHandler: (BOOL (^)(id element)) elementHandler {
+    PLSuperInit();
+
+    if ((_tokenizer = ANTJSONTokenizerCreate(ANTJSONStreamParserToken, (__bridge void *) self)) == NULL) {
+        NSLog(@"Failed to create the JSON tokenizer");
+        return nil;
+    }
+
+    _elementPath = [elementPath copy];
+    _elementHandler = [elementHandler copy];
+    _containers = [NSMutableArray array];
+    _keys = [NSMutableArray array];
+    _streamIndex = NSNotFound;
+
+    return self;
+}
+
+- (void) dealloc {
+    if (_tokenizer != NULL)
+        ANTJSONTokenizerDestroy(_tokenizer);
+}
+
+/**
+ * @internal
+ *
+ * Return a parse error with the given failure @a reason.
+ */
+static NSError *ANTJSONStreamParserError (NSString *reason) {
+    return [NSError errorWithDomain: NSCocoaErrorDomain code: NSPropertyListReadCorruptError userInfo: @{
+        NSLocalizedDescriptionKey : NSLocalizedString(@"The data couldn't be read because it isn't in the correct format.", nil),
+        NSLocalizedFailureReasonErrorKey : reason
+    }];
+}
+
+/**
+ * @internal
+ *
+ * Return the NSNumber value of the JSON number of @a length bytes at @a bytes. Integers that fit within a long long are
+ * returned as integer values; all other numbers as doubles.
+ */
+static NSNumber *ANTJSONStreamParserNumber (const char *bytes, size_t length) {
+    char buffer[64];
+
+    /* The tokenizer has validated the number grammar; only the representation remains to be determined */
+    if (length >= sizeof(buffer)) {
+        NSString *string = [[NSString alloc] initWithBytes: bytes length: length encoding: NSASCIIStringEncoding];
+        return @(strtod_l([string UTF8String], NULL, NULL));
+    }
+
+    memcpy(buffer, bytes, length);
+    buffer[length] = '\0';
+
+    if (strpbrk(buffer, ".eE") == NULL) {
+        errno = 0;
+        long long value = strtoll_l(buffer, NULL, 10, NULL);
+        if (errno != ERANGE)
+            return @(value);
+    }
+
+    /* The NULL locale selects the C locale, regardless of the user's decimal separator */
+    return @(strtod_l(buffer, NULL, NULL));
+}
+
+/**
+ * @internal
+ *
+ * Return YES if the array about to be opened is the streamed array.
+ */
+- (BOOL) isAtElementPath {
+    NSUInteger count = [_elementPath count];
+    if (_elementHandler == nil || [_containers count] != count)
+        return NO;
+
+    for (NSUInteger i = 0; i < count; i++) {
+        if (![_keys[i] isEqual: _elementPath[i]])
+            return NO;
+    }
+
+    return YES;
+}
+
+/**
+ * @internal
+ *
+ * Add a completed @a value to the innermost open container, or to the element handler if the innermost container
+ * is the streamed array.
+ */
+- (BOOL) addValue: (id) value {
+    NSUInteger depth = [_containers count];
+    if (depth == 0) {
+        _root = value;
+        return YES;
+    }
+
+    if (depth - 1 == _streamIndex) {
+        if (!_elementHandler(value)) {
+            _aborted = YES;
+            return NO;
+        }
+        return YES;
+    }
+
+    id key = _keys[depth - 1];
+    if (key == [NSNull null]) {
+        [(NSMutableArray *) _containers[depth - 1] addObject: value];
+    } else {
+        [(NSMutableDictionary *) _containers[depth - 1] setObject: value forKey: key];
+        _keys[depth - 1] = [NSNull null];
+    }
+
+    return YES;
+}
+
+/**
+ * @internal
+ *
+ * Handle a single token.
+ */
+- (BOOL) handleToken: (ANTJSONTokenType) type bytes: (const char *) bytes length: (size_t) length {
+    switch (type) {
+        case ANTJSONTokenObjectStart:
+            [_containers addObject: [NSMutableDictionary dictionary]];
+            [_keys addObject: [NSNull null]];
+            return YES;
+
+        case ANTJSONTokenArrayStart: {
+            BOOL streamed = (_streamIndex == NSNotFound && [self isAtElementPath]);
+
+            [_containers addObject: [NSMutableArray array]];
+            [_keys addObject: [NSNull null]];
+
+            if (streamed)
+                _streamIndex = [_containers count] - 1;
+            return YES;
+        }
+
+        case ANTJSONTokenObjectEnd:
+        case ANTJSONTokenArrayEnd: {
+            id container = [_containers lastObject];
+            [_containers removeLastObject];
+            [_keys removeLastObject];
+
+            if (_streamIndex == [_containers count])
+                _streamIndex = NSNotFound;
+
+            return [self addValue: container];
+        }
+
+        case ANTJSONTokenKey: {
+            NSString *key = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+            if (key == nil)
+                return NO;
+
+            _keys[[_keys count] - 1] = key;
+            return YES;
+        }
+
+        case ANTJSONTokenString: {
+            NSString *string = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+            if (string == nil)
+                return NO;
+
+            return [self addValue: string];
+        }
+
+        case ANTJSONTokenNumber:
+            return [self addValue: ANTJSONStreamParserNumber(bytes, length)];
+
+        case ANTJSONTokenTrue:
+            return [self addValue: @YES];
+
+        case ANTJSONTokenFalse:
+            return [self addValue: @NO];
+
+        case ANTJSONTokenNull:
+            return [self addValue: [NSNull null]];
+    }
+
+    // Unreachable
+    __builtin_trap();
+}
+
+/**
+ * @internal
+ *
+ * ANTJSONTokenizer callback.
+ */
+static bool ANTJSONStreamParserToken (void *context, ANTJSONTokenType type, const char *bytes, size_t length) {
+    ANTJSONStreamParser *parser = (__bridge ANTJSONStreamParser *) context;
+    return [parser handleToken: type bytes: bytes length: length];
+}
+
+/**
+ * @internal
+ *
+ * Return the error describing a failed parse.
+ */
+- (NSError *) failureError {
+    if (_aborted)
+        return [NSError errorWithDomain: NSCocoaErrorDomain code: NSUserCancelledError userInfo: nil];
+
+    return ANTJSONStreamParserError(NSLocalizedString(@"The JSON data is malformed.", nil));
+}
+
+/**
+ * Parse the next portion of the document. Any elements of the streamed array completed by @a data will be passed
+ * to the element handler before this method returns.
+ *
+ * @param data The next bytes of the document.
+ * @param outError If an error occurs and this pointer is non-NULL, an error will be returned via this pointer. If the
+ * element handler aborted parsing, the error will be NSUserCancelledError in NSCocoaErrorDomain.
+ *
+ * @return Returns YES on success, or NO if the data is malformed, or parsing was aborted. Once parsing has failed, all further
+ * calls will fail.
+ */
+- (BOOL) parseData: (NSData *) data error: (NSError **) outError {
+    __block BOOL result = YES;
+
+    [data enumerateByteRangesUsingBlock: ^(const void *bytes, NSRange byteRange, BOOL *stop) {
+        if (!ANTJSONTokenizerFeed(_tokenizer, bytes, byteRange.length)) {
+            result = NO;
+            *stop = YES;
+        }
+    }];
+
+    if (!result && outError != NULL)
+        *outError = [self failureError];
+
+    return result;
+}
+
+/**
+ * Mark the end of the document, returning its top-level value.
+ *
+ * @param outError If an error occurs and this pointer is non-NULL, an error will be returned via this pointer.
+ *
+ * @return Returns the top-level value, or nil if the document was malformed, incomplete, or parsing was aborted.
+ */
+- (id) finishWithError: (NSError **) outError {
+    if (!ANTJSONTokenizerFinish(_tokenizer)) {
+        if (outError != NULL)
+            *outError = [self failureError];
+        return nil;
+    }
+
+    return _root;
+}
+
+@end
@@ -0,0 +1,105 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTJSONStreamParser.h"
+
+@interface ANTJSONStreamParserTests : XCTestCase @end
+
+@implementation ANTJSONStreamParserTests
+
+/**
+ * Feed @a json to @a parser one byte at a time, exercising every possible chunk boundary.
+ */
+- (id) parseBytewise: (NSString *) json parser: (ANTJSONStreamParser *) parser error: (NSError **) outError {
+    NSData *data = [json dataUsingEncoding: NSUTF8StringEncoding];
+    for (NSUInteger i = 0; i < [data length]; i++) {
+        if (![parser parseData: [data subdataWithRange: NSMakeRange(i, 1)] error: outError])
+            return nil;
+    }
+
+    return [parser finishWithError: outError];
+}
+
+- (void) testMatchesNSJSONSerialization {
+    NSString *json = @"{\"a\": [1, -2.5e3, true, false, null], \"b\": {\"c\": \"\\u00e9\\ud83d\\ude00\\n\\\"\"}, \"d\": [], \"e\": 9223372036854775807}";
+    NSError *error;
+
+    id expected = [NSJSONSerialization JSONObjectWithData: [json dataUsingEncoding: NSUTF8StringEncoding] options: 0 error: &error];
+    XCTAssertNotNil(expected, @"Failed to parse with NSJSONSerialization: %@", error);
+
+    id result = [self parseBytewise: json parser: [ANTJSONStreamParser new] error: &error];
+    XCTAssertNotNil(result, @"Failed to parse: %@", error);
+    XCTAssertEqualObjects(result, expected, @"Incorrect object graph");
+}
+
+- (void) testStreamedElements {
+    NSString *json = @"{\"List\": {\"RDRGetMyOrignatedProblems\": [{\"id\": 1}, {\"id\": 2}, [3]], \"SQL\": {\"ROWSTART\": 1}}, \"RDRGetMyOrignatedProblems\": [4]}";
+    NSMutableArray *elements = [NSMutableArray array];
+    ANTJSONStreamParser *parser = [[ANTJSONStreamParser alloc] initWithElementPath: @[@"List", @"RDRGetMyOrignatedProblems"] elementHandler: ^(id element) {
+        [elements addObject: element];
+        return YES;
+    }];
+
+    NSError *error;
+    id result = [self parseBytewise: json parser: parser error: &error];
+    XCTAssertNotNil(result, @"Failed to parse: %@", error);
+
+    /* Only the array at the element path is streamed, and it is left empty in the result */
+    XCTAssertEqualObjects(elements, (@[@{@"id": @1}, @{@"id": @2}, @[@3]]), @"Incorrect streamed elements");
+    XCTAssertEqualObjects(result, (@{@"List": @{@"RDRGetMyOrignatedProblems": @[], @"SQL": @{@"ROWSTART": @1}}, @"RDRGetMyOrignatedProblems": @[@4]}), @"Incorrect result");
+}
+
+- (void) testErrors {
+    NSError *error;
+    for (NSString *json in @[@"{\"a\": 1,}", @"[1 2]", @"01", @"\"\\x\"", @"[", @"{\"a\": 1} {}"]) {
+        XCTAssertNil([self parseBytewise: json parser: [ANTJSONStreamParser new] error: &error], @"Parsed malformed JSON: %@", json);
+        XCTAssertNotNil(error, @"No error returned for %@", json);
+    }
+
+    /* Aborting from the element handler fails the parse */
+    ANTJSONStreamParser *parser = [[ANTJSONStreamParser alloc] initWithElementPath: @[@"a"] elementHandler: ^(id element) {
+        return NO;
+    }];
+    XCTAssertNil([self parseBytewise: @"{\"a\": [1, 2]}" parser: parser error: &error], @"Abort did not fail the parse");
+    XCTAssertEqual([error code], (NSInteger) NSUserCancelledError, @"Incorrect error code");
+}
+
+- (void) testUnpairedSurrogates {
+    NSError *error;
+    for (NSString *json in @[@"\"\\ud800\"", @"\"\\udc00\"", @"\"\\ud800x\"", @"\"\\ud800\\ud800\"", @"\"\\ud800\\n\"", @"\"a\\udfff\""]) {
+        XCTAssertNil([self parseBytewise: json parser: [ANTJSONStreamParser new] error: &error], @"Parsed unpaired surrogate: %@", json);
+        XCTAssertNotNil(error, @"No error returned for %@", json);
+    }
+
+    /* A surrogate pair split across chunks still decodes */
+    id result = [self parseBytewise: @"[\"\\udbff\\udfff\"]" parser: [ANTJSONStreamParser new] error: &error];
+    XCTAssertEqualObjects(result, @[@"\U0010FFFF"], @"Incorrect surrogate pair decoding: %@", error);
+}
+
+@end
@@ -0,0 +1,755 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTJSONTokenizer.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * An incremental (push) JSON tokenizer, as defined by RFC 7159.
+ *
+ * Input may be fed in arbitrarily sized chunks; tokens are reported as soon as they are complete. Strings and numbers that
+ * span chunk boundaries are accumulated in an internal buffer; strings that lie entirely within a single chunk and contain
+ * no escapes are reported directly from the input, without copying.
+ *
+ * The tokenizer validates the document's grammar and rejects unpaired surrogate escapes, but does not validate the encoding
+ * of the UTF-8 string contents.
+ */
+
+/** The maximum supported container nesting depth. */
+#define ANT_JSON_MAX_DEPTH 512
+
+/**
+ * @internal
+ *
+ * Grammar states.
+ */
+typedef enum {
+    /** Expecting a value. */
+    ANTJSONStateValue,
+
+    /** Expecting the first value of an array, or ']'. */
+    ANTJSONStateArrayFirst,
+
+    /** Expecting the first member name of an object, or '}'. */
+    ANTJSONStateObjectFirst,
+
+    /** Expecting a member name. */
+    ANTJSONStateKey,
+
+    /** Expecting ':'. */
+    ANTJSONStateColon,
+
+    /** Expecting ',' or the end of the enclosing container. */
+    ANTJSONStateAfterValue,
+
+    /** The top-level value is complete; only whitespace may follow. */
+    ANTJSONStateDone,
+
+    /** A syntax error occured, or a callback aborted tokenization. */
+    ANTJSONStateError
+} ANTJSONState;
+
+/**
+ * @internal
+ *
+ * Lexer states for tokens that may span chunks.
+ */
+typedef enum {
+    /** Between tokens. */
+    ANTJSONLexNone,
+
+    /** Within a string. */
+    ANTJSONLexString,
+
+    /** Within a number. */
+    ANTJSONLexNumber,
+
+    /** Within a 'true', 'false', or 'null' literal. */
+    ANTJSONLexLiteral
+} ANTJSONLex;
+
+/**
+ * @internal
+ *
+ * Number grammar states.
+ */
+typedef enum {
+    /** After a leading '-'. */
+    ANTJSONNumberSign,
+
+    /** After a leading '0'. */
+    ANTJSONNumberZero,
+
+    /** Within the integer digits. */
+    ANTJSONNumberInteger,
+
+    /** After the '.'. */
+    ANTJSONNumberDot,
+
+    /** Within the fraction digits. */
+    ANTJSONNumberFraction,
+
+    /** After the 'e' or 'E'. */
+    ANTJSONNumberExponent,
+
+    /** After the exponent sign. */
+    ANTJSONNumberExponentSign,
+
+    /** Within the exponent digits. */
+    ANTJSONNumberExponentDigits
+} ANTJSONNumberState;
+
+/**
+ * @internal
+ *
+ * Tokenizer state.
+ */
+struct ANTJSONTokenizer {
+    /** The token callback and its context. */
+    ANTJSONTokenCallback callback;
+    void *context;
+
+    /** The current grammar state. */
+    ANTJSONState state;
+
+    /** The open containers; each entry is either '{' or '['. */
+    char stack[ANT_JSON_MAX_DEPTH];
+    size_t depth;
+
+    /** The current lexer state. */
+    ANTJSONLex lex;
+
+    /** True if the current string is a member name. */
+    bool key;
+
+    /** The number of bytes of the current escape sequence consumed after the backslash, or 0 if not within an escape. */
+    int escape;
+
+    /** The code unit of the current \\u escape. */
+    uint32_t unit;
+
+    /** A high surrogate awaiting its low surrogate, or 0. */
+    uint32_t highSurrogate;
+
+    /** The current number state. */
+    ANTJSONNumberState number;
+
+    /** The current literal, the number of bytes matched, and the literal's token type. */
+    const char *literal;
+    size_t literalMatched;
+    ANTJSONTokenType literalType;
+
+    /** Accumulated string or number bytes. */
+    char *buffer;
+    size_t length;
+    size_t capacity;
+};
+
+/**
+ * Create a new tokenizer.
+ *
+ * @param callback The callback to which tokens will be reported.
+ * @param context A context pointer to be passed to @a callback.
+ *
+ * @return Returns the new tokenizer, or NULL on allocation failure. The tokenizer must be freed with ANTJSONTokenizerDestroy().
+ */
+ANTJSONTokenizer *ANTJSONTokenizerCreate (ANTJSONTokenCallback callback, void *context) {
+    ANTJSONTokenizer *tokenizer = calloc(1, sizeof(ANTJSONTokenizer));
+    if (tokenizer == NULL)
+        return NULL;
+
+    tokenizer->callback = callback;
+    tokenizer->context = context;
+    tokenizer->state = ANTJSONStateValue;
+    tokenizer->lex = ANTJSONLexNone;
+
+    return tokenizer;
+}
+
+/**
+ * Free @a tokenizer.
+ */
+void ANTJSONTokenizerDestroy (ANTJSONTokenizer *tokenizer) {
+    free(tokenizer->buffer);
+    free(tokenizer);
+}
+
+/**
+ * @internal
+ *
+ * Append @a length bytes to the tokenizer's buffer.
+ */
+static bool ANTJSONAppend (ANTJSONTokenizer *tokenizer, const char *bytes, size_t length) {
+    if (tokenizer->length + length > tokenizer->capacity) {
+        size_t capacity = tokenizer->capacity > 0 ? tokenizer->capacity : 256;
+        while (capacity < tokenizer->length + length)
+            capacity *= 2;
+
+        char *buffer = realloc(tokenizer->buffer, capacity);
+        if (buffer == NULL)
+            return false;
+
+        tokenizer->buffer = buffer;
+        tokenizer->capacity = capacity;
+    }
+
+    memcpy(tokenizer->buffer + tokenizer->length, bytes, length);
+    tokenizer->length += length;
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Append the UTF-8 encoding of @a codepoint to the tokenizer's buffer.
+ */
+static bool ANTJSONAppendCodepoint (ANTJSONTokenizer *tokenizer, uint32_t codepoint) {
+    char utf8[4];
+    size_t length;
+
+    if (codepoint < 0x80) {
+        utf8[0] = (char) codepoint;
+        length = 1;
+    } else if (codepoint < 0x800) {
+        utf8[0] = (char) (0xC0 | (codepoint >> 6));
+        utf8[1] = (char) (0x80 | (codepoint & 0x3F));
+        length = 2;
+    } else if (codepoint < 0x10000) {
+        utf8[0] = (char) (0xE0 | (codepoint >> 12));
+        utf8[1] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+        utf8[2] = (char) (0x80 | (codepoint & 0x3F));
+        length = 3;
+    } else {
+        utf8[0] = (char) (0xF0 | (codepoint >> 18));
+        utf8[1] = (char) (0x80 | ((codepoint >> 12) & 0x3F));
+        utf8[2] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+        utf8[3] = (char) (0x80 | (codepoint & 0x3F));
+        length = 4;
+    }
+
+    return ANTJSONAppend(tokenizer, utf8, length);
+}
+
+/**
+ * @internal
+ *
+ * Return false if a high surrogate escape is awaiting its low surrogate; anything other than a low surrogate
+ * escape following a high surrogate leaves it unpaired, and matching NSJSONSerialization, unpaired surrogates
+ * are rejected rather than encoded as invalid UTF-8.
+ */
+static bool ANTJSONCheckSurrogate (ANTJSONTokenizer *tokenizer) {
+    return tokenizer->highSurrogate == 0;
+}
+
+/**
+ * @internal
+ *
+ * Report a token, entering the error state if the callback aborts.
+ */
+static bool ANTJSONEmit (ANTJSONTokenizer *tokenizer, ANTJSONTokenType type, const char *bytes, size_t length) {
+    if (!tokenizer->callback(tokenizer->context, type, bytes, length)) {
+        tokenizer->state = ANTJSONStateError;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Transition to the appropriate state following a complete value.
+ */
+static void ANTJSONValueComplete (ANTJSONTokenizer *tokenizer) {
+    tokenizer->state = tokenizer->depth == 0 ? ANTJSONStateDone : ANTJSONStateAfterValue;
+}
+
+/**
+ * @internal
+ *
+ * Report a completed string, and update the grammar state.
+ */
+static bool ANTJSONStringComplete (ANTJSONTokenizer *tokenizer, const char *bytes, size_t length) {
+    bool key = tokenizer->key;
+
+    tokenizer->lex = ANTJSONLexNone;
+    tokenizer->length = 0;
+
+    if (!ANTJSONEmit(tokenizer, key ? ANTJSONTokenKey : ANTJSONTokenString, bytes, length))
+        return false;
+
+    if (key)
+        tokenizer->state = ANTJSONStateColon;
+    else
+        ANTJSONValueComplete(tokenizer);
+
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Complete the current number, which must be terminated by the byte that follows it.
+ */
+static bool ANTJSONNumberComplete (ANTJSONTokenizer *tokenizer) {
+    switch (tokenizer->number) {
+        case ANTJSONNumberZero:
+        case ANTJSONNumberInteger:
+        case ANTJSONNumberFraction:
+        case ANTJSONNumberExponentDigits:
+            break;
+
+        default:
+            tokenizer->state = ANTJSONStateError;
+            return false;
+    }
+
+    tokenizer->lex = ANTJSONLexNone;
+    size_t length = tokenizer->length;
+    tokenizer->length = 0;
+
+    if (!ANTJSONEmit(tokenizer, ANTJSONTokenNumber, tokenizer->buffer, length))
+        return false;
+
+    ANTJSONValueComplete(tokenizer);
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Advance the number state machine by @a c. Returns false if @a c does not continue the number.
+ */
+static bool ANTJSONNumberAdvance (ANTJSONTokenizer *tokenizer, char c) {
+    bool digit = (c >= '0' && c <= '9');
+
+    switch (tokenizer->number) {
+        case ANTJSONNumberSign:
+            if (c == '0')
+                tokenizer->number = ANTJSONNumberZero;
+            else if (digit)
+                tokenizer->number = ANTJSONNumberInteger;
+            else
+                return false;
+            return true;
+
+        case ANTJSONNumberZero:
+        case ANTJSONNumberInteger:
+            if (digit && tokenizer->number == ANTJSONNumberInteger)
+                return true;
+            else if (c == '.')
+                tokenizer->number = ANTJSONNumberDot;
+            else if (c == 'e' || c == 'E')
+                tokenizer->number = ANTJSONNumberExponent;
+            else
+                return false;
+            return true;
+
+        case ANTJSONNumberDot:
+        case ANTJSONNumberFraction:
+            if (digit)
+                tokenizer->number = ANTJSONNumberFraction;
+            else if ((c == 'e' || c == 'E') && tokenizer->number == ANTJSONNumberFraction)
+                tokenizer->number = ANTJSONNumberExponent;
+            else
+                return false;
+            return true;
+
+        case ANTJSONNumberExponent:
+            if (c == '+' || c == '-')
+                tokenizer->number = ANTJSONNumberExponentSign;
+            else if (digit)
+                tokenizer->number = ANTJSONNumberExponentDigits;
+            else
+                return false;
+            return true;
+
+        case ANTJSONNumberExponentSign:
+        case ANTJSONNumberExponentDigits:
+            if (!digit)
+                return false;
+            tokenizer->number = ANTJSONNumberExponentDigits;
+            return true;
+    }
+
+    // Unreachable
+    __builtin_trap();
+}
+
+/**
+ * @internal
+ *
+ * Return the value of hex digit @a c, or -1.
+ */
+static int ANTJSONHexValue (char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @internal
+ *
+ * Process a completed \\u escape.
+ */
+static bool ANTJSONUnicodeEscape (ANTJSONTokenizer *tokenizer) {
+    uint32_t unit = tokenizer->unit;
+
+    /* Low surrogate */
+    if (unit >= 0xDC00 && unit <= 0xDFFF) {
+        if (tokenizer->highSurrogate == 0)
+            return false;
+
+        uint32_t codepoint = 0x10000 + ((tokenizer->highSurrogate - 0xD800) << 10) + (unit - 0xDC00);
+        tokenizer->highSurrogate = 0;
+        return ANTJSONAppendCodepoint(tokenizer, codepoint);
+    }
+
+    if (!ANTJSONCheckSurrogate(tokenizer))
+        return false;
+
+    /* High surrogate; wait for the low surrogate */
+    if (unit >= 0xD800 && unit <= 0xDBFF) {
+        tokenizer->highSurrogate = unit;
+        return true;
+    }
+
+    return ANTJSONAppendCodepoint(tokenizer, unit);
+}
+
+/**
+ * @internal
+ *
+ * Consume string bytes from @a p, returning the position following the consumed bytes, or NULL on error.
+ */
+static const char *ANTJSONScanString (ANTJSONTokenizer *tokenizer, const char *p, const char *end) {
+    while (p < end) {
+        /* Within an escape sequence */
+        if (tokenizer->escape > 0) {
+            char c = *p++;
+
+            if (tokenizer->escape == 1) {
+                const char *replacement = NULL;
+                switch (c) {
+                    case '"':   replacement = "\""; break;
+                    case '\\':  replacement = "\\"; break;
+                    case '/':   replacement = "/";  break;
+                    case 'b':   replacement = "\b"; break;
+                    case 'f':   replacement = "\f"; break;
+                    case 'n':   replacement = "\n"; break;
+                    case 'r':   replacement = "\r"; break;
+                    case 't':   replacement = "\t"; break;
+                    case 'u':
+                        tokenizer->escape = 2;
+                        tokenizer->unit = 0;
+                        continue;
+                    default:
+                        return NULL;
+                }
+
+                tokenizer->escape = 0;
+                if (!ANTJSONCheckSurrogate(tokenizer) || !ANTJSONAppend(tokenizer, replacement, 1))
+                    return NULL;
+                continue;
+            }
+
+            /* Hex digits of a \u escape */
+            int value = ANTJSONHexValue(c);
+            if (value < 0)
+                return NULL;
+
+            tokenizer->unit = (tokenizer->unit << 4) | (uint32_t) value;
+            if (++tokenizer->escape < 6)
+                continue;
+
+            tokenizer->escape = 0;
+            if (!ANTJSONUnicodeEscape(tokenizer))
+                return NULL;
+            continue;
+        }
+
+        /* Scan a run of unescaped bytes */
+        const char *run = p;
+        while (p < end && *p != '"' && *p != '\\' && (unsigned char) *p >= 0x20)
+            p++;
+
+        if (p == end) {
+            if (p > run && (!ANTJSONCheckSurrogate(tokenizer) || !ANTJSONAppend(tokenizer, run, (size_t) (p - run))))
+                return NULL;
+            return p;
+        }
+
+        switch (*p) {
+            case '"':
+                /* Report strings that lie entirely within the input directly, without copying */
+                if (tokenizer->length == 0 && tokenizer->highSurrogate == 0) {
+                    if (!ANTJSONStringComplete(tokenizer, run, (size_t) (p - run)))
+                        return NULL;
+                    return p + 1;
+                }
+
+                if (!ANTJSONCheckSurrogate(tokenizer) || !ANTJSONAppend(tokenizer, run, (size_t) (p - run)))
+                    return NULL;
+
+                if (!ANTJSONStringComplete(tokenizer, tokenizer->buffer, tokenizer->length))
+                    return NULL;
+                return p + 1;
+
+            case '\\':
+                if (p > run && (!ANTJSONCheckSurrogate(tokenizer) || !ANTJSONAppend(tokenizer, run, (size_t) (p - run))))
+                    return NULL;
+                tokenizer->escape = 1;
+                p++;
+                break;
+
+            default:
+                /* Unescaped control character */
+                return NULL;
+        }
+    }
+
+    return p;
+}
+
+/**
+ * @internal
+ *
+ * Begin a value with the byte @a c. Returns false on error.
+ */
+static bool ANTJSONBeginValue (ANTJSONTokenizer *tokenizer, char c) {
+    switch (c) {
+        case '{':
+        case '[':
+            if (tokenizer->depth == ANT_JSON_MAX_DEPTH)
+                return false;
+
+            tokenizer->stack[tokenizer->depth++] = c;
+            tokenizer->state = c == '{' ? ANTJSONStateObjectFirst : ANTJSONStateArrayFirst;
+            return ANTJSONEmit(tokenizer, c == '{' ? ANTJSONTokenObjectStart : ANTJSONTokenArrayStart, NULL, 0);
+
+        case '"':
+            tokenizer->lex = ANTJSONLexString;
+            tokenizer->key = false;
+            return true;
+
+        case 't':
+            tokenizer->literal = "true";
+            tokenizer->literalType = ANTJSONTokenTrue;
+            break;
+
+        case 'f':
+            tokenizer->literal = "false";
+            tokenizer->literalType = ANTJSONTokenFalse;
+            break;
+
+        case 'n':
+            tokenizer->literal = "null";
+            tokenizer->literalType = ANTJSONTokenNull;
+            break;
+
+        default:
+            if (c != '-' && !(c >= '0' && c <= '9'))
+                return false;
+
+            tokenizer->lex = ANTJSONLexNumber;
+            tokenizer->number = c == '-' ? ANTJSONNumberSign : (c == '0' ? ANTJSONNumberZero : ANTJSONNumberInteger);
+            return ANTJSONAppend(tokenizer, &c, 1);
+    }
+
+    tokenizer->lex = ANTJSONLexLiteral;
+    tokenizer->literalMatched = 1;
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Close the innermost container with @a c. Returns false if @a c does not match the container.
+ */
+static bool ANTJSONEndContainer (ANTJSONTokenizer *tokenizer, char c) {
+    char open = c == '}' ? '{' : '[';
+    if (tokenizer->depth == 0 || tokenizer->stack[tokenizer->depth - 1] != open)
+        return false;
+
+    tokenizer->depth--;
+    if (!ANTJSONEmit(tokenizer, c == '}' ? ANTJSONTokenObjectEnd : ANTJSONTokenArrayEnd, NULL, 0))
+        return false;
+
+    ANTJSONValueComplete(tokenizer);
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Process a single structural byte @a c, outside of any token. Returns false on error.
+ */
+static bool ANTJSONStructural (ANTJSONTokenizer *tokenizer, char c) {
+    switch (tokenizer->state) {
+        case ANTJSONStateValue:
+            return ANTJSONBeginValue(tokenizer, c);
+
+        case ANTJSONStateArrayFirst:
+            if (c == ']')
+                return ANTJSONEndContainer(tokenizer, c);
+            return ANTJSONBeginValue(tokenizer, c);
+
+        case ANTJSONStateObjectFirst:
+            if (c == '}')
+                return ANTJSONEndContainer(tokenizer, c);
+            /* Fallthrough */
+
+        case ANTJSONStateKey:
+            if (c != '"')
+                return false;
+            tokenizer->lex = ANTJSONLexString;
+            tokenizer->key = true;
+            return true;
+
+        case ANTJSONStateColon:
+            if (c != ':')
+                return false;
+            tokenizer->state = ANTJSONStateValue;
+            return true;
+
+        case ANTJSONStateAfterValue:
+            if (c == ',') {
+                tokenizer->state = tokenizer->stack[tokenizer->depth - 1] == '{' ? ANTJSONStateKey : ANTJSONStateValue;
+                return true;
+            }
+
+            if (c == '}' || c == ']')
+                return ANTJSONEndContainer(tokenizer, c);
+            return false;
+
+        case ANTJSONStateDone:
+        case ANTJSONStateError:
+            return false;
+    }
+
+    // Unreachable
+    __builtin_trap();
+}
+
+/**
+ * Feed @a length bytes of the document to @a tokenizer, reporting all tokens completed by these bytes.
+ *
+ * @param tokenizer The tokenizer.
+ * @param bytes The next bytes of the document.
+ * @param length The number of bytes.
+ *
+ * @return Returns false if the document is malformed, or if the token callback aborted tokenization. Once false has been
+ * returned, all further calls will also return false.
+ */
+bool ANTJSONTokenizerFeed (ANTJSONTokenizer *tokenizer, const char *bytes, size_t length) {
+    const char *p = bytes;
+    const char *end = bytes + length;
+
+    while (p < end) {
+        if (tokenizer->state == ANTJSONStateError)
+            return false;
+
+        switch (tokenizer->lex) {
+            case ANTJSONLexString:
+                if ((p = ANTJSONScanString(tokenizer, p, end)) == NULL) {
+                    tokenizer->state = ANTJSONStateError;
+                    return false;
+                }
+                continue;
+
+            case ANTJSONLexNumber:
+                while (p < end && ANTJSONNumberAdvance(tokenizer, *p)) {
+                    if (!ANTJSONAppend(tokenizer, p, 1)) {
+                        tokenizer->state = ANTJSONStateError;
+                        return false;
+                    }
+                    p++;
+                }
+
+                /* The number is terminated by the next byte, which is then processed normally */
+                if (p < end && !ANTJSONNumberComplete(tokenizer))
+                    return false;
+                continue;
+
+            case ANTJSONLexLiteral:
+                while (p < end && tokenizer->literal[tokenizer->literalMatched] != '\0') {
+                    if (*p++ != tokenizer->literal[tokenizer->literalMatched++]) {
+                        tokenizer->state = ANTJSONStateError;
+                        return false;
+                    }
+                }
+
+                if (tokenizer->literal[tokenizer->literalMatched] == '\0') {
+                    tokenizer->lex = ANTJSONLexNone;
+                    if (!ANTJSONEmit(tokenizer, tokenizer->literalType, NULL, 0))
+                        return false;
+                    ANTJSONValueComplete(tokenizer);
+                }
+                continue;
+
+            case ANTJSONLexNone:
+                break;
+        }
+
+        char c = *p++;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+            continue;
+
+        if (!ANTJSONStructural(tokenizer, c)) {
+            tokenizer->state = ANTJSONStateError;
+            return false;
+        }
+    }
+
+    return tokenizer->state != ANTJSONStateError;
+}
+
+/**
+ * Mark the end of the document.
+ *
+ * @param tokenizer The tokenizer.
+ *
+ * @return Returns true if a single, complete JSON value was fed to @a tokenizer.
+ */
+bool ANTJSONTokenizerFinish (ANTJSONTokenizer *tokenizer) {
+    if (tokenizer->state == ANTJSONStateError)
+        return false;
+
+    /* A top-level number is only terminated by the end of the document */
+    if (tokenizer->lex == ANTJSONLexNumber && tokenizer->depth == 0 && !ANTJSONNumberComplete(tokenizer))
+        return false;
+
+    return tokenizer->lex == ANTJSONLexNone && tokenizer->state == ANTJSONStateDone;
+}
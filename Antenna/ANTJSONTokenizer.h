@@ -0,0 +1,91 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ANT_JSON_TOKENIZER_H
+#define ANT_JSON_TOKENIZER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * JSON token types.
+ */
+typedef enum {
+    /** The start of an object ('{'). */
+    ANTJSONTokenObjectStart = 0,
+
+    /** The end of an object ('}'). */
+    ANTJSONTokenObjectEnd = 1,
+
+    /** The start of an array ('['). */
+    ANTJSONTokenArrayStart = 2,
+
+    /** The end of an array (']'). */
+    ANTJSONTokenArrayEnd = 3,
+
+    /** An object member name. The token bytes are the unescaped UTF-8 name. */
+    ANTJSONTokenKey = 4,
+
+    /** A string value. The token bytes are the unescaped UTF-8 value. */
+    ANTJSONTokenString = 5,
+
+    /** A number value. The token bytes are the number's literal text, eg, "-1.5e3". */
+    ANTJSONTokenNumber = 6,
+
+    /** The literal 'true'. */
+    ANTJSONTokenTrue = 7,
+
+    /** The literal 'false'. */
+    ANTJSONTokenFalse = 8,
+
+    /** The literal 'null'. */
+    ANTJSONTokenNull = 9
+} ANTJSONTokenType;
+
+/**
+ * A token callback.
+ *
+ * @param context The context pointer supplied to ANTJSONTokenizerCreate().
+ * @param type The token type.
+ * @param bytes The token bytes, for keys, strings, and numbers; otherwise NULL. Only valid for the duration of the callback,
+ * and not NUL terminated.
+ * @param length The length of @a bytes.
+ *
+ * @return Return false to abort tokenization.
+ */
+typedef bool (*ANTJSONTokenCallback) (void *context, ANTJSONTokenType type, const char *bytes, size_t length);
+
+typedef struct ANTJSONTokenizer ANTJSONTokenizer;
+
+ANTJSONTokenizer *ANTJSONTokenizerCreate (ANTJSONTokenCallback callback, void *context);
+void ANTJSONTokenizerDestroy (ANTJSONTokenizer *tokenizer);
+
+bool ANTJSONTokenizerFeed (ANTJSONTokenizer *tokenizer, const char *bytes, size_t length);
+bool ANTJSONTokenizerFinish (ANTJSONTokenizer *tokenizer);
+
+#endif /* ANT_JSON_TOKENIZER_H */
@@ -90,7 +90,7 @@
     
     _account = account;
     _preferences = preferences;
-    _cookieJar = [ANTCookieJar new];
+    _cookieJar = [[ANTCookieJar alloc] initSharded];
 
     return self;
 }
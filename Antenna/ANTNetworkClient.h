@@ -33,6 +33,10 @@
 #import "ANTNetworkClientAuthResult.h"
 #import "ANTNetworkClientAuthDelegate.h"
 #import "ANTNetworkClientAccount.h"
+#import "ANTNetworkRequestScheduler.h"
+#import "ANTNetworkConcurrencyController.h"
+#import "ANTNetworkTransport.h"
+#import "ANTNetworkResponseCache.h"
 
 #import "ANTRadarSummariesResponse.h"
 #import "ANTRadarSummaryResponse.h"
@@ -46,6 +50,20 @@ extern NSString *ANTNetworkClientFolderTypeClosed;
 extern NSString *ANTNetworkClientFolderTypeArchive;
 extern NSString *ANTNetworkClientFolderTypeDrafts;
 
+/**
+ * Response body transfer statistics, summed over all successful requests.
+ */
+typedef struct ANTNetworkClientTransferStatistics {
+    /** The number of successful requests. */
+    uint64_t requests;
+
+    /** The total number of response body bytes received from the server, prior to any content decoding. */
+    uint64_t bodyBytesReceived;
+
+    /** The total number of response body bytes after content decoding. */
+    uint64_t bodyBytesDecoded;
+} ANTNetworkClientTransferStatistics;
+
 /**
  * Client authentication states.
  */
@@ -68,6 +86,11 @@ typedef NS_ENUM(NSUInteger, ANTNetworkClientAuthState) {
 + (NSURL *) bugReporterURL;
 
 - (instancetype) initWithAuthDelegate: (id<ANTNetworkClientAuthDelegate>) authDelegate;
+- (instancetype) initWithAuthDelegate: (id<ANTNetworkClientAuthDelegate>) authDelegate
+         maxConcurrentRequestsPerHost: (NSUInteger) maxConcurrentRequestsPerHost;
+- (instancetype) initWithAuthDelegate: (id<ANTNetworkClientAuthDelegate>) authDelegate
+                            transport: (id<ANTNetworkTransport>) transport
+         maxConcurrentRequestsPerHost: (NSUInteger) maxConcurrentRequestsPerHost;
 
 - (void) addObserver: (id<ANTNetworkClientObserver>) observer
      dispatchContext: (id<PLDispatchContext>) context;
@@ -84,6 +107,7 @@ typedef NS_ENUM(NSUInteger, ANTNetworkClientAuthState) {
               completionHandler: (void (^)(NSError *error)) callback;
 
 - (void) requestRadarWithId: (NSNumber *) radarId
+                   priority: (ANTNetworkRequestPriority) priority
                cancelTicket: (PLCancelTicket *) ticket
             dispatchContext: (id<PLDispatchContext>) context
           completionHandler: (void (^)(ANTRadarResponse *radar, NSError *error)) handler;
@@ -91,17 +115,36 @@ typedef NS_ENUM(NSUInteger, ANTNetworkClientAuthState) {
 
 - (void) requestSummariesForSections: (NSArray *) sectionNames
                         maximumCount: (NSUInteger) maximumCount
+                            priority: (ANTNetworkRequestPriority) priority
                         cancelTicket: (PLCancelTicket *) ticket
                      dispatchContext: (id<PLDispatchContext>) context
                    completionHandler: (void (^)(NSArray *summaries, NSError *error)) handler;
 
 - (void) requestSummariesForSection: (NSString *) sectionName
                        previousPage: (ANTRadarSummariesResponse *) previousPage
+                           priority: (ANTNetworkRequestPriority) priority
                        cancelTicket: (PLCancelTicket *) ticket
                     dispatchContext: (id<PLDispatchContext>) context
                   completionHandler: (void (^)(ANTRadarSummariesResponse *summaries, NSError *error)) handler;
 
+/** The transport via which all requests are sent. */
+@property(nonatomic, readonly) id<ANTNetworkTransport> transport;
+
+/** The maximum number of requests that will be in flight to any one host. */
+@property(nonatomic, readonly) NSUInteger maxConcurrentRequestsPerHost;
+
+/** A snapshot of the adaptive concurrency controller's statistics, including the current per-host concurrency window. */
+@property(nonatomic, readonly) ANTNetworkConcurrencyStatistics concurrencyStatistics;
+
+/** A snapshot of the client's response body transfer statistics. Comparing the received and decoded byte counts shows
+ * the savings from compressed responses. */
+@property(nonatomic, readonly) ANTNetworkClientTransferStatistics transferStatistics;
+
 /** Current client authentication state. */
 @property(nonatomic, readonly) ANTNetworkClientAuthState authState;
 
+/** The cache used to revalidate and store decoded radar responses, or nil to disable response caching. The cache must
+ * accept ANTRadarResponse objects. */
+@property(strong) ANTNetworkResponseCache *responseCache;
+
 @end
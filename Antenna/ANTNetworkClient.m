@@ -28,9 +28,16 @@
 
 #import "ANTNetworkClient.h"
 #import "ANTLoginWindowController.h"
+#import "ANTHTTPTransport.h"
+#import "ANTJSONStreamParser.h"
 
-#import "MAErrorReportingDictionary.h"
-#import "NSObject+MAErrorReporting.h"
+#import "ANTJSONSchema.h"
+#import "ANTRadarDate.h"
+#import "ANTRadarAttribution.h"
+#import "ANTNetworkResponseCache.h"
+#import "ANTNetworkRequestCoalescer.h"
+
+#import <xlocale.h>
 
 /**
  * @defgroup contents_network_folders Radar Folder Constants
@@ -56,6 +63,89 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
  * @}
  */
 
+/** The getSectionProblems resource path. */
+static NSString *ANTNetworkClientSectionProblemsPath = @"/developer/problem/getSectionProblems";
+
+/** The default maximum number of requests that will be in flight to any one host. */
+static const NSUInteger ANTNetworkClientDefaultMaxConcurrentRequestsPerHost = 8;
+
+/** The initial number of requests permitted in flight to any one host, prior to adjustment by the concurrency controller. */
+static const NSUInteger ANTNetworkClientInitialConcurrencyWindow = 4;
+
+/** The maximum Retry-After delay that will be honored, in seconds. Longer delays are clamped, rather than stalling all
+ * requests for an arbitrary period at the server's request. */
+static const NSTimeInterval ANTNetworkClientMaximumRetryAfter = 120.0;
+
+/** The received body size, in bytes, at or above which a response's latency is sampled as a large request. */
+static const uint64_t ANTNetworkClientLargeResponseSize = 64 * 1024;
+
+/** The number of section issues decoded by each concurrent decoding task. Large enough to amortize dispatch overhead,
+ * small enough that a chunk's parsed issues remain cache-resident and a page is spread across all cores. */
+static const NSUInteger ANTNetworkClientIssueChunkSize = 64;
+
+/** The number of UTF-16 code units copied out at a time when scanning a description for a leading attribution line, if
+ * the description's characters are not directly accessible. Most attribution lines fit within a single chunk. */
+enum { ANTNetworkClientAttributionChunkLength = 256 };
+
+/** Field indices of ANTNetworkClientSectionSchema, the top-level getSectionProblems response. */
+enum {
+    ANTSectionFieldList = 0,
+    ANTSectionFieldCount
+};
+
+/** Field indices of ANTNetworkClientListSchema, the getSectionProblems "List" object. */
+enum {
+    ANTListFieldIssues = 0,
+    ANTListFieldSQL,
+    ANTListFieldCount
+};
+
+/** Field indices of ANTNetworkClientSQLSchema, the getSectionProblems pagination data. */
+enum {
+    ANTSQLFieldRowStart = 0,
+    ANTSQLFieldRowsInCache,
+    ANTSQLFieldCount
+};
+
+/** Field indices of ANTNetworkClientSummarySchema, a single getSectionProblems issue. */
+enum {
+    ANTSummaryFieldRadarId = 0,
+    ANTSummaryFieldStateName,
+    ANTSummaryFieldTitle,
+    ANTSummaryFieldHidden,
+    ANTSummaryFieldDescription,
+    ANTSummaryFieldOriginatedDate,
+    ANTSummaryFieldRequiresAttention,
+    ANTSummaryFieldComponentName,
+    ANTSummaryFieldCount
+};
+
+/** Field indices of ANTNetworkClientRadarSchema, the openProblem response. */
+enum {
+    ANTRadarFieldTitle = 0,
+    ANTRadarFieldResolved,
+    ANTRadarFieldLastModifiedDate,
+    ANTRadarFieldDescriptionText,
+    ANTRadarFieldEnclosureId,
+    ANTRadarFieldCount
+};
+
+/** Field indices of ANTNetworkClientCommentSchema, a single openProblem comment. */
+enum {
+    ANTCommentFieldContent = 0,
+    ANTCommentFieldAuthorName,
+    ANTCommentFieldTimestamp,
+    ANTCommentFieldCount
+};
+
+/* Response schemas, initialized by +initialize. Field order must match the field index enums above. */
+static ANTJSONSchema *ANTNetworkClientSectionSchema;
+static ANTJSONSchema *ANTNetworkClientListSchema;
+static ANTJSONSchema *ANTNetworkClientSQLSchema;
+static ANTJSONSchema *ANTNetworkClientSummarySchema;
+static ANTJSONSchema *ANTNetworkClientRadarSchema;
+static ANTJSONSchema *ANTNetworkClientCommentSchema;
+
 @interface ANTNetworkClient ()
 @end
 
@@ -85,14 +175,80 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
     /** Date formatter to use for report dates (DD-MON-YYYY HH:mm:ss), assuming GMT. */
     NSDateFormatter *_dateFormatterSeconds;
 
+    /** Lock that must be held when using either date formatter. */
+    OSSpinLock _dateFormatterLock;
+
     /** (Concurrent) context on which to handle all parsing */
     id<PLDispatchContext> _parseContext;
 
-    /** Internal queue used to handle NSURLConnection callbacks */
-    NSOperationQueue *_opQueue;
+    /** Transport via which all requests are sent. */
+    id<ANTNetworkTransport> _transport;
+
+    /** Scheduler through which all requests are issued. */
+    ANTNetworkRequestScheduler *_scheduler;
+
+    /** Coalesces identical in-flight requests. */
+    ANTNetworkRequestCoalescer *_coalescer;
+
+    /** Adjusts the scheduler's concurrency limit in response to request latency and server errors. */
+    ANTNetworkConcurrencyController *_concurrencyController;
     
     /** Registered observers. */
     PLObserverSet *_observers;
+
+    /** The number of completed requests, and their total response body sizes; see ANTNetworkClientTransferStatistics. */
+    volatile int64_t _transferRequests;
+    volatile int64_t _transferBodyBytesReceived;
+    volatile int64_t _transferBodyBytesDecoded;
+}
+
++ (void) initialize {
+    if ([self class] != [ANTNetworkClient class])
+        return;
+
+    ANTNetworkClientSectionSchema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"List" type: [NSDictionary class]]
+    ]];
+
+    ANTNetworkClientListSchema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"RDRGetMyOrignatedProblems" type: [NSArray class]],
+        [ANTJSONSchemaField requiredField: @"SQL" type: [NSDictionary class]]
+    ]];
+
+    ANTNetworkClientSQLSchema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"ROWSTART" type: [NSNumber class]],
+        [ANTJSONSchemaField requiredField: @"ROWSINCACHE" type: [NSNumber class]]
+    ]];
+
+    /* The component name seems to be excluded on archived bug reports; in the case where it's missing,
+     * provide a blank value. */
+    ANTNetworkClientSummarySchema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"problemID" type: [NSNumber class]],
+        [ANTJSONSchemaField requiredField: @"probstatename" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"problemTitle" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"hide" type: [NSNumber class]],
+        [ANTJSONSchemaField requiredField: @"problemDescription" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"whenOriginatedDate" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"showHighlighted" type: [NSNumber class]],
+        [ANTJSONSchemaField optionalField: @"compNameForWeb" type: [NSString class] defaultValue: @"Unknown"]
+    ]];
+
+    ANTNetworkClientRadarSchema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"problemTitle" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"resolved" type: [NSNumber class]],
+        [ANTJSONSchemaField requiredField: @"lastModifiedDate" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"descriptionText" type: [NSArray class]],
+        [ANTJSONSchemaField optionalField: @"enclosureId" type: [NSString class] defaultValue: nil]
+    ]];
+
+    ANTNetworkClientCommentSchema = [[ANTJSONSchema alloc] initWithFields: @[
+        [ANTJSONSchemaField requiredField: @"content" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"personDetails" type: [NSString class]],
+        [ANTJSONSchemaField requiredField: @"gmtTime" type: [NSString class]]
+    ]];
+
+    NSAssert(ANTNetworkClientSummarySchema.fieldCount == ANTSummaryFieldCount, @"Summary schema does not match its field indices");
+    NSAssert(ANTNetworkClientRadarSchema.fieldCount == ANTRadarFieldCount, @"Radar schema does not match its field indices");
 }
 
 /**
@@ -103,11 +259,44 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
 }
 
 /**
- * Initialize a new instance.
+ * Initialize a new instance with the default per-host request limit.
  *
  * @param authDelegate The authentication delegate for this client instance. The reference will be held weakly.
  */
 - (instancetype) initWithAuthDelegate: (id<ANTNetworkClientAuthDelegate>) authDelegate {
+    return [self initWithAuthDelegate: authDelegate maxConcurrentRequestsPerHost: ANTNetworkClientDefaultMaxConcurrentRequestsPerHost];
+}
+
+/**
+ * Initialize a new instance, using an ANTHTTPTransport with a keep-alive pool sized to @a maxConcurrentRequestsPerHost.
+ *
+ * @param authDelegate The authentication delegate for this client instance. The reference will be held weakly.
+ * @param maxConcurrentRequestsPerHost The maximum number of requests that will be in flight to any one host. Additional
+ * requests will be queued by priority until a request completes.
+ */
+- (instancetype) initWithAuthDelegate: (id<ANTNetworkClientAuthDelegate>) authDelegate
+         maxConcurrentRequestsPerHost: (NSUInteger) maxConcurrentRequestsPerHost
+{
+    ANTHTTPTransport *transport = [[ANTHTTPTransport alloc] initWithMaxConnectionsPerHost: maxConcurrentRequestsPerHost];
+    return [self initWithAuthDelegate: authDelegate transport: transport maxConcurrentRequestsPerHost: maxConcurrentRequestsPerHost];
+}
+
+/**
+ * Initialize a new instance.
+ *
+ * @param authDelegate The authentication delegate for this client instance. The reference will be held weakly.
+ * @param transport The transport via which all requests will be sent.
+ * @param maxConcurrentRequestsPerHost The maximum number of requests that will be in flight to any one host. Additional
+ * requests will be queued by priority until a request completes. The number of requests actually permitted in flight is
+ * adapted to observed latency and server errors, up to this limit.
+ */
+- (instancetype) initWithAuthDelegate: (id<ANTNetworkClientAuthDelegate>) authDelegate
+                            transport: (id<ANTNetworkTransport>) transport
+         maxConcurrentRequestsPerHost: (NSUInteger) maxConcurrentRequestsPerHost
+{
+    if (transport == nil)
+        return nil;
+
     if ((self = [super init]) == nil)
         return nil;
     
@@ -126,9 +315,16 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
     
     _dateFormatterSeconds = [_dateFormatter copy];
     [_dateFormatterSeconds setDateFormat:@"dd-MMM-yyyy HH:mm:ss"];
+    _dateFormatterLock = OS_SPINLOCK_INIT;
 
     _parseContext = [[PLGCDDispatchContext alloc] initWithQueue: PL_DEFAULT_QUEUE];
-    _opQueue = [NSOperationQueue new];
+    _transport = transport;
+    _scheduler = [[ANTNetworkRequestScheduler alloc] initWithMaxConcurrentRequestsPerHost: maxConcurrentRequestsPerHost];
+    _coalescer = [ANTNetworkRequestCoalescer new];
+    _concurrencyController = [[ANTNetworkConcurrencyController alloc] initWithInitialWindow: ANTNetworkClientInitialConcurrencyWindow
+                                                                              minimumWindow: 1
+                                                                              maximumWindow: maxConcurrentRequestsPerHost];
+    _scheduler.concurrencyLimit = _concurrencyController.window;
     _observers = [PLObserverSet new];
     
     return self;
@@ -156,120 +352,108 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
 /**
  * Request the Radar issue associated with @a radarId.
  *
+ * If a responseCache is configured, the request is sent as a conditional GET, and an unchanged issue will be provided
+ * from the cache without being re-parsed.
+ *
  * @param radarId The radar number
+ * @param priority The request priority.
  * @param ticket A request cancellation ticket.
  * @param context The dispatch context on which @a handler will be called.
  * @param completionHandler The block to call upon completion. If an error occurs, error will be non-nil. The summaries
  * will be provided as an ordered array of ANTRadarSummaryResponse values.
  */
 - (void) requestRadarWithId: (NSNumber *) radarId
+                   priority: (ANTNetworkRequestPriority) priority
                cancelTicket: (PLCancelTicket *) ticket
             dispatchContext: (id<PLDispatchContext>) context
           completionHandler: (void (^)(ANTRadarResponse *radar, NSError *error)) handler
 {
     NSString *path = [@"/developer/problem/openProblem" stringByAppendingPathComponent: [radarId stringValue]];
-    [self getJSONWithPath: path cancelTicket: ticket dispatchContext: _parseContext completionHandler:^(id jsonData, NSError *error) {
-        /* Perform the handler callback on the user's specified dispatch context, checking for cancellation */
-        void (^performHandler)(id, NSError *) = ^(id value, NSError *error) {
-            [context performWithCancelTicket: ticket block: ^{
-                handler(value, error);
-            }];
-        };
-        
-        
-        /* Verify the response type */
-        if (![jsonData isKindOfClass: [NSDictionary class]]) {
-            performHandler(nil, [NSError errorWithDomain: NSCocoaErrorDomain code: NSURLErrorCannotParseResponse userInfo: nil]);
-            return;
-        }
-        
-        /* Parse out the data */
-        MAErrorReportingDictionary *jsonDict = [MAErrorReportingObject wrapObject: jsonData];
-        id (^Check)(id) = ^(id value) {
-            if (value == nil && [jsonDict error] != nil) {
-                NSError *error = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                        code: ANTErrorInvalidResponse
-                                        localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
-                                      localizedFailureReason: NSLocalizedString(@"Response data is missing a required value.", nil)
-                                             underlyingError: [jsonDict error] userInfo: nil];
-                performHandler(nil, error);
-                return (id) nil;
-            }
-            
-            return value;
-        };
-        
-        #define GetValue(_varname, _type, _source) \
-            _type *_varname = Check([_type ma_castRequiredObject: _source]); \
-            if (_varname == nil) { \
-                NSLog(@"Missing required var " # _source " for radarId %@ in %@", radarId, jsonDict); \
-                return; \
-            }
-        
-        /* Fetch the basic attributes */
-        GetValue(title,                 NSString,   jsonDict[@"problemTitle"]);
-        GetValue(resolved,              NSNumber,   jsonDict[@"resolved"]);
-        GetValue(modifiedDateString,    NSString,   jsonDict[@"lastModifiedDate"]);
-        GetValue(descriptionText,       NSArray,    jsonDict[@"descriptionText"]);
-        
-        /* May be nil */
-        NSString *enclosureId = [NSString ma_castOptionalObject: jsonDict[@"enclosureId"]];
-        
-        NSDate *lastModifiedDate = [_dateFormatterSeconds dateFromString: modifiedDateString];
-        if (lastModifiedDate == nil) {
-            NSLog(@"Could not format date: %@", modifiedDateString);
-            NSError *parseError = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                         code: ANTErrorInvalidResponse
-                                         localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
-                                       localizedFailureReason: NSLocalizedString(@"Server sent an unexpected date format.", nil)
-                                              underlyingError: nil
-                                                     userInfo: nil];
-            
-            performHandler(nil, parseError);
-            return;
+
+    /* Concurrent requests for the same radar (eg, from background sync and the UI) share a single request */
+    id<NSCopying> key = [ANTNetworkRequestCoalescer keyWithMethod: @"GET" path: path body: nil];
+    [_coalescer performRequestWithKey: key priority: priority cancelTicket: ticket dispatchContext: context completionHandler: handler block: ^(PLCancelTicket *requestTicket, void (^completion)(id value, NSError *error)) {
+        [self getCachedObjectWithPath: path priority: priority cancelTicket: requestTicket dispatchContext: [PLDirectDispatchContext context] decoder: ^(id jsonData, NSError **outError) {
+            return [self radarWithJSON: jsonData error: outError];
+        } completionHandler: completion];
+    }];
+}
+
+/**
+ * @internal
+ *
+ * Decode an openProblem response.
+ *
+ * @param jsonData The parsed JSON response.
+ * @param outError If decoding fails and this pointer is non-NULL, an error will be returned via this pointer.
+ *
+ * @return Returns the decoded radar, or nil on failure.
+ */
+- (ANTRadarResponse *) radarWithJSON: (id) jsonData error: (NSError **) outError {
+    /* Decode the basic attributes */
+    __unsafe_unretained id fields[ANTRadarFieldCount];
+    if (![ANTNetworkClientRadarSchema decodeObject: jsonData values: fields keyPath: nil error: outError])
+        return nil;
+
+    NSString *title = fields[ANTRadarFieldTitle];
+    NSString *modifiedDateString = fields[ANTRadarFieldLastModifiedDate];
+    NSArray *descriptionText = fields[ANTRadarFieldDescriptionText];
+
+    /* May be nil */
+    NSString *enclosureId = fields[ANTRadarFieldEnclosureId];
+
+    NSDate *lastModifiedDate = [self dateFromString: modifiedDateString formatter: _dateFormatterSeconds];
+    if (lastModifiedDate == nil) {
+        NSLog(@"Could not format date: %@", modifiedDateString);
+        if (outError != NULL) {
+            *outError = [NSError pl_errorWithDomain: ANTErrorDomain
+                                               code: ANTErrorInvalidResponse
+                               localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
+                             localizedFailureReason: NSLocalizedString(@"Server sent an unexpected date format.", nil)
+                                    underlyingError: nil
+                                           userInfo: nil];
         }
+        return nil;
+    }
 
-        
-        /* Parse the comments */
-        NSMutableArray *comments = [NSMutableArray arrayWithCapacity: [descriptionText count]];
-        for (id commentVal in comments) {
-            GetValue(commentDict,       NSDictionary,   commentVal);
-            GetValue(content,           NSString,       commentDict[@"content"]);
-            GetValue(authorName,        NSString,       commentDict[@"personDetails"]);
-            GetValue(gmtDateString,     NSString,       commentDict[@"gmtTime"]);
-            
-            /* Format the date */
-            NSDate *timestamp = [_dateFormatter dateFromString: gmtDateString];
-            if (timestamp == nil) {
-                NSLog(@"Could not format date: %@", gmtDateString);
-                NSError *parseError = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                             code: ANTErrorInvalidResponse
-                                             localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
-                                           localizedFailureReason: NSLocalizedString(@"Server sent an unexpected date format.", nil)
-                                                  underlyingError: nil
-                                                         userInfo: nil];
-                
-                performHandler(nil, parseError);
-                return;
+    /* Parse the comments */
+    NSMutableArray *comments = [NSMutableArray arrayWithCapacity: [descriptionText count]];
+    NSUInteger commentIndex = 0;
+    for (id commentVal in descriptionText) {
+        __unsafe_unretained id commentFields[ANTCommentFieldCount];
+        if (![ANTNetworkClientCommentSchema decodeObject: commentVal values: commentFields keyPath: ^{ return [NSString stringWithFormat: @"descriptionText[%lu]", (unsigned long) commentIndex]; } error: outError])
+            return nil;
+        commentIndex++;
+
+        NSString *gmtDateString = commentFields[ANTCommentFieldTimestamp];
+
+        /* Format the date */
+        NSDate *timestamp = [self dateFromString: gmtDateString formatter: _dateFormatter];
+        if (timestamp == nil) {
+            NSLog(@"Could not format date: %@", gmtDateString);
+            if (outError != NULL) {
+                *outError = [NSError pl_errorWithDomain: ANTErrorDomain
+                                                   code: ANTErrorInvalidResponse
+                                   localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
+                                 localizedFailureReason: NSLocalizedString(@"Server sent an unexpected date format.", nil)
+                                        underlyingError: nil
+                                               userInfo: nil];
             }
-            
-            
-            ANTRadarCommentResponse *comment = [[ANTRadarCommentResponse alloc] initWithAuthorName: authorName content: content timestamp: timestamp];
-            [comments addObject: comment];
+            return nil;
         }
-        
-        /* Create the result */
-        ANTRadarResponse *radar = [[ANTRadarResponse alloc] initWithTitle: title
-                                                                 comments: comments
-                                                                 resolved: [resolved boolValue]
-                                                         lastModifiedDate: lastModifiedDate
-                                                              enclosureId: enclosureId];
-    
-        /* Dispatch the results */
-        performHandler(radar, error);
 
-        #undef GetValue
-    }];
+        ANTRadarCommentResponse *comment = [[ANTRadarCommentResponse alloc] initWithAuthorName: commentFields[ANTCommentFieldAuthorName]
+                                                                                       content: commentFields[ANTCommentFieldContent]
+                                                                                     timestamp: timestamp];
+        [comments addObject: comment];
+    }
+
+    /* Create the result */
+    return [[ANTRadarResponse alloc] initWithTitle: title
+                                          comments: comments
+                                          resolved: [fields[ANTRadarFieldResolved] boolValue]
+                                  lastModifiedDate: lastModifiedDate
+                                       enclosureId: enclosureId];
 }
 
 /**
@@ -277,6 +461,7 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
  *
  * @param sectionNames The section names to be fethed. The result order is undefined. @sa @ref contents_network_folders.
  * @param maximumCount The maximum number of radars to be returned.
+ * @param priority The request priority.
  * @param ticket A request cancellation ticket.
  * @param context The dispatch context on which @a handler will be called.
  * @param completionHandler The block to call upon completion. If an error occurs, error will be non-nil. The summaries
@@ -287,6 +472,7 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
  */
 - (void) requestSummariesForSections: (NSArray *) sectionNames
                         maximumCount: (NSUInteger) maximumCount
+                            priority: (ANTNetworkRequestPriority) priority
                         cancelTicket: (PLCancelTicket *) ticket
                      dispatchContext: (id<PLDispatchContext>) context
                    completionHandler: (void (^)(NSArray *summaries, NSError *error)) handler
@@ -297,69 +483,153 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
 
     PLCancelTicketSource *internalTicketSource = [[PLCancelTicketSource alloc] initWithLinkedTickets: [NSSet setWithObjects: ticket, nil]];
     for (NSString *name in sectionNames) {
-        __block void (^completionHandler)(ANTRadarSummariesResponse *, NSError *);
-        __block __weak void (^recursiveCompletionHandler)(ANTRadarSummariesResponse *, NSError *);
-        recursiveCompletionHandler = completionHandler = [^(ANTRadarSummariesResponse *response, NSError *error) {
+        [self requestAllSummariesForSection: name maximumCount: maximumCount priority: priority cancelTicket: internalTicketSource.ticket completionHandler: ^(NSArray *summaries, NSError *error) {
             NSUInteger remaining;
-            
+
             /* Perform all mutation with the lock held */
             OSSpinLockLock(&pendingLock); {
                 /* If an error occured elsewhere in one of the other fetches, we'll be cancelled. We check
                  * this with our lock held to ensure strict ordering of cancellation handling. */
                 if (internalTicketSource.ticket.isCancelled) {
-                    OSSpinLockUnlock(&_lock);
+                    OSSpinLockUnlock(&pendingLock);
                     return;
                 }
-                
+
                 /*
                  * Handle errors:
                  * - Cancel all other pending requests
                  * - Report the error
                  */
                 if (error != nil) {
-                    
                     [internalTicketSource cancel];
-                    
+
                     /* We can't call out to cancellation handlers with our lock held */
                     OSSpinLockUnlock(&pendingLock);
-                    
+
                     /* Note cancellation and return */
                     [context performWithCancelTicket: ticket block:^{
                         handler(nil, error);
                     }];
                     return;
                 }
-                
+
                 /* Save the results */
-                [results addObjectsFromArray: response.summaries];
-                
-                /* Mark completion if no further rows are required */
-                if (!response.hasAdditionalRows) {
-                    [pending removeObject: name];
-                }
+                [results addObjectsFromArray: summaries];
+                [pending removeObject: name];
                 remaining = [pending count];
             } OSSpinLockUnlock(&pendingLock);
-            
-            /* Check for (and report!) completion. If additional rows are available, we're not complete. */
-            if (response.hasAdditionalRows) {
-                [self requestSummariesForSection: name previousPage: nil cancelTicket: internalTicketSource.ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: recursiveCompletionHandler];
-            } else if (remaining == 0) {
+
+            /* Check for (and report!) completion. */
+            if (remaining == 0) {
+                NSArray *limited = results;
+                if ([results count] > maximumCount)
+                    limited = [results subarrayWithRange: NSMakeRange(0, maximumCount)];
+
                 [context performWithCancelTicket: ticket block:^{
-                    handler(results, nil);
+                    handler(limited, nil);
                 }];
             }
-        } copy];
-        
-        [self requestSummariesForSection: name previousPage: nil cancelTicket: internalTicketSource.ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: completionHandler];
+        }];
     }
 }
 
+/**
+ * @internal
+ *
+ * Request all radar issue summaries for @a sectionName, up to @a maximumCount.
+ *
+ * The first page is requested alone; its pagination data (the row start, page size, and total row count) determines
+ * the offsets of all remaining pages, which are then requested concurrently, subject to the scheduler's per-host
+ * limit. This reduces the latency of a large section's listing from one round trip per page to roughly two. Pages
+ * are reassembled in row order, regardless of the order in which they arrive. This assumes that the server uses a
+ * fixed page size, as determined by the first page.
+ *
+ * @param sectionName The section to be fetched. @sa @ref contents_network_folders.
+ * @param maximumCount The maximum number of rows to be requested.
+ * @param priority The request priority.
+ * @param ticket A request cancellation ticket. The caller is responsible for cancelling @a ticket on error, which will
+ * cancel any outstanding page requests.
+ * @param handler The block to call upon completion, on an unspecified thread. If an error occurs, error will be non-nil. The
+ * summaries will be provided as an ordered array of ANTRadarSummaryResponse values.
+ */
+- (void) requestAllSummariesForSection: (NSString *) sectionName
+                          maximumCount: (NSUInteger) maximumCount
+                              priority: (ANTNetworkRequestPriority) priority
+                          cancelTicket: (PLCancelTicket *) ticket
+                     completionHandler: (void (^)(NSArray *summaries, NSError *error)) handler
+{
+    [self requestSummariesForSection: sectionName rowStart: 1 priority: priority cancelTicket: ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(ANTRadarSummariesResponse *first, NSError *error) {
+        if (error != nil) {
+            handler(nil, error);
+            return;
+        }
+
+        /* If everything fit in a single page, there's nothing more to fetch */
+        NSUInteger pageSize = [first.summaries count];
+        if (!first.hasAdditionalRows || pageSize == 0 || pageSize >= maximumCount) {
+            handler(first.summaries, nil);
+            return;
+        }
+
+        /* Determine the row at which to stop, avoiding overflow of rowStart + maximumCount */
+        NSUInteger endRow = first.rowsInCache;
+        if (maximumCount < endRow - first.rowStart)
+            endRow = first.rowStart + maximumCount;
+
+        /* Allocate a slot for each page */
+        NSMutableArray *pages = [NSMutableArray arrayWithObject: first.summaries];
+        for (NSUInteger row = first.rowStart + pageSize; row < endRow; row += pageSize)
+            [pages addObject: [NSNull null]];
+
+        NSUInteger pageCount = [pages count];
+        __block NSUInteger remainingPages = pageCount - 1;
+        __block BOOL failed = NO;
+        __block OSSpinLock pagesLock = OS_SPINLOCK_INIT;
+
+        /* Issue all remaining page requests at once; the scheduler bounds how many are in flight */
+        for (NSUInteger i = 1; i < pageCount; i++) {
+            NSUInteger rowStart = first.rowStart + i * pageSize;
+            [self requestSummariesForSection: sectionName rowStart: rowStart priority: priority cancelTicket: ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(ANTRadarSummariesResponse *page, NSError *error) {
+                OSSpinLockLock(&pagesLock); {
+                    /* Only the first error is reported */
+                    if (failed) {
+                        OSSpinLockUnlock(&pagesLock);
+                        return;
+                    }
+
+                    if (error != nil) {
+                        failed = YES;
+                        OSSpinLockUnlock(&pagesLock);
+                        handler(nil, error);
+                        return;
+                    }
+
+                    pages[i] = page.summaries;
+                    remainingPages--;
+                    if (remainingPages > 0) {
+                        OSSpinLockUnlock(&pagesLock);
+                        return;
+                    }
+                } OSSpinLockUnlock(&pagesLock);
+
+                /* All pages have arrived; reassemble them in row order */
+                NSMutableArray *summaries = [NSMutableArray arrayWithCapacity: endRow - first.rowStart];
+                for (NSArray *pageSummaries in pages)
+                    [summaries addObjectsFromArray: pageSummaries];
+
+                handler(summaries, nil);
+            }];
+        }
+    }];
+}
+
 /**
  * Request all radar issue summaries for @a sectionName.
  *
  * @param sectionName The section to be fethed. The result order is undefined. @sa @ref contents_network_folders.
  * @param previousPage The previous page of responses, or nil if this is the first request. The previous page will be used
  * to formulate an appropriate paginated request for a new page of data.
+ * @param priority The request priority.
  * @param ticket A request cancellation ticket.
  * @param context The dispatch context on which @a handler will be called.
  * @param completionHandler The block to call upon completion. If an error occurs, error will be non-nil.
@@ -368,17 +638,136 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
  */
 - (void) requestSummariesForSection: (NSString *) sectionName
                        previousPage: (ANTRadarSummariesResponse *) previousPage
+                           priority: (ANTNetworkRequestPriority) priority
                        cancelTicket: (PLCancelTicket *) ticket
                     dispatchContext: (id<PLDispatchContext>) context
                   completionHandler: (void (^)(ANTRadarSummariesResponse *summaries, NSError *error)) handler
 {
-    NSString *rowStartString = @"1";
+    NSUInteger rowStart = 1;
     if (previousPage != nil)
-        rowStartString = @(previousPage.rowStart + previousPage.summaries.count).stringValue;
+        rowStart = previousPage.rowStart + previousPage.summaries.count;
 
-    NSDictionary *req = @{@"reportID" : sectionName, @"orderBy" : @"DateOriginated,Descending", @"rowStartString": rowStartString };
-    
-    [self postJSON: req toPath: @"/developer/problem/getSectionProblems" cancelTicket: ticket dispatchContext: _parseContext completionHandler:^(id jsonData, NSError *error) {
+    [self requestSummariesForSection: sectionName rowStart: rowStart priority: priority cancelTicket: ticket dispatchContext: context completionHandler: handler];
+}
+
+/**
+ * @internal
+ *
+ * Request the page of radar issue summaries for @a sectionName that begins at @a rowStart.
+ *
+ * @param sectionName The section to be fethed. @sa @ref contents_network_folders.
+ * @param rowStart The first row to be fetched. The first page begins at row 1.
+ * @param priority The request priority.
+ * @param ticket A request cancellation ticket.
+ * @param context The dispatch context on which @a handler will be called.
+ * @param completionHandler The block to call upon completion. If an error occurs, error will be non-nil.
+ */
+- (void) requestSummariesForSection: (NSString *) sectionName
+                           rowStart: (NSUInteger) rowStart
+                           priority: (ANTNetworkRequestPriority) priority
+                       cancelTicket: (PLCancelTicket *) ticket
+                    dispatchContext: (id<PLDispatchContext>) context
+                  completionHandler: (void (^)(ANTRadarSummariesResponse *summaries, NSError *error)) handler
+{
+    NSDictionary *req = @{@"reportID" : sectionName, @"orderBy" : @"DateOriginated,Descending", @"rowStartString": @(rowStart).stringValue };
+
+    /* getSectionProblems is a read-only query; identical in-flight requests are coalesced */
+    NSData *body = [NSJSONSerialization dataWithJSONObject: req options: 0 error: NULL];
+    id<NSCopying> key = [ANTNetworkRequestCoalescer keyWithMethod: @"POST" path: ANTNetworkClientSectionProblemsPath body: body];
+    [_coalescer performRequestWithKey: key priority: priority cancelTicket: ticket dispatchContext: context completionHandler: handler block: ^(PLCancelTicket *requestTicket, void (^completion)(id value, NSError *error)) {
+        [self sendSectionProblemsRequest: req priority: priority cancelTicket: requestTicket dispatchContext: [PLDirectDispatchContext context] completionHandler: completion];
+    }];
+}
+
+/**
+ * @internal
+ *
+ * Send a getSectionProblems request.
+ *
+ * @param req The request parameters.
+ * @param priority The request priority.
+ * @param ticket A request cancellation ticket.
+ * @param context The dispatch context on which @a handler will be called.
+ * @param completionHandler The block to call upon completion. If an error occurs, error will be non-nil.
+ */
+- (void) sendSectionProblemsRequest: (NSDictionary *) req
+                           priority: (ANTNetworkRequestPriority) priority
+                       cancelTicket: (PLCancelTicket *) ticket
+                    dispatchContext: (id<PLDispatchContext>) context
+                  completionHandler: (void (^)(ANTRadarSummariesResponse *summaries, NSError *error)) handler
+{
+
+    /* Issues are collected as they are parsed, and decoded in fixed-size chunks on the concurrent parse queue, overlapping
+     * decoding with both the remainder of the download and with other chunks. The element handler is only ever called
+     * serially; each chunk writes only to its own results array, and the chunks are merged in order on completion. */
+    dispatch_queue_t decodeQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_group_t decodeGroup = dispatch_group_create();
+    NSMutableArray *chunkResults = [NSMutableArray array];
+    __block NSMutableArray *pendingIssues = [NSMutableArray arrayWithCapacity: ANTNetworkClientIssueChunkSize];
+    __block NSUInteger dispatchedCount = 0;
+
+    /* The first decoding error; once set, all remaining chunks (and the parse itself) are abandoned. The lock is taken
+     * only to record the error; the per-issue check reads the failure flag, which is set once the error is recorded. */
+    __block OSSpinLock errorLock = OS_SPINLOCK_INIT;
+    __block NSError *issueError = nil;
+    __block volatile uint32_t failed = 0;
+    BOOL (^Failed)(void) = ^{
+        return (BOOL) (failed != 0);
+    };
+
+    /* Dispatch all pending issues for decoding */
+    void (^DispatchChunk)(void) = ^{
+        NSArray *issues = pendingIssues;
+        NSUInteger firstIndex = dispatchedCount;
+        NSMutableArray *summaries = [NSMutableArray arrayWithCapacity: [issues count]];
+
+        [chunkResults addObject: summaries];
+        pendingIssues = [NSMutableArray arrayWithCapacity: ANTNetworkClientIssueChunkSize];
+        dispatchedCount += [issues count];
+
+        dispatch_group_async(decodeGroup, decodeQueue, ^{
+            NSUInteger index = firstIndex;
+            for (id issueVal in issues) {
+                if (Failed())
+                    return;
+
+                NSError *error;
+                ANTRadarSummaryResponse *summaryEntry = [self summaryWithIssue: issueVal index: index++ error: &error];
+                if (summaryEntry == nil) {
+                    OSSpinLockLock(&errorLock); {
+                        if (issueError == nil)
+                            issueError = error;
+                    } OSSpinLockUnlock(&errorLock);
+                    OSAtomicOr32Barrier(1, &failed);
+                    return;
+                }
+
+                [summaries addObject: summaryEntry];
+            }
+        });
+    };
+
+    BOOL (^issueHandler)(id) = ^(id issueVal) {
+        /* Stop parsing once any chunk has failed */
+        if (Failed())
+            return NO;
+
+        [pendingIssues addObject: issueVal];
+        if ([pendingIssues count] == ANTNetworkClientIssueChunkSize)
+            DispatchChunk();
+
+        return YES;
+    };
+
+    [self postJSON: req
+            toPath: ANTNetworkClientSectionProblemsPath
+       elementPath: @[@"List", @"RDRGetMyOrignatedProblems"]
+    elementHandler: issueHandler
+          priority: priority
+      cancelTicket: ticket
+   dispatchContext: _parseContext
+ completionHandler: ^(id jsonData, NSError *error)
+    {
         /* Perform the handler callback on the user's specified dispatch context, checking for cancellation */
         void (^performHandler)(ANTRadarSummariesResponse *, NSError *) = ^(ANTRadarSummariesResponse *response, NSError *error) {
             [context performWithCancelTicket: ticket block: ^{
@@ -386,108 +775,178 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
             }];
         };
 
-        /* Verify the response type */
-        if (![jsonData isKindOfClass: [NSDictionary class]]) {
-            performHandler(nil, [NSError errorWithDomain: NSCocoaErrorDomain code: NSURLErrorCannotParseResponse userInfo: nil]);
-            return;
-        }
-    
-        /* Parse out the data */
-        MAErrorReportingDictionary *jsonDict = [MAErrorReportingObject wrapObject: jsonData];
-        id (^Check)(id) = ^(id value) {
-            if (value == nil) {
-                NSError *error = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                        code: ANTErrorInvalidResponse
-                                        localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
-                                      localizedFailureReason: NSLocalizedString(@"Response data is missing a required value.", nil)
-                                             underlyingError: [jsonDict error] userInfo: nil];
+        /* Decode the final partial chunk. All element handler calls have completed prior to this handler being called. */
+        if ([pendingIssues count] > 0)
+            DispatchChunk();
+
+        dispatch_group_notify(decodeGroup, decodeQueue, ^{
+            /* Report any failure to decode an individual issue; this takes precedence over the resulting parse failure */
+            if (issueError != nil) {
+                performHandler(nil, issueError);
+                return;
+            }
+
+            if (error != nil) {
                 performHandler(nil, error);
-                return (id) nil;
+                return;
             }
-            
-            return value;
-        };
-        
-#define GetValue(_varname, _type, _source) \
-    _type *_varname = Check([_type ma_castRequiredObject: _source]); \
-    if (_varname == nil) { \
-        NSLog(@"Missing required var " # _source " in %@", jsonDict); \
-        return; \
-    }
-        
-        /* It's called a list, but it's actually a dictionary. Go figure */
-        GetValue(list, NSDictionary, jsonDict[@"List"]);
-        GetValue(issues, NSArray, list[@"RDRGetMyOrignatedProblems"]);
-        GetValue(SQL, NSDictionary, list[@"SQL"]);
-        
-        /* Fetch the pagination data */
-        GetValue(rowStart, NSNumber, SQL[@"ROWSTART"]);
-        GetValue(rowsInCache, NSNumber, SQL[@"ROWSINCACHE"]);
-
-        /* Regex to match radar attribution lines, eg, '<GMT09-Aug-2013 21:14:47GMT> Landon Fuller:' */
-        NSRegularExpression *attributionLineRegex;
-        attributionLineRegex = [NSRegularExpression regularExpressionWithPattern: @"<[A-Z0-9+]+-[A-Za-z]+-[0-9]+ [0-9]+:[0-9]+:[0-9]+[A-Z0-9+]+> .*:[ \t\n]*"
-                                                                         options: NSRegularExpressionAnchorsMatchLines
-                                                                           error: &error];
-        NSAssert(attributionLineRegex != nil, @"Failed to compile regex");
-
-        NSMutableArray *results = [NSMutableArray arrayWithCapacity: [issues count]];
-        for (id issueVal in issues) {
-            GetValue(issue, NSDictionary, issueVal);
-            GetValue(radarId,           NSNumber,   issue[@"problemID"]);
-            GetValue(stateName,         NSString,   issue[@"probstatename"]);
-            GetValue(title,             NSString,   issue[@"problemTitle"]);
-            GetValue(hidden,            NSNumber,   issue[@"hide"]);
-            GetValue(description,       NSString,   issue[@"problemDescription"]);
-            GetValue(origDateString,    NSString,   issue[@"whenOriginatedDate"]);
-            GetValue(requiresAttention,    NSNumber,   issue[@"showHighlighted"]);
-            
-            /* The component name seems to be excluded on archived bug reports; in the case where it's missing,
-             * provide a blank value. */
-            NSString *componentName = [NSString ma_castRequiredObject: issue[@"compNameForWeb"]];
-            if (componentName == nil)
-                componentName = @"Unknown";
-
-            /* Format the date */
-            NSDate *origDate = [_dateFormatter dateFromString: origDateString];
-            if (origDate == nil) {
-                NSLog(@"Could not format date: %@", origDateString);
-                NSError *parseError = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                             code: ANTErrorInvalidResponse
-                                             localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
-                                           localizedFailureReason: NSLocalizedString(@"Server sent an unexpected date format.", nil)
-                                                  underlyingError: nil
-                                                         userInfo: nil];
-                
-                performHandler(nil, parseError);
+
+            /* Decode the pagination data. It's called a list, but it's actually a dictionary. Go figure. The issues were
+             * streamed to the issue handler, leaving an empty array in their place. */
+            __unsafe_unretained id section[ANTSectionFieldCount];
+            __unsafe_unretained id list[ANTListFieldCount];
+            __unsafe_unretained id SQL[ANTSQLFieldCount];
+            NSError *decodeError;
+            if (![ANTNetworkClientSectionSchema decodeObject: jsonData values: section keyPath: nil error: &decodeError] ||
+                ![ANTNetworkClientListSchema decodeObject: section[ANTSectionFieldList] values: list keyPath: ^{ return @"List"; } error: &decodeError] ||
+                ![ANTNetworkClientSQLSchema decodeObject: list[ANTListFieldSQL] values: SQL keyPath: ^{ return @"List.SQL"; } error: &decodeError])
+            {
+                performHandler(nil, decodeError);
                 return;
             }
-            
-            /* Clean up the summary; the first line is a radar comment attributeion, eg, '<GMT09-Aug-2013 21:14:47GMT> Landon Fuller:' */
-            NSRange descriptionStart = [attributionLineRegex rangeOfFirstMatchInString: description options: 0 range: NSMakeRange(0, [description length])];
-            if (descriptionStart.location != NSNotFound)
-                description = [description substringFromIndex: NSMaxRange(descriptionStart)];
-
-            ANTRadarSummaryResponse *summaryEntry;
-            summaryEntry = [[ANTRadarSummaryResponse alloc] initWithRadarId: radarId
-                                                                  stateName: stateName
-                                                                      title: title
-                                                              componentName: componentName
-                                                          requiresAttention: [requiresAttention boolValue]
-                                                                     hidden: [hidden boolValue]
-                                                                description: description
-                                                             originatedDate: origDate];
-            [results addObject: summaryEntry];
-        }
-        
-        /* Dispatch the results */
-        ANTRadarSummariesResponse *resp = [[ANTRadarSummariesResponse alloc] initWithRowStart: [rowStart unsignedIntegerValue]
-                                                                                  rowsInCache: [rowsInCache unsignedIntegerValue]
-                                                                                    summaries: results];
-        performHandler(resp, error);
+
+            /* Merge the chunks in order */
+            NSMutableArray *results = [NSMutableArray arrayWithCapacity: dispatchedCount];
+            for (NSArray *summaries in chunkResults)
+                [results addObjectsFromArray: summaries];
+
+            /* Dispatch the results */
+            ANTRadarSummariesResponse *resp = [[ANTRadarSummariesResponse alloc] initWithRowStart: [SQL[ANTSQLFieldRowStart] unsignedIntegerValue]
+                                                                                      rowsInCache: [SQL[ANTSQLFieldRowsInCache] unsignedIntegerValue]
+                                                                                        summaries: results];
+            performHandler(resp, nil);
+        });
     }];
 }
 
+/**
+ * @internal
+ *
+ * Parse a Radar date string. The common fixed formats are handled by ANTRadarDateParse(), which is allocation-free and
+ * thread-safe; @a formatter is used only as a fallback for unexpected inputs.
+ *
+ * @param string The date string.
+ * @param formatter The formatter to use if @a string is not in a supported fixed format.
+ *
+ * @return Returns the parsed date, or nil if @a string could not be parsed.
+ */
+- (NSDate *) dateFromString: (NSString *) string formatter: (NSDateFormatter *) formatter {
+    char buffer[32];
+    double time;
+
+    if ([string getCString: buffer maxLength: sizeof(buffer) encoding: NSASCIIStringEncoding] && ANTRadarDateParse(buffer, strlen(buffer), &time))
+        return [NSDate dateWithTimeIntervalSince1970: time];
+
+    /* NSDateFormatter is not thread-safe prior to Mac OS X 10.9, and the formatters are shared by all parse tasks */
+    NSDate *date;
+    OSSpinLockLock(&_dateFormatterLock); {
+        date = [formatter dateFromString: string];
+    } OSSpinLockUnlock(&_dateFormatterLock);
+
+    return date;
+}
+
+/**
+ * @internal
+ *
+ * Return @a description with its leading Radar comment attribution line removed. If @a description does not begin with
+ * an attribution line, it is returned as-is.
+ *
+ * @param description The description text.
+ */
+- (NSString *) descriptionByRemovingAttribution: (NSString *) description {
+    NSUInteger length = [description length];
+    NSUInteger scanLength = length;
+    UniChar stackBuffer[ANTNetworkClientAttributionChunkLength];
+    UniChar *buffer = NULL;
+
+    /* When the string's backing store is not directly accessible, copy out chunks until the attribution line, if any,
+     * has been copied in full */
+    const UniChar *chars = CFStringGetCharactersPtr((__bridge CFStringRef) description);
+    if (chars == NULL) {
+        UniChar *copied = stackBuffer;
+        NSUInteger copiedLength = 0;
+        scanLength = 0;
+        while (scanLength == 0 && copiedLength < length) {
+            NSUInteger chunkLength = MIN(length - copiedLength, (NSUInteger) ANTNetworkClientAttributionChunkLength);
+            if (copiedLength > 0) {
+                buffer = realloc(buffer, (copiedLength + chunkLength) * sizeof(UniChar));
+                if (copied == stackBuffer)
+                    memcpy(buffer, stackBuffer, copiedLength * sizeof(UniChar));
+                copied = buffer;
+            }
+
+            [description getCharacters: copied + copiedLength range: NSMakeRange(copiedLength, chunkLength)];
+            copiedLength += chunkLength;
+            scanLength = ANTRadarAttributionScanLength(copied, copiedLength);
+        }
+
+        if (scanLength == 0)
+            scanLength = copiedLength;
+        chars = copied;
+    }
+
+    ANTRadarAttribution attribution;
+    BOOL found = ANTRadarAttributionScan(chars, scanLength, scanLength < length, &attribution);
+    free(buffer);
+
+    if (!found)
+        return description;
+
+    return [description substringFromIndex: attribution.length];
+}
+
+/**
+ * @internal
+ *
+ * Parse a single issue entry of a getSectionProblems response.
+ *
+ * @param issueVal The issue's JSON value.
+ * @param index The issue's index within the response, used to report the location of any invalid value.
+ * @param outError If parsing fails and this pointer is non-NULL, an error will be returned via this pointer.
+ *
+ * @return Returns the parsed summary, or nil on failure.
+ */
+- (ANTRadarSummaryResponse *) summaryWithIssue: (id) issueVal
+                                         index: (NSUInteger) index
+                                         error: (NSError **) outError
+{
+    /* The key path block is passed directly, so that it remains on the stack; it is only called on failure */
+    __unsafe_unretained id fields[ANTSummaryFieldCount];
+    if (![ANTNetworkClientSummarySchema decodeObject: issueVal values: fields keyPath: ^{ return [NSString stringWithFormat: @"List.RDRGetMyOrignatedProblems[%lu]", (unsigned long) index]; } error: outError])
+        return nil;
+
+    NSString *origDateString = fields[ANTSummaryFieldOriginatedDate];
+    NSString *description = fields[ANTSummaryFieldDescription];
+
+    /* Format the date */
+    NSDate *origDate = [self dateFromString: origDateString formatter: _dateFormatter];
+    if (origDate == nil) {
+        NSLog(@"Could not format date: %@", origDateString);
+        if (outError != NULL) {
+            *outError = [NSError pl_errorWithDomain: ANTErrorDomain
+                                               code: ANTErrorInvalidResponse
+                               localizedDescription: NSLocalizedString(@"Unable to parse the server result.", nil)
+                             localizedFailureReason: NSLocalizedString(@"Server sent an unexpected date format.", nil)
+                                    underlyingError: nil
+                                           userInfo: nil];
+        }
+        return nil;
+    }
+
+    /* Clean up the summary; the first line is a radar comment attribution, eg, '<GMT09-Aug-2013 21:14:47GMT> Landon Fuller:' */
+    description = [self descriptionByRemovingAttribution: description];
+
+    return [[ANTRadarSummaryResponse alloc] initWithRadarId: fields[ANTSummaryFieldRadarId]
+                                                  stateName: fields[ANTSummaryFieldStateName]
+                                                      title: fields[ANTSummaryFieldTitle]
+                                              componentName: fields[ANTSummaryFieldComponentName]
+                                          requiresAttention: [fields[ANTSummaryFieldRequiresAttention] boolValue]
+                                                     hidden: [fields[ANTSummaryFieldHidden] boolValue]
+                                                description: description
+                                             originatedDate: origDate];
+}
+
 /**
  * @internal
  *
@@ -626,7 +1085,7 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
     
     /* We need cookies for session and authentication verification done by the server */
     [req setHTTPShouldHandleCookies: NO];
-    NSDictionary *cookieHeaders = [NSHTTPCookie requestHeaderFieldsWithCookies: [_cookieJar cookiesForURL: req.URL]];
+    NSDictionary *cookieHeaders = [_cookieJar requestHeaderFieldsForURL: req.URL];
     for (NSString *name in cookieHeaders) {
         [req addValue: cookieHeaders[name] forHTTPHeaderField: name];
     }
@@ -634,7 +1093,7 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
     /* Used to track completion; allows for idempotent cancellation, as well as resolving
      * any potential A->B->A issues with cancellation of later requests. */
     __block BOOL finished = NO;
-    [NSURLConnection pl_sendAsynchronousRequest: req queue: _opQueue cancelTicket: ticket completionHandler:^(NSURLResponse *resp, NSData *data, NSError *error) {
+    [self sendRequest: req priority: ANTNetworkRequestPriorityInteractive cancelTicket: ticket dataHandler: nil completionHandler: ^(NSURLResponse *resp, NSData *data, NSError *error) {
         /* Mark as finished */
         OSSpinLockLock(&_lock); {
             finished = YES;
@@ -715,16 +1174,21 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
  * Send @a request, calling @a completionHandler on finish.
  *
  * @param request The request to be dispatched
+ * @param priority The request priority.
  * @param ticket A request cancellation ticket.
  * @param context The dispatch context on which the result @a handler will be called.
+ * @param dataHandler If non-nil, the block to be called serially with each portion of the response body as it is received,
+ * on an unspecified background thread, prior to the completion of the request. The data provided to @a handler will be nil.
  * @param handler The block to call upon completion. If an error occurs, error will be non-nil. On success, the JSON response data
  * will be provided via jsonData.
  *
  * @todo Implement handling of the standard error results.
  */
 - (void) sendRequest: (NSURLRequest *) request
+            priority: (ANTNetworkRequestPriority) priority
         cancelTicket: (PLCancelTicket *) ticket
      dispatchContext: (id<PLDispatchContext>) context
+         dataHandler: (ANTNetworkTransportDataHandler) dataHandler
    completionHandler: (void (^)(NSURLResponse *response, NSData *data, NSError *error)) handler
 {
     NSMutableURLRequest *mreq = [request mutableCopy];
@@ -739,40 +1203,99 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
     /* Disable caching */
     [mreq setCachePolicy: NSURLCacheStorageNotAllowed];
     [mreq addValue: @"no-cache" forHTTPHeaderField: @"Cache-Control"];
+
+    /* Request a compressed response; the transport inflates the body incrementally, prior to parsing */
+    [mreq setValue: @"gzip, deflate" forHTTPHeaderField: @"Accept-Encoding"];
     
     /* We need cookies for session and authentication verification done by the server */
     [mreq setHTTPShouldHandleCookies: NO];
-    NSDictionary *cookieHeaders = [NSHTTPCookie requestHeaderFieldsWithCookies: [_cookieJar cookiesForURL: mreq.URL]];
+    NSDictionary *cookieHeaders = [_cookieJar requestHeaderFieldsForURL: mreq.URL];
     for (NSString *name in cookieHeaders) {
         [mreq addValue: cookieHeaders[name] forHTTPHeaderField: name];
     }
 
     /* Issue the request */
-    [NSURLConnection pl_sendAsynchronousRequest: mreq queue: _opQueue cancelTicket: ticket completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
+    [self sendRequest: mreq priority: priority cancelTicket: ticket dataHandler: dataHandler completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
         [context performWithCancelTicket: ticket block:^{
             handler(response, data, error);
         }];
     }];
 }
 
+/**
+ * @internal
+ *
+ * Schedule @a request to be sent as-is once a slot is available for its host, calling @a completionHandler on finish. The
+ * request will never be sent if @a ticket is cancelled while the request is queued.
+ *
+ * @param request The request to be dispatched
+ * @param priority The request priority.
+ * @param ticket A request cancellation ticket.
+ * @param dataHandler If non-nil, the block to be called serially with each portion of the response body as it is received,
+ * on an unspecified background thread, prior to the completion of the request. The data provided to @a handler will be nil.
+ * @param handler The block to call upon completion, on an unspecified background thread.
+ */
+- (void) sendRequest: (NSURLRequest *) request
+            priority: (ANTNetworkRequestPriority) priority
+        cancelTicket: (PLCancelTicket *) ticket
+         dataHandler: (ANTNetworkTransportDataHandler) dataHandler
+   completionHandler: (void (^)(NSURLResponse *response, NSData *data, NSError *error)) handler
+{
+    [_scheduler scheduleRequestForHost: request.URL.host priority: priority cancelTicket: ticket block: ^(void (^finished)(void)) {
+        NSTimeInterval start = [[NSProcessInfo processInfo] systemUptime];
+        ANTNetworkTransportCallback completion = ^(NSURLResponse *response, NSData *data, ANTNetworkTransferSize size, NSError *error) {
+            /* Adjust the concurrency limit, and then release our slot before handing off the result */
+            [self recordResponse: response error: error size: size latency: [[NSProcessInfo processInfo] systemUptime] - start];
+            if (error == nil)
+                [self recordTransferSize: size];
+            finished();
+            handler(response, data, error);
+        };
+
+        if (dataHandler != nil)
+            [_transport sendRequest: request cancelTicket: ticket dataHandler: dataHandler completionHandler: completion];
+        else
+            [_transport sendRequest: request cancelTicket: ticket completionHandler: completion];
+    }];
+}
 
 /**
- * Send a GET request for JSON at @a resourcePath, calling @a completionHandler on finish.
+ * @internal
  *
- * @param resourcePath The resource path for which a GET should be issued.
+ * Send a JSON request, parsing the response incrementally as it is received, and call @a completionHandler on finish.
+ *
+ * @param request The request to be dispatched.
+ * @param elementPath The key path of an array within the response whose elements should be passed to @a elementHandler
+ * as they are parsed, rather than being included in the result, or nil. @sa ANTJSONStreamParser.
+ * @param elementHandler The block to be called serially with each element at @a elementPath, on an unspecified background
+ * thread, prior to the completion of the request. Return NO to abort parsing, in which case the result provided to @a handler
+ * will be an error.
+ * @param priority The request priority.
  * @param ticket A request cancellation ticket.
  * @param context The dispatch context on which the result @a handler will be called.
  * @param handler The block to call upon completion. If an error occurs, error will be non-nil. On success, the JSON response data
  * will be provided via jsonData.
  */
-- (void) getJSONWithPath: (NSString *) resourcePath cancelTicket: (PLCancelTicket *) ticket dispatchContext: (id<PLDispatchContext>) context completionHandler: (void (^)(id jsonData, NSError *error)) handler {
-    /* Formulate the GET */
-    NSURL *url = [NSURL URLWithString: resourcePath relativeToURL: [ANTNetworkClient bugReporterURL]];
-    NSMutableURLRequest *req = [NSMutableURLRequest requestWithURL: url];
-    [req addValue: @"application/json, text/javascript, */*; q=0.01" forHTTPHeaderField: @"Accept"];
-    
+- (void) sendJSONRequest: (NSURLRequest *) request
+             elementPath: (NSArray *) elementPath
+          elementHandler: (BOOL (^)(id element)) elementHandler
+                priority: (ANTNetworkRequestPriority) priority
+            cancelTicket: (PLCancelTicket *) ticket
+         dispatchContext: (id<PLDispatchContext>) context
+       completionHandler: (void (^)(id jsonData, NSError *error)) handler
+{
+    /* Parse the response as it arrives, rather than buffering the entire body. The transport serializes all data callbacks,
+     * and they complete before the completion handler is called. */
+    ANTJSONStreamParser *parser = [[ANTJSONStreamParser alloc] initWithElementPath: elementPath elementHandler: elementHandler];
+    __block NSError *streamError = nil;
+    ANTNetworkTransportDataHandler dataHandler = ^(NSData *data) {
+        NSError *error;
+        if (streamError == nil && ![parser parseData: data error: &error])
+            streamError = error;
+    };
+
     /* Issue the request */
-    [self sendRequest: req cancelTicket: ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
+    [self sendRequest: request priority: priority cancelTicket: ticket dispatchContext: [PLDirectDispatchContext context] dataHandler: dataHandler completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
         /* Perform the handler callback on the right dispatch context, checking for cancellation */
         void (^performHandler)(id, NSError *) = ^(id value, NSError *error) {
             [context performBlock:^{
@@ -792,9 +1315,12 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
             return;
         }
         
-        /* Parse the result. TODO: Generic handling of JSON isError results */
-        NSError *jsonError;
-        id jsonResult = [NSJSONSerialization JSONObjectWithData: data options:0 error: &jsonError];
+        /* Complete the parse. TODO: Generic handling of JSON isError results */
+        NSError *jsonError = streamError;
+        id jsonResult = nil;
+        if (jsonError == nil)
+            jsonResult = [parser finishWithError: &jsonError];
+
         if (jsonResult == nil) {
             NSError *antError = [NSError pl_errorWithDomain: ANTErrorDomain
                                                        code: ANTErrorInvalidResponse
@@ -811,12 +1337,288 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
     }];
 }
 
+/**
+ * Send a GET request for JSON at @a resourcePath, calling @a completionHandler on finish.
+ *
+ * @param resourcePath The resource path for which a GET should be issued.
+ * @param priority The request priority.
+ * @param ticket A request cancellation ticket.
+ * @param context The dispatch context on which the result @a handler will be called.
+ * @param handler The block to call upon completion. If an error occurs, error will be non-nil. On success, the JSON response data
+ * will be provided via jsonData.
+ */
+- (void) getJSONWithPath: (NSString *) resourcePath
+                priority: (ANTNetworkRequestPriority) priority
+            cancelTicket: (PLCancelTicket *) ticket
+         dispatchContext: (id<PLDispatchContext>) context
+       completionHandler: (void (^)(id jsonData, NSError *error)) handler
+{
+    /* Formulate the GET */
+    NSURL *url = [NSURL URLWithString: resourcePath relativeToURL: [ANTNetworkClient bugReporterURL]];
+    NSMutableURLRequest *req = [NSMutableURLRequest requestWithURL: url];
+    [req addValue: @"application/json, text/javascript, */*; q=0.01" forHTTPHeaderField: @"Accept"];
+    
+    /* Issue the request */
+    [self sendJSONRequest: req elementPath: nil elementHandler: nil priority: priority cancelTicket: ticket dispatchContext: context completionHandler: handler];
+}
+
+
+/**
+ * @internal
+ *
+ * Return the value of the header field @a name in @a headerFields, performing a case-insensitive match of the field name.
+ */
+static NSString *ANTNetworkClientHeaderValue (NSDictionary *headerFields, NSString *name) {
+    NSString *value = headerFields[name];
+    if (value != nil)
+        return value;
+
+    for (NSString *key in headerFields) {
+        if ([key caseInsensitiveCompare: name] == NSOrderedSame)
+            return headerFields[key];
+    }
+
+    return nil;
+}
+
+/**
+ * @internal
+ *
+ * Return the concurrency controller latency class of a request that transferred @a size.
+ */
+static ANTNetworkConcurrencyLatencyClass ANTNetworkClientLatencyClass (ANTNetworkTransferSize size) {
+    if (size.bodyBytesReceived == 0)
+        return ANTNetworkConcurrencyLatencyClassEmpty;
+    else if (size.bodyBytesReceived >= ANTNetworkClientLargeResponseSize)
+        return ANTNetworkConcurrencyLatencyClassLarge;
+    else
+        return ANTNetworkConcurrencyLatencyClassSmall;
+}
+
+/**
+ * @internal
+ *
+ * Return the delay requested by @a response's Retry-After header, in seconds, clamped to ANTNetworkClientMaximumRetryAfter,
+ * or 0 if the header is absent or invalid. Both the delta-seconds and HTTP-date forms are supported.
+ */
+static NSTimeInterval ANTNetworkClientRetryAfterInterval (NSURLResponse *response) {
+    if (![response isKindOfClass: [NSHTTPURLResponse class]])
+        return 0;
+
+    NSString *value = ANTNetworkClientHeaderValue([(NSHTTPURLResponse *) response allHeaderFields], @"Retry-After");
+    char buffer[64];
+    if (value == nil || ![value getCString: buffer maxLength: sizeof(buffer) encoding: NSASCIIStringEncoding])
+        return 0;
+
+    NSTimeInterval interval;
+    char *end;
+    long long seconds = strtoll(buffer, &end, 10);
+    if (end != buffer && *end == '\0') {
+        interval = seconds;
+    } else {
+        /* RFC 1123 date; the only HTTP-date form that servers are permitted to generate */
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        end = strptime_l(buffer, "%a, %d %b %Y %H:%M:%S GMT", &tm, NULL);
+        if (end == NULL || *end != '\0')
+            return 0;
+
+        interval = (NSTimeInterval) (timegm(&tm) - time(NULL));
+    }
+
+    return MIN(MAX(interval, 0), ANTNetworkClientMaximumRetryAfter);
+}
+
+/**
+ * @internal
+ *
+ * Record the result of a completed request with the concurrency controller, updating the scheduler's concurrency limit,
+ * and deferring further requests if the server has requested a backoff.
+ *
+ * @param response The request response, or nil if none was received.
+ * @param error The request error, if any.
+ * @param size The number of response body bytes transferred. Latency is compared only between requests of similar size.
+ * @param latency The time elapsed between issuing the request and its completion.
+ */
+- (void) recordResponse: (NSURLResponse *) response error: (NSError *) error size: (ANTNetworkTransferSize) size latency: (NSTimeInterval) latency {
+    NSInteger statusCode = 0;
+    if ([response isKindOfClass: [NSHTTPURLResponse class]])
+        statusCode = [(NSHTTPURLResponse *) response statusCode];
+
+    /* Only connection-level failures are treated as congestion; a response indicates that the server is reachable */
+    BOOL failed = (error != nil && statusCode == 0 && !([error.domain isEqual: NSURLErrorDomain] && error.code == NSURLErrorCancelled));
+    NSTimeInterval retryAfter = ANTNetworkClientRetryAfterInterval(response);
+
+    ANTNetworkConcurrencyDecision decision = [_concurrencyController recordRequestWithLatency: latency
+                                                                                   latencyClass: ANTNetworkClientLatencyClass(size)
+                                                                                     statusCode: statusCode
+                                                                                         failed: failed
+                                                                                     retryAfter: retryAfter];
+    if (decision == ANTNetworkConcurrencyDecisionHold)
+        return;
+
+    _scheduler.concurrencyLimit = _concurrencyController.window;
+    if (decision == ANTNetworkConcurrencyDecisionBackoff) {
+        NSLog(@"Server requested a %.0f second backoff for %@", retryAfter, response.URL.host);
+        [_scheduler pauseForInterval: retryAfter];
+    }
+}
+
+/**
+ * @internal
+ *
+ * Add the response body size of a successful request to the receiver's transfer statistics.
+ *
+ * @param size The response body size.
+ */
+- (void) recordTransferSize: (ANTNetworkTransferSize) size {
+    OSAtomicIncrement64(&_transferRequests);
+    OSAtomicAdd64((int64_t) size.bodyBytesReceived, &_transferBodyBytesReceived);
+    OSAtomicAdd64((int64_t) size.bodyBytesDecoded, &_transferBodyBytesDecoded);
+}
+
+/**
+ * @internal
+ *
+ * Send a GET request for JSON at @a resourcePath, decoding the response with @a decoder, and calling @a completionHandler on finish.
+ *
+ * If a responseCache is configured, the decoded result is cached, and any cached result is revalidated via a conditional
+ * GET. If the server reports that the resource is unchanged, or returns a body identical to the cached response, the cached
+ * result is provided without parsing the response.
+ *
+ * @param resourcePath The resource path for which a GET should be issued; also used as the cache key.
+ * @param priority The request priority.
+ * @param ticket A request cancellation ticket.
+ * @param context The dispatch context on which the result @a handler will be called.
+ * @param decoder The block to be called on an unspecified background thread to decode the parsed JSON response. The decoded
+ * value must conform to NSSecureCoding, and its classes must be registered with the response cache. On failure, return nil
+ * and provide an error via outError.
+ * @param handler The block to call upon completion. If an error occurs, error will be non-nil.
+ */
+- (void) getCachedObjectWithPath: (NSString *) resourcePath
+                        priority: (ANTNetworkRequestPriority) priority
+                    cancelTicket: (PLCancelTicket *) ticket
+                 dispatchContext: (id<PLDispatchContext>) context
+                         decoder: (id (^)(id jsonData, NSError **outError)) decoder
+               completionHandler: (void (^)(id value, NSError *error)) handler
+{
+    ANTNetworkResponseCache *cache = self.responseCache;
+
+    /* Perform the handler callback on the user's specified dispatch context, checking for cancellation */
+    void (^performHandler)(id, NSError *) = ^(id value, NSError *error) {
+        [context performWithCancelTicket: ticket block: ^{
+            handler(value, error);
+        }];
+    };
+
+    /* Look up any cached response before formulating the request; the lookup may read from disk, and is performed in the
+     * background */
+    void (^issueRequest)(ANTNetworkResponseCacheEntry *) = ^(ANTNetworkResponseCacheEntry *cached) {
+        /* Formulate the GET */
+        NSURL *url = [NSURL URLWithString: resourcePath relativeToURL: [ANTNetworkClient bugReporterURL]];
+        NSMutableURLRequest *req = [NSMutableURLRequest requestWithURL: url];
+        [req addValue: @"application/json, text/javascript, */*; q=0.01" forHTTPHeaderField: @"Accept"];
+
+        /* Revalidate any cached response */
+        if (cached.entityTag != nil)
+            [req setValue: cached.entityTag forHTTPHeaderField: @"If-None-Match"];
+        if (cached.lastModified != nil)
+            [req setValue: cached.lastModified forHTTPHeaderField: @"If-Modified-Since"];
+
+        /* Issue the request. The body is buffered, allowing it to be compared against the cached response prior to parsing. */
+        [self sendRequest: req priority: priority cancelTicket: ticket dispatchContext: _parseContext dataHandler: nil completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
+            if (error != nil) {
+                performHandler(nil, [NSError pl_errorWithDomain: ANTErrorDomain
+                                                           code: ANTErrorConnectionLost
+                                           localizedDescription: [error localizedDescription]
+                                         localizedFailureReason: [error localizedFailureReason]
+                                                underlyingError: error
+                                                       userInfo: nil]);
+                return;
+            }
+
+            /* Unchanged; use the cached result */
+            NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *) response;
+            if ([httpResponse statusCode] == 304 && cached != nil) {
+                performHandler(cached.object, nil);
+                return;
+            }
+
+            if ([httpResponse statusCode] != 200) {
+                performHandler(nil, [NSError pl_errorWithDomain: ANTErrorDomain
+                                                           code: ANTErrorInvalidResponse
+                                           localizedDescription: NSLocalizedString(@"The server request failed.", nil)
+                                         localizedFailureReason: [NSString stringWithFormat: NSLocalizedString(@"The server returned an error response (%zd)", nil), [httpResponse statusCode]]
+                                                underlyingError: nil
+                                                       userInfo: nil]);
+                return;
+            }
+
+            NSDictionary *headerFields = [httpResponse allHeaderFields];
+            NSString *entityTag = ANTNetworkClientHeaderValue(headerFields, @"ETag");
+            NSString *lastModified = ANTNetworkClientHeaderValue(headerFields, @"Last-Modified");
+            NSData *contentHash = [ANTNetworkResponseCacheEntry contentHashForData: data];
+
+            /* Identical to the cached response; refresh the validators, and use the cached result */
+            if (cached != nil && [cached.contentHash isEqualToData: contentHash]) {
+                BOOL entityTagChanged = (entityTag != cached.entityTag && ![entityTag isEqualToString: cached.entityTag]);
+                BOOL lastModifiedChanged = (lastModified != cached.lastModified && ![lastModified isEqualToString: cached.lastModified]);
+                if (entityTagChanged || lastModifiedChanged) {
+                    ANTNetworkResponseCacheEntry *refreshed = [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: entityTag lastModified: lastModified contentHash: contentHash object: cached.object];
+                    [cache setEntry: refreshed forResourcePath: resourcePath];
+                }
+
+                performHandler(cached.object, nil);
+                return;
+            }
+
+            /* Parse and decode the response */
+            ANTJSONStreamParser *parser = [ANTJSONStreamParser new];
+            NSError *jsonError;
+            id jsonData = nil;
+            if ([parser parseData: data error: &jsonError])
+                jsonData = [parser finishWithError: &jsonError];
+
+            if (jsonData == nil) {
+                performHandler(nil, [NSError pl_errorWithDomain: ANTErrorDomain
+                                                           code: ANTErrorInvalidResponse
+                                           localizedDescription: NSLocalizedString(@"Unable to parse the server result", nil)
+                                         localizedFailureReason: NSLocalizedString(@"Server sent invalid JSON data", nil)
+                                                underlyingError: jsonError
+                                                       userInfo: nil]);
+                return;
+            }
+
+            NSError *decodeError;
+            id value = decoder(jsonData, &decodeError);
+            if (value == nil) {
+                performHandler(nil, decodeError);
+                return;
+            }
+
+            /* Cache the result; responses without validators may still be matched by content hash */
+            [cache setEntry: [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: entityTag lastModified: lastModified contentHash: contentHash object: value] forResourcePath: resourcePath];
+
+            performHandler(value, nil);
+        }];
+    };
+
+    if (cache != nil)
+        [cache fetchEntryForResourcePath: resourcePath completionHandler: issueRequest];
+    else
+        issueRequest(nil);
+}
 
 /**
  * Post JSON request data @a json to @a resourcePath, calling @a completionHandler on finish.
  *
  * @param json A foundation instance that may be represented as JSON
  * @param resourcePath The resource path to which the JSON data will be POSTed.
+ * @param elementPath The key path of an array within the response whose elements should be passed to @a elementHandler
+ * as they are parsed, rather than being included in the result, or nil.
+ * @param elementHandler The block to be called serially with each element at @a elementPath, on an unspecified background
+ * thread, prior to the completion of the request. Return NO to abort parsing.
+ * @param priority The request priority.
  * @param ticket A request cancellation ticket.
  * @param context The dispatch context on which the result @a handler will be called.
  * @param handler The block to call upon completion. If an error occurs, error will be non-nil. On success, the JSON response data
@@ -826,6 +1628,9 @@ NSString *ANTNetworkClientFolderTypeDrafts = @"Drafts";
  */
 - (void) postJSON: (id) json
            toPath: (NSString *) resourcePath
+      elementPath: (NSArray *) elementPath
+   elementHandler: (BOOL (^)(id element)) elementHandler
+         priority: (ANTNetworkRequestPriority) priority
      cancelTicket: (PLCancelTicket *) ticket
   dispatchContext: (id<PLDispatchContext>) context
 completionHandler: (void (^)(id jsonData, NSError *error)) handler
@@ -843,43 +1648,32 @@ completionHandler: (void (^)(id jsonData, NSError *error)) handler
     [req setValue: @"application/json; charset=UTF-8" forHTTPHeaderField: @"Content-Type"];
     
     /* Issue the request */
-    [self sendRequest: req cancelTicket: ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
-        /* Perform the handler callback on the right dispatch context, checking for cancellation */
-        void (^performHandler)(id, NSError *) = ^(id value, NSError *error) {
-            [context performBlock:^{
-                if (!ticket.isCancelled)
-                    handler(value, error);
-            }];
-        };
-        
-        if (error != nil) {
-            NSError *antError = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                       code: ANTErrorInvalidResponse
-                                       localizedDescription: NSLocalizedString(@"Unable to parse the server result", nil)
-                                     localizedFailureReason: NSLocalizedString(@"Server sent invalid JSON data", nil)
-                                            underlyingError: error
-                                                   userInfo: nil];
-            performHandler(nil, antError);
-            return;
-        }
-        
-        /* Parse the result. TODO: Generic handling of JSON isError results */
-        NSError *jsonError;
-        id jsonResult = [NSJSONSerialization JSONObjectWithData: data options:0 error: &jsonError];
-        if (jsonResult == nil) {
-            NSError *antError = [NSError pl_errorWithDomain: ANTErrorDomain
-                                                       code: ANTErrorInvalidResponse
-                                       localizedDescription: NSLocalizedString(@"Unable to parse the server result", nil)
-                                     localizedFailureReason: NSLocalizedString(@"Server sent invalid JSON data", nil)
-                                            underlyingError: jsonError
-                                                   userInfo: nil];
-            
-            performHandler(nil, antError);
-            return;
-        }
-    
-         performHandler(jsonResult, nil);
-    }];
+    [self sendJSONRequest: req elementPath: elementPath elementHandler: elementHandler priority: priority cancelTicket: ticket dispatchContext: context completionHandler: handler];
+}
+
+// property getter
+- (id<ANTNetworkTransport>) transport {
+    return _transport;
+}
+
+// property getter
+- (NSUInteger) maxConcurrentRequestsPerHost {
+    return _scheduler.maxConcurrentRequestsPerHost;
+}
+
+// property getter
+- (ANTNetworkConcurrencyStatistics) concurrencyStatistics {
+    return _concurrencyController.statistics;
+}
+
+// property getter
+- (ANTNetworkClientTransferStatistics) transferStatistics {
+    ANTNetworkClientTransferStatistics statistics = {
+        .requests = (uint64_t) _transferRequests,
+        .bodyBytesReceived = (uint64_t) _transferBodyBytesReceived,
+        .bodyBytesDecoded = (uint64_t) _transferBodyBytesDecoded
+    };
+    return statistics;
 }
 
 // property getter
@@ -0,0 +1,230 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTNetworkClient.h"
+
+/**
+ * A stand-in authentication delegate that immediately succeeds with an empty cookie jar.
+ */
+@interface ANTNetworkClientTestAuthDelegate : NSObject <ANTNetworkClientAuthDelegate> @end
+
+@implementation ANTNetworkClientTestAuthDelegate
+
+// from ANTNetworkClientAuthDelegate protocol
+- (void) networkClient: (ANTNetworkClient *) sender authRequiredWithAccount: (ANTNetworkClientAccount *) account cancelTicket: (PLCancelTicket *) ticket andCall: (ANTNetworkClientAuthDelegateCallback) callback {
+    callback([[ANTNetworkClientAuthResult alloc] initWithCookieJar: [ANTCookieJar new] csrfToken: @"token"], nil);
+}
+
+@end
+
+/**
+ * A stand-in transport that answers each request with the response provided by its responder block, and records the
+ * requests it was sent.
+ */
+@interface ANTNetworkClientTestTransport : NSObject <ANTNetworkTransport>
+
+/** Returns the status code, header fields, and body with which @a request should be answered. */
+@property(atomic, copy) NSData *(^responder)(NSURLRequest *request, NSInteger *statusCode, NSDictionary **headerFields);
+
+/** All requests sent via the transport, in order. */
+@property(atomic, readonly) NSArray *requests;
+
+@end
+
+@implementation ANTNetworkClientTestTransport {
+    NSMutableArray *_requests;
+}
+
+- (instancetype) init {
+    PLSuperInit();
+
+    _requests = [NSMutableArray array];
+
+    return self;
+}
+
+// from ANTNetworkTransport protocol
+- (void) sendRequest: (NSURLRequest *) request cancelTicket: (PLCancelTicket *) ticket completionHandler: (ANTNetworkTransportCallback) handler {
+    @synchronized (self) {
+        [_requests addObject: request];
+    }
+
+    NSInteger statusCode = 200;
+    NSDictionary *headerFields = @{};
+    NSData *body = self.responder(request, &statusCode, &headerFields);
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL: request.URL statusCode: statusCode HTTPVersion: @"HTTP/1.1" headerFields: headerFields];
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        handler(response, body, (ANTNetworkTransferSize) { [body length], [body length] }, nil);
+    });
+}
+
+// from ANTNetworkTransport protocol
+- (void) sendRequest: (NSURLRequest *) request
+        cancelTicket: (PLCancelTicket *) ticket
+         dataHandler: (ANTNetworkTransportDataHandler) dataHandler
+   completionHandler: (ANTNetworkTransportCallback) handler
+{
+    [self sendRequest: request cancelTicket: ticket completionHandler: ^(NSURLResponse *response, NSData *data, ANTNetworkTransferSize size, NSError *error) {
+        if ([data length] > 0)
+            dataHandler(data);
+        handler(response, nil, size, error);
+    }];
+}
+
+// property getter
+- (NSArray *) requests {
+    @synchronized (self) {
+        return [_requests copy];
+    }
+}
+
+@end
+
+@interface ANTNetworkClientTests : XCTestCase @end
+
+@implementation ANTNetworkClientTests {
+    /** Temporary response cache directory */
+    NSString *_path;
+
+    /** Authentication delegate; held strongly, as the client references it weakly */
+    ANTNetworkClientTestAuthDelegate *_authDelegate;
+
+    /** The client's transport */
+    ANTNetworkClientTestTransport *_transport;
+
+    /** An authenticated client, with a response cache */
+    ANTNetworkClient *_client;
+}
+
+- (void) setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+    _authDelegate = [ANTNetworkClientTestAuthDelegate new];
+    _transport = [ANTNetworkClientTestTransport new];
+    _client = [[ANTNetworkClient alloc] initWithAuthDelegate: _authDelegate transport: _transport maxConcurrentRequestsPerHost: 4];
+
+    NSError *error;
+    NSSet *classes = [NSSet setWithObjects: [ANTRadarResponse class], [ANTRadarCommentResponse class], [NSArray class], [NSString class], [NSDate class], nil];
+    _client.responseCache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: classes error: &error];
+    XCTAssertNotNil(_client.responseCache, @"Failed to create cache: %@", error);
+
+    dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+    __block NSError *loginError = nil;
+    ANTNetworkClientAccount *account = [[ANTNetworkClientAccount alloc] initWithUsername: @"user" password: @"password"];
+    [_client loginWithAccount: account cancelTicket: [PLCancelTicketSource new].ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(NSError *error) {
+        loginError = error;
+        dispatch_semaphore_signal(sem);
+    }];
+    dispatch_semaphore_wait(sem, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    XCTAssertNil(loginError, @"Failed to log in: %@", loginError);
+}
+
+- (void) tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath: _path error: NULL];
+}
+
+/* Request radar @a radarId, waiting for the result */
+static ANTRadarResponse *RequestRadar (ANTNetworkClient *client, NSNumber *radarId, NSError **outError) {
+    dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+    __block ANTRadarResponse *result = nil;
+    __block NSError *resultError = nil;
+
+    [client requestRadarWithId: radarId priority: ANTNetworkRequestPriorityInteractive cancelTicket: [PLCancelTicketSource new].ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(ANTRadarResponse *radar, NSError *error) {
+        result = radar;
+        resultError = error;
+        dispatch_semaphore_signal(sem);
+    }];
+
+    dispatch_semaphore_wait(sem, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    if (outError != NULL)
+        *outError = resultError;
+    return result;
+}
+
+/* A valid openProblem response body */
+static NSData *RadarBody (NSString *title) {
+    NSString *json = [NSString stringWithFormat: @"{\"problemTitle\": \"%@\", \"resolved\": false, \"lastModifiedDate\": \"09-Aug-2013 21:14:47\", \"descriptionText\": []}", title];
+    return [json dataUsingEncoding: NSUTF8StringEncoding];
+}
+
+- (void) testNotModified {
+    _transport.responder = ^(NSURLRequest *request, NSInteger *statusCode, NSDictionary **headerFields) {
+        *headerFields = @{@"ETag" : @"\"v1\""};
+        return RadarBody(@"Title");
+    };
+
+    NSError *error;
+    ANTRadarResponse *radar = RequestRadar(_client, @(1), &error);
+    XCTAssertNotNil(radar, @"Request failed: %@", error);
+    XCTAssertEqualObjects(radar.title, @"Title", @"Incorrect title");
+    XCTAssertNil([_transport.requests[0] valueForHTTPHeaderField: @"If-None-Match"], @"Sent a conditional request without a cached response");
+
+    /* The cached response is revalidated, and used as-is */
+    _transport.responder = ^(NSURLRequest *request, NSInteger *statusCode, NSDictionary **headerFields) {
+        *statusCode = 304;
+        return [NSData data];
+    };
+
+    ANTRadarResponse *revalidated = RequestRadar(_client, @(1), &error);
+    XCTAssertEqual(revalidated, radar, @"The cached response was not used: %@", error);
+    XCTAssertEqualObjects([_transport.requests[1] valueForHTTPHeaderField: @"If-None-Match"], @"\"v1\"", @"The cached response was not revalidated");
+}
+
+- (void) testIdenticalResponse {
+    _transport.responder = ^(NSURLRequest *request, NSInteger *statusCode, NSDictionary **headerFields) {
+        *headerFields = @{@"ETag" : @"\"v1\""};
+        return RadarBody(@"Title");
+    };
+
+    NSError *error;
+    ANTRadarResponse *radar = RequestRadar(_client, @(1), &error);
+    XCTAssertNotNil(radar, @"Request failed: %@", error);
+
+    /* A full response with an identical body is not decoded again, but its validators replace those cached */
+    _transport.responder = ^(NSURLRequest *request, NSInteger *statusCode, NSDictionary **headerFields) {
+        *headerFields = @{@"ETag" : @"\"v2\""};
+        return RadarBody(@"Title");
+    };
+
+    ANTRadarResponse *identical = RequestRadar(_client, @(1), &error);
+    XCTAssertEqual(identical, radar, @"The cached response was not used: %@", error);
+    XCTAssertEqualObjects([_client.responseCache entryForResourcePath: @"/developer/problem/openProblem/1"].entityTag, @"\"v2\"", @"Validators were not refreshed");
+
+    /* A changed body is decoded */
+    _transport.responder = ^(NSURLRequest *request, NSInteger *statusCode, NSDictionary **headerFields) {
+        *headerFields = @{@"ETag" : @"\"v3\""};
+        return RadarBody(@"Changed");
+    };
+
+    ANTRadarResponse *changed = RequestRadar(_client, @(1), &error);
+    XCTAssertEqualObjects(changed.title, @"Changed", @"The changed response was not decoded: %@", error);
+    XCTAssertEqualObjects([_transport.requests[2] valueForHTTPHeaderField: @"If-None-Match"], @"\"v2\"", @"The refreshed validator was not sent");
+}
+
+@end
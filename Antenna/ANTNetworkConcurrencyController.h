@@ -0,0 +1,125 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Concurrency window adjustments made by ANTNetworkConcurrencyController.
+ */
+typedef NS_ENUM(NSUInteger, ANTNetworkConcurrencyDecision) {
+    /** The window was left unchanged. */
+    ANTNetworkConcurrencyDecisionHold = 0,
+
+    /** The window was additively increased. */
+    ANTNetworkConcurrencyDecisionIncrease = 1,
+
+    /** The window was multiplicatively decreased in response to increased request latency. */
+    ANTNetworkConcurrencyDecisionDecreaseLatency = 2,
+
+    /** The window was multiplicatively decreased in response to a server or connection error. */
+    ANTNetworkConcurrencyDecisionDecreaseError = 3,
+
+    /** The server requested that requests be deferred via a Retry-After header; the window may also have been decreased. */
+    ANTNetworkConcurrencyDecisionBackoff = 4
+};
+
+/**
+ * Request latency classes. Latency is only comparable between requests of similar cost; the latency of each class is
+ * sampled, and its baseline tracked, independently.
+ */
+typedef NS_ENUM(NSUInteger, ANTNetworkConcurrencyLatencyClass) {
+    /** Requests with a small response body. */
+    ANTNetworkConcurrencyLatencyClassSmall = 0,
+
+    /** Requests answered without a response body, such as a 304 revalidation. */
+    ANTNetworkConcurrencyLatencyClassEmpty = 1,
+
+    /** Requests with a large response body. */
+    ANTNetworkConcurrencyLatencyClassLarge = 2,
+
+    /** The number of latency classes. */
+    ANTNetworkConcurrencyLatencyClassCount = 3
+};
+
+/**
+ * Concurrency controller statistics.
+ */
+typedef struct ANTNetworkConcurrencyStatistics {
+    /** The current concurrency window. */
+    NSUInteger window;
+
+    /** The median latency of recent successful requests in each latency class, in seconds, or 0 if too few requests of
+     * that class have completed. */
+    NSTimeInterval latencyP50[ANTNetworkConcurrencyLatencyClassCount];
+
+    /** The 90th percentile latency of recent successful requests in each latency class, in seconds, or 0 if too few
+     * requests of that class have completed. */
+    NSTimeInterval latencyP90[ANTNetworkConcurrencyLatencyClassCount];
+
+    /** The baseline (uncongested) median latency of each latency class, in seconds, or 0 if not yet known. */
+    NSTimeInterval baselineLatency[ANTNetworkConcurrencyLatencyClassCount];
+
+    /** The total number of requests recorded. */
+    uint64_t requests;
+
+    /** The number of requests that failed with a server or connection error. */
+    uint64_t errors;
+
+    /** The number of additive increases that grew the window by a whole request. */
+    uint64_t increases;
+
+    /** The number of window decreases made in response to increased latency. */
+    uint64_t latencyDecreases;
+
+    /** The number of window decreases made in response to errors. */
+    uint64_t errorDecreases;
+
+    /** The number of Retry-After backoffs. */
+    uint64_t backoffs;
+
+    /** The most recent decision. */
+    ANTNetworkConcurrencyDecision lastDecision;
+} ANTNetworkConcurrencyStatistics;
+
+@interface ANTNetworkConcurrencyController : NSObject
+
+- (instancetype) initWithInitialWindow: (NSUInteger) initialWindow minimumWindow: (NSUInteger) minimumWindow maximumWindow: (NSUInteger) maximumWindow;
+
+- (ANTNetworkConcurrencyDecision) recordRequestWithLatency: (NSTimeInterval) latency
+                                              latencyClass: (ANTNetworkConcurrencyLatencyClass) latencyClass
+                                                statusCode: (NSInteger) statusCode
+                                                    failed: (BOOL) failed
+                                                retryAfter: (NSTimeInterval) retryAfter;
+
+/** The current concurrency window; the number of requests that should be permitted in flight. */
+@property(nonatomic, readonly) NSUInteger window;
+
+/** A snapshot of the controller's statistics. */
+@property(nonatomic, readonly) ANTNetworkConcurrencyStatistics statistics;
+
+@end
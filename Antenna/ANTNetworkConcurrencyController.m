@@ -0,0 +1,322 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTNetworkConcurrencyController.h"
+
+#import <PLFoundation/PLFoundation.h>
+#import <libkern/OSAtomic.h>
+
+/** The number of recent request latencies, per latency class, from which percentiles are computed. */
+#define ANT_CONCURRENCY_SAMPLE_COUNT 64
+
+/** The minimum number of latency samples required before latency is used to adjust the window. */
+static const NSUInteger ANTNetworkConcurrencyMinimumSamples = 16;
+
+/** The factor by which the 90th percentile latency may exceed the baseline latency before the window is decreased. */
+static const double ANTNetworkConcurrencyLatencyTolerance = 2.0;
+
+/** The factor by which the window is decreased in response to increased latency. */
+static const double ANTNetworkConcurrencyLatencyDecrease = 0.75;
+
+/** The factor by which the window is decreased in response to errors. */
+static const double ANTNetworkConcurrencyErrorDecrease = 0.5;
+
+/** The rate at which the baseline latency tracks a higher median latency, per sample. Allows the baseline to follow a
+ * persistent change in server performance, without drifting upwards in response to short-lived congestion. */
+static const double ANTNetworkConcurrencyBaselineDrift = 0.01;
+
+/**
+ * @internal
+ *
+ * The recent latencies of one latency class. The samples are held both in arrival order, to determine which sample is
+ * replaced next, and in sorted order, from which percentiles are read directly.
+ */
+typedef struct ANTNetworkConcurrencySamples {
+    /** Ring buffer of recent successful request latencies. */
+    NSTimeInterval ring[ANT_CONCURRENCY_SAMPLE_COUNT];
+
+    /** The samples in ring, in ascending order. */
+    NSTimeInterval sorted[ANT_CONCURRENCY_SAMPLE_COUNT];
+
+    /** The number of valid samples. */
+    NSUInteger count;
+
+    /** The index in ring at which the next sample will be written. */
+    NSUInteger index;
+} ANTNetworkConcurrencySamples;
+
+/**
+ * @internal
+ *
+ * Return the index of the first of the sorted @a samples that is not less than @a latency.
+ */
+static NSUInteger ANTNetworkConcurrencyLowerBound (const NSTimeInterval *samples, NSUInteger count, NSTimeInterval latency) {
+    NSUInteger low = 0;
+    NSUInteger high = count;
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (samples[mid] < latency)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/**
+ * @internal
+ *
+ * Add @a latency to @a samples, replacing the oldest sample if full. The sorted samples are updated incrementally,
+ * without sorting.
+ */
+static void ANTNetworkConcurrencySamplesAdd (ANTNetworkConcurrencySamples *samples, NSTimeInterval latency) {
+    if (samples->count == ANT_CONCURRENCY_SAMPLE_COUNT) {
+        NSUInteger evicted = ANTNetworkConcurrencyLowerBound(samples->sorted, samples->count, samples->ring[samples->index]);
+        memmove(&samples->sorted[evicted], &samples->sorted[evicted + 1], (samples->count - evicted - 1) * sizeof(NSTimeInterval));
+        samples->count--;
+    }
+
+    samples->ring[samples->index] = latency;
+    samples->index = (samples->index + 1) % ANT_CONCURRENCY_SAMPLE_COUNT;
+
+    NSUInteger position = ANTNetworkConcurrencyLowerBound(samples->sorted, samples->count, latency);
+    memmove(&samples->sorted[position + 1], &samples->sorted[position], (samples->count - position) * sizeof(NSTimeInterval));
+    samples->sorted[position] = latency;
+    samples->count++;
+}
+
+/**
+ * Computes a request concurrency window using additive-increase/multiplicative-decrease (AIMD).
+ *
+ * Each successful request with acceptable latency grows the window by 1/window, growing the window by one request per
+ * window's worth of successful requests. The window is multiplicatively decreased when the 90th percentile latency of
+ * recent requests exceeds the baseline (uncongested) median latency by more than a fixed tolerance, or when a request
+ * fails with a server error (5xx or 429) or a connection error. Latencies are compared only within a latency class, so
+ * that a mix of cheap and expensive requests is not mistaken for congestion.
+ *
+ * To avoid collapsing the window in response to a single burst of failures, at most one decrease is made for each
+ * window's worth of completed requests.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used concurrently from any thread.
+ */
+@implementation ANTNetworkConcurrencyController {
+@private
+    /** Lock that must be held when accessing mutable internal state. */
+    OSSpinLock _lock;
+
+    /** The window bounds. */
+    double _minimumWindow;
+    double _maximumWindow;
+
+    /** The current, fractional window. */
+    double _window;
+
+    /** Recent successful request latencies, by latency class. */
+    ANTNetworkConcurrencySamples _samples[ANTNetworkConcurrencyLatencyClassCount];
+
+    /** The number of requests recorded since the window was last decreased. */
+    NSUInteger _sinceDecrease;
+
+    /** Current statistics. */
+    ANTNetworkConcurrencyStatistics _statistics;
+}
+
+/**
+ * Initialize a new controller.
+ *
+ * @param initialWindow The initial window.
+ * @param minimumWindow The minimum window. Must be greater than zero.
+ * @param maximumWindow The maximum window. Must be greater than or equal to @a minimumWindow.
+ */
+- (instancetype) initWithInitialWindow: (NSUInteger) initialWindow minimumWindow: (NSUInteger) minimumWindow maximumWindow: (NSUInteger) maximumWindow {
+    NSAssert(minimumWindow > 0, @"The minimum window must be greater than zero");
+    NSAssert(maximumWindow >= minimumWindow, @"The maximum window must not be less than the minimum window");
+    PLSuperInit();
+
+    _lock = OS_SPINLOCK_INIT;
+    _minimumWindow = minimumWindow;
+    _maximumWindow = maximumWindow;
+    _window = MIN(MAX(initialWindow, minimumWindow), maximumWindow);
+    _statistics.window = [self wholeWindow];
+
+    /* Permit an immediate decrease */
+    _sinceDecrease = [self wholeWindow];
+
+    return self;
+}
+
+/**
+ * @internal
+ *
+ * Return the window as a whole number of requests. Must be called with _lock held.
+ */
+- (NSUInteger) wholeWindow {
+    return (NSUInteger) floor(_window);
+}
+
+/**
+ * @internal
+ *
+ * Multiply the window by @a factor, if a decrease is permitted. Must be called with _lock held.
+ *
+ * @return Returns YES if the window was decreased.
+ */
+- (BOOL) decreaseWindowByFactor: (double) factor {
+    /* Only the first signal from a window's worth of requests is acted upon; the remainder reflect the same congestion */
+    if (_sinceDecrease < [self wholeWindow])
+        return NO;
+
+    _window = MAX(_minimumWindow, _window * factor);
+    _sinceDecrease = 0;
+
+    /* Samples gathered at the previous window no longer reflect current conditions */
+    for (NSUInteger i = 0; i < ANTNetworkConcurrencyLatencyClassCount; i++) {
+        _samples[i].count = 0;
+        _samples[i].index = 0;
+    }
+
+    return YES;
+}
+
+/**
+ * @internal
+ *
+ * Return the @a percentile latency of the sorted @a samples.
+ */
+static NSTimeInterval ANTNetworkConcurrencyPercentile (const NSTimeInterval *samples, NSUInteger count, double percentile) {
+    NSUInteger index = (NSUInteger) ceil(percentile * count);
+    return samples[index > 0 ? index - 1 : 0];
+}
+
+/**
+ * Record the result of a completed request, adjusting the window accordingly.
+ *
+ * @param latency The time taken to complete the request, in seconds.
+ * @param latencyClass The request's latency class. Must be less than ANTNetworkConcurrencyLatencyClassCount.
+ * @param statusCode The HTTP status code of the response, or 0 if no response was received.
+ * @param failed YES if the request failed with a connection error.
+ * @param retryAfter The delay requested by the response's Retry-After header, in seconds, or 0 if none.
+ *
+ * @return Returns the decision made in response to the request.
+ */
+- (ANTNetworkConcurrencyDecision) recordRequestWithLatency: (NSTimeInterval) latency
+                                              latencyClass: (ANTNetworkConcurrencyLatencyClass) latencyClass
+                                                statusCode: (NSInteger) statusCode
+                                                    failed: (BOOL) failed
+                                                retryAfter: (NSTimeInterval) retryAfter
+{
+    NSAssert(latencyClass < ANTNetworkConcurrencyLatencyClassCount, @"Invalid latency class");
+    ANTNetworkConcurrencyDecision decision = ANTNetworkConcurrencyDecisionHold;
+    BOOL serverError = (statusCode >= 500 || statusCode == 429);
+
+    OSSpinLockLock(&_lock); {
+        _statistics.requests++;
+        _sinceDecrease++;
+
+        if (failed || serverError) {
+            _statistics.errors++;
+
+            if ([self decreaseWindowByFactor: ANTNetworkConcurrencyErrorDecrease]) {
+                _statistics.errorDecreases++;
+                decision = ANTNetworkConcurrencyDecisionDecreaseError;
+            }
+
+            if (serverError && retryAfter > 0) {
+                _statistics.backoffs++;
+                decision = ANTNetworkConcurrencyDecisionBackoff;
+            }
+        } else {
+            /* Record the latency sample */
+            ANTNetworkConcurrencySamples *samples = &_samples[latencyClass];
+            ANTNetworkConcurrencySamplesAdd(samples, latency);
+
+            BOOL congested = NO;
+            if (samples->count >= ANTNetworkConcurrencyMinimumSamples) {
+                NSTimeInterval p50 = ANTNetworkConcurrencyPercentile(samples->sorted, samples->count, 0.5);
+                NSTimeInterval p90 = ANTNetworkConcurrencyPercentile(samples->sorted, samples->count, 0.9);
+                NSTimeInterval baseline = _statistics.baselineLatency[latencyClass];
+
+                /* The baseline follows any lower median immediately, and a higher median only slowly */
+                if (baseline == 0 || p50 < baseline)
+                    baseline = p50;
+                else
+                    baseline += (p50 - baseline) * ANTNetworkConcurrencyBaselineDrift;
+
+                _statistics.latencyP50[latencyClass] = p50;
+                _statistics.latencyP90[latencyClass] = p90;
+                _statistics.baselineLatency[latencyClass] = baseline;
+
+                congested = (p90 > baseline * ANTNetworkConcurrencyLatencyTolerance);
+            }
+
+            if (congested) {
+                if ([self decreaseWindowByFactor: ANTNetworkConcurrencyLatencyDecrease]) {
+                    _statistics.latencyDecreases++;
+                    decision = ANTNetworkConcurrencyDecisionDecreaseLatency;
+                }
+            } else if (_window < _maximumWindow) {
+                NSUInteger previous = [self wholeWindow];
+                _window = MIN(_maximumWindow, _window + 1.0 / _window);
+                if ([self wholeWindow] != previous) {
+                    _statistics.increases++;
+                    decision = ANTNetworkConcurrencyDecisionIncrease;
+                }
+            }
+        }
+
+        _statistics.window = [self wholeWindow];
+        if (decision != ANTNetworkConcurrencyDecisionHold)
+            _statistics.lastDecision = decision;
+    } OSSpinLockUnlock(&_lock);
+
+    return decision;
+}
+
+// property getter
+- (NSUInteger) window {
+    NSUInteger window;
+    OSSpinLockLock(&_lock); {
+        window = [self wholeWindow];
+    } OSSpinLockUnlock(&_lock);
+
+    return window;
+}
+
+// property getter
+- (ANTNetworkConcurrencyStatistics) statistics {
+    ANTNetworkConcurrencyStatistics statistics;
+    OSSpinLockLock(&_lock); {
+        statistics = _statistics;
+    } OSSpinLockUnlock(&_lock);
+
+    return statistics;
+}
+
+@end
@@ -0,0 +1,112 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTNetworkConcurrencyController.h"
+
+@interface ANTNetworkConcurrencyControllerTests : XCTestCase @end
+
+@implementation ANTNetworkConcurrencyControllerTests
+
+- (void) testAdditiveIncreaseMultiplicativeDecrease {
+    ANTNetworkConcurrencyController *controller = [[ANTNetworkConcurrencyController alloc] initWithInitialWindow: 2 minimumWindow: 1 maximumWindow: 8];
+    XCTAssertEqual(controller.window, (NSUInteger) 2, @"Incorrect initial window");
+
+    /* Successful requests with stable latency grow the window to its maximum */
+    for (NSUInteger i = 0; i < 100; i++)
+        [controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 200 failed: NO retryAfter: 0];
+    XCTAssertEqual(controller.window, (NSUInteger) 8, @"Window did not grow to its maximum");
+    XCTAssertEqual(controller.statistics.increases, (uint64_t) 6, @"Incorrect increase count");
+    XCTAssertEqualWithAccuracy(controller.statistics.latencyP90[ANTNetworkConcurrencyLatencyClassSmall], 0.1, 0.0001, @"Incorrect latency percentile");
+
+    /* A server error halves the window; further errors from the same window are ignored */
+    XCTAssertEqual([controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 503 failed: NO retryAfter: 0], ANTNetworkConcurrencyDecisionDecreaseError, @"Incorrect decision");
+    XCTAssertEqual(controller.window, (NSUInteger) 4, @"Window was not decreased");
+    XCTAssertEqual([controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 0 failed: YES retryAfter: 0], ANTNetworkConcurrencyDecisionHold, @"Incorrect decision");
+    XCTAssertEqual(controller.window, (NSUInteger) 4, @"Window was decreased twice");
+
+    /* Client errors do not indicate congestion */
+    XCTAssertNotEqual([controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 404 failed: NO retryAfter: 0], ANTNetworkConcurrencyDecisionDecreaseError, @"Client error decreased the window");
+
+    /* Retry-After requests a backoff */
+    for (NSUInteger i = 0; i < 4; i++)
+        [controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 200 failed: NO retryAfter: 0];
+    XCTAssertEqual([controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 429 failed: NO retryAfter: 5], ANTNetworkConcurrencyDecisionBackoff, @"Incorrect decision");
+    XCTAssertEqual(controller.window, (NSUInteger) 2, @"Window was not decreased");
+    XCTAssertEqual(controller.statistics.backoffs, (uint64_t) 1, @"Incorrect backoff count");
+    XCTAssertEqual(controller.statistics.lastDecision, ANTNetworkConcurrencyDecisionBackoff, @"Incorrect last decision");
+
+    /* The window never falls below its minimum */
+    for (NSUInteger i = 0; i < 100; i++)
+        [controller recordRequestWithLatency: 0 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 0 failed: YES retryAfter: 0];
+    XCTAssertEqual(controller.window, (NSUInteger) 1, @"Window fell below its minimum");
+}
+
+- (void) testLatencyDecrease {
+    ANTNetworkConcurrencyController *controller = [[ANTNetworkConcurrencyController alloc] initWithInitialWindow: 4 minimumWindow: 1 maximumWindow: 16];
+
+    /* Establish the baseline latency */
+    for (NSUInteger i = 0; i < 16; i++)
+        [controller recordRequestWithLatency: 0.1 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 200 failed: NO retryAfter: 0];
+    XCTAssertEqualWithAccuracy(controller.statistics.baselineLatency[ANTNetworkConcurrencyLatencyClassSmall], 0.1, 0.0001, @"Incorrect baseline latency");
+
+    /* Once the tail latency exceeds the tolerance, the window is decreased */
+    NSUInteger window = controller.window;
+    ANTNetworkConcurrencyDecision decision = ANTNetworkConcurrencyDecisionHold;
+    for (NSUInteger i = 0; i < 8 && decision != ANTNetworkConcurrencyDecisionDecreaseLatency; i++)
+        decision = [controller recordRequestWithLatency: 1.0 latencyClass: ANTNetworkConcurrencyLatencyClassSmall statusCode: 200 failed: NO retryAfter: 0];
+
+    XCTAssertEqual(decision, ANTNetworkConcurrencyDecisionDecreaseLatency, @"Window was not decreased");
+    XCTAssertTrue(controller.window < window, @"Window was not decreased");
+    XCTAssertEqual(controller.statistics.latencyDecreases, (uint64_t) 1, @"Incorrect decrease count");
+}
+
+- (void) testLatencyClasses {
+    ANTNetworkConcurrencyController *controller = [[ANTNetworkConcurrencyController alloc] initWithInitialWindow: 4 minimumWindow: 1 maximumWindow: 16];
+
+    /* Interleaved cheap and expensive requests are not mistaken for congestion */
+    for (NSUInteger i = 0; i < 100; i++) {
+        [controller recordRequestWithLatency: 0.01 latencyClass: ANTNetworkConcurrencyLatencyClassEmpty statusCode: 304 failed: NO retryAfter: 0];
+        [controller recordRequestWithLatency: 1.0 latencyClass: ANTNetworkConcurrencyLatencyClassLarge statusCode: 200 failed: NO retryAfter: 0];
+    }
+
+    ANTNetworkConcurrencyStatistics statistics = controller.statistics;
+    XCTAssertEqual(statistics.latencyDecreases, (uint64_t) 0, @"Window was decreased");
+    XCTAssertEqual(statistics.window, (NSUInteger) 16, @"Window did not grow to its maximum");
+    XCTAssertEqualWithAccuracy(statistics.baselineLatency[ANTNetworkConcurrencyLatencyClassEmpty], 0.01, 0.0001, @"Incorrect baseline latency");
+    XCTAssertEqualWithAccuracy(statistics.baselineLatency[ANTNetworkConcurrencyLatencyClassLarge], 1.0, 0.0001, @"Incorrect baseline latency");
+    XCTAssertEqual(statistics.latencyP50[ANTNetworkConcurrencyLatencyClassSmall], (NSTimeInterval) 0, @"Unsampled class has a latency");
+
+    /* Congestion within a class is still detected */
+    ANTNetworkConcurrencyDecision decision = ANTNetworkConcurrencyDecisionHold;
+    for (NSUInteger i = 0; i < 16 && decision != ANTNetworkConcurrencyDecisionDecreaseLatency; i++)
+        decision = [controller recordRequestWithLatency: 0.5 latencyClass: ANTNetworkConcurrencyLatencyClassEmpty statusCode: 304 failed: NO retryAfter: 0];
+    XCTAssertEqual(decision, ANTNetworkConcurrencyDecisionDecreaseLatency, @"Window was not decreased");
+}
+
+@end
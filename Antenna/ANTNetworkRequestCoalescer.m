@@ -0,0 +1,241 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTNetworkRequestCoalescer.h"
+
+#import <CommonCrypto/CommonDigest.h>
+#import <libkern/OSAtomic.h>
+
+/**
+ * @internal
+ *
+ * A single caller waiting on an in-flight request. All mutable state is guarded by the owning coalescer's lock.
+ */
+@interface ANTNetworkRequestCoalescerWaiter : NSObject
+
+- (instancetype) initWithTicket: (PLCancelTicket *) ticket context: (id<PLDispatchContext>) context handler: (void (^)(id value, NSError *error)) handler;
+
+/** The caller's cancellation ticket. */
+@property(nonatomic, readonly) PLCancelTicket *ticket;
+
+/** The dispatch context on which the caller's handler will be called. */
+@property(nonatomic, readonly) id<PLDispatchContext> context;
+
+/** The caller's completion handler. */
+@property(nonatomic, readonly) void (^handler)(id value, NSError *error);
+
+/** YES if the caller's ticket has been cancelled. */
+@property(nonatomic) BOOL cancelled;
+
+@end
+
+@implementation ANTNetworkRequestCoalescerWaiter
+
+/**
+ * Initialize a new waiter.
+ *
+ * @param ticket The caller's cancellation ticket.
+ * @param context The dispatch context on which @a handler will be called.
+ * @param handler The caller's completion handler.
+ */
+- (instancetype) initWithTicket: (PLCancelTicket *) ticket context: (id<PLDispatchContext>) context handler: (void (^)(id value, NSError *error)) handler {
+    PLSuperInit();
+
+    _ticket = ticket;
+    _context = context;
+    _handler = [handler copy];
+
+    return self;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * A single in-flight request, shared by all of its waiters. All mutable state is guarded by the owning coalescer's lock.
+ */
+@interface ANTNetworkRequestCoalescerFlight : NSObject
+
+/** The request's priority. */
+@property(nonatomic) ANTNetworkRequestPriority priority;
+
+/** The cancellation source for the underlying request; cancelled once all waiters have cancelled. */
+@property(nonatomic, readonly) PLCancelTicketSource *ticketSource;
+
+/** All waiters, in the order they were added. */
+@property(nonatomic, readonly) NSMutableArray *waiters;
+
+/** The number of waiters that have not been cancelled. */
+@property(nonatomic) NSUInteger activeWaiters;
+
+@end
+
+@implementation ANTNetworkRequestCoalescerFlight
+
+- (instancetype) init {
+    PLSuperInit();
+
+    _ticketSource = [PLCancelTicketSource new];
+    _waiters = [NSMutableArray array];
+
+    return self;
+}
+
+@end
+
+/**
+ * Coalesces identical in-flight requests.
+ *
+ * Requests are identified by a caller-supplied key. While a request is in flight, later requests with an equal key are
+ * attached to it rather than being issued; on completion, the result is delivered to every attached caller via its own
+ * dispatch context, unless that caller's ticket has been cancelled. The underlying request is cancelled only once all
+ * of its callers have cancelled.
+ *
+ * A request is only attached to an in-flight request of the same or higher priority; a higher priority request instead
+ * replaces the in-flight request as the target of later requests, so that an interactive request is never queued behind
+ * a background request.
+ *
+ * Only requests without side effects, eg, GETs and idempotent POSTs, should be coalesced.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used concurrently from any thread.
+ */
+@implementation ANTNetworkRequestCoalescer {
+@private
+    /** Lock that must be held when accessing mutable internal state. */
+    OSSpinLock _lock;
+
+    /** In-flight requests, by key. */
+    NSMutableDictionary *_flights;
+}
+
+/**
+ * Return a request key identifying the request's method, resource path, and body.
+ *
+ * @param method The HTTP request method.
+ * @param path The request's resource path.
+ * @param body The request body, or nil.
+ */
++ (id<NSCopying>) keyWithMethod: (NSString *) method path: (NSString *) path body: (NSData *) body {
+    NSMutableData *hash = [NSMutableData dataWithLength: CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256([body bytes], (CC_LONG) [body length], [hash mutableBytes]);
+
+    return @[[method uppercaseString], path, hash];
+}
+
+- (instancetype) init {
+    PLSuperInit();
+
+    _lock = OS_SPINLOCK_INIT;
+    _flights = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+/**
+ * Perform a request, attaching the caller to an identical in-flight request if one exists.
+ *
+ * @param key The request key, eg, as returned by ANTNetworkRequestCoalescer::keyWithMethod:path:body:.
+ * @param priority The request priority.
+ * @param ticket The caller's cancellation ticket.
+ * @param context The dispatch context on which @a handler will be called.
+ * @param handler The block to be called with the request's result.
+ * @param block The block to be called to issue the request, if no identical request is in flight. The block must call
+ * completion exactly once, from any thread, unless the provided ticket is cancelled.
+ */
+- (void) performRequestWithKey: (id<NSCopying>) key
+                      priority: (ANTNetworkRequestPriority) priority
+                  cancelTicket: (PLCancelTicket *) ticket
+               dispatchContext: (id<PLDispatchContext>) context
+             completionHandler: (void (^)(id value, NSError *error)) handler
+                         block: (void (^)(PLCancelTicket *ticket, void (^completion)(id value, NSError *error))) block
+{
+    if (ticket.isCancelled)
+        return;
+
+    ANTNetworkRequestCoalescerWaiter *waiter = [[ANTNetworkRequestCoalescerWaiter alloc] initWithTicket: ticket context: context handler: handler];
+    ANTNetworkRequestCoalescerFlight *flight;
+    BOOL issue = NO;
+
+    OSSpinLockLock(&_lock); {
+        /* Lower ANTNetworkRequestPriority values are of higher priority */
+        flight = _flights[key];
+        if (flight == nil || flight.priority > priority) {
+            flight = [ANTNetworkRequestCoalescerFlight new];
+            flight.priority = priority;
+            _flights[key] = flight;
+            issue = YES;
+        }
+
+        [flight.waiters addObject: waiter];
+        flight.activeWaiters++;
+    } OSSpinLockUnlock(&_lock);
+
+    /* Cancel the underlying request once its last waiter has cancelled */
+    [ticket addCancelHandler: ^(PLCancelTicketReason reason) {
+        BOOL cancelFlight = NO;
+
+        OSSpinLockLock(&_lock); {
+            if (!waiter.cancelled) {
+                waiter.cancelled = YES;
+                flight.activeWaiters--;
+
+                if (flight.activeWaiters == 0) {
+                    cancelFlight = YES;
+                    if (_flights[key] == flight)
+                        [_flights removeObjectForKey: key];
+                }
+            }
+        } OSSpinLockUnlock(&_lock);
+
+        if (cancelFlight)
+            [flight.ticketSource cancel];
+    } dispatchContext: [PLDirectDispatchContext context]];
+
+    if (!issue)
+        return;
+
+    block(flight.ticketSource.ticket, ^(id value, NSError *error) {
+        NSArray *waiters;
+        OSSpinLockLock(&_lock); {
+            if (_flights[key] == flight)
+                [_flights removeObjectForKey: key];
+
+            waiters = [flight.waiters copy];
+        } OSSpinLockUnlock(&_lock);
+
+        for (ANTNetworkRequestCoalescerWaiter *waiter in waiters) {
+            [waiter.context performWithCancelTicket: waiter.ticket block: ^{
+                waiter.handler(value, error);
+            }];
+        }
+    });
+}
+
+@end
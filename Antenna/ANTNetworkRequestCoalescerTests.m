@@ -0,0 +1,103 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTNetworkRequestCoalescer.h"
+
+@interface ANTNetworkRequestCoalescerTests : XCTestCase @end
+
+@implementation ANTNetworkRequestCoalescerTests
+
+- (void) testCoalescing {
+    ANTNetworkRequestCoalescer *coalescer = [ANTNetworkRequestCoalescer new];
+    NSMutableArray *issued = [NSMutableArray array];
+    NSMutableDictionary *pending = [NSMutableDictionary dictionary];
+    NSMutableDictionary *tickets = [NSMutableDictionary dictionary];
+    NSMutableArray *results = [NSMutableArray array];
+
+    /* Performs a request that records its issue order, and defers completion until explicitly finished */
+    void (^Perform)(NSString *, id<NSCopying>, ANTNetworkRequestPriority, PLCancelTicket *) = ^(NSString *name, id<NSCopying> key, ANTNetworkRequestPriority priority, PLCancelTicket *ticket) {
+        [coalescer performRequestWithKey: key priority: priority cancelTicket: ticket dispatchContext: [PLDirectDispatchContext context] completionHandler: ^(id value, NSError *error) {
+            [results addObject: [NSString stringWithFormat: @"%@=%@", name, value]];
+        } block: ^(PLCancelTicket *requestTicket, void (^completion)(id value, NSError *error)) {
+            [issued addObject: name];
+            pending[name] = [completion copy];
+            tickets[name] = requestTicket;
+        }];
+    };
+
+    /* Completes the named in-flight request */
+    void (^Finish)(NSString *, id) = ^(NSString *name, id value) {
+        void (^completion)(id, NSError *) = pending[name];
+        completion(value, nil);
+    };
+
+    id<NSCopying> key = [ANTNetworkRequestCoalescer keyWithMethod: @"GET" path: @"/openProblem/1" body: nil];
+    id<NSCopying> postKey = [ANTNetworkRequestCoalescer keyWithMethod: @"POST" path: @"/openProblem/1" body: [@"{}" dataUsingEncoding: NSUTF8StringEncoding]];
+    PLCancelTicketSource *source = [PLCancelTicketSource new];
+    PLCancelTicket *ticket = [PLCancelTicketSource new].ticket;
+
+    /* Identical requests share a single request; the method and body distinguish otherwise identical requests */
+    Perform(@"sync", key, ANTNetworkRequestPriorityBackgroundSync, ticket);
+    Perform(@"sync-duplicate", [ANTNetworkRequestCoalescer keyWithMethod: @"get" path: @"/openProblem/1" body: nil], ANTNetworkRequestPriorityBackgroundSync, source.ticket);
+    Perform(@"post", postKey, ANTNetworkRequestPriorityBackgroundSync, ticket);
+    XCTAssertEqualObjects(issued, (@[@"sync", @"post"]), @"Incorrect requests issued");
+
+    /* A higher priority request is never attached to a lower priority request */
+    Perform(@"interactive", key, ANTNetworkRequestPriorityInteractive, ticket);
+    Perform(@"interactive-duplicate", key, ANTNetworkRequestPriorityFolderListing, ticket);
+    XCTAssertEqualObjects([issued lastObject], @"interactive", @"Interactive request was not issued");
+    XCTAssertEqual([issued count], (NSUInteger) 3, @"Lower priority request was not attached");
+
+    /* Results are delivered to all waiters, other than those that have been cancelled */
+    [source cancel];
+    XCTAssertFalse(((PLCancelTicket *) tickets[@"sync"]).isCancelled, @"Request was cancelled while waiters remain");
+    Finish(@"sync", @1);
+    Finish(@"interactive", @2);
+    XCTAssertEqualObjects(results, (@[@"sync=1", @"interactive=2", @"interactive-duplicate=2"]), @"Incorrect results delivered");
+
+    /* A completed request is no longer shared */
+    Perform(@"late", key, ANTNetworkRequestPriorityBackgroundSync, ticket);
+    XCTAssertEqualObjects([issued lastObject], @"late", @"Completed request was reused");
+
+    /* The request is cancelled once all waiters have cancelled */
+    PLCancelTicketSource *first = [PLCancelTicketSource new];
+    PLCancelTicketSource *second = [PLCancelTicketSource new];
+    Perform(@"cancelled", postKey, ANTNetworkRequestPriorityInteractive, first.ticket);
+    Perform(@"cancelled-duplicate", postKey, ANTNetworkRequestPriorityInteractive, second.ticket);
+    [first cancel];
+    XCTAssertFalse(((PLCancelTicket *) tickets[@"cancelled"]).isCancelled, @"Request was cancelled while a waiter remains");
+    [second cancel];
+    XCTAssertTrue(((PLCancelTicket *) tickets[@"cancelled"]).isCancelled, @"Request was not cancelled");
+
+    /* A cancelled request is no longer shared */
+    Perform(@"retry", postKey, ANTNetworkRequestPriorityInteractive, ticket);
+    XCTAssertEqualObjects([issued lastObject], @"retry", @"Cancelled request was reused");
+}
+
+@end
@@ -0,0 +1,68 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <PLFoundation/PLFoundation.h>
+
+/**
+ * Network request priority classes. Queued requests of a higher priority are always issued before those of a lower
+ * priority; requests of equal priority are issued in the order they were scheduled.
+ */
+typedef NS_ENUM(NSUInteger, ANTNetworkRequestPriority) {
+    /** A request issued directly on behalf of the user, eg, opening a single radar. */
+    ANTNetworkRequestPriorityInteractive = 0,
+
+    /** A folder listing request. */
+    ANTNetworkRequestPriorityFolderListing = 1,
+
+    /** A background synchronization request. */
+    ANTNetworkRequestPriorityBackgroundSync = 2
+};
+
+/** The total number of ANTNetworkRequestPriority classes. */
+#define ANTNetworkRequestPriorityCount 3
+
+@interface ANTNetworkRequestScheduler : NSObject
+
+- (instancetype) initWithMaxConcurrentRequestsPerHost: (NSUInteger) maxConcurrentRequestsPerHost;
+
+- (void) scheduleRequestForHost: (NSString *) host
+                       priority: (ANTNetworkRequestPriority) priority
+                   cancelTicket: (PLCancelTicket *) ticket
+                          block: (void (^)(void (^finished)(void))) block;
+
+- (void) pauseForInterval: (NSTimeInterval) interval;
+
+/** The maximum number of requests that will be in flight to any one host. */
+@property(nonatomic, readonly) NSUInteger maxConcurrentRequestsPerHost;
+
+/** The number of requests currently permitted in flight to any one host, between 1 and maxConcurrentRequestsPerHost.
+ * Values outside of this range are clamped. Defaults to maxConcurrentRequestsPerHost. */
+@property(nonatomic) NSUInteger concurrencyLimit;
+
+@end
@@ -0,0 +1,405 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTNetworkRequestScheduler.h"
+
+#import <libkern/OSAtomic.h>
+
+/**
+ * @internal
+ *
+ * Scheduled request states.
+ */
+typedef NS_ENUM(NSUInteger, ANTNetworkRequestState) {
+    /** The request is waiting for an available slot. */
+    ANTNetworkRequestStateQueued = 0,
+
+    /** The request has been issued, and is in flight. */
+    ANTNetworkRequestStateRunning = 1,
+
+    /** The request has completed, or was cancelled. */
+    ANTNetworkRequestStateFinished = 2
+};
+
+/**
+ * @internal
+ *
+ * A single scheduled request. All mutable state is guarded by the owning scheduler's lock.
+ */
+@interface ANTNetworkRequestSchedulerEntry : NSObject
+
+- (instancetype) initWithTicket: (PLCancelTicket *) ticket block: (void (^)(void (^finished)(void))) block;
+
+/** The request's cancellation ticket. Held weakly; the ticket's cancellation handler retains the entry. */
+@property(nonatomic, readonly, weak) PLCancelTicket *ticket;
+
+/** The request block, or nil if the request has been issued or cancelled. */
+@property(nonatomic, copy) void (^block)(void (^finished)(void));
+
+/** The request's current state. */
+@property(nonatomic) ANTNetworkRequestState state;
+
+@end
+
+@implementation ANTNetworkRequestSchedulerEntry
+
+/**
+ * Initialize a new queued entry.
+ *
+ * @param ticket The request's cancellation ticket.
+ * @param block The block to be executed when the request is issued.
+ */
+- (instancetype) initWithTicket: (PLCancelTicket *) ticket block: (void (^)(void (^finished)(void))) block {
+    PLSuperInit();
+
+    _ticket = ticket;
+    _block = [block copy];
+    _state = ANTNetworkRequestStateQueued;
+
+    return self;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * Per-host scheduling state. All mutable state is guarded by the owning scheduler's lock.
+ */
+@interface ANTNetworkRequestSchedulerHost : NSObject
+
+- (ANTNetworkRequestSchedulerEntry *) dequeueEntry;
+- (void) compactQueues;
+
+/** The per-priority FIFO request queues, indexed by ANTNetworkRequestPriority. */
+@property(nonatomic, readonly) NSArray *queues;
+
+/** The number of requests currently in flight. */
+@property(nonatomic) NSUInteger inFlight;
+
+/** The number of queued entries that have been cancelled, but not yet removed from their queue. */
+@property(nonatomic) NSUInteger cancelled;
+
+/** The total number of entries held by the queues, including cancelled entries. */
+@property(nonatomic) NSUInteger queued;
+
+@end
+
+@implementation ANTNetworkRequestSchedulerHost
+
+- (instancetype) init {
+    PLSuperInit();
+
+    NSMutableArray *queues = [NSMutableArray arrayWithCapacity: ANTNetworkRequestPriorityCount];
+    for (NSUInteger i = 0; i < ANTNetworkRequestPriorityCount; i++)
+        [queues addObject: [NSMutableArray array]];
+    _queues = queues;
+
+    return self;
+}
+
+/**
+ * Remove and return the highest priority runnable entry, discarding any cancelled entries encountered
+ * along the way. Returns nil if no runnable entries remain.
+ */
+- (ANTNetworkRequestSchedulerEntry *) dequeueEntry {
+    for (NSMutableArray *queue in _queues) {
+        while ([queue count] > 0) {
+            ANTNetworkRequestSchedulerEntry *entry = queue[0];
+            [queue removeObjectAtIndex: 0];
+            _queued--;
+
+            if (entry.state == ANTNetworkRequestStateQueued) {
+                /* The ticket may have been cancelled before our cancellation handler was registered */
+                if (!entry.ticket.isCancelled)
+                    return entry;
+
+                entry.state = ANTNetworkRequestStateFinished;
+                entry.block = nil;
+                continue;
+            }
+
+            NSAssert(entry.state == ANTNetworkRequestStateFinished, @"Running request found in the queue");
+            _cancelled--;
+        }
+    }
+
+    return nil;
+}
+
+/**
+ * Remove all cancelled entries from the queues.
+ */
+- (void) compactQueues {
+    NSIndexSet *(^cancelledEntries)(NSArray *) = ^(NSArray *queue) {
+        return [queue indexesOfObjectsPassingTest: ^BOOL (ANTNetworkRequestSchedulerEntry *entry, NSUInteger idx, BOOL *stop) {
+            return entry.state == ANTNetworkRequestStateFinished;
+        }];
+    };
+
+    for (NSMutableArray *queue in _queues)
+        [queue removeObjectsAtIndexes: cancelledEntries(queue)];
+
+    _queued -= _cancelled;
+    _cancelled = 0;
+}
+
+@end
+
+/**
+ * Schedules network requests, bounding the number of requests in flight to any one host.
+ *
+ * Requests that can not be issued immediately are queued by priority; when a slot becomes available, the oldest
+ * request of the highest available priority is issued. A queued request that is cancelled via its PLCancelTicket
+ * is discarded without being issued.
+ *
+ * The per-host limit may be lowered below its configured maximum at any time via the concurrencyLimit property, and
+ * the issuing of new requests may be temporarily suspended via pauseForInterval:.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used concurrently from any thread.
+ */
+@implementation ANTNetworkRequestScheduler {
+@private
+    /** Lock that must be held when accessing mutable internal state. */
+    OSSpinLock _lock;
+
+    /** Per-host scheduling state, keyed by the lowercased host name. */
+    NSMutableDictionary *_hosts;
+
+    /** The current per-host in-flight limit; at most _maxConcurrentRequestsPerHost. */
+    NSUInteger _concurrencyLimit;
+
+    /** The system uptime before which no new requests will be issued, or 0. */
+    NSTimeInterval _resumeTime;
+}
+
+/**
+ * Initialize a new scheduler.
+ *
+ * @param maxConcurrentRequestsPerHost The maximum number of requests that will be in flight to any one host. Must
+ * be greater than zero.
+ */
+- (instancetype) initWithMaxConcurrentRequestsPerHost: (NSUInteger) maxConcurrentRequestsPerHost {
+    NSAssert(maxConcurrentRequestsPerHost > 0, @"The per-host request limit must be greater than zero");
+    PLSuperInit();
+
+    _maxConcurrentRequestsPerHost = maxConcurrentRequestsPerHost;
+    _concurrencyLimit = maxConcurrentRequestsPerHost;
+    _lock = OS_SPINLOCK_INIT;
+    _hosts = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+/**
+ * Schedule a request to @a host. The request @a block will be executed once a slot is available for @a host,
+ * and must call the provided @a finished block exactly once when the request has completed; the slot will
+ * then be made available to the next queued request.
+ *
+ * If @a ticket is cancelled before the request is issued, @a block will never be executed. If @a ticket is cancelled
+ * after the request was issued, the request's slot is released immediately, and any later call to @a finished is ignored.
+ *
+ * @param host The host to which the request will be issued.
+ * @param priority The request's priority.
+ * @param ticket A request cancellation ticket.
+ * @param block The block responsible for issuing the request. The block may be executed on any thread, including the
+ * caller's.
+ */
+- (void) scheduleRequestForHost: (NSString *) host
+                       priority: (ANTNetworkRequestPriority) priority
+                   cancelTicket: (PLCancelTicket *) ticket
+                          block: (void (^)(void (^finished)(void))) block
+{
+    NSAssert(priority < ANTNetworkRequestPriorityCount, @"Invalid request priority %lu", (unsigned long) priority);
+
+    if (ticket.isCancelled)
+        return;
+
+    NSString *hostKey = host != nil ? [host lowercaseString] : @"";
+    ANTNetworkRequestSchedulerEntry *entry = [[ANTNetworkRequestSchedulerEntry alloc] initWithTicket: ticket block: block];
+    ANTNetworkRequestSchedulerHost *hostState;
+
+    OSSpinLockLock(&_lock); {
+        if ((hostState = _hosts[hostKey]) == nil) {
+            hostState = [ANTNetworkRequestSchedulerHost new];
+            _hosts[hostKey] = hostState;
+        }
+
+        [hostState.queues[priority] addObject: entry];
+        hostState.queued++;
+    } OSSpinLockUnlock(&_lock);
+
+    /* Discard the request (or release its slot) on cancellation */
+    [ticket addCancelHandler: ^(PLCancelTicketReason reason) {
+        [self finishEntry: entry host: hostState];
+    } dispatchContext: [PLDirectDispatchContext context]];
+
+    [self issueRequestsForHost: hostState];
+}
+
+/**
+ * @internal
+ *
+ * Mark @a entry as finished, releasing its slot if it was in flight, or discarding it if it was still queued. This
+ * method is idempotent.
+ *
+ * @param entry The entry to be finished.
+ * @param hostState The host state to which @a entry belongs.
+ */
+- (void) finishEntry: (ANTNetworkRequestSchedulerEntry *) entry host: (ANTNetworkRequestSchedulerHost *) hostState {
+    BOOL released = NO;
+
+    OSSpinLockLock(&_lock); {
+        switch (entry.state) {
+            case ANTNetworkRequestStateQueued:
+                /* Leave the entry in place; it will be discarded when dequeued, or when enough cancelled entries
+                 * accumulate to warrant compacting the queues. */
+                entry.state = ANTNetworkRequestStateFinished;
+                entry.block = nil;
+                hostState.cancelled++;
+                if (hostState.cancelled > hostState.queued / 2)
+                    [hostState compactQueues];
+                break;
+
+            case ANTNetworkRequestStateRunning:
+                entry.state = ANTNetworkRequestStateFinished;
+                hostState.inFlight--;
+                released = YES;
+                break;
+
+            case ANTNetworkRequestStateFinished:
+                break;
+        }
+    } OSSpinLockUnlock(&_lock);
+
+    if (released)
+        [self issueRequestsForHost: hostState];
+}
+
+/**
+ * @internal
+ *
+ * Issue queued requests for @a hostState until its in-flight limit is reached, or its queues are empty.
+ */
+- (void) issueRequestsForHost: (ANTNetworkRequestSchedulerHost *) hostState {
+    NSMutableArray *entries = nil;
+    NSMutableArray *blocks = nil;
+
+    OSSpinLockLock(&_lock); {
+        BOOL paused = (_resumeTime > [[NSProcessInfo processInfo] systemUptime]);
+        while (!paused && hostState.inFlight < _concurrencyLimit) {
+            ANTNetworkRequestSchedulerEntry *entry = [hostState dequeueEntry];
+            if (entry == nil)
+                break;
+
+            if (entries == nil) {
+                entries = [NSMutableArray array];
+                blocks = [NSMutableArray array];
+            }
+
+            [entries addObject: entry];
+            [blocks addObject: entry.block];
+
+            entry.state = ANTNetworkRequestStateRunning;
+            entry.block = nil;
+            hostState.inFlight++;
+        }
+    } OSSpinLockUnlock(&_lock);
+
+    /* We can't call out to the request blocks with our lock held */
+    for (NSUInteger i = 0; i < [entries count]; i++) {
+        ANTNetworkRequestSchedulerEntry *entry = entries[i];
+        void (^block)(void (^)(void)) = blocks[i];
+
+        block(^{
+            [self finishEntry: entry host: hostState];
+        });
+    }
+}
+
+/**
+ * @internal
+ *
+ * Issue queued requests for all hosts, up to their in-flight limit.
+ */
+- (void) issueRequestsForAllHosts {
+    NSArray *hosts;
+    OSSpinLockLock(&_lock); {
+        hosts = [_hosts allValues];
+    } OSSpinLockUnlock(&_lock);
+
+    for (ANTNetworkRequestSchedulerHost *hostState in hosts)
+        [self issueRequestsForHost: hostState];
+}
+
+/**
+ * Defer issuing any new requests for @a interval. Requests already in flight are unaffected. If requests are already
+ * paused, the pause is extended if it would otherwise end before @a interval has elapsed.
+ *
+ * @param interval The time for which no new requests will be issued, in seconds.
+ */
+- (void) pauseForInterval: (NSTimeInterval) interval {
+    if (interval <= 0)
+        return;
+
+    OSSpinLockLock(&_lock); {
+        _resumeTime = MAX(_resumeTime, [[NSProcessInfo processInfo] systemUptime] + interval);
+    } OSSpinLockUnlock(&_lock);
+
+    /* If the pause was since extended, a later resumption will issue any queued requests */
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (interval * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [self issueRequestsForAllHosts];
+    });
+}
+
+// property getter
+- (NSUInteger) concurrencyLimit {
+    NSUInteger limit;
+    OSSpinLockLock(&_lock); {
+        limit = _concurrencyLimit;
+    } OSSpinLockUnlock(&_lock);
+
+    return limit;
+}
+
+// property setter
+- (void) setConcurrencyLimit: (NSUInteger) concurrencyLimit {
+    BOOL increased;
+    OSSpinLockLock(&_lock); {
+        concurrencyLimit = MIN(MAX(concurrencyLimit, (NSUInteger) 1), _maxConcurrentRequestsPerHost);
+        increased = (concurrencyLimit > _concurrencyLimit);
+        _concurrencyLimit = concurrencyLimit;
+    } OSSpinLockUnlock(&_lock);
+
+    /* A decreased limit takes effect as in-flight requests complete */
+    if (increased)
+        [self issueRequestsForAllHosts];
+}
+
+@end
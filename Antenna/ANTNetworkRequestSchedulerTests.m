@@ -0,0 +1,132 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTNetworkRequestScheduler.h"
+
+@interface ANTNetworkRequestSchedulerTests : XCTestCase @end
+
+@implementation ANTNetworkRequestSchedulerTests
+
+- (void) testLimitPriorityAndCancellation {
+    ANTNetworkRequestScheduler *scheduler = [[ANTNetworkRequestScheduler alloc] initWithMaxConcurrentRequestsPerHost: 2];
+    NSMutableArray *issued = [NSMutableArray array];
+    NSMutableDictionary *pending = [NSMutableDictionary dictionary];
+
+    /* Schedules a request that records its issue order, and defers completion until explicitly finished */
+    void (^Schedule)(NSString *, NSString *, ANTNetworkRequestPriority, PLCancelTicket *) = ^(NSString *name, NSString *host, ANTNetworkRequestPriority priority, PLCancelTicket *ticket) {
+        [scheduler scheduleRequestForHost: host priority: priority cancelTicket: ticket block: ^(void (^finished)(void)) {
+            [issued addObject: name];
+            pending[name] = [finished copy];
+        }];
+    };
+
+    /* Completes the named in-flight request */
+    void (^Finish)(NSString *) = ^(NSString *name) {
+        void (^finished)(void) = pending[name];
+        finished();
+    };
+
+    PLCancelTicketSource *source = [PLCancelTicketSource new];
+    PLCancelTicketSource *liveSource = [PLCancelTicketSource new];
+    PLCancelTicket *ticket = liveSource.ticket;
+
+    Schedule(@"sync-1", @"bugreport.apple.com", ANTNetworkRequestPriorityBackgroundSync, ticket);
+    Schedule(@"sync-2", @"bugreport.apple.com", ANTNetworkRequestPriorityBackgroundSync, ticket);
+    Schedule(@"sync-3", @"bugreport.apple.com", ANTNetworkRequestPriorityBackgroundSync, ticket);
+    Schedule(@"cancelled", @"bugreport.apple.com", ANTNetworkRequestPriorityInteractive, source.ticket);
+    Schedule(@"folder", @"BUGREPORT.apple.com", ANTNetworkRequestPriorityFolderListing, ticket);
+    Schedule(@"interactive", @"bugreport.apple.com", ANTNetworkRequestPriorityInteractive, ticket);
+    Schedule(@"other-host", @"example.org", ANTNetworkRequestPriorityBackgroundSync, ticket);
+
+    /* Only two requests may be in flight per host; the limit is tracked independently for each host */
+    XCTAssertEqualObjects(issued, (@[@"sync-1", @"sync-2", @"other-host"]), @"Incorrect requests issued");
+
+    /* A cancelled request must never be issued */
+    [source cancel];
+
+    /* Queued requests are issued by priority, and then in FIFO order */
+    Finish(@"sync-1");
+    XCTAssertEqualObjects([issued lastObject], @"interactive", @"Interactive request did not jump the queue");
+    Finish(@"sync-2");
+    XCTAssertEqualObjects([issued lastObject], @"folder", @"Folder listing was not issued before background sync");
+    Finish(@"interactive");
+    XCTAssertEqualObjects([issued lastObject], @"sync-3", @"Background sync was not issued");
+    XCTAssertFalse([issued containsObject: @"cancelled"], @"Cancelled request was issued");
+
+    /* Finishing is idempotent; a second call must not free an additional slot */
+    Finish(@"folder");
+    Finish(@"folder");
+    Schedule(@"late-1", @"bugreport.apple.com", ANTNetworkRequestPriorityBackgroundSync, ticket);
+    Schedule(@"late-2", @"bugreport.apple.com", ANTNetworkRequestPriorityBackgroundSync, ticket);
+    XCTAssertEqualObjects([issued lastObject], @"late-1", @"Limit was exceeded after a duplicate finish");
+}
+
+- (void) testConcurrencyLimitAndPause {
+    ANTNetworkRequestScheduler *scheduler = [[ANTNetworkRequestScheduler alloc] initWithMaxConcurrentRequestsPerHost: 4];
+    PLCancelTicket *ticket = [PLCancelTicketSource new].ticket;
+    NSMutableArray *issued = [NSMutableArray array];
+    dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+
+    /* Schedules a request that is never finished */
+    void (^Schedule)(NSString *) = ^(NSString *name) {
+        [scheduler scheduleRequestForHost: @"bugreport.apple.com" priority: ANTNetworkRequestPriorityBackgroundSync cancelTicket: ticket block: ^(void (^finished)(void)) {
+            @synchronized (issued) {
+                [issued addObject: name];
+            }
+            dispatch_semaphore_signal(sem);
+        }];
+    };
+
+    /* The limit is clamped to the configured maximum */
+    scheduler.concurrencyLimit = 1;
+    Schedule(@"first");
+    Schedule(@"second");
+    XCTAssertEqualObjects(issued, (@[@"first"]), @"Limit was exceeded");
+
+    scheduler.concurrencyLimit = 100;
+    XCTAssertEqual(scheduler.concurrencyLimit, (NSUInteger) 4, @"Limit was not clamped");
+    XCTAssertEqualObjects(issued, (@[@"first", @"second"]), @"Queued request was not issued when the limit was raised");
+
+    /* Queued requests are issued once the pause has elapsed */
+    [scheduler pauseForInterval: 0.05];
+    Schedule(@"paused");
+    @synchronized (issued) {
+        XCTAssertEqual([issued count], (NSUInteger) 2, @"Request was issued while paused");
+    }
+
+    /* Consume the signals of the two requests issued above */
+    for (NSUInteger i = 0; i < 2; i++)
+        dispatch_semaphore_wait(sem, DISPATCH_TIME_NOW);
+    XCTAssertEqual(dispatch_semaphore_wait(sem, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0L, @"Request was not issued after the pause");
+    @synchronized (issued) {
+        XCTAssertEqualObjects([issued lastObject], @"paused", @"Incorrect request issued");
+    }
+}
+
+@end
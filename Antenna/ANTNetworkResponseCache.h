@@ -0,0 +1,74 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface ANTNetworkResponseCacheEntry : NSObject <NSSecureCoding>
+
++ (NSData *) contentHashForData: (NSData *) data;
+
+- (instancetype) initWithEntityTag: (NSString *) entityTag
+                      lastModified: (NSString *) lastModified
+                       contentHash: (NSData *) contentHash
+                            object: (id<NSSecureCoding>) object;
+
+/** The response's ETag validator, or nil if none was provided. */
+@property(nonatomic, readonly) NSString *entityTag;
+
+/** The response's Last-Modified validator, or nil if none was provided. */
+@property(nonatomic, readonly) NSString *lastModified;
+
+/** The SHA-256 hash of the response body. */
+@property(nonatomic, readonly) NSData *contentHash;
+
+/** The object decoded from the response body. */
+@property(nonatomic, readonly) id object;
+
+@end
+
+@interface ANTNetworkResponseCache : NSObject
+
+- (instancetype) initWithPath: (NSString *) path objectClasses: (NSSet *) objectClasses error: (NSError **) outError;
+- (instancetype) initWithPath: (NSString *) path
+                objectClasses: (NSSet *) objectClasses
+                diskSizeLimit: (uint64_t) diskSizeLimit
+                        error: (NSError **) outError;
+
+- (ANTNetworkResponseCacheEntry *) entryForResourcePath: (NSString *) resourcePath;
+- (void) fetchEntryForResourcePath: (NSString *) resourcePath completionHandler: (void (^)(ANTNetworkResponseCacheEntry *entry)) handler;
+- (void) setEntry: (ANTNetworkResponseCacheEntry *) entry forResourcePath: (NSString *) resourcePath;
+- (void) removeEntryForResourcePath: (NSString *) resourcePath;
+- (void) flush;
+
+/** The cache directory. */
+@property(nonatomic, readonly) NSString *path;
+
+/** The maximum total size of the on-disk entries, in bytes. */
+@property(nonatomic, readonly) uint64_t diskSizeLimit;
+
+@end
@@ -0,0 +1,506 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTNetworkResponseCache.h"
+
+#import <CommonCrypto/CommonDigest.h>
+#import <errno.h>
+#import <libkern/OSAtomic.h>
+#import <sys/stat.h>
+#import <sys/time.h>
+#import <unistd.h>
+#import <PLFoundation/PLFoundation.h>
+
+#import "ANTErrorDomain.h"
+
+/** The maximum number of entries retained in memory. */
+static const NSUInteger ANTNetworkResponseCacheMemoryCountLimit = 256;
+
+/** The default maximum total size of the on-disk entries, in bytes. */
+static const uint64_t ANTNetworkResponseCacheDefaultDiskSizeLimit = 32 * 1024 * 1024;
+
+/** The number of update generations tracked, each shared by the resource paths that hash to it. A read is only
+ * discarded as stale if an update to a path sharing its generation intervened. */
+#define ANT_RESPONSE_CACHE_GENERATION_COUNT 1024
+
+/**
+ * A cached response, consisting of the response's validators, a hash of the response body, and the object that was
+ * decoded from the body.
+ */
+@implementation ANTNetworkResponseCacheEntry
+
+/**
+ * Return the SHA-256 hash of @a data.
+ *
+ * @param data The data to be hashed.
+ */
++ (NSData *) contentHashForData: (NSData *) data {
+    CC_SHA256_CTX ctx;
+    CC_SHA256_Init(&ctx);
+
+    [data enumerateByteRangesUsingBlock: ^(const void *bytes, NSRange byteRange, BOOL *stop) {
+        CC_SHA256_Update(&ctx, bytes, (CC_LONG) byteRange.length);
+    }];
+
+    NSMutableData *hash = [NSMutableData dataWithLength: CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final([hash mutableBytes], &ctx);
+    return hash;
+}
+
+/**
+ * Initialize a new entry.
+ *
+ * @param entityTag The response's ETag validator, or nil.
+ * @param lastModified The response's Last-Modified validator, or nil.
+ * @param contentHash The hash of the response body, as returned by ANTNetworkResponseCacheEntry::contentHashForData:.
+ * @param object The object decoded from the response body.
+ */
+- (instancetype) initWithEntityTag: (NSString *) entityTag
+                      lastModified: (NSString *) lastModified
+                       contentHash: (NSData *) contentHash
+                            object: (id<NSSecureCoding>) object
+{
+    PLSuperInit();
+
+    _entityTag = entityTag;
+    _lastModified = lastModified;
+    _contentHash = contentHash;
+    _object = object;
+
+    return self;
+}
+
+// from NSSecureCoding protocol
++ (BOOL) supportsSecureCoding {
+    return YES;
+}
+
+// from NSCoding protocol
+- (instancetype) initWithCoder: (NSCoder *) coder {
+    PLSuperInit();
+
+    _entityTag = [coder decodeObjectOfClass: [NSString class] forKey: @"entityTag"];
+    _lastModified = [coder decodeObjectOfClass: [NSString class] forKey: @"lastModified"];
+    _contentHash = [coder decodeObjectOfClass: [NSData class] forKey: @"contentHash"];
+    _object = [coder decodeObjectOfClasses: [coder allowedClasses] forKey: @"object"];
+
+    if ([_contentHash length] != CC_SHA256_DIGEST_LENGTH || _object == nil)
+        return nil;
+
+    return self;
+}
+
+// from NSCoding protocol
+- (void) encodeWithCoder: (NSCoder *) coder {
+    [coder encodeObject: _entityTag forKey: @"entityTag"];
+    [coder encodeObject: _lastModified forKey: @"lastModified"];
+    [coder encodeObject: _contentHash forKey: @"contentHash"];
+    [coder encodeObject: _object forKey: @"object"];
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * Return the index in an ANTNetworkResponseCache's update generations of @a resourcePath.
+ */
+static inline NSUInteger ANTNetworkResponseCacheGenerationIndex (NSString *resourcePath) {
+    return [resourcePath hash] % ANT_RESPONSE_CACHE_GENERATION_COUNT;
+}
+
+/**
+ * An on-disk cache of decoded HTTP responses, keyed by resource path, used to issue conditional requests and to
+ * avoid re-decoding unchanged responses.
+ *
+ * Each entry is stored as a keyed archive in its own file, named by the SHA-256 hash of the entry's resource path.
+ * Recently used entries are also retained in memory. Files are written on a serial queue; lookups never wait on that
+ * queue, and instead consult the entries still waiting to be written. Once the files exceed the disk size limit, the
+ * least recently used (by last read or write) are evicted until the cache is at three quarters of its limit.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used concurrently from any thread.
+ */
+@implementation ANTNetworkResponseCache {
+@private
+    /** Serial queue on which all file writes and removals are performed. */
+    dispatch_queue_t _queue;
+
+    /** Recently used entries, keyed by resource path. */
+    NSCache *_entries;
+
+    /** The classes that may be decoded from an on-disk entry. */
+    NSSet *_allowedClasses;
+
+    /** Lock that must be held when accessing _pending, _generation, or _generations. */
+    OSSpinLock _lock;
+
+    /** Entries (or NSNull, for removals) that have not yet been written to disk, keyed by resource path. */
+    NSMutableDictionary *_pending;
+
+    /** Incremented on every update. */
+    uint64_t _generation;
+
+    /** The _generation of the most recent update to any resource path hashing to each index (see
+     * ANTNetworkResponseCacheGenerationIndex()). An entry read from disk is only retained in memory, and its file only
+     * touched or removed, if no update to its path intervened. */
+    uint64_t _generations[ANT_RESPONSE_CACHE_GENERATION_COUNT];
+
+    /** The total size of the on-disk entries; accessed only from _queue. */
+    uint64_t _diskSize;
+}
+
+/**
+ * Initialize a new cache with the default disk size limit. The cache directory will be created if necessary.
+ *
+ * @param path The cache directory.
+ * @param objectClasses The classes of the objects that will be stored in the cache, including those of any objects that
+ * they contain.
+ * @param outError If an error occurs and this pointer is non-NULL, an error will be returned via this pointer.
+ */
+- (instancetype) initWithPath: (NSString *) path objectClasses: (NSSet *) objectClasses error: (NSError **) outError {
+    return [self initWithPath: path objectClasses: objectClasses diskSizeLimit: ANTNetworkResponseCacheDefaultDiskSizeLimit error: outError];
+}
+
+/**
+ * Initialize a new cache. The cache directory will be created if necessary, and any existing entries will be evicted
+ * as necessary to respect @a diskSizeLimit.
+ *
+ * @param path The cache directory.
+ * @param objectClasses The classes of the objects that will be stored in the cache, including those of any objects that
+ * they contain.
+ * @param diskSizeLimit The maximum total size of the on-disk entries, in bytes.
+ * @param outError If an error occurs and this pointer is non-NULL, an error will be returned via this pointer.
+ */
+- (instancetype) initWithPath: (NSString *) path
+                objectClasses: (NSSet *) objectClasses
+                diskSizeLimit: (uint64_t) diskSizeLimit
+                        error: (NSError **) outError
+{
+    PLSuperInit();
+    NSError *error;
+
+    _path = path;
+    _diskSizeLimit = diskSizeLimit;
+
+    /* Set up the destination directory */
+    NSFileManager *fm = [NSFileManager new];
+    if (![fm createDirectoryAtPath: path withIntermediateDirectories: YES attributes: @{NSFilePosixPermissions: @(0750)} error: &error]) {
+        NSLog(@"Failed to create response cache path %@", path);
+        if (outError != NULL) {
+            *outError = [NSError pl_errorWithDomain: ANTErrorDomain
+                                               code: ANTErrorStorageFailure
+                               localizedDescription: [error localizedDescription]
+                             localizedFailureReason: [error localizedFailureReason]
+                                    underlyingError: error
+                                           userInfo: nil];
+        }
+        return nil;
+    }
+
+    _queue = dispatch_queue_create("coop.plausible.antenna.network-response-cache", DISPATCH_QUEUE_SERIAL);
+    _entries = [NSCache new];
+    [_entries setCountLimit: ANTNetworkResponseCacheMemoryCountLimit];
+    _allowedClasses = [objectClasses setByAddingObject: [ANTNetworkResponseCacheEntry class]];
+    _lock = OS_SPINLOCK_INIT;
+    _pending = [NSMutableDictionary dictionary];
+
+    /* Measure (and if necessary, trim) the existing entries */
+    dispatch_async(_queue, ^{
+        [self trimToSizeLimit];
+    });
+
+    return self;
+}
+
+/**
+ * @internal
+ *
+ * Return the path of the file backing the entry for @a resourcePath.
+ */
+- (NSString *) filePathForResourcePath: (NSString *) resourcePath {
+    NSData *hash = [ANTNetworkResponseCacheEntry contentHashForData: [resourcePath dataUsingEncoding: NSUTF8StringEncoding]];
+    const uint8_t *bytes = [hash bytes];
+
+    NSMutableString *name = [NSMutableString stringWithCapacity: [hash length] * 2];
+    for (NSUInteger i = 0; i < [hash length]; i++)
+        [name appendFormat: @"%02x", bytes[i]];
+
+    return [_path stringByAppendingPathComponent: name];
+}
+
+/**
+ * @internal
+ *
+ * Decode an on-disk entry, returning nil if @a data is not a valid entry.
+ */
+- (ANTNetworkResponseCacheEntry *) entryWithData: (NSData *) data {
+    /* NSKeyedUnarchiver reports malformed archives by raising an exception */
+    @try {
+        NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData: data];
+        [unarchiver setRequiresSecureCoding: YES];
+
+        id entry = [unarchiver decodeObjectOfClasses: _allowedClasses forKey: NSKeyedArchiveRootObjectKey];
+        [unarchiver finishDecoding];
+
+        if (![entry isKindOfClass: [ANTNetworkResponseCacheEntry class]])
+            return nil;
+
+        return entry;
+    } @catch (NSException *exception) {
+        return nil;
+    }
+}
+
+/**
+ * Return the cached entry for @a resourcePath, or nil if none is available. If the entry is not held in memory, it is
+ * read from disk on the calling thread; prefer fetchEntryForResourcePath:completionHandler: on latency-sensitive threads.
+ *
+ * @param resourcePath The resource path of the cached response.
+ */
+- (ANTNetworkResponseCacheEntry *) entryForResourcePath: (NSString *) resourcePath {
+    /* Entries that have not yet been written supersede the file on disk */
+    NSUInteger generationIndex = ANTNetworkResponseCacheGenerationIndex(resourcePath);
+    uint64_t generation;
+    OSSpinLockLock(&_lock); {
+        id pending = _pending[resourcePath];
+        generation = _generations[generationIndex];
+
+        if (pending != nil) {
+            OSSpinLockUnlock(&_lock);
+            return pending != [NSNull null] ? pending : nil;
+        }
+    } OSSpinLockUnlock(&_lock);
+
+    ANTNetworkResponseCacheEntry *entry = [_entries objectForKey: resourcePath];
+    if (entry != nil)
+        return entry;
+
+    NSString *filePath = [self filePathForResourcePath: resourcePath];
+    NSData *data = [NSData dataWithContentsOfFile: filePath options: NSDataReadingMappedIfSafe error: NULL];
+    if (data == nil)
+        return nil;
+
+    /* File updates are performed on the queue; only touch or discard the file if it has not since been replaced */
+    entry = [self entryWithData: data];
+    dispatch_async(_queue, ^{
+        if (![self isCurrentGeneration: generation index: generationIndex])
+            return;
+
+        if (entry == nil) {
+            NSLog(@"Discarding invalid cache entry for %@", resourcePath);
+            [self unlinkFileAtPath: filePath];
+        } else {
+            /* Record the access, for eviction */
+            utimes([filePath fileSystemRepresentation], NULL);
+        }
+    });
+
+    if (entry == nil)
+        return nil;
+
+    /* Retain the entry in memory, unless it was superseded while being read */
+    OSSpinLockLock(&_lock); {
+        if (generation == _generations[generationIndex])
+            [_entries setObject: entry forKey: resourcePath];
+    } OSSpinLockUnlock(&_lock);
+
+    return entry;
+}
+
+/**
+ * Fetch the cached entry for @a resourcePath, reading it from disk in the background if it is not held in memory.
+ *
+ * @param resourcePath The resource path of the cached response.
+ * @param handler The block to be called with the entry, or nil if none is available. If the entry is held in memory, the
+ * block is called immediately on the calling thread; otherwise, it is called on an unspecified background thread.
+ */
+- (void) fetchEntryForResourcePath: (NSString *) resourcePath completionHandler: (void (^)(ANTNetworkResponseCacheEntry *entry)) handler {
+    BOOL resident;
+    OSSpinLockLock(&_lock); {
+        resident = (_pending[resourcePath] != nil);
+    } OSSpinLockUnlock(&_lock);
+
+    if (resident || [_entries objectForKey: resourcePath] != nil) {
+        handler([self entryForResourcePath: resourcePath]);
+        return;
+    }
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        handler([self entryForResourcePath: resourcePath]);
+    });
+}
+
+/**
+ * Store @a entry for @a resourcePath, replacing any existing entry. The entry is immediately available to
+ * entryForResourcePath:, and is written to disk asynchronously.
+ *
+ * @param entry The entry to be stored.
+ * @param resourcePath The resource path of the cached response.
+ */
+- (void) setEntry: (ANTNetworkResponseCacheEntry *) entry forResourcePath: (NSString *) resourcePath {
+    [self updateEntry: entry forResourcePath: resourcePath];
+}
+
+/**
+ * Remove any cached entry for @a resourcePath.
+ *
+ * @param resourcePath The resource path of the cached response.
+ */
+- (void) removeEntryForResourcePath: (NSString *) resourcePath {
+    [self updateEntry: nil forResourcePath: resourcePath];
+}
+
+/**
+ * Block until all pending writes and removals have been applied to disk.
+ */
+- (void) flush {
+    dispatch_sync(_queue, ^{});
+}
+
+/**
+ * @internal
+ *
+ * Store or remove the entry for @a resourcePath. The update is visible to lookups immediately, and is applied to disk
+ * asynchronously.
+ *
+ * @param entry The entry to be stored, or nil to remove the entry.
+ * @param resourcePath The resource path of the cached response.
+ */
+- (void) updateEntry: (ANTNetworkResponseCacheEntry *) entry forResourcePath: (NSString *) resourcePath {
+    NSString *filePath = [self filePathForResourcePath: resourcePath];
+    id pending = entry != nil ? entry : [NSNull null];
+
+    OSSpinLockLock(&_lock); {
+        _pending[resourcePath] = pending;
+        _generations[ANTNetworkResponseCacheGenerationIndex(resourcePath)] = ++_generation;
+
+        if (entry != nil)
+            [_entries setObject: entry forKey: resourcePath];
+        else
+            [_entries removeObjectForKey: resourcePath];
+    } OSSpinLockUnlock(&_lock);
+
+    dispatch_async(_queue, ^{
+        [self unlinkFileAtPath: filePath];
+
+        if (entry != nil) {
+            NSError *error;
+            NSData *data = [NSKeyedArchiver archivedDataWithRootObject: entry];
+            if ([data writeToFile: filePath options: NSDataWritingAtomic error: &error])
+                _diskSize += [data length];
+            else
+                NSLog(@"Failed to write cache entry for %@: %@", resourcePath, error);
+        }
+
+        /* Lookups may now read the file; a later update of the same entry remains pending */
+        OSSpinLockLock(&_lock); {
+            if (_pending[resourcePath] == pending)
+                [_pending removeObjectForKey: resourcePath];
+        } OSSpinLockUnlock(&_lock);
+
+        if (_diskSize > _diskSizeLimit)
+            [self trimToSizeLimit];
+    });
+}
+
+/**
+ * @internal
+ *
+ * Return true if no entry sharing the generation at @a index has been updated since @a generation was read.
+ */
+- (BOOL) isCurrentGeneration: (uint64_t) generation index: (NSUInteger) index {
+    BOOL current;
+    OSSpinLockLock(&_lock); {
+        current = (generation == _generations[index]);
+    } OSSpinLockUnlock(&_lock);
+
+    return current;
+}
+
+/**
+ * @internal
+ *
+ * Remove the file at @a filePath, if any, deducting its size from the disk size. Must be called on _queue.
+ */
+- (void) unlinkFileAtPath: (NSString *) filePath {
+    struct stat sb;
+    const char *path = [filePath fileSystemRepresentation];
+    if (lstat(path, &sb) != 0)
+        return;
+
+    if (unlink(path) != 0) {
+        if (errno != ENOENT)
+            NSLog(@"Failed to remove cache file %@: %s", filePath, strerror(errno));
+        return;
+    }
+
+    _diskSize -= MIN(_diskSize, (uint64_t) sb.st_size);
+}
+
+/**
+ * @internal
+ *
+ * Recompute the disk size from the cache directory and, if it exceeds the limit, remove the least recently used files
+ * until it is within three quarters of the limit. Must be called on _queue.
+ */
+- (void) trimToSizeLimit {
+    NSArray *keys = @[NSURLContentModificationDateKey, NSURLFileSizeKey];
+    NSArray *files = [[NSFileManager new] contentsOfDirectoryAtURL: [NSURL fileURLWithPath: _path isDirectory: YES]
+                                        includingPropertiesForKeys: keys
+                                                           options: NSDirectoryEnumerationSkipsHiddenFiles
+                                                             error: NULL];
+
+    _diskSize = 0;
+    NSMutableArray *entries = [NSMutableArray arrayWithCapacity: [files count]];
+    for (NSURL *url in files) {
+        NSDictionary *values = [url resourceValuesForKeys: keys error: NULL];
+        if (values[NSURLContentModificationDateKey] == nil || values[NSURLFileSizeKey] == nil)
+            continue;
+
+        _diskSize += [values[NSURLFileSizeKey] unsignedLongLongValue];
+        [entries addObject: @[values[NSURLContentModificationDateKey], url]];
+    }
+
+    if (_diskSize <= _diskSizeLimit)
+        return;
+
+    [entries sortUsingComparator: ^(NSArray *a, NSArray *b) {
+        return [a[0] compare: b[0]];
+    }];
+
+    uint64_t target = _diskSizeLimit - _diskSizeLimit / 4;
+    for (NSArray *entry in entries) {
+        if (_diskSize <= target)
+            break;
+
+        [self unlinkFileAtPath: [entry[1] path]];
+    }
+}
+
+@end
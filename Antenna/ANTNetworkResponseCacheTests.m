@@ -0,0 +1,174 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTNetworkResponseCache.h"
+#import "ANTRadarResponse.h"
+
+@interface ANTNetworkResponseCacheTests : XCTestCase @end
+
+@implementation ANTNetworkResponseCacheTests {
+    /** Temporary cache directory */
+    NSString *_path;
+
+    /** Classes stored in the cache */
+    NSSet *_classes;
+}
+
+- (void) setUp {
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+    _classes = [NSSet setWithObjects: [ANTRadarResponse class], [ANTRadarCommentResponse class], [NSArray class], [NSString class], [NSDate class], nil];
+}
+
+- (void) tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath: _path error: NULL];
+}
+
+- (void) testPersistence {
+    NSError *error;
+    ANTNetworkResponseCache *cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    XCTAssertNotNil(cache, @"Failed to create cache: %@", error);
+
+    ANTRadarCommentResponse *comment = [[ANTRadarCommentResponse alloc] initWithAuthorName: @"Landon Fuller" content: @"Comment" timestamp: [NSDate dateWithTimeIntervalSince1970: 1376082887]];
+    ANTRadarResponse *radar = [[ANTRadarResponse alloc] initWithTitle: @"Title" comments: @[comment] resolved: YES lastModifiedDate: [NSDate dateWithTimeIntervalSince1970: 1376082887] enclosureId: nil];
+    NSData *hash = [ANTNetworkResponseCacheEntry contentHashForData: [@"{}" dataUsingEncoding: NSUTF8StringEncoding]];
+    ANTNetworkResponseCacheEntry *entry = [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: @"\"abc\"" lastModified: nil contentHash: hash object: radar];
+
+    XCTAssertNil([cache entryForResourcePath: @"/openProblem/1"], @"Returned an entry from an empty cache");
+    [cache setEntry: entry forResourcePath: @"/openProblem/1"];
+    XCTAssertEqual([cache entryForResourcePath: @"/openProblem/1"], entry, @"Incorrect entry returned");
+
+    /* Wait for the pending write, and read the entry back from disk */
+    [cache flush];
+    cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    ANTNetworkResponseCacheEntry *loaded = [cache entryForResourcePath: @"/openProblem/1"];
+    XCTAssertNotNil(loaded, @"Entry was not persisted");
+    XCTAssertEqualObjects(loaded.entityTag, @"\"abc\"", @"Incorrect entity tag");
+    XCTAssertNil(loaded.lastModified, @"Incorrect last modified value");
+    XCTAssertEqualObjects(loaded.contentHash, hash, @"Incorrect content hash");
+
+    ANTRadarResponse *loadedRadar = loaded.object;
+    XCTAssertEqualObjects(loadedRadar.title, @"Title", @"Incorrect title");
+    XCTAssertTrue(loadedRadar.resolved, @"Incorrect resolved state");
+    XCTAssertEqualObjects([loadedRadar.comments[0] authorName], @"Landon Fuller", @"Incorrect comment");
+
+    /* Removal */
+    [cache removeEntryForResourcePath: @"/openProblem/1"];
+    XCTAssertNil([cache entryForResourcePath: @"/openProblem/1"], @"Entry was not removed");
+
+    [cache flush];
+    cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    XCTAssertNil([cache entryForResourcePath: @"/openProblem/1"], @"Entry was not removed from disk");
+}
+
+- (void) testFetchEntry {
+    NSError *error;
+    ANTNetworkResponseCache *cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    XCTAssertNotNil(cache, @"Failed to create cache: %@", error);
+
+    NSData *hash = [ANTNetworkResponseCacheEntry contentHashForData: [NSData data]];
+    [cache setEntry: [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: @"\"abc\"" lastModified: nil contentHash: hash object: @"value"] forResourcePath: @"/path"];
+    [cache flush];
+
+    /* Read back from disk in the background */
+    cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+    __block ANTNetworkResponseCacheEntry *fetched = nil;
+    [cache fetchEntryForResourcePath: @"/path" completionHandler: ^(ANTNetworkResponseCacheEntry *entry) {
+        fetched = entry;
+        dispatch_semaphore_signal(sem);
+    }];
+
+    XCTAssertEqual(dispatch_semaphore_wait(sem, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), (long) 0, @"Handler was not called");
+    XCTAssertEqualObjects(fetched.object, @"value", @"Incorrect entry returned");
+}
+
+- (void) testReadDuringUnrelatedWrite {
+    NSError *error;
+    ANTNetworkResponseCache *cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    XCTAssertNotNil(cache, @"Failed to create cache: %@", error);
+
+    NSData *hash = [ANTNetworkResponseCacheEntry contentHashForData: [NSData data]];
+    [cache setEntry: [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: @"\"abc\"" lastModified: nil contentHash: hash object: @"a"] forResourcePath: @"/a"];
+    [cache flush];
+
+    /* A write of another entry while /a is read from disk must not prevent /a from being retained in memory */
+    cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    [cache setEntry: [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: @"\"def\"" lastModified: nil contentHash: hash object: @"b"] forResourcePath: @"/b"];
+    XCTAssertEqualObjects([cache entryForResourcePath: @"/a"].object, @"a", @"Incorrect entry returned");
+    [cache flush];
+
+    NSFileManager *fm = [NSFileManager new];
+    for (NSString *file in [fm contentsOfDirectoryAtPath: _path error: NULL])
+        XCTAssertTrue([fm removeItemAtPath: [_path stringByAppendingPathComponent: file] error: &error], @"Failed to remove %@: %@", file, error);
+
+    XCTAssertEqualObjects([cache entryForResourcePath: @"/a"].object, @"a", @"Entry was not retained in memory");
+}
+
+- (void) testEviction {
+    NSError *error;
+    const uint64_t limit = 16 * 1024;
+    ANTNetworkResponseCache *cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes diskSizeLimit: limit error: &error];
+    XCTAssertNotNil(cache, @"Failed to create cache: %@", error);
+
+    NSString *value = [@"" stringByPaddingToLength: 1024 withString: @"x" startingAtIndex: 0];
+    NSData *hash = [ANTNetworkResponseCacheEntry contentHashForData: [NSData data]];
+    for (NSUInteger i = 0; i < 64; i++) {
+        ANTNetworkResponseCacheEntry *entry = [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: nil lastModified: nil contentHash: hash object: value];
+        [cache setEntry: entry forResourcePath: [NSString stringWithFormat: @"/openProblem/%lu", (unsigned long) i]];
+    }
+    [cache flush];
+
+    /* The on-disk entries must have been trimmed to the limit */
+    uint64_t size = 0;
+    NSArray *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath: _path error: NULL];
+    for (NSString *name in names)
+        size += [[[NSFileManager defaultManager] attributesOfItemAtPath: [_path stringByAppendingPathComponent: name] error: NULL] fileSize];
+
+    XCTAssertTrue([names count] > 0, @"All entries were evicted");
+    XCTAssertTrue([names count] < 64, @"No entries were evicted");
+    XCTAssertTrue(size <= limit, @"The cache exceeds its size limit");
+}
+
+- (void) testInvalidEntry {
+    NSError *error;
+    ANTNetworkResponseCache *cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    XCTAssertNotNil(cache, @"Failed to create cache: %@", error);
+
+    /* Corrupt every entry on disk */
+    NSData *hash = [ANTNetworkResponseCacheEntry contentHashForData: [NSData data]];
+    [cache setEntry: [[ANTNetworkResponseCacheEntry alloc] initWithEntityTag: nil lastModified: @"Fri, 09 Aug 2013 21:14:47 GMT" contentHash: hash object: @"value"] forResourcePath: @"/path"];
+    [cache flush];
+    for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath: _path error: NULL])
+        [[@"invalid" dataUsingEncoding: NSUTF8StringEncoding] writeToFile: [_path stringByAppendingPathComponent: name] atomically: YES];
+
+    cache = [[ANTNetworkResponseCache alloc] initWithPath: _path objectClasses: _classes error: &error];
+    XCTAssertNil([cache entryForResourcePath: @"/path"], @"Returned an invalid entry");
+}
+
+@end
@@ -0,0 +1,94 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <PLFoundation/PLFoundation.h>
+
+/**
+ * The response body size of a single request.
+ */
+typedef struct ANTNetworkTransferSize {
+    /** The number of response body bytes received from the server, prior to any content decoding. Transports that
+     * cannot observe the encoded body report the decoded size. */
+    uint64_t bodyBytesReceived;
+
+    /** The number of response body bytes after content decoding. */
+    uint64_t bodyBytesDecoded;
+} ANTNetworkTransferSize;
+
+/**
+ * Request completion callback.
+ *
+ * @param response The response, or nil if an error occured.
+ * @param data The response body, or nil if an error occured.
+ * @param size The size of the response body, or zero if an error occured.
+ * @param error On failure, an error in the NSURLErrorDomain, or nil on success.
+ */
+typedef void (^ANTNetworkTransportCallback)(NSURLResponse *response, NSData *data, ANTNetworkTransferSize size, NSError *error);
+
+/**
+ * Response body callback.
+ *
+ * @param data The next portion of the response body.
+ */
+typedef void (^ANTNetworkTransportDataHandler)(NSData *data);
+
+/**
+ * The ANTNetworkTransport protocol describes the HTTP backend used by ANTNetworkClient to send fully
+ * formed requests.
+ *
+ * Implementations are responsible only for moving bytes; cookie handling, request headers, scheduling and
+ * response parsing are performed by the network client. Implementations must decode gzip and deflate
+ * Content-Encodings, and all response data is provided to the client decoded.
+ */
+@protocol ANTNetworkTransport <NSObject>
+
+/**
+ * Send @a request, and call @a handler upon completion.
+ *
+ * @param request The request to be sent as-is. Implementations must not add cookies to the request, or store cookies from the response.
+ * @param ticket The cancellation ticket for the request. If cancelled, the request will be aborted, and @a handler will not be called.
+ * @param handler The block to be called upon request completion, on an unspecified background thread.
+ */
+- (void) sendRequest: (NSURLRequest *) request cancelTicket: (PLCancelTicket *) ticket completionHandler: (ANTNetworkTransportCallback) handler;
+
+/**
+ * Send @a request, streaming the response body to @a dataHandler as it is received, and call @a handler upon completion.
+ *
+ * @param request The request to be sent as-is. Implementations must not add cookies to the request, or store cookies from the response.
+ * @param ticket The cancellation ticket for the request. If cancelled, the request will be aborted, and neither handler will be called again.
+ * @param dataHandler The block to be called with each portion of the response body, in order. Calls are serialized, on an unspecified
+ * background thread, and all calls complete before @a handler is called. If the request fails, the data delivered so far must be discarded.
+ * @param handler The block to be called upon request completion, on an unspecified background thread. The data argument is always nil.
+ */
+- (void) sendRequest: (NSURLRequest *) request
+        cancelTicket: (PLCancelTicket *) ticket
+         dataHandler: (ANTNetworkTransportDataHandler) dataHandler
+   completionHandler: (ANTNetworkTransportCallback) handler;
+
+@end
@@ -0,0 +1,513 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTPersistentMap.h"
+#import <PLFoundation/PLFoundation.h>
+
+/** The number of hash bits consumed at each level of the trie. */
+#define ANT_PERSISTENT_MAP_BITS 5
+
+/** The mask applied to the shifted hash to determine a node's slot index. */
+#define ANT_PERSISTENT_MAP_MASK ((1U << ANT_PERSISTENT_MAP_BITS) - 1)
+
+/**
+ * @internal
+ *
+ * A single map entry.
+ */
+@interface ANTPersistentMapLeaf : NSObject
+
+- (instancetype) initWithKey: (NSData *) key keyHash: (uint32_t) keyHash object: (id) object;
+
+- (BOOL) matchesKeyBytes: (const void *) bytes length: (size_t) length hash: (uint32_t) hash;
+
+/** The entry's key. */
+@property(nonatomic, readonly) NSData *key;
+
+/** The hash of the entry's key. */
+@property(nonatomic, readonly) uint32_t keyHash;
+
+/** The entry's value. */
+@property(nonatomic, readonly) id object;
+
+@end
+
+/**
+ * @internal
+ *
+ * An immutable trie node. Each node consumes ANT_PERSISTENT_MAP_BITS bits of the key hash; populated slots are
+ * flagged in the node's bitmap, and stored densely in slot order. Once all hash bits have been consumed, entries
+ * with identical hashes are stored in an unordered collision node.
+ */
+@interface ANTPersistentMapNode : NSObject
+
+- (instancetype) initWithBitmap: (uint32_t) bitmap slots: (NSArray *) slots count: (NSUInteger) count collision: (BOOL) collision;
+
+/** Bitmap of populated slots. Unused by collision nodes. */
+@property(nonatomic, readonly) uint32_t bitmap;
+
+/** The node's populated slots; each is either an ANTPersistentMapLeaf, or an ANTPersistentMapNode. The slots of a
+ * collision node are always ANTPersistentMapLeaf instances. */
+@property(nonatomic, readonly) NSArray *slots;
+
+/** The total number of entries reachable from this node. */
+@property(nonatomic, readonly) NSUInteger count;
+
+/** If YES, this is a collision node. */
+@property(nonatomic, readonly, getter=isCollision) BOOL collision;
+
+@end
+
+@implementation ANTPersistentMapLeaf
+
+/**
+ * Initialize a new instance.
+ *
+ * @param key The entry key.
+ * @param keyHash The hash of @a key.
+ * @param object The entry value.
+ */
+- (instancetype) initWithKey: (NSData *) key keyHash: (uint32_t) keyHash object: (id) object {
+    PLSuperInit();
+
+    _key = key;
+    _keyHash = keyHash;
+    _object = object;
+
+    return self;
+}
+
+/**
+ * Return YES if the receiver's key is equal to the given key.
+ *
+ * @param bytes The key bytes.
+ * @param length The key length.
+ * @param hash The hash of the key.
+ */
+- (BOOL) matchesKeyBytes: (const void *) bytes length: (size_t) length hash: (uint32_t) hash {
+    if (_keyHash != hash || [_key length] != length)
+        return NO;
+
+    return memcmp([_key bytes], bytes, length) == 0;
+}
+
+@end
+
+@implementation ANTPersistentMapNode
+
+/**
+ * Initialize a new instance.
+ *
+ * @param bitmap Bitmap of populated slots.
+ * @param slots The populated slots.
+ * @param count The total number of entries reachable from this node.
+ * @param collision If YES, this is a collision node.
+ */
+- (instancetype) initWithBitmap: (uint32_t) bitmap slots: (NSArray *) slots count: (NSUInteger) count collision: (BOOL) collision {
+    PLSuperInit();
+
+    _bitmap = bitmap;
+    _slots = slots;
+    _count = count;
+    _collision = collision;
+
+    return self;
+}
+
+@end
+
+/**
+ * @internal
+ *
+ * Return the FNV-1a hash of the given key.
+ */
+static uint32_t ANTPersistentMapHash (const void *bytes, size_t length) {
+    const uint8_t *p = bytes;
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= p[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/**
+ * @internal
+ *
+ * Return the bitmap bit for @a hash at @a shift.
+ */
+static inline uint32_t ANTPersistentMapBit (uint32_t hash, unsigned int shift) {
+    return 1U << ((hash >> shift) & ANT_PERSISTENT_MAP_MASK);
+}
+
+/**
+ * @internal
+ *
+ * Return the dense slot index of @a bit in @a bitmap.
+ */
+static inline NSUInteger ANTPersistentMapIndex (uint32_t bitmap, uint32_t bit) {
+    return __builtin_popcount(bitmap & (bit - 1));
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a slots with @a slot inserted at @a index.
+ */
+static NSArray *ANTPersistentMapInsertSlot (NSArray *slots, NSUInteger index, id slot) {
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity: [slots count] + 1];
+    [result addObjectsFromArray: slots];
+    [result insertObject: slot atIndex: index];
+    return result;
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a slots with the slot at @a index replaced by @a slot.
+ */
+static NSArray *ANTPersistentMapReplaceSlot (NSArray *slots, NSUInteger index, id slot) {
+    NSMutableArray *result = [slots mutableCopy];
+    result[index] = slot;
+    return result;
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a slots with the slot at @a index removed.
+ */
+static NSArray *ANTPersistentMapRemoveSlot (NSArray *slots, NSUInteger index) {
+    NSMutableArray *result = [slots mutableCopy];
+    [result removeObjectAtIndex: index];
+    return result;
+}
+
+/**
+ * @internal
+ *
+ * Return a new node containing the two leaves @a leaf1 and @a leaf2, which have distinct keys, and whose hashes
+ * are identical for all bits below @a shift.
+ */
+static ANTPersistentMapNode *ANTPersistentMapMerge (ANTPersistentMapLeaf *leaf1, ANTPersistentMapLeaf *leaf2, unsigned int shift) {
+    /* All hash bits have been consumed */
+    if (shift >= 32)
+        return [[ANTPersistentMapNode alloc] initWithBitmap: 0 slots: @[leaf1, leaf2] count: 2 collision: YES];
+
+    uint32_t bit1 = ANTPersistentMapBit(leaf1.keyHash, shift);
+    uint32_t bit2 = ANTPersistentMapBit(leaf2.keyHash, shift);
+
+    if (bit1 == bit2) {
+        ANTPersistentMapNode *child = ANTPersistentMapMerge(leaf1, leaf2, shift + ANT_PERSISTENT_MAP_BITS);
+        return [[ANTPersistentMapNode alloc] initWithBitmap: bit1 slots: @[child] count: 2 collision: NO];
+    }
+
+    NSArray *slots = (bit1 < bit2) ? @[leaf1, leaf2] : @[leaf2, leaf1];
+    return [[ANTPersistentMapNode alloc] initWithBitmap: bit1 | bit2 slots: slots count: 2 collision: NO];
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a node with @a leaf inserted, replacing any existing entry with the same key. Only the nodes
+ * along the path to @a leaf are copied; all other nodes are shared with @a node.
+ *
+ * @param node The node, or nil to create a new node.
+ * @param leaf The leaf to be inserted.
+ * @param shift The hash shift of @a node.
+ * @param added On return, YES if a new entry was added, or NO if an existing entry was replaced.
+ *
+ * @return Returns @a node if it already contains an identical entry, or the modified copy.
+ */
+static ANTPersistentMapNode *ANTPersistentMapInsert (ANTPersistentMapNode *node, ANTPersistentMapLeaf *leaf, unsigned int shift, BOOL *added) {
+    const void *bytes = [leaf.key bytes];
+    size_t length = [leaf.key length];
+    uint32_t hash = leaf.keyHash;
+
+    *added = YES;
+
+    if (node == nil)
+        return [[ANTPersistentMapNode alloc] initWithBitmap: ANTPersistentMapBit(hash, shift) slots: @[leaf] count: 1 collision: NO];
+
+    NSArray *slots = node.slots;
+
+    if (node.isCollision) {
+        for (NSUInteger i = 0; i < [slots count]; i++) {
+            ANTPersistentMapLeaf *existing = slots[i];
+            if (![existing matchesKeyBytes: bytes length: length hash: hash])
+                continue;
+
+            *added = NO;
+            if (existing.object == leaf.object)
+                return node;
+
+            return [[ANTPersistentMapNode alloc] initWithBitmap: 0 slots: ANTPersistentMapReplaceSlot(slots, i, leaf) count: node.count collision: YES];
+        }
+
+        return [[ANTPersistentMapNode alloc] initWithBitmap: 0 slots: [slots arrayByAddingObject: leaf] count: node.count + 1 collision: YES];
+    }
+
+    uint32_t bitmap = node.bitmap;
+    uint32_t bit = ANTPersistentMapBit(hash, shift);
+    NSUInteger index = ANTPersistentMapIndex(bitmap, bit);
+
+    /* Empty slot */
+    if ((bitmap & bit) == 0)
+        return [[ANTPersistentMapNode alloc] initWithBitmap: bitmap | bit slots: ANTPersistentMapInsertSlot(slots, index, leaf) count: node.count + 1 collision: NO];
+
+    id slot = slots[index];
+    id replacement;
+
+    if ([slot isKindOfClass: [ANTPersistentMapLeaf class]]) {
+        ANTPersistentMapLeaf *existing = slot;
+        if ([existing matchesKeyBytes: bytes length: length hash: hash]) {
+            *added = NO;
+            if (existing.object == leaf.object)
+                return node;
+
+            replacement = leaf;
+        } else {
+            replacement = ANTPersistentMapMerge(existing, leaf, shift + ANT_PERSISTENT_MAP_BITS);
+        }
+    } else {
+        replacement = ANTPersistentMapInsert(slot, leaf, shift + ANT_PERSISTENT_MAP_BITS, added);
+        if (replacement == slot)
+            return node;
+    }
+
+    NSUInteger count = node.count + (*added ? 1 : 0);
+    return [[ANTPersistentMapNode alloc] initWithBitmap: bitmap slots: ANTPersistentMapReplaceSlot(slots, index, replacement) count: count collision: NO];
+}
+
+/**
+ * @internal
+ *
+ * Return a copy of @a node with the entry for the given key removed. Nodes that are left holding a single entry
+ * are collapsed into their parent.
+ *
+ * @return Returns @a node if the key was not found, nil if the resulting node would be empty, or the modified copy.
+ */
+static ANTPersistentMapNode *ANTPersistentMapRemove (ANTPersistentMapNode *node, const void *bytes, size_t length, uint32_t hash, unsigned int shift) {
+    NSArray *slots = node.slots;
+
+    if (node.isCollision) {
+        for (NSUInteger i = 0; i < [slots count]; i++) {
+            if (![slots[i] matchesKeyBytes: bytes length: length hash: hash])
+                continue;
+
+            if ([slots count] == 1)
+                return nil;
+
+            return [[ANTPersistentMapNode alloc] initWithBitmap: 0 slots: ANTPersistentMapRemoveSlot(slots, i) count: node.count - 1 collision: YES];
+        }
+
+        return node;
+    }
+
+    uint32_t bitmap = node.bitmap;
+    uint32_t bit = ANTPersistentMapBit(hash, shift);
+    if ((bitmap & bit) == 0)
+        return node;
+
+    NSUInteger index = ANTPersistentMapIndex(bitmap, bit);
+    id slot = slots[index];
+    id replacement;
+
+    if ([slot isKindOfClass: [ANTPersistentMapLeaf class]]) {
+        if (![slot matchesKeyBytes: bytes length: length hash: hash])
+            return node;
+
+        replacement = nil;
+    } else {
+        ANTPersistentMapNode *child = ANTPersistentMapRemove(slot, bytes, length, hash, shift + ANT_PERSISTENT_MAP_BITS);
+        if (child == slot)
+            return node;
+
+        /* Inline a child that holds only a single entry */
+        replacement = child;
+        if (child != nil && child.count == 1 && [child.slots[0] isKindOfClass: [ANTPersistentMapLeaf class]])
+            replacement = child.slots[0];
+    }
+
+    if (replacement != nil)
+        return [[ANTPersistentMapNode alloc] initWithBitmap: bitmap slots: ANTPersistentMapReplaceSlot(slots, index, replacement) count: node.count - 1 collision: NO];
+
+    if (bitmap == bit)
+        return nil;
+
+    return [[ANTPersistentMapNode alloc] initWithBitmap: bitmap & ~bit slots: ANTPersistentMapRemoveSlot(slots, index) count: node.count - 1 collision: NO];
+}
+
+/**
+ * @internal
+ *
+ * Recursively enumerate all values reachable from @a node.
+ */
+static void ANTPersistentMapEnumerate (ANTPersistentMapNode *node, void (^block)(id object)) {
+    for (id slot in node.slots) {
+        if ([slot isKindOfClass: [ANTPersistentMapLeaf class]]) {
+            block(((ANTPersistentMapLeaf *) slot).object);
+        } else {
+            ANTPersistentMapEnumerate(slot, block);
+        }
+    }
+}
+
+/**
+ * An immutable map from byte string keys to object values.
+ *
+ * The map is implemented as a persistent hash array mapped trie. Lookups, insertions, and removals cost
+ * O(log32 n); modifications return a new map that shares all trie nodes with the receiver, except for the
+ * (at most seven) nodes along the path to the modified entry. Keys are compared bytewise, and lookups do not
+ * require the caller to allocate a key object.
+ *
+ * Instances are immutable, and may be safely shared between threads.
+ */
+@implementation ANTPersistentMap {
+@private
+    /** The root node, or nil if the map is empty. */
+    ANTPersistentMapNode *_root;
+}
+
+/**
+ * Initialize a new, empty instance.
+ */
+- (instancetype) init {
+    return [self initWithRoot: nil];
+}
+
+/**
+ * @internal
+ *
+ * Initialize a new instance with the given root node.
+ *
+ * @param root The root node, or nil.
+ */
+- (instancetype) initWithRoot: (ANTPersistentMapNode *) root {
+    PLSuperInit();
+
+    _root = root;
+
+    return self;
+}
+
+/**
+ * Return the value associated with the given key, or nil if none.
+ *
+ * @param bytes The key bytes.
+ * @param length The key length.
+ */
+- (id) objectForKeyBytes: (const void *) bytes length: (size_t) length {
+    uint32_t hash = ANTPersistentMapHash(bytes, length);
+    ANTPersistentMapNode *node = _root;
+    unsigned int shift = 0;
+
+    while (node != nil) {
+        NSArray *slots = node.slots;
+        id slot;
+
+        if (node.isCollision) {
+            for (ANTPersistentMapLeaf *leaf in slots) {
+                if ([leaf matchesKeyBytes: bytes length: length hash: hash])
+                    return leaf.object;
+            }
+            return nil;
+        }
+
+        uint32_t bit = ANTPersistentMapBit(hash, shift);
+        if ((node.bitmap & bit) == 0)
+            return nil;
+
+        slot = slots[ANTPersistentMapIndex(node.bitmap, bit)];
+        if ([slot isKindOfClass: [ANTPersistentMapLeaf class]]) {
+            if ([slot matchesKeyBytes: bytes length: length hash: hash])
+                return ((ANTPersistentMapLeaf *) slot).object;
+            return nil;
+        }
+
+        node = slot;
+        shift += ANT_PERSISTENT_MAP_BITS;
+    }
+
+    return nil;
+}
+
+/**
+ * Return a new map containing all of the receiver's entries, with @a object associated with the given key. Any
+ * existing value for the key will be replaced.
+ *
+ * @param object The value to be set.
+ * @param bytes The key bytes. These will be copied.
+ * @param length The key length.
+ */
+- (ANTPersistentMap *) mapBySettingObject: (id) object forKeyBytes: (const void *) bytes length: (size_t) length {
+    NSData *key = [NSData dataWithBytes: bytes length: length];
+    ANTPersistentMapLeaf *leaf = [[ANTPersistentMapLeaf alloc] initWithKey: key keyHash: ANTPersistentMapHash(bytes, length) object: object];
+
+    BOOL added;
+    ANTPersistentMapNode *root = ANTPersistentMapInsert(_root, leaf, 0, &added);
+    if (root == _root)
+        return self;
+
+    return [[ANTPersistentMap alloc] initWithRoot: root];
+}
+
+/**
+ * Return a new map containing all of the receiver's entries, except for the entry with the given key. If the key is not
+ * found, the receiver is returned.
+ *
+ * @param bytes The key bytes.
+ * @param length The key length.
+ */
+- (ANTPersistentMap *) mapByRemovingObjectForKeyBytes: (const void *) bytes length: (size_t) length {
+    if (_root == nil)
+        return self;
+
+    ANTPersistentMapNode *root = ANTPersistentMapRemove(_root, bytes, length, ANTPersistentMapHash(bytes, length), 0);
+    if (root == _root)
+        return self;
+
+    return [[ANTPersistentMap alloc] initWithRoot: root];
+}
+
+/**
+ * Enumerate all values in the map, in an unspecified order.
+ *
+ * @param block The block to be called for each value.
+ */
+- (void) enumerateObjectsUsingBlock: (void (^)(id object)) block {
+    ANTPersistentMapEnumerate(_root, block);
+}
+
+// property getter
+- (NSUInteger) count {
+    return _root.count;
+}
+
+@end
@@ -0,0 +1,84 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTPersistentMap.h"
+
+@interface ANTPersistentMapTests : XCTestCase @end
+
+@implementation ANTPersistentMapTests
+
+/* Return the value for @a key in @a map */
+static id ObjectForKey (ANTPersistentMap *map, NSString *key) {
+    return [map objectForKeyBytes: [key UTF8String] length: strlen([key UTF8String])];
+}
+
+- (void) testSetRemove {
+    ANTPersistentMap *empty = [ANTPersistentMap new];
+    ANTPersistentMap *map = empty;
+    const NSUInteger count = 5000;
+
+    /* Enough entries to populate multiple trie levels */
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *key = [NSString stringWithFormat: @"key-%lu", (unsigned long) i];
+        map = [map mapBySettingObject: @(i) forKeyBytes: [key UTF8String] length: strlen([key UTF8String])];
+    }
+    XCTAssertEqual(map.count, count, @"Incorrect count");
+    XCTAssertEqual(empty.count, (NSUInteger) 0, @"Original map was modified");
+
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *key = [NSString stringWithFormat: @"key-%lu", (unsigned long) i];
+        XCTAssertEqualObjects(ObjectForKey(map, key), @(i), @"Incorrect value for %@", key);
+    }
+    XCTAssertNil(ObjectForKey(map, @"missing"), @"Value returned for a missing key");
+
+    /* Replacement */
+    ANTPersistentMap *replaced = [map mapBySettingObject: @"replaced" forKeyBytes: "key-1" length: 5];
+    XCTAssertEqual(replaced.count, count, @"Replacement changed the count");
+    XCTAssertEqualObjects(ObjectForKey(replaced, @"key-1"), @"replaced", @"Value not replaced");
+    XCTAssertEqualObjects(ObjectForKey(map, @"key-1"), @(1), @"Original map was modified");
+
+    /* Removal */
+    XCTAssertEqual([map mapByRemovingObjectForKeyBytes: "missing" length: 7], map, @"Removing a missing key should return the receiver");
+    ANTPersistentMap *removed = map;
+    for (NSUInteger i = 0; i < count; i += 2) {
+        NSString *key = [NSString stringWithFormat: @"key-%lu", (unsigned long) i];
+        removed = [removed mapByRemovingObjectForKeyBytes: [key UTF8String] length: strlen([key UTF8String])];
+    }
+    XCTAssertEqual(removed.count, count / 2, @"Incorrect count");
+    XCTAssertEqual(map.count, count, @"Original map was modified");
+
+    __block NSUInteger enumerated = 0;
+    [removed enumerateObjectsUsingBlock: ^(NSNumber *value) {
+        XCTAssertTrue([value unsignedIntegerValue] % 2 == 1, @"Removed value enumerated");
+        enumerated++;
+    }];
+    XCTAssertEqual(enumerated, count / 2, @"Incorrect enumeration count");
+}
+
+@end
@@ -0,0 +1,1005 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTPublicSuffix.h"
+#include "ANTEpoch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <libkern/OSAtomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ANTEffectiveTLDNames.c"
+
+/*
+ * The public suffix rules are stored as a DAFSA (deterministic acyclic finite state automaton) of the reversed
+ * rule names, generated by Dependencies/effective_tld_names/process.py. Each node consists of a label -- one or
+ * more characters, the last of which has its high bit set -- followed by a list of offsets to the node's
+ * children. A word is accepted if its final label is followed by a return value node, a single byte of
+ * the form 0x80 | value.
+ *
+ * As the rule names are reversed, walking the automaton from the end of a domain name visits every rule
+ * that is a suffix of the name, in order of increasing length.
+ *
+ * The built-in table may be replaced at runtime with a memory-mapped table in the binary format emitted by
+ * `process.py --binary`; see ANTPublicSuffixLoadTable().
+ */
+
+/** Binary table file magic. */
+#define ANT_PUBLIC_SUFFIX_MAGIC "APSL"
+
+/** Binary table format version. */
+#define ANT_PUBLIC_SUFFIX_VERSION 1
+
+/** Binary table header length: magic, version, and DAFSA length. */
+#define ANT_PUBLIC_SUFFIX_HEADER_LENGTH 12
+
+/** Maximum supported binary table size. DAFSA offsets are limited to 21 bits. */
+#define ANT_PUBLIC_SUFFIX_MAX_LENGTH (1 << 21)
+
+/**
+ * @internal
+ *
+ * A public suffix table.
+ */
+typedef struct ANTPublicSuffixTable {
+    /** The encoded DAFSA. */
+    const uint8_t *dafsa;
+
+    /** The length of @a dafsa, in bytes. */
+    size_t length;
+
+    /** The backing file mapping, or NULL for the built-in table. */
+    void *mapping;
+
+    /** The length of @a mapping. */
+    size_t mappingLength;
+} ANTPublicSuffixTable;
+
+/** The built-in table. */
+static ANTPublicSuffixTable ANTPublicSuffixBuiltinTable = {
+    .dafsa = ANTEffectiveTLDNamesDAFSA,
+    .length = sizeof(ANTEffectiveTLDNamesDAFSA),
+    .mapping = NULL,
+    .mappingLength = 0
+};
+
+/** The current table. This must only be read via ANTPublicSuffixTableAcquire(). */
+static ANTPublicSuffixTable * volatile ANTPublicSuffixCurrentTable = &ANTPublicSuffixBuiltinTable;
+
+/** Lock that must be held when replacing ANTPublicSuffixCurrentTable. This serializes writers; it is never taken by readers. */
+static OSSpinLock ANTPublicSuffixTableLock = OS_SPINLOCK_INIT;
+
+/**
+ * @internal
+ *
+ * Acquire a reference to the current table. This will never block. The table must be released via
+ * ANTPublicSuffixTableRelease() once the caller has finished with it.
+ */
+static inline const ANTPublicSuffixTable *ANTPublicSuffixTableAcquire (void) {
+    /* Enter an epoch critical section before loading the pointer; a writer that has swapped out the table we
+     * load will not unmap it until we have exited. Readers touch only their own thread's epoch record. */
+    ANTEpochEnter();
+    return ANTPublicSuffixCurrentTable;
+}
+
+/**
+ * @internal
+ *
+ * Release a table acquired via ANTPublicSuffixTableAcquire().
+ */
+static inline void ANTPublicSuffixTableRelease (void) {
+    ANTEpochExit();
+}
+
+/**
+ * @internal
+ *
+ * Incremental DAFSA lookup state.
+ */
+typedef struct ANTPublicSuffixDAFSAState {
+    /** The current position within the DAFSA, or NULL if no further matches are possible. */
+    const uint8_t *pos;
+
+    /** If true, @a pos refers to a label character. Otherwise, @a pos refers to a list of child offsets. */
+    bool labelCharacter;
+} ANTPublicSuffixDAFSAState;
+
+/**
+ * @internal
+ *
+ * Initialize @a state at the root of @a table's DAFSA.
+ */
+static inline void ANTPublicSuffixDAFSAInit (ANTPublicSuffixDAFSAState *state, const ANTPublicSuffixTable *table) {
+    state->pos = table->dafsa;
+    state->labelCharacter = false;
+}
+
+/**
+ * @internal
+ *
+ * Read the next child offset from the offset list at @a pos, adding it to @a offset. @a pos is advanced to the
+ * next offset, or set to NULL if the list has been exhausted.
+ *
+ * @return Returns false if the list had already been exhausted.
+ */
+static inline bool ANTPublicSuffixDAFSANextOffset (const uint8_t **pos, const uint8_t **offset) {
+    const uint8_t *p = *pos;
+    size_t consumed;
+
+    if (p == NULL)
+        return false;
+
+    switch (p[0] & 0x60) {
+        case 0x60:
+            *offset += ((p[0] & 0x1F) << 16) | (p[1] << 8) | p[2];
+            consumed = 3;
+            break;
+
+        case 0x40:
+            *offset += ((p[0] & 0x1F) << 8) | p[1];
+            consumed = 2;
+            break;
+
+        default:
+            *offset += p[0] & 0x3F;
+            consumed = 1;
+            break;
+    }
+
+    /* The high bit flags the final offset */
+    if (p[0] & 0x80) {
+        *pos = NULL;
+    } else {
+        *pos = p + consumed;
+    }
+
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Return true if the label character at @a pos matches @a c. Sets @a last to true if this is the label's final character.
+ */
+static inline bool ANTPublicSuffixDAFSAMatch (const uint8_t *pos, uint8_t c, bool *last) {
+    *last = (*pos & 0x80) != 0;
+    if (*last)
+        return *pos == (c | 0x80);
+
+    return *pos == c;
+}
+
+/**
+ * @internal
+ *
+ * Advance @a state by the character @a c.
+ *
+ * @return Returns false if no rule can match the characters consumed thus far.
+ */
+static bool ANTPublicSuffixDAFSAAdvance (ANTPublicSuffixDAFSAState *state, uint8_t c) {
+    bool last;
+
+    if (state->pos == NULL)
+        return false;
+
+    /* Only printable ASCII may be represented; the high bit and control characters are reserved by the encoding. */
+    if (c < 0x20 || c >= 0x80) {
+        state->pos = NULL;
+        return false;
+    }
+
+    if (state->labelCharacter) {
+        if (ANTPublicSuffixDAFSAMatch(state->pos, c, &last)) {
+            state->pos++;
+            state->labelCharacter = !last;
+            return true;
+        }
+    } else {
+        const uint8_t *offset = state->pos;
+        while (ANTPublicSuffixDAFSANextOffset(&state->pos, &offset)) {
+            if (ANTPublicSuffixDAFSAMatch(offset, c, &last)) {
+                state->pos = offset + 1;
+                state->labelCharacter = !last;
+                return true;
+            }
+        }
+    }
+
+    state->pos = NULL;
+    return false;
+}
+
+/**
+ * @internal
+ *
+ * Return the rule type accepted by @a state's current position, or ANTPublicSuffixRuleNone if the characters
+ * consumed thus far do not form a complete rule.
+ */
+static ANTPublicSuffixRuleType ANTPublicSuffixDAFSAResult (const ANTPublicSuffixDAFSAState *state) {
+    if (state->pos == NULL)
+        return ANTPublicSuffixRuleNone;
+
+    if (state->labelCharacter) {
+        if ((*state->pos & 0xE0) == 0x80)
+            return (ANTPublicSuffixRuleType) (*state->pos & 0x0F);
+        return ANTPublicSuffixRuleNone;
+    }
+
+    const uint8_t *pos = state->pos;
+    const uint8_t *offset = pos;
+    while (ANTPublicSuffixDAFSANextOffset(&pos, &offset)) {
+        if ((*offset & 0xE0) == 0x80)
+            return (ANTPublicSuffixRuleType) (*offset & 0x0F);
+    }
+
+    return ANTPublicSuffixRuleNone;
+}
+
+/**
+ * @internal
+ *
+ * Return the lowercase form of the ASCII character @a c.
+ */
+static inline uint8_t ANTPublicSuffixLower (char c) {
+    if (c >= 'A' && c <= 'Z')
+        return (uint8_t) (c + ('a' - 'A'));
+
+    return (uint8_t) c;
+}
+
+/**
+ * @internal
+ *
+ * Implements ANTPublicSuffixLookupRule() using @a table.
+ */
+static ANTPublicSuffixRuleType ANTPublicSuffixLookupRuleInTable (const ANTPublicSuffixTable *table, const char *name, size_t length) {
+    ANTPublicSuffixDAFSAState state;
+    ANTPublicSuffixDAFSAInit(&state, table);
+
+    for (size_t i = length; i > 0; i--) {
+        if (!ANTPublicSuffixDAFSAAdvance(&state, ANTPublicSuffixLower(name[i - 1])))
+            return ANTPublicSuffixRuleNone;
+    }
+
+    return ANTPublicSuffixDAFSAResult(&state);
+}
+
+/**
+ * @internal
+ *
+ * Implements ANTPublicSuffixLength() using @a table.
+ */
+static size_t ANTPublicSuffixLengthInTable (const ANTPublicSuffixTable *table, const char *host, size_t length, bool *known) {
+    ANTPublicSuffixDAFSAState state;
+    ANTPublicSuffixDAFSAInit(&state, table);
+
+    /* The start of the prevailing public suffix, if any */
+    const char *suffix = NULL;
+
+    for (const char *p = host + length; p > host; p--) {
+        if (!ANTPublicSuffixDAFSAAdvance(&state, ANTPublicSuffixLower(p[-1])))
+            break;
+
+        /* Rules only match on label boundaries */
+        const char *labelStart = p - 1;
+        if (labelStart != host && labelStart[-1] != '.')
+            continue;
+
+        switch (ANTPublicSuffixDAFSAResult(&state)) {
+            case ANTPublicSuffixRuleNone:
+                break;
+
+            case ANTPublicSuffixRuleStandard:
+                suffix = labelStart;
+                break;
+
+            case ANTPublicSuffixRuleWildcard:
+                /* The wildcard matches the next label to the left. If there is none, the name is itself a public suffix. */
+                suffix = labelStart;
+                if (labelStart != host) {
+                    suffix = labelStart - 1;
+                    while (suffix > host && suffix[-1] != '.')
+                        suffix--;
+                }
+                break;
+
+            case ANTPublicSuffixRuleException: {
+                /* The public suffix is the exception rule, sans its leftmost label */
+                const char *dot = memchr(labelStart, '.', (host + length) - labelStart);
+                *known = true;
+                if (dot == NULL)
+                    return 0;
+                return (host + length) - (dot + 1);
+            }
+        }
+    }
+
+    if (suffix != NULL) {
+        *known = true;
+        return (host + length) - suffix;
+    }
+
+    /* Apply the implicit "*" rule; the public suffix is the rightmost label */
+    *known = false;
+    const char *p = host + length;
+    while (p > host && p[-1] != '.')
+        p--;
+
+    return (host + length) - p;
+}
+
+/**
+ * Look up the public suffix rule for the given domain name.
+ *
+ * @param name The domain name, without any leading or trailing '.'. ASCII uppercase characters will be matched
+ * case-insensitively. Internationalized names must be in their ASCII (punycode) form.
+ * @param length The length of @a name, in bytes.
+ *
+ * @return Returns the type of the rule matching @a name in its entirety, or ANTPublicSuffixRuleNone if no
+ * rule matches.
+ */
+ANTPublicSuffixRuleType ANTPublicSuffixLookupRule (const char *name, size_t length) {
+    const ANTPublicSuffixTable *table = ANTPublicSuffixTableAcquire();
+    ANTPublicSuffixRuleType result = ANTPublicSuffixLookupRuleInTable(table, name, length);
+    ANTPublicSuffixTableRelease();
+
+    return result;
+}
+
+/**
+ * Return the length of the public suffix of @a host, as defined by the Public Suffix List algorithm
+ * ( http://publicsuffix.org/list/ ). The host's labels are walked once, from right to left; exception
+ * rules take precedence over all other rules, and otherwise the matching rule with the most labels prevails.
+ *
+ * This function does not allocate.
+ *
+ * @param host The host name, without any leading or trailing '.'. ASCII uppercase characters will be matched
+ * case-insensitively. Internationalized names must be in their ASCII (punycode) form.
+ * @param length The length of @a host, in bytes.
+ * @param known On return, true if the public suffix was determined by a rule in the list, or false if the
+ * implicit "*" rule was applied.
+ *
+ * @return Returns the length, in bytes, of the public suffix at the end of @a host. If this is equal to @a length,
+ * @a host is itself a public suffix.
+ */
+size_t ANTPublicSuffixLength (const char *host, size_t length, bool *known) {
+    const ANTPublicSuffixTable *table = ANTPublicSuffixTableAcquire();
+    size_t result = ANTPublicSuffixLengthInTable(table, host, length, known);
+    ANTPublicSuffixTableRelease();
+
+    return result;
+}
+
+/**
+ * Return true if @a host is an IPv4 or IPv6 address literal. IPv6 literals must not include the enclosing
+ * brackets used in URLs.
+ *
+ * This function does not allocate.
+ *
+ * @param host The host name.
+ * @param length The length of @a host, in bytes.
+ */
+bool ANTPublicSuffixIsIPAddress (const char *host, size_t length) {
+    char buffer[INET6_ADDRSTRLEN];
+    uint8_t address[sizeof(struct in6_addr)];
+
+    /* inet_pton() requires a NUL terminated string */
+    if (length >= sizeof(buffer))
+        return false;
+
+    memcpy(buffer, host, length);
+    buffer[length] = '\0';
+
+    return inet_pton(AF_INET, buffer, address) == 1 || inet_pton(AF_INET6, buffer, address) == 1;
+}
+
+/** A 64-bit word with every byte set to @a b. */
+#define ANT_PUBLIC_SUFFIX_BYTES(b) (UINT64_C(0x0101010101010101) * (uint8_t) (b))
+
+/**
+ * @internal
+ *
+ * Load a 64-bit word from the (possibly unaligned) address @a p.
+ */
+static inline uint64_t ANTPublicSuffixLoadWord (const char *p) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+/**
+ * Return true if @a name consists entirely of ASCII characters. Names are scanned a word at a time.
+ *
+ * This function does not allocate.
+ *
+ * @param name The name to scan.
+ * @param length The length of @a name, in bytes.
+ */
+bool ANTPublicSuffixIsASCII (const char *name, size_t length) {
+    uint64_t bits = 0;
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+        bits |= ANTPublicSuffixLoadWord(name + i);
+
+    for (; i < length; i++)
+        bits |= (uint8_t) name[i];
+
+    return (bits & ANT_PUBLIC_SUFFIX_BYTES(0x80)) == 0;
+}
+
+/**
+ * Lowercase the ASCII characters of @a name in place. Names are converted a word at a time; non-ASCII bytes
+ * are left unmodified.
+ *
+ * This function does not allocate.
+ *
+ * @param name The name to convert.
+ * @param length The length of @a name, in bytes.
+ */
+void ANTPublicSuffixLowercaseASCII (char *name, size_t length) {
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word = ANTPublicSuffixLoadWord(name + i);
+
+        /* For each ASCII byte, the high bit of (byte + 0x80 - 'A') is set if byte >= 'A', and the high bit of
+         * (byte + 0x80 - 'Z' - 1) is set if byte > 'Z'. As the low seven bits of each byte can not carry into
+         * the next, the bytes may be added in parallel. */
+        uint64_t ascii = ~word & ANT_PUBLIC_SUFFIX_BYTES(0x80);
+        uint64_t low = word & ANT_PUBLIC_SUFFIX_BYTES(0x7F);
+        uint64_t aboveA = low + ANT_PUBLIC_SUFFIX_BYTES(0x80 - 'A');
+        uint64_t aboveZ = low + ANT_PUBLIC_SUFFIX_BYTES(0x80 - 'Z' - 1);
+        uint64_t upper = (aboveA ^ aboveZ) & ascii;
+        if (upper == 0)
+            continue;
+
+        word |= upper >> 2;
+        memcpy(name + i, &word, sizeof(word));
+    }
+
+    for (; i < length; i++)
+        name[i] = (char) ANTPublicSuffixLower(name[i]);
+}
+
+/**
+ * @internal
+ *
+ * Decode the next code point of the UTF-8 sequence at @a *pos, advancing @a *pos past it.
+ *
+ * @param pos The current position.
+ * @param end The end of the sequence.
+ * @param codePoint On return, the decoded code point.
+ *
+ * @return Returns false if the sequence is not well-formed UTF-8.
+ */
+static bool ANTPublicSuffixDecodeUTF8 (const uint8_t **pos, const uint8_t *end, uint32_t *codePoint) {
+    const uint8_t *p = *pos;
+    uint32_t c = *p++;
+    size_t continuation;
+    uint32_t minimum;
+
+    if (c < 0x80) {
+        continuation = 0;
+        minimum = 0;
+    } else if ((c & 0xE0) == 0xC0) {
+        c &= 0x1F;
+        continuation = 1;
+        minimum = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+        c &= 0x0F;
+        continuation = 2;
+        minimum = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+        c &= 0x07;
+        continuation = 3;
+        minimum = 0x10000;
+    } else {
+        return false;
+    }
+
+    if ((size_t) (end - p) < continuation)
+        return false;
+
+    for (size_t i = 0; i < continuation; i++) {
+        if ((p[i] & 0xC0) != 0x80)
+            return false;
+        c = (c << 6) | (p[i] & 0x3F);
+    }
+
+    /* Reject overlong encodings, surrogates, and values beyond the Unicode range */
+    if (c < minimum || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+        return false;
+
+    *pos = p + continuation;
+    *codePoint = c;
+    return true;
+}
+
+/** Punycode parameters, as defined by RFC 3492 section 5. */
+enum {
+    ANT_PUNYCODE_BASE = 36,
+    ANT_PUNYCODE_TMIN = 1,
+    ANT_PUNYCODE_TMAX = 26,
+    ANT_PUNYCODE_SKEW = 38,
+    ANT_PUNYCODE_DAMP = 700,
+    ANT_PUNYCODE_INITIAL_BIAS = 72,
+    ANT_PUNYCODE_INITIAL_N = 0x80
+};
+
+/**
+ * @internal
+ *
+ * Punycode bias adaptation function, as defined by RFC 3492 section 6.1.
+ */
+static uint32_t ANTPublicSuffixPunycodeAdapt (uint32_t delta, uint32_t points, bool first) {
+    delta = first ? delta / ANT_PUNYCODE_DAMP : delta / 2;
+    delta += delta / points;
+
+    uint32_t k = 0;
+    while (delta > ((ANT_PUNYCODE_BASE - ANT_PUNYCODE_TMIN) * ANT_PUNYCODE_TMAX) / 2) {
+        delta /= ANT_PUNYCODE_BASE - ANT_PUNYCODE_TMIN;
+        k += ANT_PUNYCODE_BASE;
+    }
+
+    return k + (((ANT_PUNYCODE_BASE - ANT_PUNYCODE_TMIN + 1) * delta) / (delta + ANT_PUNYCODE_SKEW));
+}
+
+/**
+ * @internal
+ *
+ * Return the punycode digit character for @a digit.
+ */
+static inline char ANTPublicSuffixPunycodeDigit (uint32_t digit) {
+    return (char) (digit < 26 ? 'a' + digit : '0' + (digit - 26));
+}
+
+/**
+ * @internal
+ *
+ * Write the A-label form ("xn--" followed by the punycode encoding) of the code points @a input to @a output.
+ *
+ * @param input The label's code points.
+ * @param count The number of code points.
+ * @param output The output buffer.
+ * @param size The size of @a output.
+ * @param written On return, the number of bytes written.
+ *
+ * @return Returns false if the encoded label does not fit within @a size bytes.
+ */
+static bool ANTPublicSuffixPunycodeEncode (const uint32_t *input, size_t count, char *output, size_t size, size_t *written) {
+    size_t out = 0;
+
+#define ANT_PUNYCODE_EMIT(c) do { \
+    if (out >= size) \
+        return false; \
+    output[out++] = (c); \
+} while (0)
+
+    ANT_PUNYCODE_EMIT('x');
+    ANT_PUNYCODE_EMIT('n');
+    ANT_PUNYCODE_EMIT('-');
+    ANT_PUNYCODE_EMIT('-');
+
+    /* Basic code points are copied as-is, followed by a delimiter */
+    uint32_t basic = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (input[i] < 0x80) {
+            ANT_PUNYCODE_EMIT((char) ANTPublicSuffixLower((char) input[i]));
+            basic++;
+        }
+    }
+
+    if (basic > 0)
+        ANT_PUNYCODE_EMIT('-');
+
+    /* Encode the insertion of each non-basic code point, in code point order */
+    uint32_t n = ANT_PUNYCODE_INITIAL_N;
+    uint32_t bias = ANT_PUNYCODE_INITIAL_BIAS;
+    uint32_t delta = 0;
+    uint32_t handled = basic;
+
+    while (handled < count) {
+        uint32_t m = UINT32_MAX;
+        for (size_t i = 0; i < count; i++) {
+            if (input[i] >= n && input[i] < m)
+                m = input[i];
+        }
+
+        /* Labels are bounded by the maximum DNS name length, so this can not overflow */
+        delta += (m - n) * (handled + 1);
+        n = m;
+
+        for (size_t i = 0; i < count; i++) {
+            if (input[i] < n) {
+                delta++;
+            } else if (input[i] == n) {
+                uint32_t q = delta;
+                for (uint32_t k = ANT_PUNYCODE_BASE;; k += ANT_PUNYCODE_BASE) {
+                    uint32_t t = k <= bias ? ANT_PUNYCODE_TMIN : (k >= bias + ANT_PUNYCODE_TMAX ? ANT_PUNYCODE_TMAX : k - bias);
+                    if (q < t)
+                        break;
+
+                    ANT_PUNYCODE_EMIT(ANTPublicSuffixPunycodeDigit(t + (q - t) % (ANT_PUNYCODE_BASE - t)));
+                    q = (q - t) / (ANT_PUNYCODE_BASE - t);
+                }
+
+                ANT_PUNYCODE_EMIT(ANTPublicSuffixPunycodeDigit(q));
+                bias = ANTPublicSuffixPunycodeAdapt(delta, handled + 1, handled == basic);
+                delta = 0;
+                handled++;
+            }
+        }
+
+        delta++;
+        n++;
+    }
+
+#undef ANT_PUNYCODE_EMIT
+
+    *written = out;
+    return true;
+}
+
+/** The maximum length of a DNS label, in bytes. */
+#define ANT_PUBLIC_SUFFIX_MAX_LABEL 63
+
+/**
+ * Convert the domain name @a name to its ASCII form, as used by the public suffix table and by DNS. ASCII labels
+ * (including A-labels) are lowercased; labels containing non-ASCII characters (U-labels) are converted to A-labels
+ * via punycode.
+ *
+ * Pure ASCII names are converted a word at a time, and never decoded. Non-ASCII characters are not case folded or
+ * normalized; callers must apply Unicode lowercasing and NFC normalization to U-labels prior to conversion.
+ *
+ * This function does not allocate.
+ *
+ * @param name The UTF-8 domain name.
+ * @param length The length of @a name, in bytes.
+ * @param buffer The output buffer.
+ * @param size The size of @a buffer, in bytes. The result will not be NUL terminated.
+ * @param written On return, the length of the ASCII name.
+ *
+ * @return Returns false if @a name is not well-formed UTF-8, contains a label that can not be converted, or if
+ * the result does not fit within @a size bytes.
+ */
+bool ANTPublicSuffixCopyASCIIName (const char *name, size_t length, char *buffer, size_t size, size_t *written) {
+    /* Fast path */
+    if (ANTPublicSuffixIsASCII(name, length)) {
+        if (length > size)
+            return false;
+
+        memcpy(buffer, name, length);
+        ANTPublicSuffixLowercaseASCII(buffer, length);
+        *written = length;
+        return true;
+    }
+
+    size_t out = 0;
+    const char *end = name + length;
+    const char *label = name;
+    while (label <= end) {
+        const char *labelEnd = memchr(label, '.', end - label);
+        if (labelEnd == NULL)
+            labelEnd = end;
+
+        size_t labelLength = labelEnd - label;
+        if (label != name) {
+            if (out >= size)
+                return false;
+            buffer[out++] = '.';
+        }
+
+        if (ANTPublicSuffixIsASCII(label, labelLength)) {
+            if (labelLength > size - out)
+                return false;
+
+            memcpy(buffer + out, label, labelLength);
+            ANTPublicSuffixLowercaseASCII(buffer + out, labelLength);
+            out += labelLength;
+        } else {
+            /* Every code point occupies at least one byte, and every encoded A-label fits within a DNS label */
+            uint32_t codePoints[ANT_PUBLIC_SUFFIX_MAX_LABEL];
+            size_t count = 0;
+            const uint8_t *p = (const uint8_t *) label;
+            while (p < (const uint8_t *) labelEnd) {
+                if (count == ANT_PUBLIC_SUFFIX_MAX_LABEL || !ANTPublicSuffixDecodeUTF8(&p, (const uint8_t *) labelEnd, &codePoints[count]))
+                    return false;
+                count++;
+            }
+
+            size_t encoded;
+            size_t available = size - out;
+            if (available > ANT_PUBLIC_SUFFIX_MAX_LABEL)
+                available = ANT_PUBLIC_SUFFIX_MAX_LABEL;
+
+            if (!ANTPublicSuffixPunycodeEncode(codePoints, count, buffer + out, available, &encoded))
+                return false;
+            out += encoded;
+        }
+
+        label = labelEnd + 1;
+    }
+
+    *written = out;
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Decode a little-endian uint32_t from @a p.
+ */
+static inline uint32_t ANTPublicSuffixReadUInt32 (const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/** Validation flag: the position has been queued as an offset list. */
+#define ANT_PUBLIC_SUFFIX_VISITED_LIST 0x1
+
+/** Validation flag: the position has been queued as a node. */
+#define ANT_PUBLIC_SUFFIX_VISITED_NODE 0x2
+
+/**
+ * @internal
+ *
+ * Verify that every offset list and node reachable from the root of @a dafsa lies within its bounds, and that
+ * every return value is a known rule type. A DAFSA that passes validation can be walked by the lookup functions
+ * without reading outside of @a dafsa, regardless of the input name.
+ *
+ * @param dafsa The encoded DAFSA.
+ * @param length The length of @a dafsa, in bytes.
+ */
+static bool ANTPublicSuffixValidateDAFSA (const uint8_t *dafsa, size_t length) {
+    bool result = false;
+
+    /* Each position is queued at most once as a list and once as a node */
+    uint8_t *visited = calloc(length, sizeof(uint8_t));
+    size_t *queue = malloc(2 * length * sizeof(size_t));
+    size_t queued = 0;
+    if (visited == NULL || queue == NULL)
+        goto cleanup;
+
+    /* Positions are queued with their kind in the low bit; the root is an offset list */
+    if (length == 0)
+        goto cleanup;
+    visited[0] = ANT_PUBLIC_SUFFIX_VISITED_LIST;
+    queue[queued++] = 0;
+
+    while (queued > 0) {
+        size_t entry = queue[--queued];
+        size_t pos = entry >> 1;
+
+        if ((entry & 1) == 0) {
+            /* Offset list; each offset is relative to the previous one, starting from the list itself */
+            size_t offset = pos;
+            bool final = false;
+            while (!final) {
+                if (pos >= length)
+                    goto cleanup;
+
+                size_t consumed;
+                switch (dafsa[pos] & 0x60) {
+                    case 0x60:
+                        consumed = 3;
+                        break;
+                    case 0x40:
+                        consumed = 2;
+                        break;
+                    default:
+                        consumed = 1;
+                        break;
+                }
+                if (length - pos < consumed)
+                    goto cleanup;
+
+                const uint8_t *p = dafsa + pos;
+                if (consumed == 3) {
+                    offset += ((p[0] & 0x1F) << 16) | (p[1] << 8) | p[2];
+                } else if (consumed == 2) {
+                    offset += ((p[0] & 0x1F) << 8) | p[1];
+                } else {
+                    offset += p[0] & 0x3F;
+                }
+
+                if (offset >= length)
+                    goto cleanup;
+
+                if ((visited[offset] & ANT_PUBLIC_SUFFIX_VISITED_NODE) == 0) {
+                    visited[offset] |= ANT_PUBLIC_SUFFIX_VISITED_NODE;
+                    queue[queued++] = (offset << 1) | 1;
+                }
+
+                final = (p[0] & 0x80) != 0;
+                pos += consumed;
+            }
+        } else {
+            /* Node; label characters up to the final (high bit) character, which is either a return value or followed by an offset list */
+            while (true) {
+                if (pos >= length)
+                    goto cleanup;
+
+                uint8_t c = dafsa[pos];
+                if ((c & 0x7F) < 0x20 && (c & 0xE0) != 0x80)
+                    goto cleanup;
+
+                if ((c & 0xE0) == 0x80) {
+                    if ((c & 0x0F) > ANTPublicSuffixRuleException)
+                        goto cleanup;
+                    break;
+                }
+
+                pos++;
+                if (c & 0x80) {
+                    if (pos >= length)
+                        goto cleanup;
+
+                    if ((visited[pos] & ANT_PUBLIC_SUFFIX_VISITED_LIST) == 0) {
+                        visited[pos] |= ANT_PUBLIC_SUFFIX_VISITED_LIST;
+                        queue[queued++] = pos << 1;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    result = true;
+
+cleanup:
+    free(visited);
+    free(queue);
+    return result;
+}
+
+/**
+ * @internal
+ *
+ * Free @a table and its backing mapping. The built-in table is ignored.
+ */
+static void ANTPublicSuffixTableFree (ANTPublicSuffixTable *table) {
+    if (table == &ANTPublicSuffixBuiltinTable)
+        return;
+
+    munmap(table->mapping, table->mappingLength);
+    free(table);
+}
+
+/**
+ * @internal
+ *
+ * ANTEpochReleaseFunction that frees a retired table.
+ */
+static void ANTPublicSuffixTableRetired (void *table) {
+    ANTPublicSuffixTableFree(table);
+}
+
+/**
+ * @internal
+ *
+ * Atomically replace the current table with @a table. The previous table is retired, and freed once all lookups
+ * that may be using it have completed; the caller does not wait for them.
+ */
+static void ANTPublicSuffixTableReplace (ANTPublicSuffixTable *table) {
+    ANTPublicSuffixTable *previous;
+
+    OSSpinLockLock(&ANTPublicSuffixTableLock); {
+        previous = ANTPublicSuffixCurrentTable;
+        if (!OSAtomicCompareAndSwapPtrBarrier(previous, table, (void * volatile *) &ANTPublicSuffixCurrentTable)) {
+            /* Only writers holding the table lock may modify the table pointer */
+            __builtin_trap();
+        }
+    } OSSpinLockUnlock(&ANTPublicSuffixTableLock);
+
+    /* Lookups that acquired the previous table may still be walking it. New lookups will acquire the new table. */
+    if (previous != table && previous != &ANTPublicSuffixBuiltinTable)
+        ANTEpochRetire(previous, ANTPublicSuffixTableRetired);
+}
+
+/**
+ * Load a public suffix table from the binary file at @a path, as emitted by `process.py --binary`, and
+ * atomically replace the current table. The file is memory-mapped, rather than read, and remains mapped until
+ * the table is itself replaced.
+ *
+ * The file is fully validated before it is used; on failure, the current table is left in place. Lookups
+ * that are in progress on other threads will complete using the previous table.
+ *
+ * @warning As the file is mapped, it must not be modified in place. Updated tables should be written to a
+ * temporary file and then moved into place with rename(2).
+ *
+ * @param path The path to the binary table file.
+ *
+ * @return Returns 0 on success, or an errno value on failure. EINVAL is returned if the file is not a valid
+ * table.
+ */
+int ANTPublicSuffixLoadTable (const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) {
+        int error = errno;
+        close(fd);
+        return error;
+    }
+
+    if (sb.st_size < ANT_PUBLIC_SUFFIX_HEADER_LENGTH || sb.st_size > ANT_PUBLIC_SUFFIX_HEADER_LENGTH + ANT_PUBLIC_SUFFIX_MAX_LENGTH) {
+        close(fd);
+        return EINVAL;
+    }
+
+    size_t mappingLength = (size_t) sb.st_size;
+    void *mapping = mmap(NULL, mappingLength, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return error;
+
+    /* Validate the header and DAFSA */
+    const uint8_t *bytes = mapping;
+    size_t length = ANTPublicSuffixReadUInt32(bytes + 8);
+    if (memcmp(bytes, ANT_PUBLIC_SUFFIX_MAGIC, 4) != 0 ||
+        ANTPublicSuffixReadUInt32(bytes + 4) != ANT_PUBLIC_SUFFIX_VERSION ||
+        length != mappingLength - ANT_PUBLIC_SUFFIX_HEADER_LENGTH ||
+        !ANTPublicSuffixValidateDAFSA(bytes + ANT_PUBLIC_SUFFIX_HEADER_LENGTH, length))
+    {
+        munmap(mapping, mappingLength);
+        return EINVAL;
+    }
+
+    ANTPublicSuffixTable *table = malloc(sizeof(ANTPublicSuffixTable));
+    if (table == NULL) {
+        munmap(mapping, mappingLength);
+        return ENOMEM;
+    }
+
+    table->dafsa = bytes + ANT_PUBLIC_SUFFIX_HEADER_LENGTH;
+    table->length = length;
+    table->mapping = mapping;
+    table->mappingLength = mappingLength;
+
+    ANTPublicSuffixTableReplace(table);
+    return 0;
+}
+
+/**
+ * Restore the built-in public suffix table, releasing any table loaded via ANTPublicSuffixLoadTable().
+ */
+void ANTPublicSuffixResetTable (void) {
+    ANTPublicSuffixTableReplace(&ANTPublicSuffixBuiltinTable);
+}
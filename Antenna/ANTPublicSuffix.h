@@ -0,0 +1,64 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ANT_PUBLIC_SUFFIX_H
+#define ANT_PUBLIC_SUFFIX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Public suffix rule types, as defined by the Public Suffix List ( http://publicsuffix.org/list/ ).
+ */
+typedef enum {
+    /** No rule matched */
+    ANTPublicSuffixRuleNone = -1,
+
+    /** A standard TLD rule */
+    ANTPublicSuffixRuleStandard = 0,
+
+    /** A wildcard rule; everything *underneath* this rule is a TLD */
+    ANTPublicSuffixRuleWildcard = 1,
+
+    /** Exception rule; overrides a wildcard rule */
+    ANTPublicSuffixRuleException = 2
+} ANTPublicSuffixRuleType;
+
+ANTPublicSuffixRuleType ANTPublicSuffixLookupRule (const char *name, size_t length);
+size_t ANTPublicSuffixLength (const char *host, size_t length, bool *known);
+
+bool ANTPublicSuffixIsIPAddress (const char *host, size_t length);
+
+bool ANTPublicSuffixIsASCII (const char *name, size_t length);
+void ANTPublicSuffixLowercaseASCII (char *name, size_t length);
+bool ANTPublicSuffixCopyASCIIName (const char *name, size_t length, char *buffer, size_t size, size_t *written);
+
+int ANTPublicSuffixLoadTable (const char *path);
+void ANTPublicSuffixResetTable (void);
+
+#endif /* ANT_PUBLIC_SUFFIX_H */
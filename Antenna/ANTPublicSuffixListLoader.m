@@ -0,0 +1,153 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTPublicSuffixListLoader.h"
+
+#import <fcntl.h>
+#import <sys/stat.h>
+
+#import "ANTPublicSuffix.h"
+
+/**
+ * Manages loading of the process-wide public suffix table from a binary table file (see ANTPublicSuffixLoadTable()),
+ * and reloads the table when the file is replaced.
+ *
+ * The file's parent directory is monitored, rather than the file itself; updates are expected to be installed
+ * by atomically renaming a new file into place, which replaces the monitored file's inode. If the file is removed,
+ * the compiled-in table is restored.
+ *
+ * As the public suffix table is process-wide, only one loader should be instantiated.
+ */
+@implementation ANTPublicSuffixListLoader {
+@private
+    /** Serial queue on which all loads are performed. */
+    dispatch_queue_t _queue;
+
+    /** Directory change source, or NULL if the directory could not be monitored. */
+    dispatch_source_t _source;
+
+    /** The device and inode of the currently loaded table file, or 0 if the compiled-in table is in use. */
+    dev_t _loadedDevice;
+    ino_t _loadedInode;
+}
+
+/**
+ * Initialize a new loader, loading the table at @a path if it exists. The containing directory will be
+ * created if necessary.
+ *
+ * @param path The path of the binary public suffix table.
+ */
+- (instancetype) initWithPath: (NSString *) path {
+    PLSuperInit();
+
+    _path = path;
+    _queue = dispatch_queue_create("coop.plausible.antenna.public-suffix-list-loader", DISPATCH_QUEUE_SERIAL);
+
+    /* Create the directory */
+    NSString *directory = [path stringByDeletingLastPathComponent];
+    NSError *error;
+    if (![[NSFileManager defaultManager] createDirectoryAtPath: directory withIntermediateDirectories: YES attributes: @{NSFilePosixPermissions: @(0750)} error: &error]) {
+        /* This should only happen on a misconfigured host; the compiled-in table remains in use */
+        NSLog(@"Failed to create public suffix list path %@: %@", directory, error);
+        return self;
+    }
+
+    /* Perform the initial load synchronously, so that the table is in place before any cookies are accepted */
+    dispatch_sync(_queue, ^{
+        [self loadTable];
+    });
+
+    /* Monitor the directory for changes */
+    int fd = open([directory fileSystemRepresentation], O_EVTONLY);
+    if (fd < 0) {
+        NSLog(@"Failed to open public suffix list path %@ for monitoring: %s", directory, strerror(errno));
+        return self;
+    }
+
+    _source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd, DISPATCH_VNODE_WRITE | DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME, _queue);
+
+    __weak ANTPublicSuffixListLoader *weakSelf = self;
+    dispatch_source_set_event_handler(_source, ^{
+        [weakSelf loadTable];
+    });
+    dispatch_source_set_cancel_handler(_source, ^{
+        close(fd);
+    });
+    dispatch_resume(_source);
+
+    return self;
+}
+
+- (void) dealloc {
+    if (_source != NULL)
+        dispatch_source_cancel(_source);
+}
+
+/**
+ * Reload the table file, if it has been replaced since it was last loaded.
+ */
+- (void) reload {
+    dispatch_async(_queue, ^{
+        [self loadTable];
+    });
+}
+
+/**
+ * Load the table file, if it has changed. Must be called on _queue.
+ */
+- (void) loadTable {
+    const char *path = [_path fileSystemRepresentation];
+
+    struct stat sb;
+    if (stat(path, &sb) != 0) {
+        /* If the file has been removed, restore the compiled-in table */
+        if (errno == ENOENT && _loadedInode != 0) {
+            ANTPublicSuffixResetTable();
+            _loadedDevice = 0;
+            _loadedInode = 0;
+        } else if (errno != ENOENT) {
+            NSLog(@"Failed to stat public suffix list %@: %s", _path, strerror(errno));
+        }
+        return;
+    }
+
+    /* Files are replaced via rename(), so an unchanged inode is an unchanged table */
+    if (sb.st_dev == _loadedDevice && sb.st_ino == _loadedInode)
+        return;
+
+    int error = ANTPublicSuffixLoadTable(path);
+    if (error != 0) {
+        NSLog(@"Failed to load public suffix list %@: %s", _path, strerror(error));
+        return;
+    }
+
+    _loadedDevice = sb.st_dev;
+    _loadedInode = sb.st_ino;
+}
+
+@end
@@ -0,0 +1,275 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTPublicSuffix.h"
+#import "ANTPublicSuffixListLoader.h"
+
+/**
+ * A binary table (see ANTPublicSuffixLoadTable()) generated by `process.py --binary` from the rules:
+ *
+ *   antenna.test
+ *   *.wild.test
+ *   !www.wild.test
+ */
+static const uint8_t ANTPublicSuffixTestTable[] = {
+    0x41, 0x50, 0x53, 0x4c, 0x01, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00,
+    0x81, 0x74, 0x73, 0x65, 0x74, 0xae, 0x02, 0x8c, 0x64, 0x6c, 0x69, 0xf7,
+    0x02, 0x85, 0x2e, 0x77, 0x77, 0x77, 0x82, 0x81, 0x61, 0x6e, 0x6e, 0x65,
+    0x74, 0x6e, 0x61, 0x80
+};
+
+/** Offset of the DAFSA within ANTPublicSuffixTestTable; the header is a 4 byte magic, and 32-bit version and length. */
+#define TEST_TABLE_DAFSA_OFFSET 12
+
+@interface ANTPublicSuffixTests : XCTestCase @end
+
+@implementation ANTPublicSuffixTests {
+    /** Scratch directory for table files. */
+    NSString *_directory;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+    XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath: _directory withIntermediateDirectories: YES attributes: nil error: NULL], @"Failed to create scratch directory");
+}
+
+- (void) tearDown {
+    /* The table is process-wide */
+    ANTPublicSuffixResetTable();
+    [[NSFileManager defaultManager] removeItemAtPath: _directory error: NULL];
+
+    [super tearDown];
+}
+
+/* Write @a data to a new file in the scratch directory, returning its path */
+- (NSString *) writeTable: (NSData *) data name: (NSString *) name {
+    NSString *path = [_directory stringByAppendingPathComponent: name];
+    XCTAssertTrue([data writeToFile: path atomically: YES], @"Failed to write %@", path);
+    return path;
+}
+
+/* Return a mutable copy of the test table */
+static NSMutableData *TestTable (void) {
+    return [NSMutableData dataWithBytes: ANTPublicSuffixTestTable length: sizeof(ANTPublicSuffixTestTable)];
+}
+
+/* Return YES if the test table is in use */
+static BOOL TestTableLoaded (void) {
+    bool known;
+    return ANTPublicSuffixLength("www.antenna.test", 16, &known) == 12 && known;
+}
+
+/* Return YES if the built-in table is in use */
+static BOOL BuiltinTableLoaded (void) {
+    bool known;
+    return ANTPublicSuffixLength("www.example.com", 15, &known) == 3 && known;
+}
+
+/* Return the public suffix length of @a host, storing whether it was determined by a listed rule in @a known */
+static size_t SuffixLength (const char *host, bool *known) {
+    return ANTPublicSuffixLength(host, strlen(host), known);
+}
+
+/* Return YES if @a host is an IP address literal */
+static BOOL IsIPAddress (const char *host) {
+    return ANTPublicSuffixIsIPAddress(host, strlen(host));
+}
+
+- (void) testSuffixLength {
+    bool known;
+
+    /* Standard rules */
+    XCTAssertEqual(SuffixLength("com", &known), (size_t) 3, @"A TLD is its own public suffix");
+    XCTAssertTrue(known, @"Rule not found");
+    XCTAssertEqual(SuffixLength("www.example.com", &known), (size_t) 3, @"Incorrect suffix length");
+    XCTAssertTrue(known, @"Rule not found");
+    XCTAssertEqual(SuffixLength("WWW.Example.COM", &known), (size_t) 3, @"Uppercase characters should be matched case-insensitively");
+    XCTAssertEqual(SuffixLength("foo.github.io", &known), (size_t) 9, @"The longest matching rule should prevail");
+
+    /* Wildcard and exception rules */
+    XCTAssertEqual(SuffixLength("kawasaki.jp", &known), (size_t) 11, @"A wildcard rule's parent should be a public suffix");
+    XCTAssertEqual(SuffixLength("foo.kawasaki.jp", &known), (size_t) 15, @"A wildcard should match the next label");
+    XCTAssertEqual(SuffixLength("a.foo.kawasaki.jp", &known), (size_t) 15, @"A wildcard should match only a single label");
+    XCTAssertEqual(SuffixLength("city.kawasaki.jp", &known), (size_t) 11, @"An exception should override the wildcard");
+    XCTAssertEqual(SuffixLength("www.city.kawasaki.jp", &known), (size_t) 11, @"An exception should override the wildcard");
+    XCTAssertEqual(SuffixLength("example.co.uk", &known), (size_t) 5, @"Incorrect suffix length");
+    XCTAssertEqual(SuffixLength("www.bl.uk", &known), (size_t) 2, @"An exception should override the wildcard");
+    XCTAssertTrue(known, @"Rule not found");
+
+    /* Rules only match on label boundaries */
+    XCTAssertEqual(SuffixLength("notcom", &known), (size_t) 6, @"A rule matched within a label");
+    XCTAssertFalse(known, @"A rule matched within a label");
+
+    /* The implicit '*' rule */
+    XCTAssertEqual(SuffixLength("example.unknowntld", &known), (size_t) 10, @"The implicit rule should match the rightmost label");
+    XCTAssertFalse(known, @"Unlisted TLD reported as known");
+    XCTAssertEqual(SuffixLength("", &known), (size_t) 0, @"Incorrect suffix length for an empty host");
+    XCTAssertFalse(known, @"Empty host reported as known");
+
+    /* Internationalized rules are matched in their punycode form */
+    XCTAssertEqual(SuffixLength("example.xn--p1ai", &known), (size_t) 8, @"Incorrect suffix length");
+    XCTAssertTrue(known, @"Rule not found");
+}
+
+- (void) testLookupRule {
+    XCTAssertEqual(ANTPublicSuffixLookupRule("com", 3), ANTPublicSuffixRuleStandard, @"Incorrect rule type");
+    XCTAssertEqual(ANTPublicSuffixLookupRule("kawasaki.jp", 11), ANTPublicSuffixRuleWildcard, @"Incorrect rule type");
+    XCTAssertEqual(ANTPublicSuffixLookupRule("city.kawasaki.jp", 16), ANTPublicSuffixRuleException, @"Incorrect rule type");
+    XCTAssertEqual(ANTPublicSuffixLookupRule("example.com", 11), ANTPublicSuffixRuleNone, @"Only rules matching the whole name should be returned");
+}
+
+- (void) testIsIPAddress {
+    XCTAssertTrue(IsIPAddress("192.168.0.1"), @"IPv4 address not detected");
+    XCTAssertTrue(IsIPAddress("::1"), @"IPv6 address not detected");
+    XCTAssertTrue(IsIPAddress("fe80::1"), @"IPv6 address not detected");
+
+    XCTAssertFalse(IsIPAddress("256.1.1.1"), @"Out of range octet accepted");
+    XCTAssertFalse(IsIPAddress("1.2.3"), @"Truncated IPv4 address accepted");
+    XCTAssertFalse(IsIPAddress("www.example.com"), @"Host name reported as an address");
+}
+
+- (void) testCopyASCIIName {
+    char buffer[256];
+    size_t written;
+
+    XCTAssertTrue(ANTPublicSuffixCopyASCIIName("WWW.EXAMPLE.COM", 15, buffer, sizeof(buffer), &written), @"Conversion failed");
+    XCTAssertEqual(strncmp(buffer, "www.example.com", written), 0, @"ASCII name was not lowercased");
+    XCTAssertEqual(written, (size_t) 15, @"Incorrect length");
+
+    const char *idn = "B\xc3\xbc" "cher.Example";
+    XCTAssertTrue(ANTPublicSuffixCopyASCIIName(idn, strlen(idn), buffer, sizeof(buffer), &written), @"Conversion failed");
+    XCTAssertEqual(written, strlen("xn--bcher-kva.example"), @"Incorrect length");
+    XCTAssertEqual(strncmp(buffer, "xn--bcher-kva.example", written), 0, @"Incorrect punycode encoding");
+
+    /* Invalid UTF-8 and undersized buffers must be rejected */
+    XCTAssertFalse(ANTPublicSuffixCopyASCIIName("bad\xff.com", 8, buffer, sizeof(buffer), &written), @"Invalid UTF-8 accepted");
+    XCTAssertFalse(ANTPublicSuffixCopyASCIIName("example", 7, buffer, 4, &written), @"Buffer overrun");
+}
+
+- (void) testLoadTable {
+    XCTAssertTrue(BuiltinTableLoaded(), @"The built-in table should be in use by default");
+
+    NSString *path = [self writeTable: TestTable() name: @"test.apsl"];
+    XCTAssertEqual(ANTPublicSuffixLoadTable([path fileSystemRepresentation]), 0, @"Failed to load a valid table");
+    XCTAssertTrue(TestTableLoaded(), @"Loaded table not in use");
+    XCTAssertFalse(BuiltinTableLoaded(), @"Built-in rules matched after replacement");
+
+    bool known;
+    XCTAssertEqual(SuffixLength("x.a.wild.test", &known), (size_t) 11, @"Wildcard rule not applied from the loaded table");
+    XCTAssertEqual(SuffixLength("www.wild.test", &known), (size_t) 9, @"Exception rule not applied from the loaded table");
+
+    /* Replacing a loaded table must release the previous table, and leave the new one in place */
+    XCTAssertEqual(ANTPublicSuffixLoadTable([path fileSystemRepresentation]), 0, @"Failed to reload a valid table");
+    XCTAssertTrue(TestTableLoaded(), @"Reloaded table not in use");
+
+    /* The file may be removed once mapped */
+    [[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+    XCTAssertTrue(TestTableLoaded(), @"Loaded table not in use");
+
+    ANTPublicSuffixResetTable();
+    XCTAssertTrue(BuiltinTableLoaded(), @"The built-in table was not restored");
+    XCTAssertFalse(TestTableLoaded(), @"Loaded rules matched after reset");
+}
+
+- (void) testLoadTableRejectsMalformedFiles {
+    /* Load a valid table; rejected files must leave it in place */
+    XCTAssertEqual(ANTPublicSuffixLoadTable([[self writeTable: TestTable() name: @"valid.apsl"] fileSystemRepresentation]), 0, @"Failed to load a valid table");
+
+    NSMutableDictionary *cases = [NSMutableDictionary dictionary];
+
+    cases[@"empty"] = [NSData data];
+    cases[@"header"] = [TestTable() subdataWithRange: NSMakeRange(0, 5)];
+    cases[@"truncated"] = [TestTable() subdataWithRange: NSMakeRange(0, sizeof(ANTPublicSuffixTestTable) - 4)];
+
+    NSMutableData *data = TestTable();
+    memcpy(data.mutableBytes, "APSX", 4);
+    cases[@"magic"] = data;
+
+    data = TestTable();
+    ((uint8_t *) data.mutableBytes)[4] = 2;
+    cases[@"version"] = data;
+
+    /* Truncated, with a header length that is consistent with the file */
+    data = [[TestTable() subdataWithRange: NSMakeRange(0, sizeof(ANTPublicSuffixTestTable) - 4)] mutableCopy];
+    ((uint8_t *) data.mutableBytes)[8] -= 4;
+    cases[@"truncated-dafsa"] = data;
+
+    /* A root offset that lies beyond the end of the DAFSA */
+    data = TestTable();
+    ((uint8_t *) data.mutableBytes)[TEST_TABLE_DAFSA_OFFSET] = 0xBF;
+    cases[@"offset"] = data;
+
+    for (NSString *name in cases) {
+        NSString *path = [self writeTable: cases[name] name: name];
+        XCTAssertEqual(ANTPublicSuffixLoadTable([path fileSystemRepresentation]), EINVAL, @"Malformed table (%@) was not rejected", name);
+        XCTAssertTrue(TestTableLoaded(), @"Malformed table (%@) replaced the current table", name);
+    }
+
+    NSString *missing = [_directory stringByAppendingPathComponent: @"missing.apsl"];
+    XCTAssertEqual(ANTPublicSuffixLoadTable([missing fileSystemRepresentation]), ENOENT, @"Missing table was not reported");
+    XCTAssertTrue(TestTableLoaded(), @"Missing table replaced the current table");
+}
+
+/* Spin the run loop until @a condition returns YES, or a timeout elapses */
+static BOOL WaitFor (BOOL (^condition)(void)) {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+    while (!condition()) {
+        if ([deadline timeIntervalSinceNow] < 0)
+            return NO;
+        [[NSRunLoop currentRunLoop] runUntilDate: [NSDate dateWithTimeIntervalSinceNow: 0.01]];
+    }
+    return YES;
+}
+
+- (void) testListLoader {
+    NSString *path = [[_directory stringByAppendingPathComponent: @"PublicSuffixList"] stringByAppendingPathComponent: @"effective_tld_names.apsl"];
+
+    /* With no table file, the built-in table remains in use */
+    ANTPublicSuffixListLoader *loader = [[ANTPublicSuffixListLoader alloc] initWithPath: path];
+    XCTAssertTrue(BuiltinTableLoaded(), @"The built-in table should be used when no table file exists");
+
+    /* A malformed file is ignored */
+    XCTAssertTrue([[NSData dataWithBytes: "APSX" length: 4] writeToFile: path atomically: YES], @"Failed to write table");
+    [loader reload];
+    XCTAssertTrue(BuiltinTableLoaded(), @"A malformed table replaced the built-in table");
+
+    /* Install a table by renaming it into place */
+    XCTAssertTrue([TestTable() writeToFile: path atomically: YES], @"Failed to write table");
+    [loader reload];
+    XCTAssertTrue(WaitFor(^{ return TestTableLoaded(); }), @"The installed table was not loaded");
+
+    /* Removing the file restores the built-in table */
+    XCTAssertTrue([[NSFileManager defaultManager] removeItemAtPath: path error: NULL], @"Failed to remove table");
+    [loader reload];
+    XCTAssertTrue(WaitFor(^{ return BuiltinTableLoaded(); }), @"The built-in table was not restored");
+}
+
+@end
@@ -0,0 +1,210 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTRadarAttribution.h"
+#include "ANTRadarDate.h"
+
+/*
+ * An anchored, single pass scanner for the attribution line that prefixes Radar comment text. The accepted grammar is
+ * that of the regular expression previously used to strip these lines:
+ *
+ *   <[A-Z0-9+]+-[A-Za-z]+-[0-9]+ [0-9]+:[0-9]+:[0-9]+[A-Z0-9+]+> .*:[ \t\n]*
+ *
+ * where '.' matches any character other than a line terminator, and the match must begin at the start of the text.
+ */
+
+/**
+ * @internal
+ *
+ * Return true if @a c is in [A-Z0-9+], the time zone character class.
+ */
+static inline bool ANTRadarAttributionIsZone (uint16_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '+';
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a c is a decimal digit.
+ */
+static inline bool ANTRadarAttributionIsDigit (uint16_t c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a c is an ASCII letter.
+ */
+static inline bool ANTRadarAttributionIsAlpha (uint16_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a c is a line terminator, as defined by ICU regular expressions.
+ */
+static inline bool ANTRadarAttributionIsLineTerminator (uint16_t c) {
+    return (c >= 0x0A && c <= 0x0D) || c == 0x85 || c == 0x2028 || c == 0x2029;
+}
+
+/**
+ * @internal
+ *
+ * Advance @a pos past a run of characters matching @a predicate, returning false if the run is empty.
+ */
+static inline bool ANTRadarAttributionSkip (const uint16_t *chars, size_t length, size_t *pos, bool (*predicate)(uint16_t)) {
+    size_t start = *pos;
+    while (*pos < length && predicate(chars[*pos]))
+        (*pos)++;
+
+    return *pos > start;
+}
+
+/**
+ * @internal
+ *
+ * Advance @a pos past the character @a c, returning false if the character at @a pos is not @a c.
+ */
+static inline bool ANTRadarAttributionExpect (const uint16_t *chars, size_t length, size_t *pos, uint16_t c) {
+    if (*pos >= length || chars[*pos] != c)
+        return false;
+
+    (*pos)++;
+    return true;
+}
+
+/**
+ * Return the number of code units at the start of a text that ANTRadarAttributionScan() must be given to determine
+ * whether the text begins with an attribution line: the first line, and any whitespace that may follow the attribution.
+ * This allows a caller that must copy out the text's characters to copy only a prefix of the text.
+ *
+ * @param chars A prefix of the text.
+ * @param length The number of code units in @a chars.
+ *
+ * @return Returns the required prefix length, which will not exceed @a length, or 0 if a longer prefix must be examined.
+ * If @a chars is the entire text, and 0 is returned, the entire text is required.
+ */
+size_t ANTRadarAttributionScanLength (const uint16_t *chars, size_t length) {
+    /* Fail fast on text that can not begin with an attribution */
+    if (length > 0 && chars[0] != '<')
+        return 1;
+
+    size_t pos = 0;
+    while (pos < length && !ANTRadarAttributionIsLineTerminator(chars[pos]))
+        pos++;
+
+    /* The whitespace following the attribution may continue past the line terminator; include the character that ends it */
+    while (pos < length && (chars[pos] == ' ' || chars[pos] == '\t' || chars[pos] == '\n'))
+        pos++;
+
+    if (pos == length)
+        return 0;
+
+    return pos + 1;
+}
+
+/**
+ * Scan the attribution line at the start of @a chars.
+ *
+ * @param chars The UTF-16 text to be scanned.
+ * @param length The number of code units in @a chars.
+ * @param truncated If true, @a chars is a prefix of a longer text. The scan will fail if the attribution line is not
+ * terminated within @a chars, as the remainder of the line can not be examined.
+ * @param attribution On success, the parsed attribution.
+ *
+ * @return Returns true if @a chars begins with an attribution line, or false otherwise.
+ */
+bool ANTRadarAttributionScan (const uint16_t *chars, size_t length, bool truncated, ANTRadarAttribution *attribution) {
+    size_t pos = 0;
+
+    /* <[A-Z0-9+]+-[A-Za-z]+-[0-9]+ [0-9]+:[0-9]+: */
+    if (!ANTRadarAttributionExpect(chars, length, &pos, '<') ||
+        !ANTRadarAttributionSkip(chars, length, &pos, ANTRadarAttributionIsZone) ||
+        !ANTRadarAttributionExpect(chars, length, &pos, '-') ||
+        !ANTRadarAttributionSkip(chars, length, &pos, ANTRadarAttributionIsAlpha) ||
+        !ANTRadarAttributionExpect(chars, length, &pos, '-') ||
+        !ANTRadarAttributionSkip(chars, length, &pos, ANTRadarAttributionIsDigit) ||
+        !ANTRadarAttributionExpect(chars, length, &pos, ' ') ||
+        !ANTRadarAttributionSkip(chars, length, &pos, ANTRadarAttributionIsDigit) ||
+        !ANTRadarAttributionExpect(chars, length, &pos, ':') ||
+        !ANTRadarAttributionSkip(chars, length, &pos, ANTRadarAttributionIsDigit) ||
+        !ANTRadarAttributionExpect(chars, length, &pos, ':'))
+    {
+        return false;
+    }
+
+    /* [0-9]+[A-Z0-9+]+ is a single run of the zone class that begins with a digit and is at least two characters long */
+    size_t secondsStart = pos;
+    if (pos >= length || !ANTRadarAttributionIsDigit(chars[pos]))
+        return false;
+
+    ANTRadarAttributionSkip(chars, length, &pos, ANTRadarAttributionIsZone);
+    if (pos - secondsStart < 2)
+        return false;
+
+    /* '> ' */
+    size_t dateEnd = pos;
+    if (!ANTRadarAttributionExpect(chars, length, &pos, '>') || !ANTRadarAttributionExpect(chars, length, &pos, ' '))
+        return false;
+
+    /* .*: matches up to the last colon on the line */
+    size_t authorStart = pos;
+    size_t colon = length;
+    while (pos < length && !ANTRadarAttributionIsLineTerminator(chars[pos])) {
+        if (chars[pos] == ':')
+            colon = pos;
+        pos++;
+    }
+
+    if (colon == length || (pos == length && truncated))
+        return false;
+
+    /* [ \t\n]* */
+    pos = colon + 1;
+    while (pos < length && (chars[pos] == ' ' || chars[pos] == '\t' || chars[pos] == '\n'))
+        pos++;
+
+    attribution->authorOffset = authorStart;
+    attribution->authorLength = colon - authorStart;
+    attribution->length = pos;
+
+    /* Parse the timestamp, if it is in the standard GMT form */
+    char date[28];
+    size_t dateLength = dateEnd + 1;
+    attribution->hasTimestamp = false;
+    if (dateLength == sizeof(date)) {
+        for (size_t i = 0; i < dateLength; i++)
+            date[i] = (char) chars[i];
+
+        attribution->hasTimestamp = ANTRadarDateParseAttribution(date, dateLength, &attribution->timestamp);
+    }
+
+    return true;
+}
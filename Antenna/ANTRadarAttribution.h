@@ -0,0 +1,60 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ANT_RADAR_ATTRIBUTION_H
+#define ANT_RADAR_ATTRIBUTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A Radar comment attribution line, eg, "<GMT09-Aug-2013 21:14:47GMT> Landon Fuller:". All offsets are in UTF-16 code units,
+ * relative to the start of the scanned text.
+ */
+typedef struct ANTRadarAttribution {
+    /** The offset of the author's name. */
+    size_t authorOffset;
+
+    /** The length of the author's name; may be 0. */
+    size_t authorLength;
+
+    /** True if the attribution's timestamp is in the GMT form, and was successfully parsed. */
+    bool hasTimestamp;
+
+    /** If hasTimestamp is true, the attribution time, in seconds since 00:00:00 UTC on 1 January 1970. */
+    double timestamp;
+
+    /** The length of the attribution line, including any whitespace that follows it. The attributed text begins at this offset. */
+    size_t length;
+} ANTRadarAttribution;
+
+size_t ANTRadarAttributionScanLength (const uint16_t *chars, size_t length);
+bool ANTRadarAttributionScan (const uint16_t *chars, size_t length, bool truncated, ANTRadarAttribution *attribution);
+
+#endif /* ANT_RADAR_ATTRIBUTION_H */
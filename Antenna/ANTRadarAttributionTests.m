@@ -0,0 +1,91 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTRadarAttribution.h"
+
+@interface ANTRadarAttributionTests : XCTestCase @end
+
+@implementation ANTRadarAttributionTests
+
+/**
+ * Scan @a string, returning the result via @a attribution.
+ */
+- (BOOL) scanString: (NSString *) string attribution: (ANTRadarAttribution *) attribution {
+    UniChar chars[[string length]];
+    [string getCharacters: chars range: NSMakeRange(0, [string length])];
+    return ANTRadarAttributionScan(chars, [string length], false, attribution);
+}
+
+- (void) testScan {
+    NSString *string = @"<GMT09-Aug-2013 21:14:47GMT> Landon Fuller:\n\nSummary: text";
+    ANTRadarAttribution attribution;
+
+    XCTAssertTrue([self scanString: string attribution: &attribution], @"Failed to scan %@", string);
+    XCTAssertEqualObjects([string substringFromIndex: attribution.length], @"Summary: text", @"Incorrect attribution length");
+    XCTAssertEqualObjects([string substringWithRange: NSMakeRange(attribution.authorOffset, attribution.authorLength)], @"Landon Fuller", @"Incorrect author");
+    XCTAssertTrue(attribution.hasTimestamp, @"Timestamp was not parsed");
+    XCTAssertEqual(attribution.timestamp, 1376082887.0, @"Incorrect timestamp");
+
+    /* Non-GMT zones are recognized, but the timestamp is not parsed */
+    string = @"<PST09-Aug-2013 21:14:47PST> Landon Fuller: text";
+    XCTAssertTrue([self scanString: string attribution: &attribution], @"Failed to scan %@", string);
+    XCTAssertEqualObjects([string substringFromIndex: attribution.length], @"text", @"Incorrect attribution length");
+    XCTAssertFalse(attribution.hasTimestamp, @"Parsed non-GMT timestamp");
+}
+
+- (void) testScanLength {
+    /* The first line and the whitespace that follows it are required, however long the line */
+    NSString *author = [@"" stringByPaddingToLength: 1000 withString: @"Landon Fuller " startingAtIndex: 0];
+    NSString *string = [NSString stringWithFormat: @"<GMT09-Aug-2013 21:14:47GMT> %@:\n\nSummary: text", author];
+    UniChar chars[[string length]];
+    [string getCharacters: chars range: NSMakeRange(0, [string length])];
+
+    size_t required = [string length] - [@"ummary: text" length];
+    XCTAssertEqual(ANTRadarAttributionScanLength(chars, 256), (size_t) 0, @"Scan length found within a partial line");
+    XCTAssertEqual(ANTRadarAttributionScanLength(chars, required - 1), (size_t) 0, @"Scan length found within trailing whitespace");
+    XCTAssertEqual(ANTRadarAttributionScanLength(chars, [string length]), required, @"Incorrect scan length");
+
+    ANTRadarAttribution attribution;
+    XCTAssertTrue(ANTRadarAttributionScan(chars, required, true, &attribution), @"Failed to scan the required prefix");
+    XCTAssertEqualObjects([string substringFromIndex: attribution.length], @"Summary: text", @"Incorrect attribution length");
+
+    /* Text that does not begin with an attribution is rejected after a single character */
+    XCTAssertEqual(ANTRadarAttributionScanLength(chars + 1, [string length] - 1), (size_t) 1, @"Incorrect scan length");
+}
+
+- (void) testInvalid {
+    ANTRadarAttribution attribution;
+    for (NSString *string in @[@"", @"Summary: text", @" <GMT09-Aug-2013 21:14:47GMT> Landon Fuller:", @"<GMT09-Aug-2013 21:14:47GMT> Landon Fuller\nSummary: text",
+                               @"<GMT09-Aug-2013 21:14GMT> Landon Fuller:", @"<GMT09-Aug-2013 21:14:47GMT>Landon Fuller:"])
+    {
+        XCTAssertFalse([self scanString: string attribution: &attribution], @"Scanned invalid attribution %@", string);
+    }
+}
+
+@end
@@ -382,7 +382,7 @@
 
     /* Request summaries for all supported sections */
     NSArray *sections = @[ANTNetworkClientFolderTypeOpen, ANTNetworkClientFolderTypeClosed, ANTNetworkClientFolderTypeArchive];
-    [_client requestSummariesForSections: sections maximumCount: MAX_RADARS cancelTicket: ticket dispatchContext: concurrentContext completionHandler: ^(NSArray *summaries, NSError *error) {
+    [_client requestSummariesForSections: sections maximumCount: MAX_RADARS priority: ANTNetworkRequestPriorityBackgroundSync cancelTicket: ticket dispatchContext: concurrentContext completionHandler: ^(NSArray *summaries, NSError *error) {
         /* Handle network failure */
         if (error != nil) {
             NSLog(@"A network request failure occured: %@", error);
@@ -404,7 +404,7 @@
         /* Iterate over the summary data, fetching and caching the Radar contents. */
         for (ANTRadarSummaryResponse *summaryResponse in summaries) {
             /* Fetch the radar details for each radar summary and insert into the backing database. We maintain serialization through the use of a shared serial context*/
-            [_client requestRadarWithId: summaryResponse.radarId cancelTicket: multiRequestCancellation.ticket dispatchContext: serialContext completionHandler: ^(ANTRadarResponse *radarResponse, NSError *error) {
+            [_client requestRadarWithId: summaryResponse.radarId priority: ANTNetworkRequestPriorityBackgroundSync cancelTicket: multiRequestCancellation.ticket dispatchContext: serialContext completionHandler: ^(ANTRadarResponse *radarResponse, NSError *error) {
                 PLSqliteDatabase *db;
                 NSError *dbError;
                 
@@ -0,0 +1,182 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTRadarDate.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * A parser for the fixed date formats used by Radar Web, which are always GMT:
+ *
+ *   - "dd-MMM-yyyy HH:mm", eg, "09-Aug-2013 21:14"
+ *   - "dd-MMM-yyyy HH:mm:ss", eg, "09-Aug-2013 21:14:47"
+ *   - The comment attribution form, "<GMTdd-MMM-yyyy HH:mm:ssGMT>"
+ *
+ * The parser performs no allocation and holds no state, and is safe to call concurrently from any thread. Any input
+ * that does not exactly match one of these formats is rejected, allowing the caller to fall back on a general purpose
+ * date parser.
+ */
+
+/**
+ * @internal
+ *
+ * Return the two digit value at @a p, or -1 if either byte is not a digit.
+ */
+static inline int ANTRadarDateDigits2 (const char *p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9')
+        return -1;
+
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+/**
+ * @internal
+ *
+ * Return the 1-based month number of the English three letter month abbreviation at @a p, ignoring case, or 0.
+ */
+static inline unsigned ANTRadarDateMonth (const char *p) {
+    /* Pack the lowercased letters into a single value, allowing each month to be matched with a single comparison */
+    uint32_t key = ((uint32_t) (p[0] | 0x20) << 16) | ((uint32_t) (p[1] | 0x20) << 8) | (uint32_t) (p[2] | 0x20);
+
+#define ANT_MONTH(a, b, c) (((uint32_t) (a) << 16) | ((uint32_t) (b) << 8) | (uint32_t) (c))
+    static const uint32_t months[12] = {
+        ANT_MONTH('j', 'a', 'n'), ANT_MONTH('f', 'e', 'b'), ANT_MONTH('m', 'a', 'r'), ANT_MONTH('a', 'p', 'r'),
+        ANT_MONTH('m', 'a', 'y'), ANT_MONTH('j', 'u', 'n'), ANT_MONTH('j', 'u', 'l'), ANT_MONTH('a', 'u', 'g'),
+        ANT_MONTH('s', 'e', 'p'), ANT_MONTH('o', 'c', 't'), ANT_MONTH('n', 'o', 'v'), ANT_MONTH('d', 'e', 'c')
+    };
+#undef ANT_MONTH
+
+    for (unsigned i = 0; i < 12; i++) {
+        if (months[i] == key)
+            return i + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Return the number of days in @a month of @a year.
+ */
+static inline unsigned ANTRadarDateDaysInMonth (int year, unsigned month) {
+    static const unsigned days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+    if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)))
+        return 29;
+
+    return days[month - 1];
+}
+
+/**
+ * @internal
+ *
+ * Return the number of days between 1970-01-01 and the given proleptic Gregorian date.
+ *
+ * This is Howard Hinnant's days_from_civil() algorithm, which computes the day count directly from the
+ * 400-year Gregorian cycle, without tables or loops.
+ */
+static inline int64_t ANTRadarDateDaysFromCivil (int64_t year, unsigned month, unsigned day) {
+    year -= (month <= 2);
+
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = (unsigned) (year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + (int64_t) dayOfEra - 719468;
+}
+
+/**
+ * Parse a Radar date of the form "dd-MMM-yyyy HH:mm" or "dd-MMM-yyyy HH:mm:ss", in GMT.
+ *
+ * @param string The date string. Need not be NUL terminated.
+ * @param length The length of @a string, in bytes.
+ * @param time On success, the parsed date, in seconds since 00:00:00 UTC on 1 January 1970.
+ *
+ * @return Returns true on success, or false if @a string is not a valid date in one of the supported formats.
+ */
+bool ANTRadarDateParse (const char *string, size_t length, double *time) {
+    /* 0         1
+     * 01234567890123456789
+     * dd-MMM-yyyy HH:mm:ss */
+    if (length != 17 && length != 20)
+        return false;
+
+    if (string[2] != '-' || string[6] != '-' || string[11] != ' ' || string[14] != ':')
+        return false;
+
+    int day = ANTRadarDateDigits2(string);
+    unsigned month = ANTRadarDateMonth(string + 3);
+    int century = ANTRadarDateDigits2(string + 7);
+    int yearOfCentury = ANTRadarDateDigits2(string + 9);
+    int hour = ANTRadarDateDigits2(string + 12);
+    int minute = ANTRadarDateDigits2(string + 15);
+    int second = 0;
+
+    if (length == 20) {
+        if (string[17] != ':')
+            return false;
+        second = ANTRadarDateDigits2(string + 18);
+    }
+
+    if (month == 0 || century < 0 || yearOfCentury < 0)
+        return false;
+
+    int year = century * 100 + yearOfCentury;
+    if (day < 1 || (unsigned) day > ANTRadarDateDaysInMonth(year, month))
+        return false;
+
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59)
+        return false;
+
+    int64_t days = ANTRadarDateDaysFromCivil(year, month, (unsigned) day);
+    *time = (double) (days * 86400 + hour * 3600 + minute * 60 + second);
+    return true;
+}
+
+/**
+ * Parse a Radar comment attribution date of the form "<GMTdd-MMM-yyyy HH:mm:ssGMT>".
+ *
+ * @param string The date string. Need not be NUL terminated.
+ * @param length The length of @a string, in bytes.
+ * @param time On success, the parsed date, in seconds since 00:00:00 UTC on 1 January 1970.
+ *
+ * @return Returns true on success, or false if @a string is not a valid attribution date.
+ */
+bool ANTRadarDateParseAttribution (const char *string, size_t length, double *time) {
+    /* "<GMT" + "dd-MMM-yyyy HH:mm:ss" + "GMT>" */
+    if (length != 28)
+        return false;
+
+    if (memcmp(string, "<GMT", 4) != 0 || memcmp(string + 24, "GMT>", 4) != 0)
+        return false;
+
+    return ANTRadarDateParse(string + 4, 20, time);
+}
@@ -0,0 +1,76 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <XCTest/XCTest.h>
+#import "ANTRadarDate.h"
+
+@interface ANTRadarDateTests : XCTestCase @end
+
+@implementation ANTRadarDateTests
+
+/**
+ * Parse @a string with NSDateFormatter, for comparison.
+ */
+- (NSTimeInterval) referenceTimeForString: (NSString *) string format: (NSString *) format {
+    NSDateFormatter *formatter = [NSDateFormatter new];
+    [formatter setDateFormat: format];
+    [formatter setLocale: [[NSLocale alloc] initWithLocaleIdentifier:@"en_US"]];
+    [formatter setTimeZone: [NSTimeZone timeZoneForSecondsFromGMT: 0]];
+    return [[formatter dateFromString: string] timeIntervalSince1970];
+}
+
+- (void) testParse {
+    double time;
+
+    for (NSString *string in @[@"09-Aug-2013 21:14", @"29-Feb-2012 00:00", @"31-Dec-1969 23:59", @"01-Mar-2000 12:30"]) {
+        XCTAssertTrue(ANTRadarDateParse([string UTF8String], [string length], &time), @"Failed to parse %@", string);
+        XCTAssertEqual(time, [self referenceTimeForString: string format: @"dd-MMM-yyyy HH:mm"], @"Incorrect time for %@", string);
+    }
+
+    NSString *string = @"09-Aug-2013 21:14:47";
+    XCTAssertTrue(ANTRadarDateParse([string UTF8String], [string length], &time), @"Failed to parse %@", string);
+    XCTAssertEqual(time, [self referenceTimeForString: string format: @"dd-MMM-yyyy HH:mm:ss"], @"Incorrect time for %@", string);
+
+    string = @"<GMT09-Aug-2013 21:14:47GMT>";
+    XCTAssertTrue(ANTRadarDateParseAttribution([string UTF8String], [string length], &time), @"Failed to parse %@", string);
+    XCTAssertEqual(time, 1376082887.0, @"Incorrect time for %@", string);
+}
+
+- (void) testInvalid {
+    double time;
+    for (NSString *string in @[@"29-Feb-2013 10:00", @"31-Apr-2013 10:00", @"00-Jan-2013 10:00", @"01-Foo-2013 10:00",
+                               @"01-Jan-2013 24:00", @"01-Jan-2013 23:60", @"1-Jan-2013 10:00", @"01-Jan-2013T10:00", @""])
+    {
+        XCTAssertFalse(ANTRadarDateParse([string UTF8String], [string length], &time), @"Parsed invalid date %@", string);
+    }
+
+    NSString *string = @"<PST09-Aug-2013 21:14:47PST>";
+    XCTAssertFalse(ANTRadarDateParseAttribution([string UTF8String], [string length], &time), @"Parsed non-GMT attribution %@", string);
+}
+
+@end
@@ -28,7 +28,7 @@
 
 #import <Foundation/Foundation.h>
 
-@interface ANTRadarCommentResponse : NSObject
+@interface ANTRadarCommentResponse : NSObject <NSSecureCoding>
 
 - (instancetype) initWithAuthorName: (NSString *) authorName
                             content: (NSString *) content
@@ -45,7 +45,7 @@
 
 @end
 
-@interface ANTRadarResponse : NSObject
+@interface ANTRadarResponse : NSObject <NSSecureCoding>
 
 - (instancetype) initWithTitle: (NSString *) title
                       comments: (NSArray *) comments
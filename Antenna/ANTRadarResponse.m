@@ -51,6 +51,33 @@
     return self;
 }
 
+// from NSSecureCoding protocol
++ (BOOL) supportsSecureCoding {
+    return YES;
+}
+
+// from NSCoding protocol
+- (instancetype) initWithCoder: (NSCoder *) coder {
+    PLSuperInit();
+
+    _title = [coder decodeObjectOfClass: [NSString class] forKey: @"title"];
+    _comments = [coder decodeObjectOfClasses: [NSSet setWithObjects: [NSArray class], [ANTRadarCommentResponse class], nil] forKey: @"comments"];
+    _resolved = [coder decodeBoolForKey: @"resolved"];
+    _lastModifiedDate = [coder decodeObjectOfClass: [NSDate class] forKey: @"lastModifiedDate"];
+    _enclosureId = [coder decodeObjectOfClass: [NSString class] forKey: @"enclosureId"];
+
+    return self;
+}
+
+// from NSCoding protocol
+- (void) encodeWithCoder: (NSCoder *) coder {
+    [coder encodeObject: _title forKey: @"title"];
+    [coder encodeObject: _comments forKey: @"comments"];
+    [coder encodeBool: _resolved forKey: @"resolved"];
+    [coder encodeObject: _lastModifiedDate forKey: @"lastModifiedDate"];
+    [coder encodeObject: _enclosureId forKey: @"enclosureId"];
+}
+
 @end
 
 /**
@@ -71,4 +98,27 @@
     return self;
 }
 
+// from NSSecureCoding protocol
++ (BOOL) supportsSecureCoding {
+    return YES;
+}
+
+// from NSCoding protocol
+- (instancetype) initWithCoder: (NSCoder *) coder {
+    PLSuperInit();
+
+    _authorName = [coder decodeObjectOfClass: [NSString class] forKey: @"authorName"];
+    _content = [coder decodeObjectOfClass: [NSString class] forKey: @"content"];
+    _timestamp = [coder decodeObjectOfClass: [NSDate class] forKey: @"timestamp"];
+
+    return self;
+}
+
+// from NSCoding protocol
+- (void) encodeWithCoder: (NSCoder *) coder {
+    [coder encodeObject: _authorName forKey: @"authorName"];
+    [coder encodeObject: _content forKey: @"content"];
+    [coder encodeObject: _timestamp forKey: @"timestamp"];
+}
+
 @end
\ No newline at end of file
@@ -210,7 +210,7 @@
     
     // XXX - We should actually display the radar ...
     ANTRadarSummaryResponse *summary = [_summaries objectAtIndex: [selection firstIndex]];
-    [_client requestRadarWithId: summary.radarId cancelTicket: [PLCancelTicketSource new].ticket dispatchContext: [PLGCDDispatchContext mainQueueContext] completionHandler:^(ANTRadarResponse *radar, NSError *error) {
+    [_client requestRadarWithId: summary.radarId priority: ANTNetworkRequestPriorityInteractive cancelTicket: [PLCancelTicketSource new].ticket dispatchContext: [PLGCDDispatchContext mainQueueContext] completionHandler:^(ANTRadarResponse *radar, NSError *error) {
         NSLog(@"Radar: %@", radar.title);
     }];
 }
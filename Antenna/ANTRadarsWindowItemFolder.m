@@ -79,7 +79,7 @@
 
 // from ANTRadarsWindowItemDataSource protocol
 - (void) radarSummariesWithCancelTicket: (PLCancelTicket *) ticket dispatchContext: (id<PLDispatchContext>) context completionHander: (void (^)(NSArray *, NSError *))handler {
-    [_client requestSummariesForSections: _sectionNames maximumCount: MAX_RADARS cancelTicket: ticket dispatchContext: context completionHandler: handler];
+    [_client requestSummariesForSections: _sectionNames maximumCount: MAX_RADARS priority: ANTNetworkRequestPriorityFolderListing cancelTicket: ticket dispatchContext: context completionHandler: handler];
 }
 
 // from NSCopying protocol
@@ -0,0 +1,450 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ANTSetCookie.h"
+
+#include <string.h>
+#include <strings.h>
+
+/*
+ * Set-Cookie header values are tokenized in place, following the parsing algorithm of RFC 6265, section 5.2.
+ *
+ * NSHTTPURLResponse coalesces multiple Set-Cookie headers into a single comma separated value. As the Expires
+ * attribute may itself contain a comma ("Expires=Wed, 09 Jun 2021 10:18:14 GMT"), a comma is only treated as
+ * a cookie separator if it is followed by a name=value pair.
+ */
+
+/** Maximum supported Max-Age value, in seconds; larger values are clamped. */
+#define ANT_SET_COOKIE_MAX_AGE_LIMIT ((int64_t) 1 << 40)
+
+/**
+ * @internal
+ *
+ * Return true if @a c is linear whitespace.
+ */
+static inline bool ANTSetCookieIsWhitespace (char c) {
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a c is an RFC 2616 token character.
+ */
+static inline bool ANTSetCookieIsTokenCharacter (char c) {
+    unsigned char uc = (unsigned char) c;
+    if (uc <= 0x20 || uc >= 0x7F)
+        return false;
+
+    return strchr("()<>@,;:\\\"/[]?={}", c) == NULL;
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a c is an ASCII digit.
+ */
+static inline bool ANTSetCookieIsDigit (char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * @internal
+ *
+ * Return true if the comma at @a p separates two cookies; that is, if it is followed by a name=value pair.
+ */
+static bool ANTSetCookieIsSeparator (const char *p, const char *end) {
+    p++;
+    while (p < end && ANTSetCookieIsWhitespace(*p))
+        p++;
+
+    const char *token = p;
+    while (p < end && ANTSetCookieIsTokenCharacter(*p))
+        p++;
+
+    if (p == token)
+        return false;
+
+    while (p < end && ANTSetCookieIsWhitespace(*p))
+        p++;
+
+    return p < end && *p == '=';
+}
+
+/**
+ * @internal
+ *
+ * Scan from @a p to the end of the current field, which is terminated by ';', a cookie separator, or
+ * (if @a stopAtEquals is true) '='.
+ *
+ * @return Returns a pointer to the terminating character, or @a end.
+ */
+static const char *ANTSetCookieScan (const char *p, const char *end, bool stopAtEquals) {
+    for (; p < end; p++) {
+        if (*p == ';')
+            break;
+
+        if (stopAtEquals && *p == '=')
+            break;
+
+        if (*p == ',' && ANTSetCookieIsSeparator(p, end))
+            break;
+    }
+
+    return p;
+}
+
+/**
+ * @internal
+ *
+ * Return a span covering [@a start, @a end), with leading and trailing whitespace removed.
+ */
+static ANTSetCookieSpan ANTSetCookieTrim (const char *start, const char *end) {
+    while (start < end && ANTSetCookieIsWhitespace(*start))
+        start++;
+
+    while (end > start && ANTSetCookieIsWhitespace(end[-1]))
+        end--;
+
+    return (ANTSetCookieSpan) { .bytes = start, .length = (size_t) (end - start) };
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a span case-insensitively matches the NUL terminated ASCII string @a name.
+ */
+static inline bool ANTSetCookieSpanEquals (ANTSetCookieSpan span, const char *name) {
+    size_t length = strlen(name);
+    return span.length == length && strncasecmp(span.bytes, name, length) == 0;
+}
+
+/**
+ * @internal
+ *
+ * Parse a leading run of between @a minDigits and @a maxDigits ASCII digits from @a bytes. The digits may be
+ * followed by any non-digit characters, which are ignored.
+ */
+static bool ANTSetCookieParseDigits (const char *bytes, size_t length, size_t minDigits, size_t maxDigits, int *value) {
+    size_t count = 0;
+    int result = 0;
+
+    while (count < length && ANTSetCookieIsDigit(bytes[count])) {
+        if (count == maxDigits)
+            return false;
+
+        result = (result * 10) + (bytes[count] - '0');
+        count++;
+    }
+
+    if (count < minDigits)
+        return false;
+
+    *value = result;
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Parse an RFC 6265 hms-time token ("h:m:s", with one or two digits per field).
+ */
+static bool ANTSetCookieParseTime (const char *bytes, size_t length, int *hour, int *minute, int *second) {
+    int *fields[] = { hour, minute, second };
+    size_t pos = 0;
+
+    for (size_t i = 0; i < 3; i++) {
+        size_t start = pos;
+        int value = 0;
+        while (pos < length && pos - start < 2 && ANTSetCookieIsDigit(bytes[pos])) {
+            value = (value * 10) + (bytes[pos] - '0');
+            pos++;
+        }
+
+        if (pos == start)
+            return false;
+        *fields[i] = value;
+
+        if (i < 2) {
+            if (pos == length || bytes[pos] != ':')
+                return false;
+            pos++;
+        }
+    }
+
+    /* Any trailing characters must not be digits */
+    return pos == length || !ANTSetCookieIsDigit(bytes[pos]);
+}
+
+/**
+ * @internal
+ *
+ * Parse a month name token, returning the month (1-12), or 0 if the token is not a month name.
+ */
+static int ANTSetCookieParseMonth (const char *bytes, size_t length) {
+    static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+
+    if (length < 3)
+        return 0;
+
+    for (int i = 0; i < 12; i++) {
+        if (strncasecmp(bytes, months + (i * 3), 3) == 0)
+            return i + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @internal
+ *
+ * Return true if @a c is a cookie-date delimiter.
+ */
+static inline bool ANTSetCookieIsDateDelimiter (char c) {
+    unsigned char uc = (unsigned char) c;
+    return uc == 0x09 || (uc >= 0x20 && uc <= 0x2F) || (uc >= 0x3B && uc <= 0x40) || (uc >= 0x5B && uc <= 0x60) || (uc >= 0x7B && uc <= 0x7E);
+}
+
+/**
+ * @internal
+ *
+ * Return the number of days between the UNIX epoch and the given proleptic Gregorian calendar date.
+ */
+static int64_t ANTSetCookieDaysFromCivil (int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - (era * 400);
+    int64_t dayOfYear = ((153 * (month + (month > 2 ? -3 : 9))) + 2) / 5 + day - 1;
+    int64_t dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+
+    return (era * 146097) + dayOfEra - 719468;
+}
+
+/**
+ * Parse a cookie date, as used by the Set-Cookie Expires attribute, using the algorithm specified by
+ * RFC 6265, section 5.1.1. This accepts RFC 1123, RFC 850 and asctime() dates, along with the many
+ * variants thereof sent by real servers.
+ *
+ * @param bytes The date string.
+ * @param length The length of @a bytes.
+ * @param time On success, the parsed date, in seconds since the UNIX epoch.
+ *
+ * @return Returns true on success, or false if @a bytes is not a valid cookie date.
+ */
+bool ANTSetCookieParseDate (const char *bytes, size_t length, double *time) {
+    bool foundTime = false, foundDay = false, foundMonth = false, foundYear = false;
+    int hour = 0, minute = 0, second = 0, day = 0, month = 0, year = 0;
+
+    const char *p = bytes;
+    const char *end = bytes + length;
+    while (p < end) {
+        while (p < end && ANTSetCookieIsDateDelimiter(*p))
+            p++;
+
+        const char *token = p;
+        while (p < end && !ANTSetCookieIsDateDelimiter(*p))
+            p++;
+
+        size_t tokenLength = (size_t) (p - token);
+        if (tokenLength == 0)
+            continue;
+
+        if (!foundTime && ANTSetCookieParseTime(token, tokenLength, &hour, &minute, &second)) {
+            foundTime = true;
+        } else if (!foundDay && ANTSetCookieParseDigits(token, tokenLength, 1, 2, &day)) {
+            foundDay = true;
+        } else if (!foundMonth && (month = ANTSetCookieParseMonth(token, tokenLength)) != 0) {
+            foundMonth = true;
+        } else if (!foundYear && ANTSetCookieParseDigits(token, tokenLength, 2, 4, &year)) {
+            foundYear = true;
+        }
+    }
+
+    if (!foundTime || !foundDay || !foundMonth || !foundYear)
+        return false;
+
+    /* Two digit years */
+    if (year >= 70 && year <= 99)
+        year += 1900;
+    else if (year >= 0 && year <= 69)
+        year += 2000;
+
+    if (year < 1601 || hour > 23 || minute > 59 || second > 59)
+        return false;
+
+    /* Validate the day against the month's length */
+    static const int monthDays[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (day < 1 || day > monthDays[month - 1] || (month == 2 && day == 29 && !leap))
+        return false;
+
+    *time = (double) ((ANTSetCookieDaysFromCivil(year, month, day) * 86400) + (hour * 3600) + (minute * 60) + second);
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Parse a Max-Age attribute value: an optional '-', followed by one or more digits.
+ */
+static bool ANTSetCookieParseMaxAge (ANTSetCookieSpan span, int64_t *maxAge) {
+    size_t pos = 0;
+    bool negative = false;
+    int64_t value = 0;
+
+    if (span.length > 0 && span.bytes[0] == '-') {
+        negative = true;
+        pos++;
+    }
+
+    if (pos == span.length)
+        return false;
+
+    for (; pos < span.length; pos++) {
+        if (!ANTSetCookieIsDigit(span.bytes[pos]))
+            return false;
+
+        if (value < ANT_SET_COOKIE_MAX_AGE_LIMIT)
+            value = (value * 10) + (span.bytes[pos] - '0');
+    }
+
+    if (value > ANT_SET_COOKIE_MAX_AGE_LIMIT)
+        value = ANT_SET_COOKIE_MAX_AGE_LIMIT;
+
+    *maxAge = negative ? -value : value;
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Apply the cookie attribute @a name with @a value to @a cookie. Unknown attributes are ignored.
+ */
+static void ANTSetCookieApplyAttribute (ANTSetCookie *cookie, ANTSetCookieSpan name, ANTSetCookieSpan value) {
+    if (ANTSetCookieSpanEquals(name, "expires")) {
+        if (value.bytes != NULL && ANTSetCookieParseDate(value.bytes, value.length, &cookie->expires))
+            cookie->hasExpires = true;
+
+    } else if (ANTSetCookieSpanEquals(name, "max-age")) {
+        if (value.bytes != NULL && ANTSetCookieParseMaxAge(value, &cookie->maxAge))
+            cookie->hasMaxAge = true;
+
+    } else if (ANTSetCookieSpanEquals(name, "domain")) {
+        /* An empty domain is ignored */
+        if (value.length > 0)
+            cookie->domain = value;
+
+    } else if (ANTSetCookieSpanEquals(name, "path")) {
+        /* Relative paths are ignored; the default path will be used */
+        if (value.length > 0 && value.bytes[0] == '/')
+            cookie->path = value;
+
+    } else if (ANTSetCookieSpanEquals(name, "secure")) {
+        cookie->secure = true;
+
+    } else if (ANTSetCookieSpanEquals(name, "httponly")) {
+        cookie->httpOnly = true;
+
+    } else if (ANTSetCookieSpanEquals(name, "discard")) {
+        cookie->discard = true;
+
+    } else if (ANTSetCookieSpanEquals(name, "comment")) {
+        if (value.bytes != NULL)
+            cookie->comment = value;
+
+    } else if (ANTSetCookieSpanEquals(name, "version")) {
+        int version;
+        if (value.bytes != NULL && ANTSetCookieParseDigits(value.bytes, value.length, 1, 1, &version))
+            cookie->version = version;
+    }
+}
+
+/**
+ * Parse the next cookie from a Set-Cookie header value. Cookies that lack a name=value pair are skipped.
+ *
+ * This function does not allocate; all spans in @a cookie reference the header bytes.
+ *
+ * @param cursor The current parse position. On return, this will be advanced past the parsed cookie.
+ * @param end The end of the header value.
+ * @param cookie On success, the parsed cookie.
+ *
+ * @return Returns true if a cookie was parsed, or false if no further cookies are available.
+ */
+bool ANTSetCookieNext (const char **cursor, const char *end, ANTSetCookie *cookie) {
+    const char *p = *cursor;
+
+    while (p < end) {
+        /* Skip any cookie separators */
+        while (p < end && (ANTSetCookieIsWhitespace(*p) || *p == ','))
+            p++;
+
+        if (p == end)
+            break;
+
+        memset(cookie, 0, sizeof(*cookie));
+
+        /* Parse the name=value pair. If there is no '=', the cookie will be ignored. */
+        const char *nameEnd = ANTSetCookieScan(p, end, true);
+        cookie->name = ANTSetCookieTrim(p, nameEnd);
+        bool valid = nameEnd < end && *nameEnd == '=' && cookie->name.length > 0;
+
+        p = nameEnd;
+        if (p < end && *p == '=') {
+            const char *valueEnd = ANTSetCookieScan(p + 1, end, false);
+            cookie->value = ANTSetCookieTrim(p + 1, valueEnd);
+            p = valueEnd;
+        }
+
+        /* Parse the attributes */
+        while (p < end && *p == ';') {
+            p++;
+
+            const char *attrNameEnd = ANTSetCookieScan(p, end, true);
+            ANTSetCookieSpan attrName = ANTSetCookieTrim(p, attrNameEnd);
+            ANTSetCookieSpan attrValue = { .bytes = NULL, .length = 0 };
+
+            p = attrNameEnd;
+            if (p < end && *p == '=') {
+                const char *attrValueEnd = ANTSetCookieScan(p + 1, end, false);
+                attrValue = ANTSetCookieTrim(p + 1, attrValueEnd);
+                p = attrValueEnd;
+            }
+
+            if (valid)
+                ANTSetCookieApplyAttribute(cookie, attrName, attrValue);
+        }
+
+        if (valid) {
+            *cursor = p;
+            return true;
+        }
+    }
+
+    *cursor = end;
+    return false;
+}
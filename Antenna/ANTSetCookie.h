@@ -0,0 +1,91 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ANT_SET_COOKIE_H
+#define ANT_SET_COOKIE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A borrowed range of bytes within a Set-Cookie header value.
+ */
+typedef struct ANTSetCookieSpan {
+    /** The first byte of the span, or NULL if the span is absent. */
+    const char *bytes;
+
+    /** The length of the span, in bytes. */
+    size_t length;
+} ANTSetCookieSpan;
+
+/**
+ * A single cookie parsed from a Set-Cookie header value. All spans reference the parsed header bytes, with
+ * surrounding whitespace removed; no attribute values are decoded or copied.
+ */
+typedef struct ANTSetCookie {
+    /** The cookie name. This is never empty. */
+    ANTSetCookieSpan name;
+
+    /** The cookie value. */
+    ANTSetCookieSpan value;
+
+    /** The Domain attribute, or an absent span. */
+    ANTSetCookieSpan domain;
+
+    /** The Path attribute, or an absent span if not specified or not an absolute path. */
+    ANTSetCookieSpan path;
+
+    /** The Comment attribute, or an absent span. */
+    ANTSetCookieSpan comment;
+
+    /** The Expires attribute, in seconds since the UNIX epoch. Only valid if @a hasExpires is true. */
+    double expires;
+    bool hasExpires;
+
+    /** The Max-Age attribute, in seconds. Only valid if @a hasMaxAge is true. */
+    int64_t maxAge;
+    bool hasMaxAge;
+
+    /** The cookie version; 1 if a Version attribute was supplied, otherwise 0. */
+    int version;
+
+    /** True if the Secure attribute was supplied. */
+    bool secure;
+
+    /** True if the HttpOnly attribute was supplied. */
+    bool httpOnly;
+
+    /** True if the Discard attribute was supplied. */
+    bool discard;
+} ANTSetCookie;
+
+bool ANTSetCookieNext (const char **cursor, const char *end, ANTSetCookie *cookie);
+bool ANTSetCookieParseDate (const char *bytes, size_t length, double *time);
+
+#endif /* ANT_SET_COOKIE_H */
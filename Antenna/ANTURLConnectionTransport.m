@@ -0,0 +1,73 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTURLConnectionTransport.h"
+
+/**
+ * An ANTNetworkTransport backed by NSURLConnection.
+ *
+ * Connection reuse is managed (and hidden) by the URL loading system; prefer ANTHTTPTransport where connection
+ * reuse must be controlled or observed. The URL loading system decodes response bodies transparently, and the reported
+ * transfer size is always the decoded size.
+ */
+@implementation ANTURLConnectionTransport {
+@private
+    /** Internal queue used to handle NSURLConnection callbacks */
+    NSOperationQueue *_opQueue;
+}
+
+- (instancetype) init {
+    PLSuperInit();
+
+    _opQueue = [NSOperationQueue new];
+
+    return self;
+}
+
+// from ANTNetworkTransport protocol
+- (void) sendRequest: (NSURLRequest *) request cancelTicket: (PLCancelTicket *) ticket completionHandler: (ANTNetworkTransportCallback) handler {
+    [NSURLConnection pl_sendAsynchronousRequest: request queue: _opQueue cancelTicket: ticket completionHandler: ^(NSURLResponse *response, NSData *data, NSError *error) {
+        handler(response, data, (ANTNetworkTransferSize) { [data length], [data length] }, error);
+    }];
+}
+
+// from ANTNetworkTransport protocol
+- (void) sendRequest: (NSURLRequest *) request
+        cancelTicket: (PLCancelTicket *) ticket
+         dataHandler: (ANTNetworkTransportDataHandler) dataHandler
+   completionHandler: (ANTNetworkTransportCallback) handler
+{
+    /* NSURLConnection's block API buffers the full response; deliver it as a single portion */
+    [self sendRequest: request cancelTicket: ticket completionHandler: ^(NSURLResponse *response, NSData *data, ANTNetworkTransferSize size, NSError *error) {
+        if (error == nil && [data length] > 0)
+            dataHandler(data);
+        handler(response, nil, size, error);
+    }];
+}
+
+@end
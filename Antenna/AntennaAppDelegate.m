@@ -31,6 +31,7 @@
 #import "ANTLoginWindowController.h"
 #import "ANTPreferencesWindowController.h"
 #import "ANTRadarCache.h"
+#import "ANTPublicSuffixListLoader.h"
 
 #import "ANTRadarsWindowController.h"
 #import "AntennaApp.h"
@@ -63,6 +64,9 @@
 
     /** The local Radar cache */
     ANTRadarCache *_radarCache;
+
+    /** Loads updated public suffix lists from the cache directory */
+    ANTPublicSuffixListLoader *_publicSuffixListLoader;
     
     /**
      * All pending authentication blocks; these should be dispatched when the login
@@ -79,12 +83,21 @@
     NSString *cacheDir = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex: 0];
     cacheDir = [cacheDir stringByAppendingPathComponent: [[NSBundle mainBundle] bundleIdentifier]];
     
+    /* Load any updated public suffix list before cookies are accepted */
+    _publicSuffixListLoader = [[ANTPublicSuffixListLoader alloc] initWithPath: [cacheDir stringByAppendingPathComponent: @"PublicSuffixList/effective_tld_names.apsl"]];
+
     /* Fetch preferences */
     _preferences = [[ANTPreferences alloc] init];
     
     /* Set up client */
     _networkClient = [[ANTNetworkClient alloc] initWithAuthDelegate: self];
 
+    /* Set up the response cache; if unavailable, responses are simply not cached */
+    NSSet *cachedClasses = [NSSet setWithObjects: [ANTRadarResponse class], [ANTRadarCommentResponse class], [NSArray class], [NSString class], [NSDate class], nil];
+    _networkClient.responseCache = [[ANTNetworkResponseCache alloc] initWithPath: [cacheDir stringByAppendingPathComponent: @"Responses"] objectClasses: cachedClasses error: &error];
+    if (_networkClient.responseCache == nil)
+        NSLog(@"Response caching is disabled: %@", error);
+
     /* Set up the Radar cache */
     _radarCache = [[ANTRadarCache alloc] initWithClient: _networkClient path: [cacheDir stringByAppendingPathComponent: @"Radars"] error: &error];
     if (_radarCache == nil) {
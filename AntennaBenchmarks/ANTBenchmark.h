@@ -0,0 +1,89 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A benchmark operation.
+ *
+ * @param thread The index of the calling thread, from zero.
+ * @param iteration The calling thread's iteration count, from zero.
+ */
+typedef void (^ANTBenchmarkOperation)(NSUInteger thread, NSUInteger iteration);
+
+@interface ANTBenchmarkResult : NSObject
+
+- (instancetype) initWithName: (NSString *) name
+                         size: (NSUInteger) size
+                      threads: (NSUInteger) threads
+                   operations: (uint64_t) operations
+               nsPerOperation: (double) nsPerOperation
+                          p50: (double) p50
+                          p99: (double) p99
+      allocationsPerOperation: (double) allocationsPerOperation;
+
+/** The benchmark name. */
+@property(nonatomic, readonly) NSString *name;
+
+/** The benchmark's input size (eg, the number of cookies in the jar), or zero if not applicable. */
+@property(nonatomic, readonly) NSUInteger size;
+
+/** The number of concurrent threads. */
+@property(nonatomic, readonly) NSUInteger threads;
+
+/** The total number of operations performed across all threads. */
+@property(nonatomic, readonly) uint64_t operations;
+
+/** The mean time per operation, per thread, in nanoseconds. */
+@property(nonatomic, readonly) double nsPerOperation;
+
+/** The median operation latency, in nanoseconds. */
+@property(nonatomic, readonly) double p50;
+
+/** The 99th percentile operation latency, in nanoseconds. */
+@property(nonatomic, readonly) double p99;
+
+/** The mean number of heap allocations per operation, or a negative value if allocations were not counted. */
+@property(nonatomic, readonly) double allocationsPerOperation;
+
+@end
+
+@interface ANTBenchmarkRunner : NSObject
+
+- (ANTBenchmarkResult *) measure: (NSString *) name size: (NSUInteger) size threads: (NSUInteger) threads operation: (ANTBenchmarkOperation) operation;
+
+/** The target wall clock duration of each measurement, in seconds. */
+@property(nonatomic) NSTimeInterval duration;
+
+/** The maximum number of operations performed by each thread in a single measurement. */
+@property(nonatomic) NSUInteger maxIterations;
+
+/** If YES, heap allocations are counted. */
+@property(nonatomic, readonly) BOOL countsAllocations;
+
+@end
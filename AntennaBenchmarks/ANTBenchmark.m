@@ -0,0 +1,363 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTBenchmark.h"
+
+#import <PLFoundation/PLFoundation.h>
+#import <libkern/OSAtomic.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+#import <pthread.h>
+
+/**
+ * @internal
+ *
+ * The number of operations performed between autorelease pool drains.
+ */
+static const NSUInteger ANTBenchmarkPoolInterval = 64;
+
+/**
+ * @internal
+ *
+ * The number of heap allocations performed by the current thread, maintained once ANTBenchmarkInstallAllocationCounter()
+ * has been called. Counting per thread avoids introducing contention between benchmark threads.
+ */
+static __thread uint64_t ANTBenchmarkThreadAllocations = 0;
+
+/**
+ * @internal
+ *
+ * A copy of the default malloc zone's original function table.
+ */
+static malloc_zone_t ANTBenchmarkDefaultZone;
+
+static void *ANTBenchmarkMalloc (malloc_zone_t *zone, size_t size) {
+    ANTBenchmarkThreadAllocations++;
+    return ANTBenchmarkDefaultZone.malloc(zone, size);
+}
+
+static void *ANTBenchmarkCalloc (malloc_zone_t *zone, size_t count, size_t size) {
+    ANTBenchmarkThreadAllocations++;
+    return ANTBenchmarkDefaultZone.calloc(zone, count, size);
+}
+
+static void *ANTBenchmarkValloc (malloc_zone_t *zone, size_t size) {
+    ANTBenchmarkThreadAllocations++;
+    return ANTBenchmarkDefaultZone.valloc(zone, size);
+}
+
+static void *ANTBenchmarkRealloc (malloc_zone_t *zone, void *ptr, size_t size) {
+    ANTBenchmarkThreadAllocations++;
+    return ANTBenchmarkDefaultZone.realloc(zone, ptr, size);
+}
+
+static void *ANTBenchmarkMemalign (malloc_zone_t *zone, size_t alignment, size_t size) {
+    ANTBenchmarkThreadAllocations++;
+    return ANTBenchmarkDefaultZone.memalign(zone, alignment, size);
+}
+
+/**
+ * @internal
+ *
+ * Interpose on the default malloc zone's allocation functions, counting allocations in ANTBenchmarkThreadAllocations.
+ *
+ * @return Returns true on success, or false if the zone could not be modified.
+ */
+static bool ANTBenchmarkInstallAllocationCounter (void) {
+    malloc_zone_t *zone = malloc_default_zone();
+    ANTBenchmarkDefaultZone = *zone;
+
+    /* The zone's function table is mapped read-only */
+    vm_address_t page = trunc_page((vm_address_t) zone);
+    vm_size_t length = round_page((vm_address_t) zone + sizeof(*zone)) - page;
+    if (vm_protect(mach_task_self(), page, length, 0, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS)
+        return false;
+
+    zone->malloc = ANTBenchmarkMalloc;
+    zone->calloc = ANTBenchmarkCalloc;
+    zone->valloc = ANTBenchmarkValloc;
+    zone->realloc = ANTBenchmarkRealloc;
+    if (zone->version >= 5)
+        zone->memalign = ANTBenchmarkMemalign;
+
+    vm_protect(mach_task_self(), page, length, 0, VM_PROT_READ);
+    return true;
+}
+
+/**
+ * @internal
+ *
+ * Per-thread benchmark state.
+ */
+typedef struct ANTBenchmarkThread {
+    /** The operation to be performed. Borrowed from the runner. */
+    __unsafe_unretained ANTBenchmarkOperation operation;
+
+    /** The thread index. */
+    NSUInteger index;
+
+    /** The number of operations to perform. */
+    NSUInteger iterations;
+
+    /** The latency of each operation, in mach_absolute_time() units. */
+    uint64_t *samples;
+
+    /** Incremented by the thread once it is ready to begin. */
+    volatile int32_t *ready;
+
+    /** Set to a non-zero value once all threads are ready. */
+    volatile int32_t *start;
+
+    /** On return, the thread's total elapsed time, in mach_absolute_time() units. */
+    uint64_t elapsed;
+
+    /** On return, the number of heap allocations performed by the thread. */
+    uint64_t allocations;
+} ANTBenchmarkThread;
+
+/**
+ * @internal
+ *
+ * Benchmark thread entry point.
+ *
+ * @param arg The thread's ANTBenchmarkThread state.
+ */
+static void *ANTBenchmarkThreadMain (void *arg) {
+    ANTBenchmarkThread *thread = arg;
+
+    /* Wait for all threads to be ready, so that every thread's measurement overlaps the others. */
+    OSAtomicIncrement32Barrier(thread->ready);
+    while (OSAtomicAdd32Barrier(0, thread->start) == 0)
+        continue;
+
+    uint64_t allocations = ANTBenchmarkThreadAllocations;
+    uint64_t begin = mach_absolute_time();
+
+    for (NSUInteger i = 0; i < thread->iterations;) {
+        @autoreleasepool {
+            NSUInteger end = MIN(i + ANTBenchmarkPoolInterval, thread->iterations);
+            for (; i < end; i++) {
+                uint64_t opBegin = mach_absolute_time();
+                thread->operation(thread->index, i);
+                thread->samples[i] = mach_absolute_time() - opBegin;
+            }
+        }
+    }
+
+    thread->elapsed = mach_absolute_time() - begin;
+    thread->allocations = ANTBenchmarkThreadAllocations - allocations;
+    return NULL;
+}
+
+/**
+ * @internal
+ *
+ * qsort() comparator for uint64_t values.
+ */
+static int ANTBenchmarkSampleCompare (const void *lhs, const void *rhs) {
+    uint64_t l = *(const uint64_t *) lhs;
+    uint64_t r = *(const uint64_t *) rhs;
+
+    if (l < r)
+        return -1;
+    else if (l > r)
+        return 1;
+    else
+        return 0;
+}
+
+/**
+ * The result of a single benchmark measurement.
+ */
+@implementation ANTBenchmarkResult
+
+/**
+ * Initialize a new instance.
+ *
+ * @param name The benchmark name.
+ * @param size The benchmark's input size, or zero if not applicable.
+ * @param threads The number of concurrent threads.
+ * @param operations The total number of operations performed across all threads.
+ * @param nsPerOperation The mean time per operation, per thread, in nanoseconds.
+ * @param p50 The median operation latency, in nanoseconds.
+ * @param p99 The 99th percentile operation latency, in nanoseconds.
+ * @param allocationsPerOperation The mean number of heap allocations per operation, or a negative value if
+ * allocations were not counted.
+ */
+- (instancetype) initWithName: (NSString *) name
+                         size: (NSUInteger) size
+                      threads: (NSUInteger) threads
+                   operations: (uint64_t) operations
+               nsPerOperation: (double) nsPerOperation
+                          p50: (double) p50
+                          p99: (double) p99
+      allocationsPerOperation: (double) allocationsPerOperation
+{
+    PLSuperInit();
+
+    _name = name;
+    _size = size;
+    _threads = threads;
+    _operations = operations;
+    _nsPerOperation = nsPerOperation;
+    _p50 = p50;
+    _p99 = p99;
+    _allocationsPerOperation = allocationsPerOperation;
+
+    return self;
+}
+
+@end
+
+/**
+ * Runs benchmark operations concurrently on a fixed number of threads, recording the latency and heap allocations
+ * of each operation.
+ *
+ * Each measurement is preceded by a single-threaded warm-up, which is also used to estimate the number of iterations
+ * that will complete within the target duration.
+ */
+@implementation ANTBenchmarkRunner {
+    /** Conversion factors from mach_absolute_time() units to nanoseconds. */
+    mach_timebase_info_data_t _timebase;
+}
+
+/**
+ * Initialize a new instance. Allocation counting will be enabled, if supported.
+ */
+- (instancetype) init {
+    PLSuperInit();
+
+    _duration = 0.25;
+    _maxIterations = 1000000;
+    mach_timebase_info(&_timebase);
+
+    static dispatch_once_t onceToken;
+    static bool installed;
+    dispatch_once(&onceToken, ^{
+        installed = ANTBenchmarkInstallAllocationCounter();
+    });
+    _countsAllocations = installed;
+
+    return self;
+}
+
+/**
+ * @internal
+ *
+ * Convert @a ticks from mach_absolute_time() units to nanoseconds.
+ */
+- (double) nanosecondsWithTicks: (double) ticks {
+    return ticks * _timebase.numer / _timebase.denom;
+}
+
+/**
+ * Measure @a operation.
+ *
+ * @param name The benchmark name.
+ * @param size The benchmark's input size, or zero if not applicable.
+ * @param threads The number of threads on which @a operation will be concurrently performed.
+ * @param operation The operation to be measured. The operation must be safe to perform concurrently.
+ */
+- (ANTBenchmarkResult *) measure: (NSString *) name size: (NSUInteger) size threads: (NSUInteger) threads operation: (ANTBenchmarkOperation) operation {
+    NSAssert(threads > 0, @"At least one thread is required");
+
+    /* Warm up, and estimate the cost of a single operation */
+    NSUInteger warmup = 0;
+    uint64_t warmupBegin = mach_absolute_time();
+    double warmupTarget = _duration * NSEC_PER_SEC / 10;
+    double warmupElapsed;
+    do {
+        @autoreleasepool {
+            for (NSUInteger end = warmup + ANTBenchmarkPoolInterval; warmup < end; warmup++)
+                operation(0, warmup);
+        }
+        warmupElapsed = [self nanosecondsWithTicks: mach_absolute_time() - warmupBegin];
+    } while (warmupElapsed < warmupTarget && warmup < _maxIterations);
+
+    NSUInteger iterations = (NSUInteger) (_duration * NSEC_PER_SEC / (warmupElapsed / warmup));
+    iterations = MAX(10, MIN(iterations, _maxIterations));
+
+    /* Run the measurement */
+    ANTBenchmarkThread *state = calloc(threads, sizeof(ANTBenchmarkThread));
+    uint64_t *samples = malloc(sizeof(uint64_t) * iterations * threads);
+    pthread_t *pthreads = malloc(sizeof(pthread_t) * threads);
+    volatile int32_t ready = 0;
+    volatile int32_t start = 0;
+
+    for (NSUInteger i = 0; i < threads; i++) {
+        state[i].operation = operation;
+        state[i].index = i;
+        state[i].iterations = iterations;
+        state[i].samples = samples + (i * iterations);
+        state[i].ready = &ready;
+        state[i].start = &start;
+
+        int err = pthread_create(&pthreads[i], NULL, ANTBenchmarkThreadMain, &state[i]);
+        if (err != 0) {
+            NSLog(@"Failed to create benchmark thread: %s", strerror(err));
+            abort();
+        }
+    }
+
+    while (OSAtomicAdd32Barrier(0, &ready) != (int32_t) threads)
+        continue;
+    OSAtomicIncrement32Barrier(&start);
+
+    uint64_t elapsed = 0;
+    uint64_t allocations = 0;
+    for (NSUInteger i = 0; i < threads; i++) {
+        pthread_join(pthreads[i], NULL);
+        elapsed += state[i].elapsed;
+        allocations += state[i].allocations;
+    }
+
+    /* Compute the results */
+    uint64_t operations = (uint64_t) iterations * threads;
+    qsort(samples, operations, sizeof(uint64_t), ANTBenchmarkSampleCompare);
+
+    double p50 = [self nanosecondsWithTicks: samples[operations / 2]];
+    double p99 = [self nanosecondsWithTicks: samples[MIN(operations - 1, (operations * 99) / 100)]];
+    double nsPerOperation = [self nanosecondsWithTicks: elapsed] / operations;
+    double allocationsPerOperation = _countsAllocations ? (double) allocations / operations : -1;
+
+    free(pthreads);
+    free(samples);
+    free(state);
+
+    return [[ANTBenchmarkResult alloc] initWithName: name
+                                               size: size
+                                            threads: threads
+                                         operations: operations
+                                     nsPerOperation: nsPerOperation
+                                                p50: p50
+                                                p99: p99
+                            allocationsPerOperation: allocationsPerOperation];
+}
+
+@end
@@ -0,0 +1,385 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "ANTBenchmarkCorpus.h"
+
+#import <PLFoundation/PLFoundation.h>
+
+/**
+ * @internal
+ *
+ * Public suffixes from which synthetic sites are drawn. Common suffixes are repeated in proportion to their
+ * approximate popularity.
+ */
+static const char *ANTBenchmarkSiteSuffixes[] = {
+    "com", "com", "com", "com", "com", "com", "com", "com",
+    "org", "org", "net", "net", "de", "de", "co.uk", "co.uk",
+    "com.au", "jp", "fr", "ru", "com.br", "io", "github.io", "appspot.com",
+};
+
+/**
+ * @internal
+ *
+ * Subdomains from which synthetic hosts are drawn. The empty string denotes the site itself.
+ */
+static const char *ANTBenchmarkSubdomains[] = {
+    "", "www", "www", "www", "api", "m", "static", "login", "app", "mail",
+};
+
+/**
+ * @internal
+ *
+ * Path components from which synthetic cookie and request paths are drawn.
+ */
+static const char *ANTBenchmarkPathComponents[] = {
+    "app", "account", "api", "v1", "v2", "static", "search", "login", "radar", "problem",
+};
+
+/**
+ * @internal
+ *
+ * Real hostnames included in the hostname corpus.
+ */
+static const char *ANTBenchmarkRealHostnames[] = {
+    "bugreport.apple.com", "www.apple.com", "developer.apple.com", "idmsa.apple.com", "openradar.appspot.com",
+    "www.google.com", "mail.google.com", "www.google.co.uk", "www.amazon.co.jp", "www.bbc.co.uk",
+    "en.wikipedia.org", "github.com", "gist.github.com", "landonf.github.io", "www.facebook.com",
+    "static.xx.fbcdn.net", "twitter.com", "t.co", "news.ycombinator.com", "www.reddit.com",
+    "opensource.plausible.coop", "plausible.coop", "www.yahoo.co.jp", "www.baidu.com", "www.yandex.ru",
+    "www.mozilla.org", "publicsuffix.org", "s3.amazonaws.com", "bucket.s3.amazonaws.com", "www.city.kawasaki.jp",
+    "foo.bar.kawasaki.jp", "www.gov.uk", "www.ox.ac.uk", "www.abc.net.au", "www.lemonde.fr",
+    "www.spiegel.de", "www.uol.com.br", "www.nic.ck", "www.example.com", "localhost",
+};
+
+/**
+ * @internal
+ *
+ * Suffixes for random hostnames; includes wildcard and exception rules, and names that match no rule.
+ */
+static const char *ANTBenchmarkRandomSuffixes[] = {
+    "com", "org", "net", "co.uk", "ac.uk", "com.au", "jp", "kawasaki.jp", "city.kawasaki.jp", "ck",
+    "de", "github.io", "appspot.com", "museum", "xn--p1ai", "local", "invalid", "bogus", "zz", "example",
+};
+
+#define ANT_BENCHMARK_COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+/**
+ * @internal
+ *
+ * Return the number of distinct sites over which @a cookieCount cookies are distributed.
+ */
+static NSUInteger ANTBenchmarkSiteCount (NSUInteger cookieCount) {
+    return MAX(10, cookieCount / 10);
+}
+
+/**
+ * @internal
+ *
+ * Return the (unnormalized) cumulative Zipf distribution over @a count sites, with an exponent of 1. The caller is
+ * responsible for freeing the returned buffer.
+ */
+static double *ANTBenchmarkZipfDistribution (NSUInteger count) {
+    double *cdf = malloc(sizeof(double) * count);
+    double total = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        total += 1.0 / (i + 1);
+        cdf[i] = total;
+    }
+
+    return cdf;
+}
+
+/**
+ * Generates reproducible synthetic cookies, request URLs, and hostnames for benchmarking.
+ *
+ * Synthetic sites are drawn from a Zipf distribution, so that a few sites hold most of the cookies and receive most of
+ * the requests, as in a real browsing history. A given site index always produces the same site name, so that the
+ * request URLs generated for a cookie count address the sites of the cookies generated for the same count.
+ */
+@implementation ANTBenchmarkCorpus {
+    /** The xorshift32 PRNG state. */
+    uint32_t _state;
+}
+
+/**
+ * Initialize a new instance.
+ *
+ * @param seed The PRNG seed. Instances initialized with the same seed return identical results.
+ */
+- (instancetype) initWithSeed: (uint32_t) seed {
+    PLSuperInit();
+
+    /* xorshift32 requires a non-zero state */
+    _state = seed != 0 ? seed : 1;
+
+    return self;
+}
+
+/**
+ * @internal
+ *
+ * Return the next pseudo-random value.
+ */
+- (uint32_t) next {
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+}
+
+/**
+ * @internal
+ *
+ * Return a pseudo-random value in the range [0, @a bound).
+ */
+- (NSUInteger) nextBelow: (NSUInteger) bound {
+    return [self next] % bound;
+}
+
+/**
+ * @internal
+ *
+ * Return a pseudo-random lowercase label of between @a minLength and @a maxLength characters.
+ */
+- (NSString *) labelWithMinLength: (NSUInteger) minLength maxLength: (NSUInteger) maxLength {
+    NSUInteger length = minLength + [self nextBelow: maxLength - minLength + 1];
+    char label[length];
+    for (NSUInteger i = 0; i < length; i++)
+        label[i] = (char) ('a' + [self nextBelow: 26]);
+
+    return [[NSString alloc] initWithBytes: label length: length encoding: NSASCIIStringEncoding];
+}
+
+/**
+ * @internal
+ *
+ * Return the name of the site with index @a site. The name depends only on the index.
+ */
+- (NSString *) siteWithIndex: (NSUInteger) site {
+    /* Derive a fixed label from the index (via a multiplicative hash), independent of the PRNG state */
+    uint32_t hash = (uint32_t) site * 2654435761u;
+    char label[8];
+    for (NSUInteger i = 0; i < sizeof(label); i++) {
+        label[i] = (char) ('a' + (hash % 26));
+        hash = hash / 26 + (uint32_t) (site + i) * 40503u;
+    }
+
+    const char *suffix = ANTBenchmarkSiteSuffixes[site % ANT_BENCHMARK_COUNT(ANTBenchmarkSiteSuffixes)];
+    return [NSString stringWithFormat: @"%.*s%lu.%s", (int) sizeof(label), label, (unsigned long) site, suffix];
+}
+
+/**
+ * @internal
+ *
+ * Return a Zipf-distributed site index in the range [0, @a siteCount).
+ *
+ * @param cdf The cumulative distribution returned by ANTBenchmarkZipfDistribution().
+ * @param siteCount The number of sites.
+ */
+- (NSUInteger) siteWithDistribution: (const double *) cdf count: (NSUInteger) siteCount {
+    double target = ((double) [self next] / UINT32_MAX) * cdf[siteCount - 1];
+
+    NSUInteger low = 0;
+    NSUInteger high = siteCount - 1;
+    while (low < high) {
+        NSUInteger mid = (low + high) / 2;
+        if (cdf[mid] < target)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/**
+ * @internal
+ *
+ * Return a pseudo-random host within @a site.
+ */
+- (NSString *) hostWithSite: (NSString *) site {
+    const char *subdomain = ANTBenchmarkSubdomains[[self nextBelow: ANT_BENCHMARK_COUNT(ANTBenchmarkSubdomains)]];
+    if (*subdomain == '\0')
+        return site;
+
+    return [NSString stringWithFormat: @"%s.%@", subdomain, site];
+}
+
+/**
+ * @internal
+ *
+ * Return a pseudo-random absolute path of exactly @a depth components.
+ */
+- (NSString *) pathWithDepth: (NSUInteger) depth {
+    if (depth == 0)
+        return @"/";
+
+    NSMutableString *path = [NSMutableString string];
+    for (NSUInteger i = 0; i < depth; i++)
+        [path appendFormat: @"/%s", ANTBenchmarkPathComponents[[self nextBelow: ANT_BENCHMARK_COUNT(ANTBenchmarkPathComponents)]]];
+
+    return path;
+}
+
+/**
+ * Return @a count NSHTTPCookie instances, distributed over count / 10 sites. Most cookies are scoped to the root
+ * path; most are persistent, and a minority are secure.
+ *
+ * @param count The number of cookies to generate.
+ */
+- (NSArray *) cookiesWithCount: (NSUInteger) count {
+    NSUInteger siteCount = ANTBenchmarkSiteCount(count);
+    double *cdf = ANTBenchmarkZipfDistribution(siteCount);
+    NSDate *now = [NSDate date];
+
+    NSMutableArray *cookies = [NSMutableArray arrayWithCapacity: count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *site = [self siteWithIndex: [self siteWithDistribution: cdf count: siteCount]];
+        NSString *host = [self hostWithSite: site];
+
+        /* Path depths of 0 (50%), 1 (30%), 2 (15%), and 3 (5%) */
+        NSUInteger roll = [self nextBelow: 100];
+        NSUInteger depth = roll < 50 ? 0 : roll < 80 ? 1 : roll < 95 ? 2 : 3;
+
+        NSMutableDictionary *properties = [NSMutableDictionary dictionary];
+        properties[NSHTTPCookieDomain] = [self nextBelow: 10] < 6 ? [@"." stringByAppendingString: site] : host;
+        properties[NSHTTPCookiePath] = [self pathWithDepth: depth];
+        properties[NSHTTPCookieName] = [NSString stringWithFormat: @"c%lu", (unsigned long) i];
+        properties[NSHTTPCookieValue] = [self labelWithMinLength: 16 maxLength: 32];
+
+        if ([self nextBelow: 10] < 2)
+            properties[NSHTTPCookieSecure] = @"TRUE";
+
+        if ([self nextBelow: 10] < 7)
+            properties[NSHTTPCookieExpires] = [now dateByAddingTimeInterval: 86400.0 * (1 + [self nextBelow: 365])];
+
+        [cookies addObject: [NSHTTPCookie cookieWithProperties: properties]];
+    }
+
+    free(cdf);
+    return cookies;
+}
+
+/**
+ * Return @a count request NSURLs addressing the sites of the cookies returned by -cookiesWithCount: for
+ * @a cookieCount, following the same distribution.
+ *
+ * @param count The number of URLs to generate.
+ * @param cookieCount The cookie count for which the URLs will be generated.
+ */
+- (NSArray *) requestURLsWithCount: (NSUInteger) count cookieCount: (NSUInteger) cookieCount {
+    NSUInteger siteCount = ANTBenchmarkSiteCount(cookieCount);
+    double *cdf = ANTBenchmarkZipfDistribution(siteCount);
+
+    NSMutableArray *urls = [NSMutableArray arrayWithCapacity: count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *site = [self siteWithIndex: [self siteWithDistribution: cdf count: siteCount]];
+        NSString *host = [self hostWithSite: site];
+        NSString *scheme = [self nextBelow: 10] < 2 ? @"https" : @"http";
+        NSString *path = [self pathWithDepth: [self nextBelow: 5]];
+
+        [urls addObject: [NSURL URLWithString: [NSString stringWithFormat: @"%@://%@%@", scheme, host, path]]];
+    }
+
+    free(cdf);
+    return urls;
+}
+
+/**
+ * Return @a count two-element arrays, each holding an NSHTTPCookie and the NSURL of the response that set it, for
+ * use with +[ANTCookieJar validateCookie:forURL:]. Cookie domains include valid domain and host-only domains, domains
+ * that must be rewritten to the host, and domains that must be rejected.
+ *
+ * @param count The number of cases to generate.
+ */
+- (NSArray *) validationCasesWithCount: (NSUInteger) count {
+    NSMutableArray *cases = [NSMutableArray arrayWithCapacity: count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *site = [self siteWithIndex: [self nextBelow: 1000]];
+        NSString *host = [NSString stringWithFormat: @"%@.%@", [self labelWithMinLength: 1 maxLength: 8], site];
+
+        NSString *domain;
+        NSUInteger roll = [self nextBelow: 10];
+        if (roll < 4) {
+            domain = [@"." stringByAppendingString: site];
+        } else if (roll < 6) {
+            domain = host;
+        } else if (roll < 8) {
+            domain = [@"." stringByAppendingString: host];
+        } else if (roll < 9) {
+            /* The site's public suffix; must be rewritten */
+            domain = [site substringFromIndex: [site rangeOfString: @"."].location];
+        } else {
+            /* Unrelated; must be rejected */
+            domain = [@"." stringByAppendingString: [self siteWithIndex: 1000 + [self nextBelow: 1000]]];
+        }
+
+        NSHTTPCookie *cookie = [NSHTTPCookie cookieWithProperties: @{
+            NSHTTPCookieDomain : domain,
+            NSHTTPCookieName : @"name",
+            NSHTTPCookiePath : @"/",
+            NSHTTPCookieValue : @"val"
+        }];
+        NSURL *url = [NSURL URLWithString: [NSString stringWithFormat: @"http://%@/", host]];
+
+        [cases addObject: @[cookie, url]];
+    }
+
+    return cases;
+}
+
+/**
+ * Return @a count hostnames, approximately half of which are drawn from a list of real hostnames. The remainder are
+ * random names under a mix of standard, wildcard, exception, and unlisted suffixes, along with IP address literals.
+ *
+ * @param count The number of hostnames to generate.
+ */
+- (NSArray *) hostnamesWithCount: (NSUInteger) count {
+    NSMutableArray *hostnames = [NSMutableArray arrayWithCapacity: count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSUInteger roll = [self nextBelow: 20];
+        if (roll < 10) {
+            [hostnames addObject: @(ANTBenchmarkRealHostnames[[self nextBelow: ANT_BENCHMARK_COUNT(ANTBenchmarkRealHostnames)]])];
+        } else if (roll < 11) {
+            [hostnames addObject: [NSString stringWithFormat: @"%lu.%lu.%lu.%lu", (unsigned long) [self nextBelow: 256],
+                                   (unsigned long) [self nextBelow: 256], (unsigned long) [self nextBelow: 256], (unsigned long) [self nextBelow: 256]]];
+        } else {
+            NSMutableString *hostname = [NSMutableString string];
+            NSUInteger labels = 1 + [self nextBelow: 3];
+            for (NSUInteger j = 0; j < labels; j++)
+                [hostname appendFormat: @"%@.", [self labelWithMinLength: 3 maxLength: 12]];
+            [hostname appendFormat: @"%s", ANTBenchmarkRandomSuffixes[[self nextBelow: ANT_BENCHMARK_COUNT(ANTBenchmarkRandomSuffixes)]]];
+
+            [hostnames addObject: hostname];
+        }
+    }
+
+    return hostnames;
+}
+
+@end
@@ -0,0 +1,298 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2013 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <getopt.h>
+
+#import "ANTBenchmark.h"
+#import "ANTBenchmarkCorpus.h"
+#import "ANTCookieJar.h"
+#import "ANTPublicSuffix.h"
+
+/** A rule of the legacy gperf(1) public suffix table; see Dependencies/effective_tld_names/README.txt. */
+struct TLDRule {
+    int name;
+    int type;
+};
+
+/* Generated by 'make gperf' in Dependencies/effective_tld_names, and built into the benchmarks only; the application
+ * uses the DAFSA in ANTEffectiveTLDNames.c. */
+const struct TLDRule *ANTTopLevelDomainTableLookup (const char *str, unsigned int len);
+
+/** The number of distinct inputs (hostnames, URLs, or validation cases) used by each benchmark. */
+static const NSUInteger ANTBenchmarkInputCount = 10000;
+
+/** The corpus seed. Every benchmark generates its inputs from the same seed, so that results are comparable across runs
+ * and unaffected by the benchmark filter. */
+static const uint32_t ANTBenchmarkSeed = 0x414e5442;
+
+/**
+ * Benchmark configuration, as parsed from the command line.
+ */
+typedef struct ANTBenchmarkOptions {
+    /** The maximum number of concurrent threads. */
+    NSUInteger maxThreads;
+
+    /** The maximum jar size, in cookies. */
+    NSUInteger maxSize;
+
+    /** If non-nil, only benchmarks whose names contain this string are run. */
+    __unsafe_unretained NSString *filter;
+
+    /** If YES, results are written as CSV. */
+    BOOL csv;
+} ANTBenchmarkOptions;
+
+/**
+ * Write the command line usage to stderr.
+ */
+static void ANTBenchmarkPrintUsage (const char *progname) {
+    fprintf(stderr, "Usage: %s [-t max threads] [-s max jar size] [-d seconds per measurement] [-f name filter] [-c]\n", progname);
+}
+
+/**
+ * Return YES if the benchmark @a name should be run.
+ */
+static BOOL ANTBenchmarkEnabled (const ANTBenchmarkOptions *options, NSString *name) {
+    return options->filter == nil || [name rangeOfString: options->filter].location != NSNotFound;
+}
+
+/**
+ * Write @a result to stdout.
+ */
+static void ANTBenchmarkPrint (const ANTBenchmarkOptions *options, ANTBenchmarkResult *result) {
+    if (options->csv) {
+        printf("%s,%lu,%lu,%llu,%.1f,%.1f,%.1f,%.2f\n", [result.name UTF8String], (unsigned long) result.size, (unsigned long) result.threads,
+               (unsigned long long) result.operations, result.nsPerOperation, result.p50, result.p99, result.allocationsPerOperation);
+    } else {
+        printf("%-36s %8lu %8lu %12.1f %12.1f %12.1f %12.2f\n", [result.name UTF8String], (unsigned long) result.size, (unsigned long) result.threads,
+               result.nsPerOperation, result.p50, result.p99, result.allocationsPerOperation);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Measure @a operation with 1, 2, 4, ... up to the maximum number of threads, printing each result.
+ */
+static void ANTBenchmarkRun (const ANTBenchmarkOptions *options, ANTBenchmarkRunner *runner, NSString *name, NSUInteger size, ANTBenchmarkOperation operation) {
+    if (!ANTBenchmarkEnabled(options, name))
+        return;
+
+    for (NSUInteger step = 1;; step *= 2) {
+        NSUInteger threads = MIN(step, options->maxThreads);
+        @autoreleasepool {
+            ANTBenchmarkPrint(options, [runner measure: name size: size threads: threads operation: operation]);
+        }
+
+        if (threads == options->maxThreads)
+            break;
+    }
+}
+
+/**
+ * Return the suffix of @a name following its first label, or NULL if @a name has a single label.
+ */
+static const char *ANTBenchmarkNextSuffix (const char *name) {
+    const char *dot = strchr(name, '.');
+    return dot != NULL ? dot + 1 : NULL;
+}
+
+/**
+ * Run the public suffix benchmarks.
+ */
+static void ANTBenchmarkPublicSuffix (const ANTBenchmarkOptions *options, ANTBenchmarkRunner *runner) {
+    if (!ANTBenchmarkEnabled(options, @"psl.length") && !ANTBenchmarkEnabled(options, @"psl.isIPAddress") &&
+        !ANTBenchmarkEnabled(options, @"psl.rule"))
+    {
+        return;
+    }
+
+    ANTBenchmarkCorpus *corpus = [[ANTBenchmarkCorpus alloc] initWithSeed: ANTBenchmarkSeed];
+    NSArray *hostnames = [corpus hostnamesWithCount: ANTBenchmarkInputCount];
+
+    /* Pre-encode the hostnames; only the lookup is measured. */
+    NSUInteger count = hostnames.count;
+    const char **names = malloc(sizeof(char *) * count);
+    size_t *lengths = malloc(sizeof(size_t) * count);
+    for (NSUInteger i = 0; i < count; i++) {
+        names[i] = strdup([hostnames[i] UTF8String]);
+        lengths[i] = strlen(names[i]);
+    }
+
+    ANTBenchmarkRun(options, runner, @"psl.length", 0, ^(NSUInteger thread, NSUInteger iteration) {
+        NSUInteger i = (thread * 7919 + iteration) % count;
+        bool known;
+        ANTPublicSuffixLength(names[i], lengths[i], &known);
+    });
+
+    ANTBenchmarkRun(options, runner, @"psl.isIPAddress", 0, ^(NSUInteger thread, NSUInteger iteration) {
+        NSUInteger i = (thread * 7919 + iteration) % count;
+        ANTPublicSuffixIsIPAddress(names[i], lengths[i]);
+    });
+
+    /* Exact rule lookups of every suffix of a hostname, as performed by the gperf-based suffix walk that the DAFSA
+     * replaced. Both tables are given identical inputs. */
+    ANTBenchmarkRun(options, runner, @"psl.rule.dafsa", 0, ^(NSUInteger thread, NSUInteger iteration) {
+        NSUInteger i = (thread * 7919 + iteration) % count;
+        for (const char *suffix = names[i]; suffix != NULL; suffix = ANTBenchmarkNextSuffix(suffix))
+            ANTPublicSuffixLookupRule(suffix, lengths[i] - (size_t) (suffix - names[i]));
+    });
+
+    ANTBenchmarkRun(options, runner, @"psl.rule.gperf", 0, ^(NSUInteger thread, NSUInteger iteration) {
+        NSUInteger i = (thread * 7919 + iteration) % count;
+        for (const char *suffix = names[i]; suffix != NULL; suffix = ANTBenchmarkNextSuffix(suffix))
+            ANTTopLevelDomainTableLookup(suffix, (unsigned int) (lengths[i] - (size_t) (suffix - names[i])));
+    });
+
+    for (NSUInteger i = 0; i < count; i++)
+        free((void *) names[i]);
+    free(names);
+    free(lengths);
+}
+
+/**
+ * Run the cookie validation benchmarks.
+ */
+static void ANTBenchmarkValidation (const ANTBenchmarkOptions *options, ANTBenchmarkRunner *runner) {
+    if (!ANTBenchmarkEnabled(options, @"validate.cookie"))
+        return;
+
+    ANTBenchmarkCorpus *corpus = [[ANTBenchmarkCorpus alloc] initWithSeed: ANTBenchmarkSeed];
+    NSArray *cases = [corpus validationCasesWithCount: ANTBenchmarkInputCount];
+    NSUInteger count = cases.count;
+
+    ANTBenchmarkRun(options, runner, @"validate.cookie", 0, ^(NSUInteger thread, NSUInteger iteration) {
+        NSArray *testCase = cases[(thread * 7919 + iteration) % count];
+        [ANTCookieJar validateCookie: testCase[0] forURL: testCase[1]];
+    });
+}
+
+/**
+ * Run the cookie jar benchmarks against a jar of @a size cookies.
+ *
+ * @param kind The benchmark name prefix.
+ * @param jar An empty jar.
+ * @param size The number of cookies with which @a jar will be populated.
+ */
+static void ANTBenchmarkJar (const ANTBenchmarkOptions *options, ANTBenchmarkRunner *runner, NSString *kind, ANTCookieJar *jar, NSUInteger size) {
+    NSString *cookiesForURL = [kind stringByAppendingString: @".cookiesForURL"];
+    NSString *requestHeaderFields = [kind stringByAppendingString: @".requestHeaderFieldsForURL"];
+    NSString *setCookie = [kind stringByAppendingString: @".setCookie"];
+    NSString *mutableCopy = [kind stringByAppendingString: @".mutableCopy"];
+    if (!ANTBenchmarkEnabled(options, cookiesForURL) && !ANTBenchmarkEnabled(options, requestHeaderFields) &&
+        !ANTBenchmarkEnabled(options, setCookie) && !ANTBenchmarkEnabled(options, mutableCopy))
+    {
+        return;
+    }
+
+    ANTBenchmarkCorpus *corpus = [[ANTBenchmarkCorpus alloc] initWithSeed: ANTBenchmarkSeed];
+    NSArray *cookies = [corpus cookiesWithCount: size];
+    NSArray *urls = [corpus requestURLsWithCount: ANTBenchmarkInputCount cookieCount: size];
+    NSUInteger urlCount = urls.count;
+
+    for (NSHTTPCookie *cookie in cookies)
+        [jar setCookie: cookie];
+
+    ANTBenchmarkRun(options, runner, cookiesForURL, size, ^(NSUInteger thread, NSUInteger iteration) {
+        [jar cookiesForURL: urls[(thread * 7919 + iteration) % urlCount]];
+    });
+
+    ANTBenchmarkRun(options, runner, requestHeaderFields, size, ^(NSUInteger thread, NSUInteger iteration) {
+        [jar requestHeaderFieldsForURL: urls[(thread * 7919 + iteration) % urlCount]];
+    });
+
+    /* Re-set existing cookies, so that the jar's size remains constant */
+    ANTBenchmarkRun(options, runner, setCookie, size, ^(NSUInteger thread, NSUInteger iteration) {
+        [jar setCookie: cookies[(thread * 7919 + iteration) % size]];
+    });
+
+    ANTBenchmarkRun(options, runner, mutableCopy, size, ^(NSUInteger thread, NSUInteger iteration) {
+        (void) [jar mutableCopy];
+    });
+}
+
+int main (int argc, char * const argv[]) {
+    @autoreleasepool {
+        ANTBenchmarkRunner *runner = [ANTBenchmarkRunner new];
+        ANTBenchmarkOptions options = {
+            .maxThreads = [[NSProcessInfo processInfo] activeProcessorCount],
+            .maxSize = 100000,
+            .filter = nil,
+            .csv = NO
+        };
+        /* Holds the reference borrowed by options.filter */
+        NSString *filter = nil;
+
+        int ch;
+        while ((ch = getopt(argc, argv, "t:s:d:f:ch")) != -1) {
+            switch (ch) {
+                case 't':
+                    options.maxThreads = (NSUInteger) MAX(1, strtol(optarg, NULL, 10));
+                    break;
+                case 's':
+                    options.maxSize = (NSUInteger) MAX(0, strtol(optarg, NULL, 10));
+                    break;
+                case 'd':
+                    runner.duration = MAX(0.01, strtod(optarg, NULL));
+                    break;
+                case 'f':
+                    filter = @(optarg);
+                    options.filter = filter;
+                    break;
+                case 'c':
+                    options.csv = YES;
+                    break;
+                case 'h':
+                default:
+                    ANTBenchmarkPrintUsage(argv[0]);
+                    return ch == 'h' ? 0 : 1;
+            }
+        }
+
+        if (!runner.countsAllocations)
+            fprintf(stderr, "Allocation counting is not supported; allocs/op will be reported as -1\n");
+
+        if (options.csv)
+            printf("benchmark,size,threads,operations,ns_per_op,p50_ns,p99_ns,allocs_per_op\n");
+        else
+            printf("%-36s %8s %8s %12s %12s %12s %12s\n", "benchmark", "size", "threads", "ns/op", "p50 ns", "p99 ns", "allocs/op");
+
+        ANTBenchmarkPublicSuffix(&options, runner);
+        ANTBenchmarkValidation(&options, runner);
+
+        for (NSUInteger size = 100; size <= options.maxSize; size *= 10) {
+            @autoreleasepool {
+                /* The jars are unbounded, so that every generated cookie is retained. */
+                ANTBenchmarkJar(&options, runner, @"jar", [[ANTCookieJar alloc] initWithMaxCookies: NSUIntegerMax maxCookiesPerDomain: NSUIntegerMax], size);
+                ANTBenchmarkJar(&options, runner, @"sharded", [[ANTCookieJar alloc] initShardedWithMaxCookies: NSUIntegerMax maxCookiesPerDomain: NSUIntegerMax], size);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -1,22 +1,39 @@
 #!/usr/bin/python
+#
+# Generates the public suffix tables from effective_tld_names.dat.
+#
+# By default, the rules are emitted as a C byte array encoding a DAFSA (deterministic acyclic
+# finite state automaton) of the reversed rule names, in the format used by Chromium's
+# make_dafsa.py. Walking the automaton from the end of a domain name matches every rule that
+# is a suffix of the name in a single pass.
+#
+# With --binary, the same DAFSA is emitted in the binary format loaded at runtime by
+# ANTPublicSuffixLoadTable(); see "Binary output" below.
+#
+# With --gperf, the legacy gperf(1) keyword input is emitted instead.
 
-import fileinput
+from __future__ import print_function
+
+import io
+import struct
+import sys
 
 TYPE_STANDARD_RULE = 0
 TYPE_WILDCARD_RULE = 1
 TYPE_EXCEPTION_RULE = 2
 
-def process (line):
+def parse (line):
+    """Parse a single rule line, returning a (rule, type) tuple, or None if the line is not a rule."""
     rule = line.strip()
-    
+
     # Skip empty lines
     if len(rule) == 0:
-        return
-    
+        return None
+
     # Skip comments
     if rule.startswith("//"):
-        return
-    
+        return None
+
     # Handle special rule types
     if rule.startswith("!"):
         type = TYPE_EXCEPTION_RULE
@@ -27,10 +44,32 @@ def process (line):
     else:
         type = TYPE_STANDARD_RULE
 
-    print "%s,%d" % (rule, type)
+    return (rule, type)
+
+def to_ascii (rule):
+    """Convert an internationalized rule to its ASCII (punycode) form. Returns None if the rule can not be encoded."""
+    try:
+        return rule.encode("idna").decode("ascii").lower()
+    except UnicodeError:
+        return None
+
+def read_rules (path):
+    """Read all rules from @path, returning a list of (rule, type) tuples."""
+    rules = []
+    with io.open(path, encoding="utf-8") as f:
+        for line in f:
+            parsed = parse(line)
+            if parsed is not None:
+                rules.append(parsed)
+    return rules
+
+#
+# gperf output
+#
 
-# Output standard header
-print """\
+def emit_gperf (rules):
+    # Output standard header
+    print("""\
 %define lookup-function-name ANTTopLevelDomainTableLookup
 %compare-lengths
 %readonly-tables
@@ -50,16 +89,258 @@ struct TLDRule {
     int name;
     int type;
 };
-%%\
-"""
+%%""")
 
-# Process input
-for line in fileinput.input():
-    process(line)
+    for (rule, type) in rules:
+        line = "%s,%d" % (rule, type)
+        if sys.version_info[0] < 3:
+            line = line.encode("utf-8")
+        print(line)
 
-
-# Output standard footer
-print """\
+    # Output standard footer
+    print("""\
 %%
 #pragma clang diagnostic pop
-"""
+""")
+
+#
+# DAFSA output
+#
+# A DAFSA node is a (label, children) tuple; a child of None marks the end of a word. Each word
+# is terminated by a single character label holding the word's return value (0-15), which the
+# encoder stores with the high bit set.
+#
+
+def to_dafsa (words):
+    """Generate a minimal DAFSA accepting @words.
+
+    The words are inserted into a trie, which is then minimized bottom-up by merging structurally
+    identical nodes. For an acyclic automaton built from a trie, this yields the minimal automaton
+    in time linear in the total length of the words."""
+    trie = {}
+    for word in words:
+        node = trie
+        for c in word[:-1]:
+            if not 0x1F < ord(c) < 0x80:
+                raise ValueError("Rules must be printable ASCII: %r" % word)
+            node = node.setdefault(c, {})
+
+        # The final character of each word is its return value. This is stored as a control character,
+        # so that it can not be confused with a label character of a longer word.
+        node.setdefault(chr(ord(word[-1]) & 0x0F), {})
+
+    register = {}
+    serials = {}
+
+    def minimize (label, children):
+        if not children:
+            nodes = [None]
+            key = (label, ())
+        else:
+            nodes = [minimize(c, children[c]) for c in sorted(children)]
+            key = (label, tuple(serials[id(n)] for n in nodes))
+
+        node = register.get(key)
+        if node is None:
+            node = (label, nodes)
+            register[key] = node
+            serials[id(node)] = len(serials)
+        return node
+
+    return [minimize(c, trie[c]) for c in sorted(trie)]
+
+def join_labels (dafsa):
+    """Generate a new DAFSA in which nodes with a single, singly referenced child are merged with that child."""
+    parentcount = { id(None): 2 }
+    nodemap = { id(None): None }
+
+    def count_parents (node):
+        if id(node) in parentcount:
+            parentcount[id(node)] += 1
+        else:
+            parentcount[id(node)] = 1
+            for child in node[1]:
+                count_parents(child)
+
+    def join (node):
+        if id(node) not in nodemap:
+            children = [join(child) for child in node[1]]
+            if len(children) == 1 and parentcount[id(node[1][0])] == 1:
+                child = children[0]
+                nodemap[id(node)] = (node[0] + child[0], child[1])
+            else:
+                nodemap[id(node)] = (node[0], children)
+        return nodemap[id(node)]
+
+    for node in dafsa:
+        count_parents(node)
+    return [join(node) for node in dafsa]
+
+def top_sort (dafsa):
+    """Return the DAFSA's nodes in topological order."""
+    incoming = {}
+
+    def count_incoming (node):
+        if node:
+            if id(node) not in incoming:
+                incoming[id(node)] = 1
+                for child in node[1]:
+                    count_incoming(child)
+            else:
+                incoming[id(node)] += 1
+
+    for node in dafsa:
+        count_incoming(node)
+    for node in dafsa:
+        incoming[id(node)] -= 1
+
+    waiting = [node for node in dafsa if incoming[id(node)] == 0]
+    nodes = []
+    while waiting:
+        node = waiting.pop()
+        nodes.append(node)
+        for child in node[1]:
+            if child:
+                incoming[id(child)] -= 1
+                if incoming[id(child)] == 0:
+                    waiting.append(child)
+    return nodes
+
+def encode_links (children, offsets, current):
+    """Encode a node's child list as one, two, or three byte offsets."""
+    if not children[0]:
+        # Return value nodes have no children
+        return []
+
+    guess = 3 * len(children)
+    children = sorted(children, key = lambda x: -offsets[id(x)])
+    while True:
+        offset = current + guess
+        buf = []
+        for child in children:
+            last = len(buf)
+            distance = offset - offsets[id(child)]
+            assert distance > 0 and distance < (1 << 21)
+
+            if distance < (1 << 6):
+                # 6-bit offset: "s0xxxxxx"
+                buf.append(distance)
+            elif distance < (1 << 13):
+                # 13-bit offset: "s10xxxxx xxxxxxxx"
+                buf.append(0x40 | (distance >> 8))
+                buf.append(distance & 0xFF)
+            else:
+                # 21-bit offset: "s11xxxxx xxxxxxxx xxxxxxxx"
+                buf.append(0x60 | (distance >> 16))
+                buf.append((distance >> 8) & 0xFF)
+                buf.append(distance & 0xFF)
+
+            # The first offset is relative to the end of the list; subsequent offsets are relative to the previous child.
+            offset -= distance
+
+        if len(buf) == guess:
+            break
+        guess = len(buf)
+
+    # Flag the final offset in the list
+    buf[last] |= (1 << 7)
+    buf.reverse()
+    return buf
+
+def encode_prefix (label):
+    """Encode a label that is immediately followed by its only child's label."""
+    return [ord(c) for c in reversed(label)]
+
+def encode_label (label):
+    """Encode a label, flagging its final character."""
+    buf = encode_prefix(label)
+    buf[0] |= (1 << 7)
+    return buf
+
+def encode (dafsa):
+    """Encode a DAFSA as a list of bytes."""
+    output = []
+    offsets = {}
+
+    for node in reversed(top_sort(dafsa)):
+        if len(node[1]) == 1 and node[1][0] and offsets[id(node[1][0])] == len(output):
+            output.extend(encode_prefix(node[0]))
+        else:
+            output.extend(encode_links(node[1], offsets, len(output)))
+            output.extend(encode_label(node[0]))
+        offsets[id(node)] = len(output)
+
+    output.extend(encode_links(dafsa, offsets, len(output)))
+    output.reverse()
+    return output
+
+def build_dafsa (rules):
+    """Return the encoded DAFSA for @rules as a list of bytes, along with the number of rules encoded."""
+    words = set()
+    for (rule, type) in rules:
+        name = to_ascii(rule)
+        if name is None:
+            print("Skipping rule that can not be represented in ASCII: %r" % rule, file=sys.stderr)
+            continue
+
+        # Names are stored reversed, so that the automaton may be walked from the end of a domain name
+        words.add(name[::-1] + chr(ord("0") + type))
+
+    return (encode(join_labels(to_dafsa(sorted(words)))), len(words))
+
+def emit_dafsa (rules):
+    (output, count) = build_dafsa(rules)
+
+    print("/* Generated by process.py from effective_tld_names.dat. Do not edit. */")
+    print("")
+    print("/* A DAFSA of %d reversed public suffix rules. See process.py for a description of the encoding. */" % count)
+    print("static const unsigned char ANTEffectiveTLDNamesDAFSA[%d] = {" % len(output))
+    for i in range(0, len(output), 12):
+        print("    " + ", ".join("0x%02x" % b for b in output[i:i + 12]) + ",")
+    print("};")
+
+#
+# Binary output
+#
+# The binary format may be loaded at runtime by ANTPublicSuffixLoadTable(). All integers are little-endian:
+#
+#   magic    4 bytes   "APSL"
+#   version  uint32    BINARY_VERSION
+#   length   uint32    the length of the DAFSA, in bytes
+#   dafsa    length bytes
+#
+
+BINARY_MAGIC = b"APSL"
+BINARY_VERSION = 1
+
+def emit_binary (rules):
+    (output, count) = build_dafsa(rules)
+
+    data = bytearray(BINARY_MAGIC)
+    data += struct.pack("<II", BINARY_VERSION, len(output))
+    data += bytearray(output)
+
+    out = getattr(sys.stdout, "buffer", sys.stdout)
+    out.write(bytes(data))
+    out.flush()
+
+def main ():
+    args = sys.argv[1:]
+    mode = None
+    if len(args) > 0 and args[0] in ("--gperf", "--binary"):
+        mode = args[0]
+        args = args[1:]
+
+    if len(args) != 1:
+        print("Usage: %s [--gperf | --binary] <effective_tld_names.dat>" % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+
+    rules = read_rules(args[0])
+    if mode == "--gperf":
+        emit_gperf(rules)
+    elif mode == "--binary":
+        emit_binary(rules)
+    else:
+        emit_dafsa(rules)
+
+main()